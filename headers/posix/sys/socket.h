@@ -125,6 +125,7 @@ struct msghdr {
 #define MSG_MCAST		0x0200	/* this message rec'd as multicast */
 #define	MSG_EOF			0x0400	/* data completes connection */
 #define MSG_NOSIGNAL	0x0800	/* don't raise SIGPIPE if socket is closed */
+#define MSG_ZEROCOPY	0x1000	/* send the data without copying it */
 
 struct cmsghdr {
 	socklen_t	cmsg_len;
@@ -183,6 +184,7 @@ ssize_t recvfrom(int socket, void *buffer, size_t bufferLength, int flags,
 			struct sockaddr *address, socklen_t *_addressLength);
 ssize_t recvmsg(int socket, struct msghdr *message, int flags);
 ssize_t send(int socket, const void *buffer, size_t length, int flags);
+ssize_t	sendfile(int socket, int fd, off_t *_offset, size_t count);
 ssize_t	sendmsg(int socket, const struct msghdr *message, int flags);
 ssize_t sendto(int socket, const void *message, size_t length, int flags,
 			const struct sockaddr *address, socklen_t addressLength);
@@ -26,6 +26,7 @@
 #	include "fssh_auto_deleter.h"
 #else
 #	include <dirent.h>
+#	include <stdio.h>
 #	include <stdlib.h>
 #	include <string.h>
 
@@ -96,6 +97,14 @@ enum ops {
 };
 
 
+// An equation that is checked for every entry found through another one
+// may first collect the IDs of all nodes that match it from its own index,
+// if its estimated score is small enough. Entries that are not among those
+// candidates can then be rejected without having to load their node.
+static const int32 kMaxCandidateScore = 256;
+static const int32 kMaxCandidates = 16384;
+
+
 template<typename QueryPolicy>
 union value {
 	int64	Int64;
@@ -108,6 +117,47 @@ union value {
 };
 
 
+/*!	Collects a query plan in a buffer of a fixed size. The text is cut off
+	when it does not fit, but its full length is still counted.
+*/
+class PlanWriter {
+public:
+	PlanWriter(char* buffer, size_t bufferSize)
+		:
+		fBuffer(buffer),
+		fBufferSize(bufferSize),
+		fLength(0)
+	{
+		if (bufferSize > 0)
+			buffer[0] = '\0';
+	}
+
+	void Append(const char* string)
+	{
+		if (fLength < fBufferSize)
+			strlcpy(fBuffer + fLength, string, fBufferSize - fLength);
+		fLength += strlen(string);
+	}
+
+	void Append(int64 number)
+	{
+		char buffer[32];
+		snprintf(buffer, sizeof(buffer), "%" B_PRId64, number);
+		Append(buffer);
+	}
+
+	size_t Length() const
+	{
+		return fLength;
+	}
+
+private:
+	char*	fBuffer;
+	size_t	fBufferSize;
+	size_t	fLength;
+};
+
+
 template<typename QueryPolicy>
 class Query {
 public:
@@ -131,6 +181,8 @@ public:
 			status_t		Rewind();
 	inline	status_t		GetNextEntry(struct dirent* dirent, size_t size);
 
+			ssize_t			Explain(char* buffer, size_t bufferSize);
+
 			void			LiveUpdate(Entry* entry, Node* node,
 								const char* attribute, int32 type,
 								const uint8* oldKey, size_t oldLength,
@@ -147,6 +199,8 @@ public:
 								{ return fFlags; }
 
 private:
+			status_t		_PushEquations(
+								Stack<Equation<QueryPolicy>*>& stack);
 			status_t		_GetNextEntry(struct dirent* dirent, size_t size);
 			void			_EvaluateLiveUpdate(Entry* entry, Node* node,
 								const char* attribute, int32 type,
@@ -200,11 +254,19 @@ public:
 
 	virtual	void		CalculateScore(Index& index) = 0;
 	virtual	int32		Score() const = 0;
+	virtual	int32		MatchCost() const = 0;
+
+	virtual	bool		IsCandidate(ino_t id) const = 0;
+	virtual	bool		IsExhausted() const = 0;
+	virtual	void		Reset() = 0;
 
 	virtual	status_t	InitCheck() = 0;
 
 	virtual	bool		NeedsEntry() = 0;
 
+	virtual	void		Describe(PlanWriter& writer) const = 0;
+	virtual	void		DescribeCandidates(PlanWriter& writer) const = 0;
+
 #ifdef DEBUG_QUERY
 	virtual	void		PrintToStream() = 0;
 #endif
@@ -254,15 +316,27 @@ public:
 
 			status_t	PrepareQuery(Context* context, Index& index,
 							IndexIterator** iterator, bool queryNonIndexed);
+			void		PrepareCandidates(Context* context);
 			status_t	GetNextMatching(Context* context,
 							IndexIterator* iterator, struct dirent* dirent,
 							size_t bufferSize);
 
 	virtual	void		CalculateScore(Index &index);
 	virtual	int32		Score() const { return fScore; }
+	virtual	int32		MatchCost() const;
+
+	virtual	bool		IsCandidate(ino_t id) const;
+	virtual	bool		IsExhausted() const { return fExhausted; }
+			void		SetExhausted() { fExhausted = true; }
+	virtual	void		Reset();
 
 	virtual	bool		NeedsEntry();
 
+	virtual	void		Describe(PlanWriter& writer) const;
+	virtual	void		DescribeCandidates(PlanWriter& writer) const;
+			void		Explain(PlanWriter& writer, Index& index,
+							bool queryNonIndexed) const;
+
 #ifdef DEBUG_QUERY
 	virtual	void		PrintToStream();
 #endif
@@ -276,6 +350,13 @@ private:
 			bool		CompareTo(const uint8* value, size_t size);
 			uint8*		Value() const { return (uint8*)&fValue; }
 
+			status_t	_EstimateScore(Index& index, int32 size);
+			bool		_CanCollectCandidates() const;
+			status_t	_CollectCandidates(Context* context, Index& index);
+	static	uint32		_CandidateSlot(ino_t id, uint32 slots);
+			bool		_IsCandidateOfRest(ino_t id) const;
+			bool		_WasFoundBefore(Entry* entry) const;
+
 			char*		fAttribute;
 			char*		fString;
 			union value<QueryPolicy> fValue;
@@ -284,7 +365,16 @@ private:
 			bool		fIsPattern;
 
 			int32		fScore;
+			bool		fScoreEstimated;
 			bool		fHasIndex;
+
+			bool		fExhausted;
+			bool		fFiltered;
+			bool		fCandidatesCollected;
+			ino_t*		fCandidates;
+				// a hash table, or NULL
+			uint32		fCandidateSlots;
+			int32		fCandidateCount;
 };
 
 
@@ -315,11 +405,19 @@ public:
 
 	virtual	void		CalculateScore(Index& index);
 	virtual	int32		Score() const;
+	virtual	int32		MatchCost() const;
+
+	virtual	bool		IsCandidate(ino_t id) const;
+	virtual	bool		IsExhausted() const;
+	virtual	void		Reset();
 
 	virtual	status_t	InitCheck();
 
 	virtual	bool		NeedsEntry();
 
+	virtual	void		Describe(PlanWriter& writer) const;
+	virtual	void		DescribeCandidates(PlanWriter& writer) const;
+
 #ifdef DEBUG_QUERY
 	virtual	void		PrintToStream();
 #endif
@@ -374,7 +472,14 @@ Equation<QueryPolicy>::Equation(const char** expr)
 	fString(NULL),
 	fType(0),
 	fIsPattern(false),
-	fScore(INT32_MAX)
+	fScore(INT32_MAX),
+	fScoreEstimated(false),
+	fExhausted(false),
+	fFiltered(false),
+	fCandidatesCollected(false),
+	fCandidates(NULL),
+	fCandidateSlots(0),
+	fCandidateCount(-1)
 {
 	const char* string = *expr;
 	const char* start = string;
@@ -503,6 +608,7 @@ Equation<QueryPolicy>::~Equation()
 {
 	free(fAttribute);
 	free(fString);
+	free(fCandidates);
 }
 
 
@@ -772,12 +878,19 @@ Equation<QueryPolicy>::CalculateScore(Index &index)
 	}
 
 	fScore = QueryPolicy::IndexGetSize(index);
+	fScoreEstimated = false;
 
 	if (Term<QueryPolicy>::fOp == OP_UNEQUAL) {
 		// we'll need to scan the whole index
 		return;
 	}
 
+	// ask the index where our value is, if it can tell us
+	if (_EstimateScore(index, fScore) == B_OK) {
+		fScoreEstimated = true;
+		return;
+	}
+
 	// if we have a pattern, how much does it help our search?
 	if (fIsPattern) {
 		const int32 firstSymbolIndex = getFirstPatternSymbol(fString);
@@ -798,6 +911,98 @@ Equation<QueryPolicy>::CalculateScore(Index &index)
 }
 
 
+/*!	Estimates the score from the position of the value within the index, if
+	the index is able to tell. The score of a pattern is the range of keys
+	that start with the part of it before the first wildcard.
+*/
+template<typename QueryPolicy>
+status_t
+Equation<QueryPolicy>::_EstimateScore(Index& index, int32 size)
+{
+	status_t status = ConvertValue(QueryPolicy::IndexGetType(index),
+		QueryPolicy::IndexGetKeySize(index));
+	if (status != B_OK)
+		return status;
+
+	size_t keySize = fSize;
+	if (fIsPattern) {
+		int32 prefixLength = getFirstPatternSymbol(fString);
+		if (prefixLength <= 0 || (size_t)prefixLength > fSize
+			|| memchr(fString, '\\', prefixLength) != NULL)
+			return B_NOT_SUPPORTED;
+
+		keySize = prefixLength;
+	} else if (fType == B_STRING_TYPE && keySize == 0) {
+		// the empty string, see PrepareQuery()
+		keySize = 1;
+	}
+
+	int32 start = 0;
+	int32 end = size;
+
+	switch (Term<QueryPolicy>::fOp) {
+		case OP_EQUAL:
+		{
+			status = QueryPolicy::IndexEstimatePosition(index, Value(),
+				keySize, &start);
+			if (status != B_OK)
+				return status;
+			if (!fIsPattern) {
+				end = start;
+				break;
+			}
+
+			// the keys with the prefix end before the next possible prefix
+			uint8 next[QueryPolicy::kMaxFileNameLength];
+			memcpy(next, Value(), keySize);
+			while (keySize > 0 && next[keySize - 1] == 0xff)
+				keySize--;
+			if (keySize == 0)
+				break;
+
+			next[keySize - 1]++;
+			status = QueryPolicy::IndexEstimatePosition(index, next, keySize,
+				&end);
+			break;
+		}
+		case OP_GREATER_THAN:
+		case OP_GREATER_THAN_OR_EQUAL:
+			status = QueryPolicy::IndexEstimatePosition(index, Value(),
+				keySize, &start);
+			break;
+		case OP_LESS_THAN:
+		case OP_LESS_THAN_OR_EQUAL:
+			status = QueryPolicy::IndexEstimatePosition(index, Value(),
+				keySize, &end);
+			break;
+		default:
+			return B_BAD_VALUE;
+	}
+	if (status != B_OK)
+		return status;
+
+	fScore = end > start ? end - start : 1;
+	return B_OK;
+}
+
+
+/*!	Returns how expensive it is to match a node against this equation:
+	the size, and the modification time are part of the node, the name needs
+	its entry, and any other attribute might have to be read first.
+*/
+template<typename QueryPolicy>
+int32
+Equation<QueryPolicy>::MatchCost() const
+{
+	if (!strcmp(fAttribute, "size") || !strcmp(fAttribute, "last_modified"))
+		return 0;
+	if (!strcmp(fAttribute, "name"))
+		return 1;
+
+	return 2;
+}
+
+
 template<typename QueryPolicy>
 status_t
 Equation<QueryPolicy>::PrepareQuery(Context* /*context*/, Index& index,
@@ -891,6 +1096,261 @@ Equation<QueryPolicy>::PrepareQuery(Context* /*context*/, Index& index,
 }
 
 
+/*!	Is called before the entries matching this equation are iterated.
+	Every equation an entry then has to match as well collects the nodes
+	that match it from its index, if that is cheap enough; entries that are
+	not among those candidates can then be skipped right away.
+*/
+template<typename QueryPolicy>
+void
+Equation<QueryPolicy>::PrepareCandidates(Context* context)
+{
+	fFiltered = false;
+
+	// start with the other sides of all &&-operators up in the tree
+	Stack<Term<QueryPolicy>*> stack;
+	for (Term<QueryPolicy>* term = this; term->Parent() != NULL;
+			term = term->Parent()) {
+		Operator<QueryPolicy>* parent
+			= (Operator<QueryPolicy>*)term->Parent();
+		if (parent->Op() != OP_AND)
+			continue;
+
+		stack.Push(parent->Left() == term ? parent->Right() : parent->Left());
+	}
+
+	Index index(context);
+
+	Term<QueryPolicy>* term;
+	while (stack.Pop(&term)) {
+		if (term->Op() == OP_AND) {
+			Operator<QueryPolicy>* op = (Operator<QueryPolicy>*)term;
+			stack.Push(op->Left());
+			stack.Push(op->Right());
+			continue;
+		}
+		if (term->Op() == OP_OR)
+			continue;
+
+		Equation<QueryPolicy>* equation = (Equation<QueryPolicy>*)term;
+		if (!equation->fCandidatesCollected
+			&& equation->_CanCollectCandidates()) {
+			equation->fCandidatesCollected = true;
+			equation->_CollectCandidates(context, index);
+		}
+		if (equation->fCandidateCount >= 0)
+			fFiltered = true;
+	}
+
+	QueryPolicy::IndexUnset(index);
+}
+
+
+template<typename QueryPolicy>
+bool
+Equation<QueryPolicy>::_CanCollectCandidates() const
+{
+	// only estimated scores are reliable enough
+	return fScoreEstimated && fScore <= kMaxCandidateScore;
+}
+
+
+/*!	Collects the IDs of all nodes that match this equation according to its
+	index, unless there are more than kMaxCandidates of them.
+*/
+template<typename QueryPolicy>
+status_t
+Equation<QueryPolicy>::_CollectCandidates(Context* context, Index& index)
+{
+	IndexIterator* iterator = NULL;
+	status_t status = PrepareQuery(context, index, &iterator, false);
+	if (iterator == NULL)
+		return status != B_OK ? status : B_ERROR;
+	if ((status != B_OK && status != B_ENTRY_NOT_FOUND) || !fHasIndex) {
+		QueryPolicy::IndexIteratorDelete(iterator);
+		return status != B_OK ? status : B_ENTRY_NOT_FOUND;
+	}
+
+	ino_t* candidates = NULL;
+	int32 count = 0;
+	int32 maxCount = 0;
+
+	while (true) {
+		union value<QueryPolicy> indexValue;
+		size_t keyLength;
+		size_t duplicate = 0;
+
+		status = QueryPolicy::IndexIteratorFetchNextEntry(iterator,
+			&indexValue, &keyLength, (size_t)sizeof(indexValue), &duplicate);
+		if (status != B_OK)
+			break;
+
+		// see GetNextMatching()
+		if (duplicate < 2 && !CompareTo((uint8*)&indexValue, keyLength)) {
+			if (Term<QueryPolicy>::fOp == OP_LESS_THAN
+				|| Term<QueryPolicy>::fOp == OP_LESS_THAN_OR_EQUAL
+				|| (Term<QueryPolicy>::fOp == OP_EQUAL && !fIsPattern)) {
+				status = B_ENTRY_NOT_FOUND;
+				break;
+			}
+
+			if (duplicate > 0)
+				QueryPolicy::IndexIteratorSkipDuplicates(iterator);
+			continue;
+		}
+
+		if (count == maxCount) {
+			if (count == kMaxCandidates) {
+				status = B_BUFFER_OVERFLOW;
+				break;
+			}
+
+			maxCount = maxCount == 0 ? 256 : maxCount * 2;
+			if (maxCount > kMaxCandidates)
+				maxCount = kMaxCandidates;
+
+			ino_t* newCandidates = (ino_t*)realloc(candidates,
+				maxCount * sizeof(ino_t));
+			if (newCandidates == NULL) {
+				status = B_NO_MEMORY;
+				break;
+			}
+			candidates = newCandidates;
+		}
+
+		candidates[count++] = QueryPolicy::IndexIteratorGetNodeID(iterator);
+	}
+
+	QueryPolicy::IndexIteratorDelete(iterator);
+
+	if (status != B_ENTRY_NOT_FOUND) {
+		free(candidates);
+		return status;
+	}
+
+	// put them into a hash table that is at most half full
+	uint32 slots = 16;
+	while (slots < (uint32)count * 2)
+		slots <<= 1;
+
+	ino_t* table = (ino_t*)malloc(slots * sizeof(ino_t));
+	if (table == NULL) {
+		free(candidates);
+		return B_NO_MEMORY;
+	}
+
+	for (uint32 i = 0; i < slots; i++)
+		table[i] = -1;
+
+	for (int32 i = 0; i < count; i++) {
+		uint32 slot = _CandidateSlot(candidates[i], slots);
+		while (table[slot] != -1 && table[slot] != candidates[i])
+			slot = (slot + 1) & (slots - 1);
+
+		table[slot] = candidates[i];
+	}
+
+	free(candidates);
+
+	fCandidates = table;
+	fCandidateSlots = slots;
+	fCandidateCount = count;
+	return B_OK;
+}
+
+
+template<typename QueryPolicy>
+/*static*/ uint32
+Equation<QueryPolicy>::_CandidateSlot(ino_t id, uint32 slots)
+{
+	return (uint32)(((uint64)id * 0x9e3779b97f4a7c15ULL) >> 32) & (slots - 1);
+}
+
+
+template<typename QueryPolicy>
+bool
+Equation<QueryPolicy>::IsCandidate(ino_t id) const
+{
+	if (fCandidateCount < 0)
+		return true;
+
+	for (uint32 slot = _CandidateSlot(id, fCandidateSlots);;
+			slot = (slot + 1) & (fCandidateSlots - 1)) {
+		if (fCandidates[slot] == id)
+			return true;
+		if (fCandidates[slot] == -1)
+			return false;
+	}
+}
+
+
+/*!	Returns whether the node could still match the rest of the expression,
+	according to the candidates collected in PrepareCandidates().
+*/
+template<typename QueryPolicy>
+bool
+Equation<QueryPolicy>::_IsCandidateOfRest(ino_t id) const
+{
+	for (const Term<QueryPolicy>* term = this; term->Parent() != NULL;
+			term = term->Parent()) {
+		Operator<QueryPolicy>* parent
+			= (Operator<QueryPolicy>*)term->Parent();
+		if (parent->Op() != OP_AND)
+			continue;
+
+		Term<QueryPolicy>* other
+			= parent->Left() == term ? parent->Right() : parent->Left();
+		if (!other->IsCandidate(id))
+			return false;
+	}
+
+	return true;
+}
+
+
+/*!	Returns whether the entry has already been returned while iterating the
+	other side of an ||-operator. That is the case when it matches a side
+	that has been iterated completely.
+*/
+template<typename QueryPolicy>
+bool
+Equation<QueryPolicy>::_WasFoundBefore(Entry* entry) const
+{
+	for (const Term<QueryPolicy>* term = this; term->Parent() != NULL;
+			term = term->Parent()) {
+		Operator<QueryPolicy>* parent
+			= (Operator<QueryPolicy>*)term->Parent();
+		if (parent->Op() != OP_OR)
+			continue;
+
+		Term<QueryPolicy>* other
+			= parent->Left() == term ? parent->Right() : parent->Left();
+		if (other->IsExhausted()
+			&& other->Match(entry, QueryPolicy::EntryGetNode(entry))
+				== MATCH_OK) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+template<typename QueryPolicy>
+void
+Equation<QueryPolicy>::Reset()
+{
+	fExhausted = false;
+	fFiltered = false;
+	fCandidatesCollected = false;
+
+	free(fCandidates);
+	fCandidates = NULL;
+	fCandidateSlots = 0;
+	fCandidateCount = -1;
+}
+
+
 template<typename QueryPolicy>
 status_t
 Equation<QueryPolicy>::GetNextMatching(Context* context,
@@ -924,6 +1384,13 @@ Equation<QueryPolicy>::GetNextMatching(Context* context,
 			continue;
 		}
 
+		// don't bother loading the node if the candidates of the rest of
+		// the expression already rule it out
+		if (fFiltered && !_IsCandidateOfRest(
+				QueryPolicy::IndexIteratorGetNodeID(iterator))) {
+			continue;
+		}
+
 		Entry* entry = NULL;
 		status = QueryPolicy::IndexIteratorGetEntry(context, iterator,
 			nodeHolder, &entry);
@@ -976,6 +1443,9 @@ Equation<QueryPolicy>::GetNextMatching(Context* context,
 			term = (Term<QueryPolicy>*)parent;
 		}
 
+		if (status == MATCH_OK && _WasFoundBefore(entry))
+			status = NO_MATCH;
+
 		if (status == MATCH_OK) {
 			ssize_t nameLength = QueryPolicy::EntryGetName(entry,
 				dirent->d_name,
@@ -1007,6 +1477,92 @@ Equation<QueryPolicy>::NeedsEntry()
 }
 
 
+template<typename QueryPolicy>
+void
+Equation<QueryPolicy>::Describe(PlanWriter& writer) const
+{
+	const char* symbol = "?";
+	switch (Term<QueryPolicy>::fOp) {
+		case OP_EQUAL: symbol = "=="; break;
+		case OP_UNEQUAL: symbol = "!="; break;
+		case OP_GREATER_THAN: symbol = ">"; break;
+		case OP_GREATER_THAN_OR_EQUAL: symbol = ">="; break;
+		case OP_LESS_THAN: symbol = "<"; break;
+		case OP_LESS_THAN_OR_EQUAL: symbol = "<="; break;
+	}
+
+	writer.Append(fAttribute);
+	writer.Append(symbol);
+	writer.Append("\"");
+	writer.Append(fString);
+	writer.Append("\"");
+}
+
+
+template<typename QueryPolicy>
+void
+Equation<QueryPolicy>::DescribeCandidates(PlanWriter& writer) const
+{
+	if (!_CanCollectCandidates())
+		return;
+
+	writer.Append("\tfilter through index: ");
+	Describe(writer);
+	writer.Append(", score ");
+	writer.Append((int64)fScore);
+	writer.Append("\n");
+}
+
+
+/*!	Describes how the entries matching this equation are found, and what
+	they are checked against afterwards.
+*/
+template<typename QueryPolicy>
+void
+Equation<QueryPolicy>::Explain(PlanWriter& writer, Index& index,
+	bool queryNonIndexed) const
+{
+	Describe(writer);
+
+	if (QueryPolicy::IndexSetTo(index, fAttribute) != B_OK) {
+		if (!queryNonIndexed) {
+			writer.Append(": no index, skipped\n");
+			return;
+		}
+		writer.Append(": no index, iterate the \"name\" index\n");
+	} else if (Term<QueryPolicy>::fOp == OP_UNEQUAL) {
+		writer.Append(": iterate the whole index\n");
+	} else {
+		writer.Append(": iterate the index, score ");
+		writer.Append((int64)fScore);
+		writer.Append(" of ");
+		writer.Append((int64)QueryPolicy::IndexGetSize(index));
+		writer.Append(fScoreEstimated ? "\n" : " (guessed)\n");
+	}
+
+	for (const Term<QueryPolicy>* term = this; term->Parent() != NULL;
+			term = term->Parent()) {
+		Operator<QueryPolicy>* parent
+			= (Operator<QueryPolicy>*)term->Parent();
+		Term<QueryPolicy>* other
+			= parent->Left() == term ? parent->Right() : parent->Left();
+
+		if (parent->Op() == OP_AND) {
+			other->DescribeCandidates(writer);
+			writer.Append("\tmatch: ");
+			other->Describe(writer);
+			writer.Append("\n");
+		} else if (term == parent->Right()
+			&& (queryNonIndexed || other->Score() < INT32_MAX)) {
+			// the left side is iterated first, see Query::_PushEquations()
+			writer.Append("\tskip if already found by: ");
+			other->Describe(writer);
+			writer.Append("\n");
+		}
+	}
+}
+
+
 //	#pragma mark -
 
 
@@ -1039,12 +1595,20 @@ Operator<QueryPolicy>::Match(Entry* entry, Node* node, const char* attribute,
 	int32 type, const uint8* key, size_t size)
 {
 	if (Term<QueryPolicy>::fOp == OP_AND) {
-		status_t status = fLeft->Match(entry, node, attribute, type, key,
+		// check the side first that is cheaper to match
+		Term<QueryPolicy>* first = fLeft;
+		Term<QueryPolicy>* second = fRight;
+		if (fRight->MatchCost() < fLeft->MatchCost()) {
+			first = fRight;
+			second = fLeft;
+		}
+
+		status_t status = first->Match(entry, node, attribute, type, key,
 			size);
 		if (status != MATCH_OK)
 			return status;
 
-		return fRight->Match(entry, node, attribute, type, key, size);
+		return second->Match(entry, node, attribute, type, key, size);
 	} else {
 		// choose the term with the better score for OP_OR
 		Term<QueryPolicy>* first;
@@ -1108,6 +1672,50 @@ Operator<QueryPolicy>::Score() const
 }
 
 
+template<typename QueryPolicy>
+int32
+Operator<QueryPolicy>::MatchCost() const
+{
+	if (fRight->MatchCost() > fLeft->MatchCost())
+		return fRight->MatchCost();
+	return fLeft->MatchCost();
+}
+
+
+template<typename QueryPolicy>
+bool
+Operator<QueryPolicy>::IsCandidate(ino_t id) const
+{
+	if (Term<QueryPolicy>::fOp == OP_AND)
+		return fLeft->IsCandidate(id) && fRight->IsCandidate(id);
+
+	return fLeft->IsCandidate(id) || fRight->IsCandidate(id);
+}
+
+
+template<typename QueryPolicy>
+bool
+Operator<QueryPolicy>::IsExhausted() const
+{
+	if (Term<QueryPolicy>::fOp == OP_OR)
+		return fLeft->IsExhausted() && fRight->IsExhausted();
+
+	// only the side with the better score is iterated for OP_AND
+	if (fRight->Score() < fLeft->Score())
+		return fRight->IsExhausted();
+	return fLeft->IsExhausted();
+}
+
+
+template<typename QueryPolicy>
+void
+Operator<QueryPolicy>::Reset()
+{
+	fLeft->Reset();
+	fRight->Reset();
+}
+
+
 template<typename QueryPolicy>
 status_t
 Operator<QueryPolicy>::InitCheck()
@@ -1129,6 +1737,31 @@ Operator<QueryPolicy>::NeedsEntry()
 }
 
 
+template<typename QueryPolicy>
+void
+Operator<QueryPolicy>::Describe(PlanWriter& writer) const
+{
+	writer.Append("(");
+	fLeft->Describe(writer);
+	writer.Append(Term<QueryPolicy>::fOp == OP_AND ? " && " : " || ");
+	fRight->Describe(writer);
+	writer.Append(")");
+}
+
+
+template<typename QueryPolicy>
+void
+Operator<QueryPolicy>::DescribeCandidates(PlanWriter& writer) const
+{
+	// candidates are only collected for equations that always have to match
+	if (Term<QueryPolicy>::fOp != OP_AND)
+		return;
+
+	fLeft->DescribeCandidates(writer);
+	fRight->DescribeCandidates(writer);
+}
+
+
 //	#pragma mark -
 
 #ifdef DEBUG_QUERY
@@ -1492,8 +2125,53 @@ Query<QueryPolicy>::Rewind()
 	fIterator = NULL;
 	fCurrent = NULL;
 
+	fExpression->Root()->Reset();
+
 	// put the whole expression on the stack
+	return _PushEquations(fStack);
+}
+
+
+/*!	Describes how the query is evaluated, without running it: which
+	equations are iterated in which order, and what the entries found are
+	checked against. The returned length does not include the terminating
+	null byte; if it is not smaller than \a bufferSize, the description has
+	been cut off.
+*/
+template<typename QueryPolicy>
+ssize_t
+Query<QueryPolicy>::Explain(char* buffer, size_t bufferSize)
+{
+	if (fExpression == NULL || fExpression->Root() == NULL)
+		QUERY_RETURN_ERROR(B_BAD_VALUE);
+
+	Stack<Equation<QueryPolicy>*> stack;
+	status_t status = _PushEquations(stack);
+	if (status != B_OK)
+		QUERY_RETURN_ERROR(status);
+
+	PlanWriter writer(buffer, bufferSize);
+	Index index(fContext);
+
+	Equation<QueryPolicy>* equation;
+	for (int32 step = 1; stack.Pop(&equation); step++) {
+		writer.Append((int64)step);
+		writer.Append(". ");
+		equation->Explain(writer, index, (fFlags & B_QUERY_NON_INDEXED) != 0);
+	}
+
+	QueryPolicy::IndexUnset(index);
+	return writer.Length();
+}
 
+
+/*!	Pushes all equations that need to be iterated on \a equations, the one
+	to iterate first on top.
+*/
+template<typename QueryPolicy>
+status_t
+Query<QueryPolicy>::_PushEquations(Stack<Equation<QueryPolicy>*>& equations)
+{
 	Stack<Term<QueryPolicy>*> stack;
 	stack.Push(fExpression->Root());
 
@@ -1514,8 +2192,10 @@ Query<QueryPolicy>::Rewind()
 					stack.Push(op->Left());
 			}
 		} else if (term->Op() == OP_EQUATION
-				|| fStack.Push((Equation<QueryPolicy>*)term) != B_OK)
+				|| equations.Push((Equation<QueryPolicy>*)term) != B_OK) {
 			QUERY_FATAL("Unknown term on stack or stack error\n");
+			return B_ERROR;
+		}
 	}
 
 	return B_OK;
@@ -1681,6 +2361,8 @@ Query<QueryPolicy>::_GetNextEntry(struct dirent* dirent, size_t size)
 
 			if (status != B_OK)
 				return status;
+
+			fCurrent->PrepareCandidates(fContext);
 		}
 		if (fCurrent == NULL)
 			QUERY_RETURN_ERROR(B_ERROR);
@@ -1688,6 +2370,10 @@ Query<QueryPolicy>::_GetNextEntry(struct dirent* dirent, size_t size)
 		status_t status = fCurrent->GetNextMatching(fContext, fIterator, dirent,
 			size);
 		if (status != B_OK) {
+			// all entries have been seen, if it just ran out of them
+			if (status == B_ENTRY_NOT_FOUND)
+				fCurrent->SetExhausted();
+
 			QueryPolicy::IndexIteratorDelete(fIterator);
 			fIterator = NULL;
 			fCurrent = NULL;
@@ -12,6 +12,8 @@
 #define ACPI_MADT_SIGNATURE		"APIC"
 #define ACPI_MCFG_SIGNATURE		"MCFG"
 #define ACPI_SPCR_SIGNATURE		"SPCR"
+#define ACPI_SRAT_SIGNATURE		"SRAT"
+#define ACPI_SLIT_SIGNATURE		"SLIT"
 
 #define ACPI_LOCAL_APIC_ENABLED	0x01
 
@@ -292,6 +294,65 @@ enum {
 	ACPI_SPCR_INTERFACE_TYPE_PL011 = 3,
 };
 
+typedef struct acpi_srat {
+	acpi_descriptor_header	header;		/* "SRAT" signature */
+	uint32	table_revision;
+	uint64	reserved;
+} _PACKED acpi_srat;
+
+enum {
+	ACPI_SRAT_LOCAL_APIC_AFFINITY = 0,
+	ACPI_SRAT_MEMORY_AFFINITY = 1,
+	ACPI_SRAT_LOCAL_X2_APIC_AFFINITY = 2,
+};
+
+#define ACPI_SRAT_AFFINITY_ENABLED	0x01
+
+typedef struct acpi_srat_entry {
+	uint8	type;
+	uint8	length;
+} _PACKED acpi_srat_entry;
+
+typedef struct acpi_srat_local_apic_affinity {
+	uint8	type;
+	uint8	length;
+	uint8	proximity_domain_low;
+	uint8	apic_id;
+	uint32	flags;
+	uint8	local_sapic_eid;
+	uint8	proximity_domain_high[3];
+	uint32	clock_domain;
+} _PACKED acpi_srat_local_apic_affinity;
+
+typedef struct acpi_srat_memory_affinity {
+	uint8	type;
+	uint8	length;
+	uint32	proximity_domain;
+	uint16	reserved1;
+	uint64	base_address;
+	uint64	address_length;
+	uint32	reserved2;
+	uint32	flags;
+	uint64	reserved3;
+} _PACKED acpi_srat_memory_affinity;
+
+typedef struct acpi_srat_local_x2_apic_affinity {
+	uint8	type;
+	uint8	length;
+	uint16	reserved1;
+	uint32	proximity_domain;
+	uint32	x2apic_id;
+	uint32	flags;
+	uint32	clock_domain;
+	uint32	reserved2;
+} _PACKED acpi_srat_local_x2_apic_affinity;
+
+typedef struct acpi_slit {
+	acpi_descriptor_header	header;		/* "SLIT" signature */
+	uint64	locality_count;
+	uint8	entries[0];					/* locality_count^2 distances */
+} _PACKED acpi_slit;
+
 
 /* The following definitions are adapted from acpica/include/acrestyp.h */
 
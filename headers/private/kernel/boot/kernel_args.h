@@ -21,8 +21,10 @@
 #include <util/FixedWidthPointer.h>
 
 
-#define CURRENT_KERNEL_ARGS_VERSION	1
+#define CURRENT_KERNEL_ARGS_VERSION	2
 #define MAX_KERNEL_ARGS_RANGE		20
+#define MAX_MEMORY_NODES			16
+#define MAX_MEMORY_NODE_RANGES		32
 
 // names of common boot_volume fields
 #define BOOT_METHOD						"boot method"
@@ -62,6 +64,16 @@ typedef struct kernel_args {
 	uint32		num_cpus;
 	addr_range	cpu_kstack[SMP_MAX_CPUS];
 
+	// NUMA topology as reported by the firmware. If num_memory_nodes is 0,
+	// it is unknown, and all memory is treated as a single node.
+	uint32		num_memory_nodes;
+	uint32		num_memory_node_ranges;
+	addr_range	memory_node_range[MAX_MEMORY_NODE_RANGES];
+	uint8		memory_node_range_node[MAX_MEMORY_NODE_RANGES];
+	uint8		cpu_memory_node[SMP_MAX_CPUS];
+	uint8		memory_node_distance[MAX_MEMORY_NODES][MAX_MEMORY_NODES];
+		// relative distances as in the ACPI SLIT, 10 means local
+
 	// boot volume KMessage data
 	FixedWidthPointer<void> boot_volume;
 	int32		boot_volume_size;
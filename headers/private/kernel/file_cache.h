@@ -14,8 +14,10 @@
 // temporary/optional cache syscall API
 #define CACHE_SYSCALLS "cache"
 
-#define CACHE_CLEAR			1	// takes no parameters
-#define CACHE_SET_MODULE	2	// gets the module name as parameter
+#define CACHE_CLEAR					1	// takes no parameters
+#define CACHE_SET_MODULE			2	// gets the module name as parameter
+#define CACHE_GET_READ_AHEAD_STATS	3	// fills in file_cache_read_ahead_stats
+#define CACHE_SET_READ_AHEAD_MAX	4	// gets the maximum window size (uint32)
 
 #define CACHE_MODULES_NAME	"file_cache"
 
@@ -23,6 +25,19 @@
 #define FILE_CACHE_LOADED_COMPLETELY	0x02
 #define FILE_CACHE_NO_IO				0x04
 
+typedef struct file_cache_read_ahead_stats {
+	uint64	hits;
+		// reads that were completely covered by a read-ahead window
+	uint64	misses;
+		// sequential or strided reads that were not
+	uint64	pages_read_ahead;
+	uint64	pages_wasted;
+		// pages that were read ahead, but the stream ended before reaching them
+	uint32	max_window_size;
+	uint32	effective_max_window_size;
+		// the maximum after taking the memory situation into account
+} file_cache_read_ahead_stats;
+
 struct cache_module_info {
 	module_info	info;
 
@@ -44,6 +59,11 @@ extern void cache_node_closed(struct vnode *vnode, VMCache *cache,
 extern void cache_node_launched(size_t argCount, char * const *args);
 extern void cache_prefetch_vnode(struct vnode *vnode, off_t offset, size_t size);
 extern void cache_prefetch(dev_t mountID, ino_t vnodeID, off_t offset, size_t size);
+extern status_t cache_wire_pages(struct vnode *vnode, void *cookie,
+				off_t offset, size_t *_size, VMCache **_cache,
+				struct vm_page **pages, uint32 *_count);
+extern void cache_unwire_pages(VMCache *cache, struct vm_page **pages,
+				uint32 count);
 
 extern status_t file_map_init(void);
 extern status_t file_cache_init_post_boot_device(void);
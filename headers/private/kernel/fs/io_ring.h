@@ -0,0 +1,27 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_FS_IO_RING_H
+#define _KERNEL_FS_IO_RING_H
+
+
+#include <OS.h>
+
+#include <io_ring_defs.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int			_user_io_ring_create(uint32 entries, int openFlags,
+				void** _address);
+ssize_t		_user_io_ring_enter(int ring, uint32 toSubmit, uint32 flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif	/* _KERNEL_FS_IO_RING_H */
@@ -14,6 +14,7 @@
 #include <thread_types.h>
 
 
+struct scheduler_cpu_stats;
 struct scheduling_analysis;
 struct SchedulerListener;
 
@@ -95,6 +96,8 @@ status_t _user_analyze_scheduling(bigtime_t from, bigtime_t until, void* buffer,
 
 status_t _user_set_scheduler_mode(int32 mode);
 int32 _user_get_scheduler_mode(void);
+status_t _user_get_scheduler_cpu_stats(int32 cpu,
+	struct scheduler_cpu_stats* stats, size_t size);
 
 status_t _user_get_loadavg(struct loadavg* info, size_t size);
 
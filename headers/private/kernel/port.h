@@ -18,8 +18,15 @@ struct select_info;
 // port flags
 enum {
 	// read_port_etc() flags
-	B_PEEK_PORT_MESSAGE		= 0x100	// read the message, but don't remove it;
-									// kernel-only; memory must be locked
+	B_PEEK_PORT_MESSAGE		= 0x100,	// read the message, but don't remove it;
+										// kernel-only; memory must be locked
+
+	// write_port_etc() flags
+	B_ZERO_COPY_PORT_MESSAGE	= 0x200	// don't copy large messages into the
+										// kernel; the receiver reads them
+										// directly from the sender's pages,
+										// and the call only returns once the
+										// message has been read
 };
 
 // port notifications
@@ -22,13 +22,37 @@ typedef struct object_depot {
 	size_t					empty_count;
 	size_t					max_count;
 	size_t					magazine_capacity;
+	size_t					min_magazine_capacity;
 	struct depot_cpu_store*	stores;
 	void*					cookie;
 
+	// adaptive magazine sizing, see object_depot_maintenance()
+	uint64					lock_waits;
+	uint64					last_operations;
+	uint64					last_depot_accesses;
+	uint64					last_lock_waits;
+	uint32					idle_intervals;
+	uint32					resize_count;
+	bool					stale_magazines;
+
 	void (*return_object)(struct object_depot* depot, void* cookie,
 		void* object, uint32 flags);
 } object_depot;
 
+typedef struct object_depot_stats {
+	uint64					hits;
+		// objects served from or stored to the CPU magazines
+	uint64					exchanges;
+		// magazines exchanged with the depot
+	uint64					misses;
+		// objects that had to go to or come from the slabs
+	uint64					lock_waits;
+	size_t					magazine_capacity;
+	size_t					full_magazines;
+	size_t					empty_magazines;
+	uint32					resize_count;
+} object_depot_stats;
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,6 +69,9 @@ void object_depot_store(object_depot* depot, void* object, uint32 flags);
 
 void object_depot_make_empty(object_depot* depot, uint32 flags);
 
+void object_depot_maintenance(object_depot* depot, uint32 flags);
+void object_depot_get_stats(object_depot* depot, object_depot_stats* stats);
+
 #if PARANOID_KERNEL_FREE
 bool object_depot_contains_object(object_depot* depot, void* object);
 #endif
@@ -78,6 +78,14 @@ public:
 
 	virtual	void				Flush() = 0;
 
+	// large pages -- map locked
+	virtual	size_t				LargePageSize() const;
+	virtual	int32				PromoteLargePages(addr_t start, addr_t end);
+	virtual	void				DemoteLargePages(addr_t start, addr_t end);
+	virtual	int32				CountLargePages(addr_t start, addr_t end);
+	inline	int32				LargePageCount() const
+									{ return fLargePageCount; }
+
 	// backends for KDL commands
 	virtual	void				DebugPrintMappingInfo(addr_t virtualAddress);
 	virtual	bool				DebugGetReverseMappingInfo(
@@ -95,6 +103,7 @@ protected:
 protected:
 			recursive_lock		fLock;
 			int32				fMapCount;
+			int32				fLargePageCount;
 };
 
 
@@ -173,6 +173,11 @@ status_t _user_sync_memory(void *address, size_t size, uint32 flags);
 status_t _user_memory_advice(void* address, size_t size, uint32 advice);
 status_t _user_get_memory_properties(team_id teamID, const void *address,
 			uint32 *_protected, uint32 *_lock);
+status_t _user_get_large_page_info(area_id area, large_page_info* info);
+status_t _user_get_memory_node_info(uint32 node, memory_node_info* info);
+status_t _user_get_next_object_cache_info(int32* cookie,
+			object_cache_info* info);
+status_t _user_get_compressed_swap_info(compressed_swap_info* info);
 
 status_t _user_mlock(const void* address, size_t size);
 status_t _user_munlock(const void* address, size_t size);
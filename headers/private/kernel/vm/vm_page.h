@@ -16,6 +16,7 @@
 struct kernel_args;
 
 extern int32 gMappedPagesCount;
+extern int32 gMappedLargePagesCount;
 
 
 struct vm_page_reservation {
@@ -55,6 +56,11 @@ page_num_t vm_page_num_unused_pages(void);
 void vm_page_get_stats(system_info *info);
 phys_addr_t vm_page_max_address();
 
+// NUMA topology
+uint32 vm_page_memory_node_count(void);
+uint32 vm_page_cpu_memory_node(int32 cpu);
+uint32 vm_page_memory_node_distance(uint32 from, uint32 to);
+
 status_t vm_page_write_modified_page_range(struct VMCache *cache,
 	uint32 firstPage, uint32 endPage);
 status_t vm_page_write_modified_pages(struct VMCache *cache);
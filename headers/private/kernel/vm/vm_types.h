@@ -152,6 +152,11 @@ public:
 	uint8					_unused : 1;
 
 	uint8					usage_count;
+	uint8					memory_node;
+								// the NUMA node the page belongs to
+	uint16					io_wired_count;
+								// the part of the wired count that is due
+								// to cache_wire_pages()
 
 	inline void Init(page_num_t pageNumber);
 
@@ -211,6 +216,8 @@ vm_page::Init(page_num_t pageNumber)
 	accessed = modified = false;
 	_unused = 0;
 	usage_count = 0;
+	memory_node = 0;
+	io_wired_count = 0;
 
 	fWiredCount = 0;
 
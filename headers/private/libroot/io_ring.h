@@ -0,0 +1,48 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _LIBROOT_IO_RING_H
+#define _LIBROOT_IO_RING_H
+
+
+#include <OS.h>
+
+#include <io_ring_defs.h>
+
+
+typedef struct io_ring {
+	int						fd;
+	io_ring_header*			header;
+	io_ring_submission*		submissions;
+	io_ring_completion*		completions;
+	uint32					submission_tail;
+		// not yet submitted to the kernel
+} io_ring;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+status_t	io_ring_init(io_ring* ring, uint32 entries);
+void		io_ring_destroy(io_ring* ring);
+
+io_ring_submission*	io_ring_get_submission(io_ring* ring);
+ssize_t		io_ring_submit(io_ring* ring);
+
+io_ring_completion* io_ring_peek_completion(io_ring* ring);
+void		io_ring_completion_seen(io_ring* ring);
+
+void		io_ring_prepare_read(io_ring_submission* submission, int fd,
+				void* buffer, size_t length, off_t offset, uint64 userData);
+void		io_ring_prepare_write(io_ring_submission* submission, int fd,
+				const void* buffer, size_t length, off_t offset,
+				uint64 userData);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif	// _LIBROOT_IO_RING_H
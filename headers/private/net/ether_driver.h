@@ -28,6 +28,8 @@ enum {
 
 	ETHER_SEND_NET_BUFFER,					/* send a net_buffer */
 	ETHER_RECEIVE_NET_BUFFER,				/* receive a net_buffer */
+	ETHER_GET_OFFLOAD_CAPABILITIES,
+		/* get the offloads a net_buffer device supports (uint32 *) */
 };
 
 
@@ -36,6 +38,15 @@ typedef struct ether_address {
 	uint8	ebyte[6];
 } ether_address_t;
 
+/* ETHER_GET_OFFLOAD_CAPABILITIES - a frame the device cannot ever split
+ * itself is refused with B_BUFFER_OVERFLOW, and split in software instead */
+enum {
+	ETHER_OFFLOAD_TSO4	= 0x01,
+		/* splits TCP/IPv4 frames with NET_BUFFER_TCP_SEGMENTATION set */
+	ETHER_OFFLOAD_TSO6	= 0x02,
+		/* splits TCP/IPv6 frames with NET_BUFFER_TCP_SEGMENTATION set */
+};
+
 /* ETHER_GETLINKSTATE */
 typedef struct ether_link_state {
 	uint32	media;		/* as specified in net/if_media.h */
@@ -19,8 +19,13 @@
 enum net_buffer_flags {
 	NET_BUFFER_L3_CHECKSUM_VALID = (1 << 0),
 	NET_BUFFER_L4_CHECKSUM_VALID = (1 << 1),
+	NET_BUFFER_TCP_SEGMENTATION = (1 << 2),
+		// the buffer holds a TCP segment that is larger than the MTU, and
+		// must be split into segments of segment_size payload bytes
 };
 
+typedef void (*net_buffer_release_func)(void* cookie);
+
 
 typedef struct net_buffer {
 	struct list_link		link;
@@ -42,6 +47,7 @@ typedef struct net_buffer {
 	uint32					size;
 	uint8					protocol;
 	uint16					buffer_flags;
+	uint16					segment_size;
 } net_buffer;
 
 struct ancillary_data_container;
@@ -74,6 +80,9 @@ struct net_buffer_module_info {
 	status_t		(*trim)(net_buffer* buffer, size_t newSize);
 	status_t		(*append_cloned)(net_buffer* buffer, net_buffer* source,
 						uint32 offset, size_t bytes);
+	status_t		(*append_external)(net_buffer* buffer,
+						const struct iovec* vecs, uint32 vecCount,
+						net_buffer_release_func release, void* cookie);
 
 	status_t		(*associate_data)(net_buffer* buffer, void* data);
 
@@ -31,6 +31,7 @@ typedef struct net_device {
 	uint64	link_speed;
 	uint32	link_quality;
 	size_t	header_length;
+	uint32	offload;	// NET_DEVICE_OFFLOAD_*
 
 	struct net_hardware_address address;
 
@@ -38,6 +39,20 @@ typedef struct net_device {
 } net_device;
 
 
+// net_device::offload flags
+enum {
+	NET_DEVICE_OFFLOAD_SEGMENTATION	= (1 << 0),
+		// TCP segments larger than the MTU may be passed down; the stack
+		// splits them right before they are handed to the device
+	NET_DEVICE_OFFLOAD_TSO4			= (1 << 1),
+	NET_DEVICE_OFFLOAD_TSO6			= (1 << 2),
+		// the device splits TCP segments larger than the MTU itself
+	NET_DEVICE_OFFLOAD_COALESCING	= (1 << 3),
+		// consecutive received TCP segments may be merged before they are
+		// passed to the protocols
+};
+
+
 struct net_device_module_info {
 	struct module_info info;
 
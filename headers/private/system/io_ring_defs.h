@@ -0,0 +1,76 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_IO_RING_DEFS_H
+#define _SYSTEM_IO_RING_DEFS_H
+
+
+#include <OS.h>
+
+
+#define IO_RING_MAX_ENTRIES		4096
+
+
+// submission opcodes
+enum {
+	IO_RING_OP_NOP		= 0,
+	IO_RING_OP_READ,		// fd, buffer, length, offset (-1: current pos)
+	IO_RING_OP_WRITE,		// fd, buffer, length, offset (-1: current pos)
+	IO_RING_OP_FSYNC,		// fd
+	IO_RING_OP_STAT,		// fd, path (may be NULL), buffer, length
+	IO_RING_OP_SEND,		// fd, buffer, length, op_flags (MSG_*)
+	IO_RING_OP_RECV,		// fd, buffer, length, op_flags (MSG_*)
+	IO_RING_OP_CLOSE,		// fd
+
+	IO_RING_OP_LAST
+};
+
+// io_ring_submission::flags
+enum {
+	IO_RING_SUBMISSION_NO_LINK_STAT	= 0x01,	// IO_RING_OP_STAT: like lstat()
+	IO_RING_SUBMISSION_STOP_ON_ERROR = 0x02	// don't process any further
+											// submissions, if this one fails
+};
+
+
+typedef struct io_ring_submission {
+	uint8		opcode;
+	uint8		flags;
+	uint16		_reserved;
+	int32		fd;
+	off_t		offset;
+	void*		buffer;
+	size_t		length;
+	const char*	path;
+	uint32		op_flags;
+	uint32		_reserved2;
+	uint64		user_data;
+} io_ring_submission;
+
+typedef struct io_ring_completion {
+	uint64		user_data;
+	int64		result;		// bytes transferred, or error code
+} io_ring_completion;
+
+
+/*!	Lies at the start of the ring's area. The submission queue is written by
+	userland and consumed by the kernel, the completion queue is written by the
+	kernel and consumed by userland. Every side only writes the index it owns
+	(submission_tail and completion_head for userland), the kernel ignores
+	changes to the other ones.
+*/
+typedef struct io_ring_header {
+	uint32		submission_head;
+	uint32		submission_tail;
+	uint32		submission_count;
+	uint32		submission_offset;
+
+	uint32		completion_head;
+	uint32		completion_tail;
+	uint32		completion_count;
+	uint32		completion_offset;
+} io_ring_header;
+
+
+#endif	/* _SYSTEM_IO_RING_DEFS_H */
@@ -68,4 +68,42 @@ struct loadavg {
 };
 
 
+#define SCHEDULER_LATENCY_BUCKETS		20
+	// bucket i counts latencies of less than 2^i microseconds, the last one
+	// all longer ones
+#define SCHEDULER_QUEUE_DEPTH_BUCKETS	8
+	// bucket 0 counts empty run queues, bucket i > 0 depths of less than
+	// 2^i threads, the last one all deeper ones
+
+// threads are counted in the band of their effective priority
+enum {
+	SCHEDULER_BAND_LOW = 0,
+	SCHEDULER_BAND_NORMAL,
+	SCHEDULER_BAND_DISPLAY,
+	SCHEDULER_BAND_URGENT,
+	SCHEDULER_BAND_REAL_TIME,
+
+	SCHEDULER_PRIORITY_BANDS
+};
+
+struct scheduler_cpu_stats {
+	int32		cpu;
+
+	uint64		context_switches;
+	uint64		migrations;
+		// threads that last ran on another core
+
+	uint64		wakeups;
+	bigtime_t	total_wakeup_latency;
+	bigtime_t	max_wakeup_latency;
+	uint64		wakeup_latencies[SCHEDULER_LATENCY_BUCKETS];
+
+	uint64		queue_depths[SCHEDULER_QUEUE_DEPTH_BUCKETS];
+
+	uint64		dispatches[SCHEDULER_PRIORITY_BANDS];
+	bigtime_t	queue_time[SCHEDULER_PRIORITY_BANDS];
+	bigtime_t	run_time[SCHEDULER_PRIORITY_BANDS];
+};
+
+
 #endif	/* _SYSTEM_SCHEDULER_DEFS_H */
@@ -22,17 +22,22 @@ extern "C" {
 #endif
 
 struct attr_info;
+struct compressed_swap_info;
 struct dirent;
 struct event_wait_info;
 struct fd_info;
 struct fd_set;
 struct fs_info;
 struct iovec;
+struct large_page_info;
 struct loadavg;
+struct memory_node_info;
 struct msqid_ds;
 struct net_stat;
+struct object_cache_info;
 struct pollfd;
 struct rlimit;
+struct scheduler_cpu_stats;
 struct scheduling_analysis;
 struct _sem_t;
 struct sembuf;
@@ -82,6 +87,10 @@ extern status_t		_kern_event_queue_select(int queue,
 extern ssize_t		_kern_event_queue_wait(int queue, struct event_wait_info* infos,
 						int numInfos, uint32 flags, bigtime_t timeout);
 
+extern int			_kern_io_ring_create(uint32 entries, int openFlags,
+						void** _address);
+extern ssize_t		_kern_io_ring_enter(int ring, uint32 toSubmit, uint32 flags);
+
 /* user mutex functions */
 extern status_t		_kern_mutex_lock(int32* mutex, const char* name,
 						uint32 flags, bigtime_t timeout);
@@ -213,6 +222,8 @@ extern bigtime_t	_kern_estimate_max_scheduling_latency(thread_id thread);
 
 extern status_t		_kern_set_scheduler_mode(int32 mode);
 extern int32		_kern_get_scheduler_mode(void);
+extern status_t		_kern_get_scheduler_cpu_stats(int32 cpu,
+						struct scheduler_cpu_stats* stats, size_t size);
 extern status_t		_kern_get_loadavg(struct loadavg* info, size_t size);
 
 // user/group functions
@@ -380,6 +391,8 @@ extern ssize_t		_kern_sendto(int socket, const void *data, size_t length,
 						socklen_t addressLength);
 extern ssize_t		_kern_sendmsg(int socket, const struct msghdr *message,
 						int flags);
+extern ssize_t		_kern_sendfile(int socket, int fd, off_t *_offset,
+						size_t count);
 extern status_t		_kern_getsockopt(int socket, int level, int option,
 						void *value, socklen_t *_length);
 extern status_t		_kern_setsockopt(int socket, int level, int option,
@@ -464,6 +477,14 @@ extern status_t		_kern_memory_advice(void *address, size_t size,
 
 extern status_t		_kern_get_memory_properties(team_id teamID,
 						const void *address, uint32* _protected, uint32* _lock);
+extern status_t		_kern_get_large_page_info(area_id area,
+						struct large_page_info* info);
+extern status_t		_kern_get_memory_node_info(uint32 node,
+						struct memory_node_info* info);
+extern status_t		_kern_get_next_object_cache_info(int32* cookie,
+						struct object_cache_info* info);
+extern status_t		_kern_get_compressed_swap_info(
+						struct compressed_swap_info* info);
 
 extern status_t		_kern_mlock(const void* address, size_t size);
 extern status_t		_kern_munlock(const void* address, size_t size);
@@ -26,9 +26,13 @@
 #define B_KERNEL_AREA			(1 << 14)
 	// Usable from userland according to its protection flags, but the area
 	// itself is not deletable, resizable, etc from userland.
+#define B_LARGE_PAGES_AREA		(1 << 15)
+	// Wired, and mapped with large pages (e.g. 2 MB on x86-64) where the
+	// architecture supports it.
 
 #define B_USER_AREA_FLAGS		\
-	(B_USER_PROTECTION | B_OVERCOMMITTING_AREA | B_CLONEABLE_AREA)
+	(B_USER_PROTECTION | B_OVERCOMMITTING_AREA | B_CLONEABLE_AREA \
+	| B_LARGE_PAGES_AREA)
 #define B_KERNEL_AREA_FLAGS \
 	(B_KERNEL_PROTECTION | B_SHARED_AREA)
 
@@ -47,4 +51,55 @@ enum {
 #define MEMORY_TYPE_SHIFT		28
 
 
+typedef struct large_page_info {
+	size_t		page_size;		// 0, if large pages are not supported
+	size_t		count;			// number of currently mapped large pages
+} large_page_info;
+
+typedef struct memory_node_info {
+	uint32		node;
+	uint32		node_count;			// number of memory nodes in the system
+	uint32		cpu_count;
+	uint32		_reserved;
+	uint64		cpus[4];			// bitmap of the CPUs local to the node
+	uint64		total_pages;
+	uint64		free_pages;
+	uint64		local_allocations;	// free pages taken by CPUs of the node
+	uint64		remote_allocations;	// free pages taken by other CPUs
+	uint8		distance[16];		// relative distance to the other nodes,
+									// 10 meaning local, 0 unknown
+} memory_node_info;
+
+typedef struct object_cache_info {
+	char		name[32];
+	uint64		object_size;
+	uint64		usage;				// bytes used by the cache's slabs
+	uint64		total_objects;
+	uint64		used_objects;
+	uint64		slab_allocations;
+	uint64		lock_waits;			// contended cache lock acquisitions
+
+	// object depot (all 0, if the cache doesn't have one)
+	uint32		magazine_capacity;
+	uint32		full_magazines;
+	uint64		depot_hits;			// served by the per-CPU magazines
+	uint64		depot_exchanges;	// magazines exchanged with the depot
+	uint64		depot_misses;		// had to fall back to the slabs
+	uint64		depot_lock_waits;
+	uint32		depot_resizes;		// magazine capacity changes
+	uint32		_reserved;
+} object_cache_info;
+
+typedef struct compressed_swap_info {
+	uint64		max_size;			// 0, if the store is disabled
+	uint64		used_size;			// memory used by the compressed pages
+	uint64		stored_pages;
+	uint64		stores;				// pages stored in total
+	uint64		rejected;			// pages that went to the swap file
+	uint64		hits;				// pages read from the store
+	uint64		misses;				// pages read from the swap file
+	uint64		demotions;			// pages written back to the swap file
+} compressed_swap_info;
+
+
 #endif	/* _SYSTEM_VM_DEFS_H */
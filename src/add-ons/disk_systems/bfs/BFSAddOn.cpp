@@ -13,6 +13,7 @@
 
 #include <Directory.h>
 #include <List.h>
+#include <OS.h>
 #include <Path.h>
 #include <Volume.h>
 
@@ -242,10 +243,14 @@ BFSPartitionHandle::Repair(bool checkOnly)
 	if (!fd.IsSet())
 	    return errno;
 
+	system_info info;
+	get_system_info(&info);
+
 	struct check_control result;
 	memset(&result, 0, sizeof(result));
 	result.magic = BFS_IOCTL_CHECK_MAGIC;
 	result.flags = 0;
+	result.threads = info.cpu_count;
 	if (!checkOnly) {
 		//printf("will fix any severe errors!\n");
 		result.flags |= BFS_FIX_BITMAP_ERRORS | BFS_REMOVE_WRONG_TYPES
@@ -264,6 +269,20 @@ BFSPartitionHandle::Repair(bool checkOnly)
 	// check all files and report errors
 	while (ioctl(fd.Get(), BFS_IOCTL_CHECK_NEXT_NODE, &result,
 			sizeof(result)) == 0) {
+		if (result.pass == BFS_CHECK_PASS_BITMAP_WINDOW) {
+			// all nodes are visited again for each further window of the
+			// block bitmap, but they have been counted already
+			if (previousPass != result.pass) {
+				printf("Checking further allocation groups...\n");
+				previousPass = result.pass;
+			}
+			if (result.errors) {
+				printf("%s (inode = %" B_PRIdINO "), has blocks already set\n",
+					result.name, result.inode);
+			}
+			continue;
+		}
+
 		if (++counter % 50 == 0)
 			printf("%9" B_PRIu64 " nodes processed\x1b[1A\n", counter);
 
@@ -333,6 +352,9 @@ BFSPartitionHandle::Repair(bool checkOnly)
 		result.stats.double_indirect_array_blocks,
 		size_string(1.0 * result.stats.blocks_in_double_indirect
 			* result.stats.block_size).String());
+	printf("\tfile fragments\t\t\t%" B_PRIu64 " (%" B_PRIu64
+		" files fragmented)\n", result.stats.file_fragments,
+		result.stats.fragmented_files);
 	// TODO: this is currently not maintained correctly
 	//printf("\tpartial block runs\t%" B_PRIu64 "\n",
 	//	result.stats.partial_block_runs);
@@ -717,6 +717,23 @@ extern struct nvme_qpair * nvme_ioqp_get(struct nvme_ctrlr *ctrlr,
 					 enum nvme_qprio qprio,
 					 unsigned int qd);
 
+/**
+ * @brief Get an I/O queue pair with its own completion interrupt
+ *
+ * @param ctrlr	Controller handle
+ * @param qprio I/O queue pair priority for weighted round robin arbitration
+ * @param qd 	I/O queue pair maximum submission queue depth
+ * @param iv	MSI-X vector the completion queue signals completions on
+ *
+ * Same as nvme_ioqp_get(), which uses the vector of the admin queue.
+ *
+ * @return An I/O queue pair handle on success and NULL in case of failure.
+ */
+extern struct nvme_qpair * nvme_ioqp_get_iv(struct nvme_ctrlr *ctrlr,
+					    enum nvme_qprio qprio,
+					    unsigned int qd,
+					    uint16_t iv);
+
 /**
  * @brief Release an I/O queue pair
  *
@@ -781,6 +798,27 @@ extern int nvme_ioqp_submit_cmd(struct nvme_qpair *qpair,
 extern unsigned int nvme_qpair_poll(struct nvme_qpair *qpair,
 				   unsigned int max_completions);
 
+/**
+ * @brief Hold back the submission doorbell of a queue pair
+ *
+ * @param qpair		I/O queue pair handle
+ *
+ * Commands submitted while the queue pair is plugged are only passed to
+ * the controller once every caller of this function has called
+ * nvme_qpair_unplug(). This allows to submit a batch of commands with a
+ * single doorbell write. Must not be held while waiting for completions.
+ */
+extern void nvme_qpair_plug(struct nvme_qpair *qpair);
+
+/**
+ * @brief Release a queue pair plugged with nvme_qpair_plug()
+ *
+ * @param qpair		I/O queue pair handle
+ *
+ * @return 1 if the submission doorbell was written, 0 otherwise.
+ */
+extern int nvme_qpair_unplug(struct nvme_qpair *qpair);
+
 /**
  * @brief Open a name space
  *
@@ -210,7 +210,8 @@ int nvme_admin_create_ioq(struct nvme_ctrlr *ctrlr,
 	case NVME_IO_COMPLETION_QUEUE:
 		cmd.opc = NVME_OPC_CREATE_IO_CQ;
 #ifdef __HAIKU__ // TODO: Option!
-		cmd.cdw11 = 0x1 | 0x2; /* enable interrupts */
+		/* enable interrupts */
+		cmd.cdw11 = ((uint32_t)qpair->iv << 16) | 0x1 | 0x2;
 #else
 		cmd.cdw11 = 0x1;
 #endif
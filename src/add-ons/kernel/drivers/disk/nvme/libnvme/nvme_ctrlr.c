@@ -1402,6 +1402,17 @@ out:
  */
 struct nvme_qpair *nvme_ioqp_get(struct nvme_ctrlr *ctrlr,
 				 enum nvme_qprio qprio, unsigned int qd)
+{
+	return nvme_ioqp_get_iv(ctrlr, qprio, qd, 0);
+}
+
+/*
+ * Get an unused I/O queue pair, completing through the given
+ * interrupt vector.
+ */
+struct nvme_qpair *nvme_ioqp_get_iv(struct nvme_ctrlr *ctrlr,
+				    enum nvme_qprio qprio, unsigned int qd,
+				    uint16_t iv)
 {
 	struct nvme_qpair *qpair = NULL;
 	union nvme_cc_register cc;
@@ -1457,6 +1468,7 @@ struct nvme_qpair *nvme_ioqp_get(struct nvme_ctrlr *ctrlr,
 		qpair = NULL;
 		goto out;
 	}
+	qpair->iv = iv;
 
 	/*
 	 * At this point, qpair contains a preallocated submission
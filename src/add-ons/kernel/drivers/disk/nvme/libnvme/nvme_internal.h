@@ -388,6 +388,13 @@ struct nvme_qpair {
 	bool				enabled;
 	bool				sq_in_cmb;
 
+	/*
+	 * While the qpair is plugged, the submission queue tail doorbell
+	 * is only written once the last submitter unplugs it.
+	 */
+	uint16_t			plugged;
+	bool				sq_tdbl_pending;
+
 	/*
 	 * Fields below this point should not be touched on the
 	 * normal I/O happy path.
@@ -395,6 +402,11 @@ struct nvme_qpair {
 
 	uint8_t				qprio;
 
+	/*
+	 * Interrupt vector of the completion queue.
+	 */
+	uint16_t			iv;
+
 	struct nvme_ctrlr		*ctrlr;
 
 	/* List entry for nvme_ctrlr::free_io_qpairs and active_io_qpairs */
@@ -361,7 +361,10 @@ static void nvme_qpair_submit_tracker(struct nvme_qpair *qpair,
 		qpair->sq_tail = 0;
 
 	nvme_wmb();
-	nvme_mmio_write_4(qpair->sq_tdbl, qpair->sq_tail);
+	if (qpair->plugged > 0)
+		qpair->sq_tdbl_pending = true;
+	else
+		nvme_mmio_write_4(qpair->sq_tdbl, qpair->sq_tail);
 }
 
 static void nvme_qpair_complete_tracker(struct nvme_qpair *qpair,
@@ -859,7 +862,10 @@ int nvme_qpair_construct(struct nvme_ctrlr *ctrlr, struct nvme_qpair *qpair,
 	qpair->entries = entries;
 	qpair->trackers = trackers;
 	qpair->qprio = qprio;
+	qpair->iv = 0;
 	qpair->sq_in_cmb = false;
+	qpair->plugged = 0;
+	qpair->sq_tdbl_pending = false;
 	qpair->ctrlr = ctrlr;
 
 	if (ctrlr->opts.use_cmb_sqs) {
@@ -1093,6 +1099,41 @@ int nvme_qpair_submit_request(struct nvme_qpair *qpair,
 	return ret;
 }
 
+/*
+ * Hold back the submission queue doorbell, so that several
+ * commands can be passed to the controller at once.
+ */
+void nvme_qpair_plug(struct nvme_qpair *qpair)
+{
+	pthread_mutex_lock(&qpair->lock);
+	qpair->plugged++;
+	pthread_mutex_unlock(&qpair->lock);
+}
+
+/*
+ * Write the submission queue doorbell, if this was the last
+ * submitter holding it back, and commands have been submitted
+ * in the mean time. Returns 1 if the doorbell was written.
+ */
+int nvme_qpair_unplug(struct nvme_qpair *qpair)
+{
+	int written = 0;
+
+	pthread_mutex_lock(&qpair->lock);
+
+	nvme_assert(qpair->plugged > 0, "qpair is not plugged\n");
+
+	if (--qpair->plugged == 0 && qpair->sq_tdbl_pending) {
+		qpair->sq_tdbl_pending = false;
+		nvme_mmio_write_4(qpair->sq_tdbl, qpair->sq_tail);
+		written = 1;
+	}
+
+	pthread_mutex_unlock(&qpair->lock);
+
+	return written;
+}
+
 /*
  * Poll for completion of NVMe commands submitted to the
  * specified I/O queue pair.
@@ -1164,6 +1205,7 @@ void nvme_qpair_reset(struct nvme_qpair *qpair)
 	pthread_mutex_lock(&qpair->lock);
 
 	qpair->sq_tail = qpair->cq_head = 0;
+	qpair->sq_tdbl_pending = false;
 
 	/*
 	 * First time through the completion queue, HW will set phase
@@ -13,8 +13,11 @@
 #include <algorithm>
 #include <condition_variable.h>
 #include <AutoDeleter.h>
+#include <debug.h>
+#include <interrupts.h>
 #include <kernel.h>
 #include <smp.h>
+#include <StackOrHeapArray.h>
 #include <util/AutoLock.h>
 
 #include <fs/devfs.h>
@@ -76,7 +79,7 @@ static const uint8 kDriveIcon[] = {
 
 static device_manager_info* sDeviceManager;
 
-typedef struct {
+typedef struct nvme_disk_driver_info {
 	device_node*			node;
 	pci_info				info;
 
@@ -86,6 +89,7 @@ typedef struct {
 	uint64					capacity;
 	uint32					block_size;
 	uint32					max_io_blocks;
+	bool					sgl_supported;
 	status_t				media_status;
 
 	DMAResource				dma_resource;
@@ -93,13 +97,27 @@ typedef struct {
 
 	rw_lock					rounded_write_lock;
 
-	ConditionVariable		interrupt;
+	uint32					irq;
 	int32					polling;
 
 	struct qpair_info {
 		struct nvme_qpair*	qpair;
+		nvme_disk_driver_info* info;
+		uint32				irq;
+		ConditionVariable	interrupt;
+
+		// statistics
+		int32				queued;
+		int32				max_queued;
+		int64				commands;
+		int64				doorbells;
+		int64				merged_vecs;
+		int64				total_latency;
+		int64				max_latency;
 	}						qpairs[NVME_MAX_QPAIRS];
 	uint32					qpair_count;
+
+	nvme_disk_driver_info*	next;
 } nvme_disk_driver_info;
 typedef nvme_disk_driver_info::qpair_info qpair_info;
 
@@ -109,6 +127,10 @@ typedef struct {
 } nvme_disk_handle;
 
 
+static mutex sDeviceListLock = MUTEX_INITIALIZER("nvme_disk devices");
+static nvme_disk_driver_info* sDeviceList = NULL;
+
+
 static status_t
 get_geometry(nvme_disk_handle* handle, device_geometry* geometry)
 {
@@ -148,6 +170,34 @@ nvme_disk_set_capacity(nvme_disk_driver_info* info, uint64 capacity,
 
 
 static int32 nvme_interrupt_handler(void* _info);
+static int32 nvme_qpair_interrupt_handler(void* _qpinfo);
+
+
+static int
+dump_nvme_disk_stats(int argc, char** argv)
+{
+	for (nvme_disk_driver_info* info = sDeviceList; info != NULL;
+			info = info->next) {
+		kprintf("nvme_disk %p: PCI %d:%d:%d, IRQ %" B_PRIu32 "%s\n", info,
+			info->info.bus, info->info.device, info->info.function, info->irq,
+			info->polling > 0 ? ", polling" : "");
+		kprintf("  qpair  irq  queued   max     commands    doorbells  "
+			"merged vecs  avg lat  max lat\n");
+
+		for (uint32 i = 0; i < info->qpair_count; i++) {
+			qpair_info& qpinfo = info->qpairs[i];
+			int64 average = qpinfo.commands > 0
+				? qpinfo.total_latency / qpinfo.commands : 0;
+			kprintf("  %5" B_PRIu32 " %4" B_PRIu32 " %7" B_PRId32 " %5" B_PRId32
+				" %12" B_PRId64 " %12" B_PRId64 " %12" B_PRId64 " %8" B_PRId64
+				" %8" B_PRId64 "\n", i, qpinfo.irq, qpinfo.queued,
+				qpinfo.max_queued, qpinfo.commands, qpinfo.doorbells,
+				qpinfo.merged_vecs, average, qpinfo.max_latency);
+		}
+	}
+
+	return 0;
+}
 
 
 static status_t
@@ -233,17 +283,38 @@ nvme_disk_init_device(void* _info, void** _cookie)
 	command &= ~(PCI_command_int_disable);
 	pci->write_pci_config(pcidev, PCI_command, 2, command);
 
+	// decide on the number of qpairs
+	uint32 try_qpairs = cstat->io_qpairs;
+	try_qpairs = min_c(try_qpairs, NVME_MAX_QPAIRS);
+	if (try_qpairs >= (uint32)smp_get_num_cpus()) {
+		try_qpairs = smp_get_num_cpus();
+	} else {
+		// Find the highest number of qpairs that evenly divides the number of CPUs.
+		while ((smp_get_num_cpus() % try_qpairs) != 0)
+			try_qpairs--;
+	}
+
 	uint32 irq = info->info.u.h0.interrupt_line;
 	if (irq == 0xFF)
 		irq = 0;
 
+	// If possible, every qpair gets an MSI-X vector of its own, following the
+	// one of the admin queue.
+	uint32 vectorCount = 0;
 	if (pci->get_msix_count(pcidev)) {
 		uint32 msixVector = 0;
-		if (pci->configure_msix(pcidev, 1, &msixVector) == B_OK
-			&& pci->enable_msix(pcidev) == B_OK) {
-			TRACE_ALWAYS("using MSI-X\n");
+		if (pci->get_msix_count(pcidev) > try_qpairs
+			&& pci->configure_msix(pcidev, try_qpairs + 1, &msixVector)
+				== B_OK) {
+			vectorCount = try_qpairs + 1;
+		} else if (pci->configure_msix(pcidev, 1, &msixVector) == B_OK)
+			vectorCount = 1;
+
+		if (vectorCount > 0 && pci->enable_msix(pcidev) == B_OK) {
+			TRACE_ALWAYS("using MSI-X, %" B_PRIu32 " vectors\n", vectorCount);
 			irq = msixVector;
-		}
+		} else
+			vectorCount = 0;
 	} else if (pci->get_msi_count(pcidev) >= 1) {
 		uint32 msiVector = 0;
 		if (pci->configure_msi(pcidev, 1, &msiVector) == B_OK
@@ -260,7 +331,7 @@ nvme_disk_init_device(void* _info, void** _cookie)
 	} else {
 		info->polling = 0;
 	}
-	info->interrupt.Init(info, "nvme_disk interrupt");
+	info->irq = irq;
 	install_io_interrupt_handler(irq, nvme_interrupt_handler, (void*)info, B_NO_HANDLED_INFO);
 
 	if (info->ctrlr->feature_supported[NVME_FEAT_INTERRUPT_COALESCING]) {
@@ -339,22 +410,36 @@ nvme_disk_init_device(void* _info, void** _cookie)
 	}
 
 	// allocate qpairs
-	uint32 try_qpairs = cstat->io_qpairs;
-	try_qpairs = min_c(try_qpairs, NVME_MAX_QPAIRS);
-	if (try_qpairs >= (uint32)smp_get_num_cpus()) {
-		try_qpairs = smp_get_num_cpus();
-	} else {
-		// Find the highest number of qpairs that evenly divides the number of CPUs.
-		while ((smp_get_num_cpus() % try_qpairs) != 0)
-			try_qpairs--;
-	}
 	info->qpair_count = 0;
 	for (uint32 i = 0; i < try_qpairs; i++) {
-		info->qpairs[i].qpair = nvme_ioqp_get(info->ctrlr,
-			(enum nvme_qprio)0, 0);
-		if (info->qpairs[i].qpair == NULL)
+		qpair_info& qpinfo = info->qpairs[i];
+		uint16 vector = vectorCount > 1 ? i + 1 : 0;
+
+		qpinfo.qpair = nvme_ioqp_get_iv(info->ctrlr, (enum nvme_qprio)0, 0,
+			vector);
+		if (qpinfo.qpair == NULL)
 			break;
 
+		qpinfo.info = info;
+		qpinfo.irq = irq + vector;
+		qpinfo.interrupt.Init(&qpinfo, "nvme qpair interrupt");
+		qpinfo.queued = 0;
+		qpinfo.max_queued = 0;
+		qpinfo.commands = 0;
+		qpinfo.doorbells = 0;
+		qpinfo.merged_vecs = 0;
+		qpinfo.total_latency = 0;
+		qpinfo.max_latency = 0;
+
+		if (vector != 0) {
+			install_io_interrupt_handler(qpinfo.irq,
+				nvme_qpair_interrupt_handler, &qpinfo, B_NO_HANDLED_INFO);
+
+			// The qpair is used by the CPUs whose index modulo the qpair
+			// count matches its own; deliver its completions to the first.
+			assign_io_interrupt_to_cpu(qpinfo.irq, i);
+		}
+
 		info->qpair_count++;
 	}
 	if (info->qpair_count == 0) {
@@ -369,6 +454,8 @@ nvme_disk_init_device(void* _info, void** _cookie)
 	// allocate DMA buffers
 	int buffers = info->qpair_count * 2;
 
+	info->sgl_supported = cstat->sgl_supported;
+
 	dma_restrictions restrictions = {};
 	restrictions.alignment = B_PAGE_SIZE;
 		// Technically, the first and last segments in a transfer can be aligned
@@ -395,6 +482,18 @@ nvme_disk_init_device(void* _info, void** _cookie)
 	// set up rounded-write lock
 	rw_lock_init(&info->rounded_write_lock, "nvme rounded writes");
 
+	MutexLocker locker(sDeviceListLock);
+	if (sDeviceList == NULL) {
+		add_debugger_command_etc("nvme_disk_stats", &dump_nvme_disk_stats,
+			"Dump the queue statistics of all NVMe disks",
+			"\n"
+			"Prints the queue depth, latency, and merges of each qpair of all\n"
+			"NVMe disks.\n", 0);
+	}
+	info->next = sDeviceList;
+	sDeviceList = info;
+	locker.Unlock();
+
 	*_cookie = info;
 	return B_OK;
 }
@@ -406,8 +505,24 @@ nvme_disk_uninit_device(void* _cookie)
 	CALLED();
 	nvme_disk_driver_info* info = (nvme_disk_driver_info*)_cookie;
 
-	remove_io_interrupt_handler(info->info.u.h0.interrupt_line,
-		nvme_interrupt_handler, (void*)info);
+	MutexLocker locker(sDeviceListLock);
+	nvme_disk_driver_info** link = &sDeviceList;
+	while (*link != info)
+		link = &(*link)->next;
+	*link = info->next;
+	if (sDeviceList == NULL)
+		remove_debugger_command("nvme_disk_stats", &dump_nvme_disk_stats);
+	locker.Unlock();
+
+	for (uint32 i = 0; i < info->qpair_count; i++) {
+		qpair_info& qpinfo = info->qpairs[i];
+		if (qpinfo.irq != info->irq) {
+			remove_io_interrupt_handler(qpinfo.irq,
+				nvme_qpair_interrupt_handler, &qpinfo);
+		}
+	}
+	remove_io_interrupt_handler(info->irq, nvme_interrupt_handler,
+		(void*)info);
 
 	rw_lock_destroy(&info->rounded_write_lock);
 
@@ -465,12 +580,27 @@ static int32
 nvme_interrupt_handler(void* _info)
 {
 	nvme_disk_driver_info* info = (nvme_disk_driver_info*)_info;
-	info->interrupt.NotifyAll();
+
+	// Wake up the waiters of all qpairs that share this interrupt.
+	for (uint32 i = 0; i < info->qpair_count; i++) {
+		if (info->qpairs[i].irq == info->irq)
+			info->qpairs[i].interrupt.NotifyAll();
+	}
 	info->polling = -1;
 	return 0;
 }
 
 
+static int32
+nvme_qpair_interrupt_handler(void* _qpinfo)
+{
+	qpair_info* qpinfo = (qpair_info*)_qpinfo;
+	qpinfo->interrupt.NotifyAll();
+	qpinfo->info->polling = -1;
+	return 0;
+}
+
+
 static qpair_info*
 get_qpair(nvme_disk_driver_info* info)
 {
@@ -486,14 +616,15 @@ io_finished_callback(status_t* status, const struct nvme_cpl* cpl)
 
 
 static void
-await_status(nvme_disk_driver_info* info, struct nvme_qpair* qpair, status_t& status)
+await_status(nvme_disk_driver_info* info, qpair_info* qpinfo, status_t& status)
 {
 	CALLED();
 
+	struct nvme_qpair* qpair = qpinfo->qpair;
 	ConditionVariableEntry entry;
 	int timeouts = 0;
 	while (status == EINPROGRESS) {
-		info->interrupt.Add(&entry);
+		qpinfo->interrupt.Add(&entry);
 
 		nvme_qpair_poll(qpair, 0);
 
@@ -506,7 +637,7 @@ await_status(nvme_disk_driver_info* info, struct nvme_qpair* qpair, status_t& st
 			timeouts++;
 		} else if (entry.Wait(B_RELATIVE_TIMEOUT, 5 * 1000 * 1000) != B_OK) {
 			// This should never happen, as we are woken up on every interrupt
-			// no matter the qpair or transfer within; so if it does occur,
+			// of the qpair no matter the transfer within; so if it does occur,
 			// that probably means the controller stalled, or maybe cannot
 			// generate interrupts at all.
 
@@ -541,6 +672,8 @@ struct nvme_io_request {
 
 	int32 iovec_i;
 	uint32 iovec_offset;
+
+	bigtime_t submitted;
 };
 
 
@@ -578,12 +711,40 @@ ior_next_sge(nvme_io_request* request, uint64_t* address, uint32_t* length)
 }
 
 
+/*!	Merges physically contiguous entries of \a vecs in place, and updates
+	\a count accordingly. Returns the number of entries that were merged away.
+*/
+static int32
+merge_physical_entries(physical_entry* vecs, int32& count)
+{
+	if (count < 2)
+		return 0;
+
+	int32 last = 0;
+	for (int32 i = 1; i < count; i++) {
+		if (vecs[last].address + vecs[last].size == vecs[i].address
+				&& (uint64)vecs[last].size + vecs[i].size <= UINT32_MAX) {
+			vecs[last].size += vecs[i].size;
+			continue;
+		}
+
+		if (++last != i)
+			vecs[last] = vecs[i];
+	}
+
+	int32 merged = count - (last + 1);
+	count = last + 1;
+	return merged;
+}
+
+
 static status_t
-do_nvme_io_request(nvme_disk_driver_info* info, nvme_io_request* request)
+submit_nvme_io_request(nvme_disk_driver_info* info, qpair_info* qpinfo,
+	nvme_io_request* request)
 {
 	request->status = EINPROGRESS;
+	request->submitted = system_time();
 
-	qpair_info* qpinfo = get_qpair(info);
 	int ret = -1;
 	if (request->write) {
 		ret = nvme_ns_writev(info->ns, qpinfo->qpair, request->lba_start,
@@ -605,7 +766,36 @@ do_nvme_io_request(nvme_disk_driver_info* info, nvme_io_request* request)
 		return ret;
 	}
 
-	await_status(info, qpinfo->qpair, request->status);
+	int32 queued = atomic_add(&qpinfo->queued, 1) + 1;
+	int32 maxQueued;
+	while ((maxQueued = atomic_get(&qpinfo->max_queued)) < queued) {
+		if (atomic_test_and_set(&qpinfo->max_queued, queued, maxQueued)
+				== maxQueued) {
+			break;
+		}
+	}
+	atomic_add64(&qpinfo->commands, 1);
+	return B_OK;
+}
+
+
+static status_t
+await_nvme_io_request(nvme_disk_driver_info* info, qpair_info* qpinfo,
+	nvme_io_request* request)
+{
+	await_status(info, qpinfo, request->status);
+
+	atomic_add(&qpinfo->queued, -1);
+
+	bigtime_t latency = system_time() - request->submitted;
+	atomic_add64(&qpinfo->total_latency, latency);
+	int64 maxLatency;
+	while ((maxLatency = atomic_get64(&qpinfo->max_latency)) < latency) {
+		if (atomic_test_and_set64(&qpinfo->max_latency, latency, maxLatency)
+				== maxLatency) {
+			break;
+		}
+	}
 
 	if (request->status != B_OK) {
 		TRACE_ERROR("%s at LBA %" B_PRIdOFF " of %" B_PRIuSIZE
@@ -618,6 +808,22 @@ do_nvme_io_request(nvme_disk_driver_info* info, nvme_io_request* request)
 }
 
 
+static status_t
+do_nvme_io_request(nvme_disk_driver_info* info, nvme_io_request* request)
+{
+	qpair_info* qpinfo = get_qpair(info);
+
+	nvme_qpair_plug(qpinfo->qpair);
+	status_t status = submit_nvme_io_request(info, qpinfo, request);
+	if (nvme_qpair_unplug(qpinfo->qpair) != 0)
+		atomic_add64(&qpinfo->doorbells, 1);
+	if (status != B_OK)
+		return status;
+
+	return await_nvme_io_request(info, qpinfo, request);
+}
+
+
 static status_t
 nvme_disk_bounced_io(nvme_disk_handle* handle, io_request* request)
 {
@@ -757,11 +963,38 @@ nvme_disk_io(void* cookie, io_request* request)
 		}
 
 		nvme_request.iovecs = vtophys;
+	} else if (buffer->VecCount() > 1) {
+		// Copy the vecs, so that we can merge them without changing the
+		// buffer.
+		const int32 vecCount = buffer->VecCount();
+		if (vecCount <= 8) {
+			vtophys = (physical_entry*)alloca(sizeof(physical_entry) * vecCount);
+		} else {
+			vtophys = (physical_entry*)malloc(sizeof(physical_entry) * vecCount);
+			vtophysDeleter.SetTo(vtophys);
+		}
+		if (vtophys == NULL) {
+			TRACE_ERROR("failed to allocate memory for iovecs\n");
+			request->SetStatusAndNotify(B_NO_MEMORY);
+			return B_NO_MEMORY;
+		}
+
+		memcpy(vtophys, buffer->Vecs(), sizeof(physical_entry) * vecCount);
+		nvme_request.iovecs = vtophys;
+		nvme_request.iovec_count = vecCount;
 	} else {
 		nvme_request.iovecs = (physical_entry*)buffer->Vecs();
 		nvme_request.iovec_count = buffer->VecCount();
 	}
 
+	// Merge physically contiguous vecs, so that we need as few (and as large)
+	// commands as possible.
+	int32 mergedVecs = 0;
+	if (nvme_request.iovecs != NULL) {
+		mergedVecs = merge_physical_entries(nvme_request.iovecs,
+			nvme_request.iovec_count);
+	}
+
 	// See if we need to bounce anything other than the first or last vec.
 	const size_t block_size = handle->info->block_size;
 	bool bounceAll = (nvme_request.iovecs == NULL);
@@ -818,34 +1051,86 @@ nvme_disk_io(void* cookie, io_request* request)
 		return status;
 	}
 
-	const uint32 max_io_blocks = handle->info->max_io_blocks;
-	int32 remaining = nvme_request.iovec_count;
-	nvme_request.lba_start = rounded_pos / block_size;
-	while (remaining > 0) {
-		nvme_request.iovec_count = min_c(remaining,
-			NVME_MAX_SGL_DESCRIPTORS / 2);
-
-		nvme_request.lba_count = 0;
-		for (int i = 0; i < nvme_request.iovec_count; i++) {
-			uint32 new_lba_count = nvme_request.lba_count
+	// Split the request into as few commands as possible: each is limited
+	// by the maximum transfer size, and by the number of SGL descriptors, if
+	// we use them. PRP lists are only bounded by the transfer size.
+	nvme_disk_driver_info* info = handle->info;
+	const uint32 max_io_blocks = info->max_io_blocks;
+	const int32 max_vecs = info->sgl_supported
+		? NVME_MAX_SGL_DESCRIPTORS / 2 : nvme_request.iovec_count;
+
+	int32 commandCount = 0;
+	for (int32 i = 0; i < nvme_request.iovec_count; commandCount++) {
+		uint32 lba_count = 0;
+		for (int32 j = 0; j < max_vecs && i < nvme_request.iovec_count;
+				j++, i++) {
+			uint32 new_lba_count = lba_count
 				+ (nvme_request.iovecs[i].size / block_size);
-			if (nvme_request.lba_count > 0 && new_lba_count > max_io_blocks) {
+			if (lba_count > 0 && new_lba_count > max_io_blocks)
+				break;
+			lba_count = new_lba_count;
+		}
+	}
+
+	BStackOrHeapArray<nvme_io_request, 8> commands(commandCount);
+	if (!commands.IsValid()) {
+		request->SetStatusAndNotify(B_NO_MEMORY);
+		return B_NO_MEMORY;
+	}
+
+	off_t lba_start = rounded_pos / block_size;
+	physical_entry* iovecs = nvme_request.iovecs;
+	int32 remaining = nvme_request.iovec_count;
+	for (int32 i = 0; i < commandCount; i++) {
+		nvme_io_request& command = commands[i];
+		command = nvme_request;
+		command.iovecs = iovecs;
+		command.iovec_count = min_c(remaining, max_vecs);
+		command.lba_start = lba_start;
+
+		command.lba_count = 0;
+		for (int32 j = 0; j < command.iovec_count; j++) {
+			uint32 new_lba_count = command.lba_count
+				+ (command.iovecs[j].size / block_size);
+			if (command.lba_count > 0 && new_lba_count > max_io_blocks) {
 				// We already have a nonzero length, and adding this vec would
 				// make us go over (or we already are over.) Stop adding.
-				nvme_request.iovec_count = i;
+				command.iovec_count = j;
 				break;
 			}
 
-			nvme_request.lba_count = new_lba_count;
+			command.lba_count = new_lba_count;
 		}
 
-		status = do_nvme_io_request(handle->info, &nvme_request);
+		iovecs += command.iovec_count;
+		remaining -= command.iovec_count;
+		lba_start += command.lba_count;
+	}
+
+	// Submit all commands at once, so that the controller only needs to be
+	// notified once, and only then wait for them to complete.
+	qpair_info* qpinfo = get_qpair(info);
+	atomic_add64(&qpinfo->merged_vecs, mergedVecs);
+
+	int32 submitted = 0;
+	nvme_qpair_plug(qpinfo->qpair);
+	for (; submitted < commandCount; submitted++) {
+		status = submit_nvme_io_request(info, qpinfo, &commands[submitted]);
 		if (status != B_OK)
 			break;
-
-		nvme_request.iovecs += nvme_request.iovec_count;
-		remaining -= nvme_request.iovec_count;
-		nvme_request.lba_start += nvme_request.lba_count;
+	}
+	if (nvme_qpair_unplug(qpinfo->qpair) != 0)
+		atomic_add64(&qpinfo->doorbells, 1);
+
+	// Only the leading, successfully completed commands count as transferred.
+	generic_size_t transferred = 0;
+	for (int32 i = 0; i < submitted; i++) {
+		status_t commandStatus = await_nvme_io_request(info, qpinfo,
+			&commands[i]);
+		if (commandStatus != B_OK && status == B_OK)
+			status = commandStatus;
+		if (status == B_OK)
+			transferred += commands[i].lba_count * block_size;
 	}
 
 	if (status != B_OK)
@@ -853,8 +1138,7 @@ nvme_disk_io(void* cookie, io_request* request)
 
 	readLocker.Unlock();
 
-	request->SetTransferredBytes(status != B_OK,
-		(nvme_request.lba_start * block_size) - rounded_pos);
+	request->SetTransferredBytes(status != B_OK, transferred);
 	request->SetStatusAndNotify(status);
 	return status;
 }
@@ -918,7 +1202,7 @@ nvme_disk_flush(nvme_disk_driver_info* info)
 	if (ret != 0)
 		return ret;
 
-	await_status(info, qpinfo->qpair, status);
+	await_status(info, qpinfo, status);
 	return status;
 }
 
@@ -985,7 +1269,7 @@ nvme_disk_trim(nvme_disk_driver_info* info, fs_trim_data* trimData)
 			(nvme_cmd_cb)io_finished_callback, &status) != 0)
 		return B_IO_ERROR;
 
-	await_status(info, qpair->qpair, status);
+	await_status(info, qpair, status);
 	if (status != B_OK)
 		return status;
 
@@ -4,7 +4,7 @@
  */
 
 
-#include <condition_variable.h>
+#include <debug.h>
 #include <lock.h>
 #include <StackOrHeapArray.h>
 #include <util/AutoLock.h>
@@ -14,6 +14,7 @@
 
 
 class DMAResource;
+class IOOperation;
 class IOScheduler;
 
 
@@ -48,6 +49,18 @@ static const uint8 kDriveIcon[] = {
 #define VIRTIO_BLOCK_DEVICE_MODULE_NAME "drivers/disk/virtual/virtio_block/device_v1"
 #define VIRTIO_BLOCK_DEVICE_ID_GENERATOR	"virtio_block/device_id"
 
+#define VIRTIO_BLOCK_MAX_COMMANDS	128
+
+
+// the part of a request the device reads and writes, in the command buffer
+typedef struct {
+	struct virtio_blk_outhdr	header;
+	uint8						ack;
+} virtio_block_command;
+
+STATIC_ASSERT(VIRTIO_BLOCK_MAX_COMMANDS * sizeof(virtio_block_command)
+	<= B_PAGE_SIZE);
+
 
 typedef struct {
 	device_node*			node;
@@ -69,9 +82,12 @@ typedef struct {
 	uint32					physical_block_size;
 	status_t				media_status;
 
-	mutex					lock;
-	int32					currentRequest;
-	ConditionVariable		interruptCondition;
+	uint32					max_segments;
+
+	spinlock				lock;
+	uint32					queue_depth;
+	IOOperation*			operations[VIRTIO_BLOCK_MAX_COMMANDS];
+		// the operations in flight, indexed by their command
 } virtio_block_driver_info;
 
 
@@ -88,7 +104,7 @@ typedef struct {
 
 #include "dma_resources.h"
 #include "IORequest.h"
-#include "IOSchedulerSimple.h"
+#include "IOSchedulerRoster.h"
 
 
 //#define TRACE_VIRTIO_BLOCK
@@ -174,82 +190,113 @@ virtio_block_config_callback(void* driverCookie)
 }
 
 
+/*!	Completes the operations the device is done with. Called from the
+	interrupt handler of the queue.
+*/
 static void
 virtio_block_callback(void* driverCookie, void* _cookie)
 {
 	virtio_block_driver_info* info = (virtio_block_driver_info*)_cookie;
 
-	void* cookie = NULL;
-	while (info->virtio->queue_dequeue(info->virtio_queue, &cookie, NULL)) {
-		if ((int32)(addr_t)cookie == atomic_get(&info->currentRequest))
-			info->interruptCondition.NotifyAll();
+	while (true) {
+		InterruptsSpinLocker locker(info->lock);
+
+		void* cookie = NULL;
+		if (!info->virtio->queue_dequeue(info->virtio_queue, &cookie, NULL))
+			break;
+
+		uint32 index = (addr_t)cookie;
+		IOOperation* operation = info->operations[index];
+		uint8 ack = ((virtio_block_command*)info->bufferAddr)[index].ack;
+		info->operations[index] = NULL;
+
+		locker.Unlock();
+
+		size_t bytesTransferred = 0;
+		status_t status;
+		switch (ack) {
+			case VIRTIO_BLK_S_OK:
+				status = B_OK;
+				bytesTransferred = operation->Length();
+				break;
+			case VIRTIO_BLK_S_UNSUPP:
+				status = ENOTSUP;
+				break;
+			default:
+				status = EIO;
+				break;
+		}
+
+		info->io_scheduler->OperationCompleted(operation, status,
+			bytesTransferred);
 	}
 }
 
 
+/*!	Passes the operation to the device, and returns without waiting for it;
+	it is completed by virtio_block_callback().
+	Since the I/O scheduler calls this from any thread that schedules a
+	request, there can be up to queue_depth operations in flight.
+*/
 static status_t
 do_io(void* cookie, IOOperation* operation)
 {
 	virtio_block_driver_info* info = (virtio_block_driver_info*)cookie;
 
-	MutexTryLocker locker(&info->lock);
-	if (!locker.IsLocked())
-		return B_BUSY;
-
 	BStackOrHeapArray<physical_entry, 16> entries(operation->VecCount() + 2);
+	if (!entries.IsValid()) {
+		info->io_scheduler->OperationCompleted(operation, B_NO_MEMORY, 0);
+		return B_NO_MEMORY;
+	}
 
-	struct virtio_blk_outhdr *header = (struct virtio_blk_outhdr*)info->bufferAddr;
-	header->type = operation->IsWrite() ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
-	header->sector = operation->Offset() / 512;
-	header->ioprio = 1;
+	InterruptsSpinLocker locker(info->lock);
 
-	uint8* ack = (uint8*)info->bufferAddr + sizeof(struct virtio_blk_outhdr);
-	*ack = 0xff;
+	uint32 index = 0;
+	while (index < info->queue_depth && info->operations[index] != NULL)
+		index++;
+	if (index == info->queue_depth) {
+		// The I/O scheduler never passes us more operations than that
+		locker.Unlock();
+		ERROR("no free command for operation %p\n", operation);
+		info->io_scheduler->OperationCompleted(operation, B_BUSY, 0);
+		return B_BUSY;
+	}
 
-	entries[0].address = info->bufferPhysAddr;
+	virtio_block_command* command
+		= &((virtio_block_command*)info->bufferAddr)[index];
+	command->header.type = operation->IsWrite()
+		? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+	command->header.sector = operation->Offset() / 512;
+	command->header.ioprio = 1;
+	command->ack = 0xff;
+
+	phys_addr_t commandAddress = info->bufferPhysAddr
+		+ index * sizeof(virtio_block_command);
+	entries[0].address = commandAddress
+		+ offsetof(virtio_block_command, header);
 	entries[0].size = sizeof(struct virtio_blk_outhdr);
-	entries[operation->VecCount() + 1].address = entries[0].address
-		+ sizeof(struct virtio_blk_outhdr);
+	entries[operation->VecCount() + 1].address = commandAddress
+		+ offsetof(virtio_block_command, ack);
 	entries[operation->VecCount() + 1].size = sizeof(uint8);
 
 	memcpy(entries + 1, operation->Vecs(), operation->VecCount()
 		* sizeof(physical_entry));
 
-	atomic_add(&info->currentRequest, 1);
+	info->operations[index] = operation;
 
-	ConditionVariableEntry entry;
-	info->interruptCondition.Add(&entry);
-
-	status_t result = info->virtio->queue_request_v(info->virtio_queue, entries,
-		1 + (operation->IsWrite() ? operation->VecCount() : 0 ),
+	status_t status = info->virtio->queue_request_v(info->virtio_queue,
+		entries, 1 + (operation->IsWrite() ? operation->VecCount() : 0 ),
 		1 + (operation->IsWrite() ? 0 : operation->VecCount()),
-		(void *)(addr_t)info->currentRequest);
-
-	if (result == B_OK)
-		result = entry.Wait(B_RELATIVE_TIMEOUT, 10 * 1000 * 1000);
+		(void *)(addr_t)index);
+	if (status != B_OK) {
+		info->operations[index] = NULL;
+		locker.Unlock();
 
-	size_t bytesTransferred = 0;
-	status_t status = B_OK;
-	if (result != B_OK) {
-		status = EIO;
-	} else {
-		switch (*ack) {
-			case VIRTIO_BLK_S_OK:
-				status = B_OK;
-				bytesTransferred = operation->Length();
-				break;
-			case VIRTIO_BLK_S_UNSUPP:
-				status = ENOTSUP;
-				break;
-			default:
-				status = EIO;
-				break;
-		}
+		info->io_scheduler->OperationCompleted(operation, EIO, 0);
+		return EIO;
 	}
 
-	info->io_scheduler->OperationCompleted(operation, status,
-		bytesTransferred);
-	return status;
+	return B_OK;
 }
 
 
@@ -298,6 +345,37 @@ virtio_block_init_device(void* _info, void** _cookie)
 		return status;
 	}
 
+	// Without indirect descriptors, every vector of a request takes up an
+	// entry in the ring. With them, a request takes up a single entry, but
+	// the ring still needs to have room for all of its vectors.
+	int32 queueSize = info->virtio->queue_size(info->virtio_queue);
+	int32 requestSize = info->max_segments + 2;
+	int32 queueDepth = queueSize / requestSize;
+	if ((info->features & VIRTIO_FEATURE_RING_INDIRECT_DESC) != 0)
+		queueDepth = queueSize - requestSize + 1;
+	info->queue_depth = max_c(1, min_c(queueDepth, VIRTIO_BLOCK_MAX_COMMANDS));
+
+	// The device takes requests from any CPU, and do_io() doesn't wait for
+	// them, so we don't need the threads of the simple scheduler.
+	info->io_scheduler = IOSchedulerRoster::CreateScheduler(
+		info->dma_resource, 1, info->queue_depth);
+	if (info->io_scheduler == NULL)
+		return B_NO_MEMORY;
+
+	// TODO: use whole device name here
+	status = info->io_scheduler->Init("virtio");
+	if (status != B_OK) {
+		ERROR("initializing IOScheduler failed (%s)\n", strerror(status));
+		delete info->io_scheduler;
+		info->io_scheduler = NULL;
+		return status;
+	}
+
+	info->io_scheduler->SetCallback(do_io, info);
+
+	TRACE("queue size %" B_PRId32 ", queue depth %" B_PRIu32 "\n", queueSize,
+		info->queue_depth);
+
 	status = info->virtio->setup_interrupt(info->virtio_device,
 		virtio_block_config_callback, info);
 
@@ -468,12 +546,18 @@ virtio_block_set_capacity(virtio_block_driver_info* info)
 		panic("updating DMAResource not yet implemented...");
 	}
 
+	// the DMAResource default, which we need to know for the queue depth
+	info->max_segments = 16;
+
 	dma_restrictions restrictions;
 	memset(&restrictions, 0, sizeof(restrictions));
 	if ((info->features & VIRTIO_BLK_F_SIZE_MAX) != 0)
 		restrictions.max_segment_size = info->config.size_max;
-	if ((info->features & VIRTIO_BLK_F_SEG_MAX) != 0)
-		restrictions.max_segment_count = info->config.seg_max;
+	if ((info->features & VIRTIO_BLK_F_SEG_MAX) != 0
+		&& info->config.seg_max != 0) {
+		info->max_segments = info->config.seg_max;
+	}
+	restrictions.max_segment_count = info->max_segments;
 
 	// TODO: we need to replace the DMAResource in our IOScheduler
 	status_t status = info->dma_resource->Init(restrictions, blockSize,
@@ -481,18 +565,6 @@ virtio_block_set_capacity(virtio_block_driver_info* info)
 	if (status != B_OK)
 		panic("initializing DMAResource failed: %s", strerror(status));
 
-	info->io_scheduler = new(std::nothrow) IOSchedulerSimple(
-		info->dma_resource);
-	if (info->io_scheduler == NULL)
-		panic("allocating IOScheduler failed.");
-
-	// TODO: use whole device name here
-	status = info->io_scheduler->Init("virtio");
-	if (status != B_OK)
-		panic("initializing IOScheduler failed: %s", strerror(status));
-
-	info->io_scheduler->SetCallback(do_io, info);
-
 	info->block_size = blockSize;
 	info->physical_block_size = physicalBlockSize;
 	return true;
@@ -582,9 +654,7 @@ virtio_block_init_driver(device_node *node, void **cookie)
 	}
 
 	info->bufferPhysAddr = entry.address;
-	info->interruptCondition.Init(info, "virtio block transfer");
-	info->currentRequest = 0;
-	mutex_init(&info->lock, "virtio block request");
+	B_INITIALIZE_SPINLOCK(&info->lock);
 
 	info->node = node;
 
@@ -598,7 +668,6 @@ virtio_block_uninit_driver(void *_cookie)
 {
 	CALLED();
 	virtio_block_driver_info* info = (virtio_block_driver_info*)_cookie;
-	mutex_destroy(&info->lock);
 	delete_area(info->bufferArea);
 	free(info);
 }
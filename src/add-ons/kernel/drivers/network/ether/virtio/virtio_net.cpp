@@ -9,7 +9,9 @@
 #include <netinet/in.h>
 #include <netinet/ip.h>
 #include <netinet/ip6.h>
+#include <netinet/tcp.h>
 #include <sys/sockio.h>
+#include <sys/uio.h>
 
 #include <ethernet.h>
 #include <kernel.h>
@@ -30,6 +32,7 @@
 
 #define BUFFER_SIZE	2048
 #define MAX_FRAME_SIZE 1536
+#define MAX_SEGMENTATION_VECS	128
 
 
 struct virtio_net_rx_hdr {
@@ -52,6 +55,8 @@ struct BufInfo : DoublyLinkedListLinkImpl<BufInfo> {
 	physical_entry			entry;
 	physical_entry			hdrEntry;
 	uint32					rxUsedLength;
+	net_buffer*				txBuffer;
+		// only set for buffers that are sent in place
 };
 
 
@@ -182,12 +187,61 @@ get_feature_name(uint64 feature)
 }
 
 
+static void
+virtio_net_tx_free_buf(virtio_net_driver_info* info, BufInfo* buf)
+{
+	if (buf->txBuffer != NULL) {
+		sBufferModule->free(buf->txBuffer);
+		buf->txBuffer = NULL;
+	}
+	info->txFreeList.Add(buf);
+}
+
+
+/*!	Waits until the host has finished at least one transmission, and puts
+	the completed buffers back on the free list. Must be called with the tx
+	lock held, which is released while waiting.
+*/
+static status_t
+virtio_net_wait_for_tx(virtio_net_driver_info* info)
+{
+	if (info->nonblocking)
+		return B_WOULD_BLOCK;
+
+	mutex_unlock(&info->txLock);
+
+	status_t status = acquire_sem(info->txDone);
+	if (status != B_OK) {
+		ERROR("acquire_sem(txDone) failed (%s)\n", strerror(status));
+		mutex_lock(&info->txLock);
+		return status;
+	}
+
+	int32 semCount = 0;
+	get_sem_count(info->txDone, &semCount);
+	if (semCount > 0)
+		acquire_sem_etc(info->txDone, semCount, B_RELATIVE_TIMEOUT, 0);
+
+	mutex_lock(&info->txLock);
+	while (info->txDone != -1) {
+		BufInfo* buf = NULL;
+		if (!info->virtio->queue_dequeue(info->txQueues[0], (void**)&buf,
+				NULL) || buf == NULL) {
+			break;
+		}
+
+		virtio_net_tx_free_buf(info, buf);
+	}
+	return B_OK;
+}
+
+
 static status_t
 virtio_net_drain_queues(virtio_net_driver_info* info)
 {
 	BufInfo* buf = NULL;
 	while (info->virtio->queue_dequeue(info->txQueues[0], (void**)&buf, NULL))
-		info->txFreeList.Add(buf);
+		virtio_net_tx_free_buf(info, buf);
 
 	while (info->virtio->queue_dequeue(info->rxQueues[0], NULL, NULL))
 		;
@@ -297,6 +351,7 @@ virtio_net_init_device(void* _info, void** _cookie)
 	info->virtio->negotiate_features(info->virtio_device,
 		VIRTIO_NET_F_STATUS | VIRTIO_NET_F_MAC | VIRTIO_NET_F_MTU
 			| VIRTIO_NET_F_CTRL_VQ | VIRTIO_NET_F_CTRL_RX | VIRTIO_NET_F_GUEST_CSUM
+			| VIRTIO_NET_F_CSUM | VIRTIO_NET_F_HOST_TSO4 | VIRTIO_NET_F_HOST_TSO6
 			/* | VIRTIO_NET_F_MQ */,
 		&info->features, &get_feature_name);
 
@@ -413,6 +468,7 @@ virtio_net_init_device(void* _info, void** _cookie)
 		buf->hdr = (struct virtio_net_hdr*)((addr_t)txBuffer
 			+ i * BUFFER_SIZE);
 		buf->buffer = (char*)((addr_t)buf->hdr + sizeof(virtio_net_tx_hdr));
+		buf->txBuffer = NULL;
 
 		status = get_memory_map(buf->buffer,
 			BUFFER_SIZE - sizeof(virtio_net_tx_hdr), &buf->entry, 1);
@@ -718,6 +774,132 @@ virtio_net_txDone(void* driverCookie, void* cookie)
 }
 
 
+/*!	Prepares the header of \a buf for letting the host split the oversized
+	TCP segment in \a buffer, and fills in the pseudo header checksum that
+	the host completes for each of the segments.
+*/
+static status_t
+virtio_net_prepare_segmentation(virtio_net_driver_info* info, BufInfo* buf,
+	net_buffer* buffer)
+{
+	uint8 headers[sizeof(ip6_hdr) + sizeof(tcphdr)];
+	if (buffer->size < ETHER_HEADER_LENGTH + sizeof(headers)
+		|| sBufferModule->read(buffer, ETHER_HEADER_LENGTH, headers,
+			sizeof(headers)) != B_OK)
+		return B_BAD_DATA;
+
+	uint32 sum = 0;
+	size_t ipLength;
+	uint8 gsoType;
+	switch (headers[0] >> 4) {
+		case 4:
+		{
+			const struct ip* header = (const struct ip*)headers;
+			if ((info->features & VIRTIO_NET_F_HOST_TSO4) == 0
+				|| header->ip_p != IPPROTO_TCP)
+				return B_NOT_SUPPORTED;
+
+			ipLength = header->ip_hl * 4;
+			gsoType = VIRTIO_NET_HDR_GSO_TCPV4;
+			for (int32 i = 0; i < 4; i++)
+				sum += ((const uint16*)&header->ip_src)[i];
+			break;
+		}
+		case 6:
+		{
+			const ip6_hdr* header = (const ip6_hdr*)headers;
+			if ((info->features & VIRTIO_NET_F_HOST_TSO6) == 0
+				|| header->ip6_nxt != IPPROTO_TCP)
+				return B_NOT_SUPPORTED;
+
+			ipLength = sizeof(ip6_hdr);
+			gsoType = VIRTIO_NET_HDR_GSO_TCPV6;
+			for (int32 i = 0; i < 16; i++)
+				sum += ((const uint16*)&header->ip6_src)[i];
+			break;
+		}
+		default:
+			return B_NOT_SUPPORTED;
+	}
+
+	const size_t tcpOffset = ETHER_HEADER_LENGTH + ipLength;
+	uint8 tcpHeaderLength;
+	if (sBufferModule->read(buffer, tcpOffset + 12, &tcpHeaderLength,
+			sizeof(tcpHeaderLength)) != B_OK)
+		return B_BAD_DATA;
+
+	sum += htons(IPPROTO_TCP) + htons(buffer->size - tcpOffset);
+	while ((sum >> 16) != 0)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	uint16 checksum = sum;
+	status_t status = sBufferModule->write(buffer,
+		tcpOffset + offsetof(tcphdr, th_sum), &checksum, sizeof(checksum));
+	if (status != B_OK)
+		return status;
+
+	memset(buf->hdr, 0, sizeof(virtio_net_hdr));
+	buf->hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+	buf->hdr->gso_type = gsoType;
+	buf->hdr->hdr_len = tcpOffset + (tcpHeaderLength >> 4) * 4;
+	buf->hdr->gso_size = buffer->segment_size;
+	buf->hdr->csum_start = tcpOffset;
+	buf->hdr->csum_offset = offsetof(tcphdr, th_sum);
+	return B_OK;
+}
+
+
+/*!	Queues the oversized TCP segment in \a buffer without copying it; the
+	host splits it into segments. \a buffer is freed once the host is done
+	with it. Must be called with the tx lock held.
+	Returns \c B_BUFFER_OVERFLOW if \a buffer consists of too many pieces to
+	ever be queued at once, and \c B_BUSY if the ring is currently short of
+	the descriptors it needs.
+*/
+static status_t
+virtio_net_send_segmentation(virtio_net_driver_info* info, BufInfo* buf,
+	net_buffer* buffer)
+{
+	uint32 vecCount = sBufferModule->count_iovecs(buffer);
+	if (vecCount + 1 > MAX_SEGMENTATION_VECS)
+		return B_BUFFER_OVERFLOW;
+
+	status_t status = virtio_net_prepare_segmentation(info, buf, buffer);
+	if (status != B_OK)
+		return status;
+
+	iovec vecs[vecCount];
+	vecCount = sBufferModule->get_iovecs(buffer, vecs, vecCount);
+
+	physical_entry entries[MAX_SEGMENTATION_VECS];
+	entries[0] = buf->hdrEntry;
+	entries[0].size = sizeof(virtio_net_hdr);
+	uint32 count = 1;
+
+	for (uint32 i = 0; i < vecCount; i++) {
+		uint32 entryCount = MAX_SEGMENTATION_VECS - count;
+		status = get_memory_map_etc(B_CURRENT_TEAM, vecs[i].iov_base,
+			vecs[i].iov_len, entries + count, &entryCount);
+		if (status != B_OK)
+			return status;
+		count += entryCount;
+	}
+
+	status = info->virtio->queue_request_v(info->txQueues[0], entries, count,
+		0, buf);
+	if (status != B_OK) {
+		if (status != B_BUSY) {
+			ERROR("tx queueing on queue %d failed (%s)\n", 0,
+				strerror(status));
+		}
+		return status;
+	}
+
+	buf->txBuffer = buffer;
+	return B_OK;
+}
+
+
 static status_t
 virtio_net_send(void* cookie, net_buffer* buffer)
 {
@@ -727,33 +909,33 @@ virtio_net_send(void* cookie, net_buffer* buffer)
 
 	mutex_lock(&info->txLock);
 	while (info->txFreeList.Head() == NULL) {
-		mutex_unlock(&info->txLock);
-		if (info->nonblocking)
-			return B_WOULD_BLOCK;
-
-		status_t status = acquire_sem(info->txDone);
+		status_t status = virtio_net_wait_for_tx(info);
 		if (status != B_OK) {
-			ERROR("acquire_sem(txDone) failed (%s)\n", strerror(status));
+			mutex_unlock(&info->txLock);
 			return status;
 		}
+	}
+	BufInfo* buf = info->txFreeList.RemoveHead();
 
-		int32 semCount = 0;
-		get_sem_count(info->txDone, &semCount);
-		if (semCount > 0)
-			acquire_sem_etc(info->txDone, semCount, B_RELATIVE_TIMEOUT, 0);
-
-		mutex_lock(&info->txLock);
-		while (info->txDone != -1) {
-			BufInfo* buf = NULL;
-			if (!info->virtio->queue_dequeue(info->txQueues[0], (void**)&buf,
-					NULL) || buf == NULL) {
-				break;
-			}
-
-			info->txFreeList.Add(buf);
+	if ((buffer->buffer_flags & NET_BUFFER_TCP_SEGMENTATION) != 0) {
+		status_t status = virtio_net_send_segmentation(info, buf, buffer);
+		while (status == B_BUSY
+			&& !info->virtio->queue_is_empty(info->txQueues[0])) {
+			// The ring is short of descriptors for this frame; wait for the
+			// host to finish earlier ones instead of dropping it.
+			status = virtio_net_wait_for_tx(info);
+			if (status == B_OK)
+				status = virtio_net_send_segmentation(info, buf, buffer);
+		}
+		if (status == B_BUSY) {
+			// it does not even fit into the empty ring
+			status = B_BUFFER_OVERFLOW;
 		}
+		if (status != B_OK)
+			info->txFreeList.Add(buf);
+		mutex_unlock(&info->txLock);
+		return status;
 	}
-	BufInfo* buf = info->txFreeList.RemoveHead();
 
 	const size_t size = MIN(MAX_FRAME_SIZE, buffer->size);
 	TRACE("virtio_net_write: copying %lu\n", size);
@@ -926,6 +1108,18 @@ virtio_net_ioctl(void* cookie, uint32 op, void* buffer, size_t length)
 				return B_BAD_ADDRESS;
 			return virtio_net_receive(cookie, (net_buffer**)buffer);
 
+		case ETHER_GET_OFFLOAD_CAPABILITIES:
+		{
+			uint32 offload = 0;
+			if ((info->features & VIRTIO_NET_F_HOST_TSO4) != 0)
+				offload |= ETHER_OFFLOAD_TSO4;
+			if ((info->features & VIRTIO_NET_F_HOST_TSO6) != 0)
+				offload |= ETHER_OFFLOAD_TSO6;
+			if (length != sizeof(offload))
+				return B_BAD_VALUE;
+			return user_memcpy(buffer, &offload, sizeof(offload));
+		}
+
 		case SIOCGIFSTATS:
 			break;
 
@@ -2342,6 +2342,66 @@ BPlusTree::Find(const uint8* key, uint16 keyLength, off_t* _value)
 
 
 #if !_BOOT_MODE
+/*!	Estimates where \a key would be positioned in the tree, as a fraction of
+	\a scale: 0 means before the first key, and \a scale after the last one.
+	Only a single node is read per level; the estimate assumes that all nodes
+	of a level hold the same number of keys, and it ignores duplicates.
+*/
+status_t
+BPlusTree::EstimatePosition(const uint8* key, uint16 keyLength, uint32 scale,
+	uint32* _position)
+{
+	if (key == NULL || keyLength < BPLUSTREE_MIN_KEY_LENGTH)
+		RETURN_ERROR(B_BAD_VALUE);
+
+	if (keyLength > BPLUSTREE_MAX_KEY_LENGTH)
+		RETURN_ERROR(B_NAME_TOO_LONG);
+
+	InodeReadLocker locker(fStream);
+
+	off_t nodeOffset = fHeader.RootNode();
+	CachedNode cached(this);
+	const bplustree_node* node;
+	uint64 position = 0;
+	uint64 range = scale;
+	uint32 levels = 0;
+
+	while ((node = cached.SetTo(nodeOffset)) != NULL) {
+		uint16 keyIndex = 0;
+		off_t nextOffset;
+		status_t status = _FindKey(node, key, keyLength, &keyIndex,
+			&nextOffset);
+		if (status != B_OK && status != B_ENTRY_NOT_FOUND)
+			return status;
+
+		if (node->OverflowLink() == BPLUSTREE_NULL) {
+			// the key index is the number of smaller keys in this node
+			if (node->NumKeys() > 0)
+				position += range * keyIndex / node->NumKeys();
+
+			*_position = min_c(position, scale);
+			return B_OK;
+		}
+		if (nextOffset == nodeOffset || ++levels > fHeader.MaxNumberOfLevels())
+			RETURN_ERROR(B_BAD_DATA);
+
+		// the overflow link is the last of the children
+		uint32 children = node->NumKeys() + 1;
+		position += range * keyIndex / children;
+		range /= children;
+		if (range == 0)
+			break;
+
+		nodeOffset = nextOffset;
+	}
+	if (node == NULL)
+		RETURN_ERROR(B_IO_ERROR);
+
+	*_position = min_c(position, scale);
+	return B_OK;
+}
+
+
 status_t
 BPlusTree::_ValidateChildren(TreeCheck& check, uint32 level, off_t offset,
 	const uint8* largestKey, uint16 largestKeyLength,
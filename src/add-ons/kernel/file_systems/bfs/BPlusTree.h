@@ -302,6 +302,10 @@ public:
 									off_t* value);
 
 #if !_BOOT_MODE
+			status_t			EstimatePosition(const uint8* key,
+									uint16 keyLength, uint32 scale,
+									uint32* _position);
+
 	static	int32				TypeCodeToKeyType(type_code code);
 	static	int32				ModeToKeyType(mode_t mode);
 
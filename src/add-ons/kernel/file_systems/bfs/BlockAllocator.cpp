@@ -997,10 +997,14 @@ BlockAllocator::Allocate(Transaction& transaction, Inode* inode,
 
 	// Are there already allocated blocks? (then just try to allocate near the
 	// last one)
-	if (inode->Size() > 0) {
+	block_run last = inode->LastAllocation();
+	if (!last.IsZero()) {
+		// the inode remembers where its stream was grown last, this also
+		// covers the indirect ranges
+		group = last.AllocationGroup();
+		start = last.Start() + last.Length();
+	} else if (inode->Size() > 0) {
 		const data_stream& data = inode->Node().data;
-		// TODO: we currently don't care for when the data stream
-		// is already grown into the indirect ranges
 		if (data.max_double_indirect_range == 0
 			&& data.max_indirect_range == 0) {
 			// Since size > 0, there must be a valid block run in this stream
@@ -29,16 +29,69 @@ struct check_index {
 };
 
 
+/*!	The outcome of checking the blocks of a single inode. When files are
+	checked in parallel, a node is passed from the visitor to one of the
+	workers, and back.
+*/
+struct check_node : DoublyLinkedListLinkImpl<check_node> {
+	check_node()
+	{
+		Clear();
+	}
+
+	void Clear()
+	{
+		inode = NULL;
+		errors = 0;
+		status = B_OK;
+		memset(&stats, 0, sizeof(stats));
+		last_run_end = 0;
+		fragments = 0;
+	}
+
+	Inode*				inode;
+	char				name[B_FILE_NAME_LENGTH];
+	uint32				errors;
+	status_t			status;
+	check_stats			stats;
+	off_t				last_run_end;
+	uint32				fragments;
+		// contiguous pieces of the data stream
+};
+
+
+static const uint32 kMaxCheckThreads = 16;
+static const uint32 kNodesPerThread = 8;
+	// limits the number of nodes waiting to be checked, or reported
+static const uint32 kMaxCheckBitmapSize = 16 * 1024 * 1024;
+	// covers 256 GB with 2 KB blocks in a single window
+
+
 CheckVisitor::CheckVisitor(Volume* volume)
 	:
 	FileSystemVisitor(volume),
-	fCheckBitmap(NULL)
+	fCheckBitmap(NULL),
+	fWindowStart(0),
+	fWindowEnd(0),
+	fWindowBlocks(0),
+	fUsedBlocks(0),
+	fNodes(NULL),
+	fQueuedSem(-1),
+	fCheckedSem(-1),
+	fWorkers(NULL),
+	fWorkerCount(0),
+	fPendingNodes(0),
+	fNodeQueued(false),
+	fTraversed(false)
 {
+	mutex_init(&fNodesLock, "bfs check nodes");
 }
 
 
 CheckVisitor::~CheckVisitor()
 {
+	_StopWorkers();
+	mutex_destroy(&fNodesLock);
 	free(fCheckBitmap);
 }
 
@@ -53,8 +106,20 @@ CheckVisitor::StartBitmapPass()
 	GetVolume()->GetJournal(0)->Lock(NULL, true);
 	recursive_lock_lock(&GetVolume()->Allocator().Lock());
 
-	size_t size = _BitmapSize();
-	fCheckBitmap = (uint32*)malloc(size);
+	// The check bitmap covers as many whole allocation groups as fit into
+	// the memory we want to spend on it. If that's not the whole volume,
+	// all nodes are visited again for each further window of groups.
+	uint32 maxSize = Control().max_bitmap_size != 0
+		? Control().max_bitmap_size : kMaxCheckBitmapSize;
+	uint32 groupShift = GetVolume()->AllocationGroupShift();
+	off_t groups = max_c(((off_t)maxSize * 8) >> groupShift, 1);
+
+	fWindowBlocks = groups << groupShift;
+	fWindowStart = 0;
+	fWindowEnd = min_c(fWindowBlocks, GetVolume()->NumBlocks());
+	fUsedBlocks = 0;
+
+	fCheckBitmap = (uint32*)malloc(_BitmapSize());
 	if (fCheckBitmap == NULL) {
 		recursive_lock_unlock(&GetVolume()->Allocator().Lock());
 		GetVolume()->GetJournal(0)->Unlock(NULL, true);
@@ -62,17 +127,22 @@ CheckVisitor::StartBitmapPass()
 	}
 
 	memset(&Control().stats, 0, sizeof(check_control::stats));
-
-	// initialize bitmap
-	memset(fCheckBitmap, 0, size);
-	for (off_t block = GetVolume()->ToBlock(GetVolume()->Log())
-		+ GetVolume()->Log().Length(); block-- > 0;) {
-		_SetCheckBitmapAt(block);
-	}
+	_ClearWindow();
 
 	Control().pass = BFS_CHECK_PASS_BITMAP;
 	Control().stats.block_size = GetVolume()->BlockSize();
 
+	if (Control().threads > 0) {
+		status_t status = _StartWorkers();
+		if (status != B_OK) {
+			free(fCheckBitmap);
+			fCheckBitmap = NULL;
+			recursive_lock_unlock(&GetVolume()->Allocator().Lock());
+			GetVolume()->GetJournal(0)->Unlock(NULL, true);
+			return status;
+		}
+	}
+
 	// TODO: check reserved area in bitmap!
 
 	Start(VISIT_REGULAR | VISIT_INDICES | VISIT_REMOVED
@@ -82,80 +152,164 @@ CheckVisitor::StartBitmapPass()
 }
 
 
+/*!	Visits the next node, and reports it in Control(). When files are
+	checked in parallel, the traversal runs ahead of the reports, and the
+	nodes are reported in the order their check has been completed.
+*/
+status_t
+CheckVisitor::NextNode()
+{
+	if (fWorkerCount == 0 || Pass() == BFS_CHECK_PASS_INDEX)
+		return Next();
+
+	while (true) {
+		if (acquire_sem_etc(fCheckedSem, 1, B_RELATIVE_TIMEOUT, 0) == B_OK)
+			return _ReportNode();
+
+		if (!fTraversed && fPendingNodes < fWorkerCount * kNodesPerThread) {
+			fNodeQueued = false;
+			Control().errors = 0;
+
+			status_t status = Next();
+			if (status == B_ENTRY_NOT_FOUND) {
+				fTraversed = true;
+				continue;
+			}
+			if (status != B_OK || !fNodeQueued) {
+				// this node has been checked right away
+				return status;
+			}
+			continue;
+		}
+
+		if (fPendingNodes == 0)
+			return B_ENTRY_NOT_FOUND;
+
+		// wait for one of the workers
+		status_t status = acquire_sem(fCheckedSem);
+		if (status != B_OK)
+			return status;
+
+		return _ReportNode();
+	}
+}
+
+
+/*!	Compares the check bitmap of the current window with the block bitmap
+	on disk, and replaces the bitmap blocks that differ, if asked to. The
+	number of blocks that could be freed is known after the last window.
+*/
 status_t
 CheckVisitor::WriteBackCheckBitmap()
 {
 	if (GetVolume()->IsReadOnly())
 		return B_OK;
 
-	// calculate the number of used blocks in the check bitmap
-	size_t size = _BitmapSize();
-	off_t usedBlocks = 0LL;
+	size_t blockSize = GetVolume()->BlockSize();
+	uint32 wordsPerBlock = blockSize / sizeof(uint32);
+	uint32 numBitmapBlocks = _BitmapSize() / blockSize;
+	off_t firstBitmapBlock = 1 + fWindowStart / (blockSize * 8);
+	bool fixErrors = (Control().flags & BFS_FIX_BITMAP_ERRORS) != 0;
+
+	CachedBlock cached(GetVolume());
+	Transaction transaction;
+	uint32 blocksWritten = 0;
 
 	// TODO: update the allocation groups used blocks info
-	for (uint32 i = size >> 2; i-- > 0;) {
-		uint32 compare = 1;
-		// Count the number of bits set
-		for (int16 j = 0; j < 32; j++, compare <<= 1) {
-			if ((compare & fCheckBitmap[i]) != 0)
-				usedBlocks++;
+	for (uint32 i = 0; i < numBitmapBlocks; i++) {
+		const uint32* checkBlock = fCheckBitmap + i * wordsPerBlock;
+
+		// calculate the number of used blocks in the check bitmap
+		for (uint32 j = 0; j < wordsPerBlock; j++) {
+			uint32 compare = 1;
+			// Count the number of bits set
+			for (int16 k = 0; k < 32; k++, compare <<= 1) {
+				if ((compare & checkBlock[j]) != 0)
+					fUsedBlocks++;
+			}
+		}
+
+		if (!fixErrors)
+			continue;
+
+		status_t status = cached.SetTo(firstBitmapBlock + i);
+		if (status != B_OK)
+			return status;
+
+		if (memcmp(cached.Block(), checkBlock, blockSize) == 0)
+			continue;
+
+		// Write the check bitmap back over the original one, and use
+		// transactions here to play safe - we even use several transactions,
+		// so that we don't blow the maximum log size on large disks, since
+		// we don't need to make this atomic.
+		if (!transaction.IsStarted()) {
+			status = transaction.Start(GetVolume(), firstBitmapBlock + i);
+			if (status != B_OK)
+				return status;
+		}
+
+		status = cached.MakeWritable(transaction);
+		if (status != B_OK) {
+			FATAL(("error writing bitmap: %s\n", strerror(status)));
+			return status;
+		}
+		memcpy(cached.WritableBlock(), checkBlock, blockSize);
+
+		if (++blocksWritten % 512 == 0) {
+			cached.Unset();
+			status = transaction.Done();
+			if (status != B_OK)
+				return status;
 		}
 	}
 
-	Control().stats.freed = GetVolume()->UsedBlocks() - usedBlocks
+	cached.Unset();
+	if (transaction.IsStarted()) {
+		status_t status = transaction.Done();
+		if (status != B_OK)
+			return status;
+	}
+
+	if (fWindowEnd < GetVolume()->NumBlocks())
+		return B_OK;
+
+	Control().stats.freed = GetVolume()->UsedBlocks() - fUsedBlocks
 		+ Control().stats.missing;
 	if (Control().stats.freed < 0)
 		Control().stats.freed = 0;
 
-	// Should we fix errors? Were there any errors we can fix?
-	if ((Control().flags & BFS_FIX_BITMAP_ERRORS) != 0
+	if (fixErrors
 		&& (Control().stats.freed != 0 || Control().stats.missing != 0)) {
-		// If so, write the check bitmap back over the original one,
-		// and use transactions here to play safe - we even use several
-		// transactions, so that we don't blow the maximum log size
-		// on large disks, since we don't need to make this atomic.
-#if 0
-		// prints the blocks that differ
-		off_t block = 0;
-		for (int32 i = 0; i < fNumGroups; i++) {
-			AllocationBlock cached(fVolume);
-			for (uint32 j = 0; j < fGroups[i].NumBlocks(); j++) {
-				cached.SetTo(fGroups[i], j);
-				for (uint32 k = 0; k < cached.NumBlockBits(); k++) {
-					if (cached.IsUsed(k) != _CheckBitmapIsUsedAt(block)) {
-						dprintf("differ block %lld (should be %d)\n", block,
-							_CheckBitmapIsUsedAt(block));
-					}
-					block++;
-				}
-			}
-		}
-#endif
-
 		GetVolume()->SuperBlock().used_blocks
-			= HOST_ENDIAN_TO_BFS_INT64(usedBlocks);
+			= HOST_ENDIAN_TO_BFS_INT64(fUsedBlocks);
+	}
 
-		size_t blockSize = GetVolume()->BlockSize();
-		off_t numBitmapBlocks = GetVolume()->NumBitmapBlocks();
+	return B_OK;
+}
 
-		for (uint32 i = 0; i < numBitmapBlocks; i += 512) {
-			Transaction transaction(GetVolume(), 1 + i);
 
-			uint32 blocksToWrite = 512;
-			if (blocksToWrite + i > numBitmapBlocks)
-				blocksToWrite = numBitmapBlocks - i;
+/*!	Moves the check bitmap on to the next window of allocation groups, and
+	visits all nodes again to fill it in. Returns \c B_ENTRY_NOT_FOUND if
+	the last window has been checked already.
+*/
+status_t
+CheckVisitor::StartNextWindow()
+{
+	if (fWindowEnd >= GetVolume()->NumBlocks())
+		return B_ENTRY_NOT_FOUND;
+
+	fWindowStart = fWindowEnd;
+	fWindowEnd = min_c(fWindowStart + fWindowBlocks,
+		GetVolume()->NumBlocks());
+	_ClearWindow();
 
-			status_t status = transaction.WriteBlocks(1 + i,
-				(uint8*)fCheckBitmap + i * blockSize, blocksToWrite);
-			if (status < B_OK) {
-				FATAL(("error writing bitmap: %s\n", strerror(status)));
-				return status;
-			}
-			transaction.Done();
-		}
-	}
+	Control().pass = BFS_CHECK_PASS_BITMAP_WINDOW;
+	fTraversed = false;
 
-	return B_OK;
+	Start(VISIT_REGULAR | VISIT_INDICES | VISIT_REMOVED
+		| VISIT_ATTRIBUTE_DIRECTORIES);
+	return NextNode();
 }
 
 
@@ -182,6 +336,8 @@ CheckVisitor::StartIndexPass()
 status_t
 CheckVisitor::StopChecking()
 {
+	_StopWorkers();
+
 	if (GetVolume()->IsReadOnly()) {
 		// We can't fix errors on this volume
 		Control().flags = 0;
@@ -292,13 +448,23 @@ CheckVisitor::VisitInode(Inode* inode, const char* treeName)
 
 	switch (Pass()) {
 		case BFS_CHECK_PASS_BITMAP:
+		case BFS_CHECK_PASS_BITMAP_WINDOW:
 		{
-			status = _CheckInodeBlocks(inode, NULL);
+			if (fWorkerCount > 0 && inode->IsFile()) {
+				// one of the workers will check the blocks
+				_QueueNode(inode);
+				break;
+			}
+
+			check_node node;
+			node.inode = inode;
+			status = _CheckInodeBlocks(inode, node);
+			_AddResult(node);
 			if (status != B_OK)
 				return status;
 
 			// Check the B+tree as well
-			if (inode->IsContainer()) {
+			if (Pass() == BFS_CHECK_PASS_BITMAP && inode->IsContainer()) {
 				bool repairErrors = (Control().flags & BFS_FIX_BPLUSTREES) != 0;
 				bool errorsFound = false;
 
@@ -336,6 +502,12 @@ status_t
 CheckVisitor::OpenInodeFailed(status_t reason, ino_t id, Inode* parent,
 		char* treeName, TreeIterator* iterator)
 {
+	if (Pass() == BFS_CHECK_PASS_BITMAP_WINDOW) {
+		// this has been reported, and dealt with in the first window
+		Control().status = B_OK;
+		return B_OK;
+	}
+
 	FATAL(("Could not open inode at %" B_PRIdOFF ": %s\n", id,
 		strerror(reason)));
 
@@ -435,39 +607,61 @@ CheckVisitor::_ControlValid()
 bool
 CheckVisitor::_CheckBitmapIsUsedAt(off_t block) const
 {
-	size_t size = _BitmapSize();
-	uint32 index = block / 32;	// 32bit resolution
-	if (index > size / 4)
+	if (block < fWindowStart || block >= fWindowEnd)
 		return false;
 
+	uint32 index = (block - fWindowStart) / 32;	// 32bit resolution
+
 	return BFS_ENDIAN_TO_HOST_INT32(fCheckBitmap[index])
 		& (1UL << (block & 0x1f));
 }
 
 
-void
+/*!	Marks the block as used in the check bitmap, and returns whether or not
+	it had been marked already. Blocks outside of the current window are
+	ignored. This is safe to be called by the workers.
+*/
+bool
 CheckVisitor::_SetCheckBitmapAt(off_t block)
 {
-	size_t size = _BitmapSize();
-	uint32 index = block / 32;	// 32bit resolution
-	if (index > size / 4)
-		return;
+	if (block < fWindowStart || block >= fWindowEnd)
+		return false;
+
+	uint32 index = (block - fWindowStart) / 32;	// 32bit resolution
 
-	fCheckBitmap[index] |= HOST_ENDIAN_TO_BFS_INT32(1UL << (block & 0x1f));
+	int32 mask = HOST_ENDIAN_TO_BFS_INT32(1UL << (block & 0x1f));
+	return (atomic_or((int32*)&fCheckBitmap[index], mask) & mask) != 0;
 }
 
 
+//!	Returns the size of the check bitmap of the current window.
 size_t
 CheckVisitor::_BitmapSize() const
 {
-	return GetVolume()->BlockSize() * GetVolume()->NumBitmapBlocks();
+	// the window always starts at the beginning of a bitmap block
+	off_t bitsPerBlock = GetVolume()->BlockSize() * 8;
+	return (fWindowEnd - fWindowStart + bitsPerBlock - 1) / bitsPerBlock
+		* GetVolume()->BlockSize();
+}
+
+
+void
+CheckVisitor::_ClearWindow()
+{
+	memset(fCheckBitmap, 0, _BitmapSize());
+
+	// the super block, the block bitmap, and the log are always in use
+	off_t reservedEnd = min_c(GetVolume()->ToBlock(GetVolume()->Log())
+		+ GetVolume()->Log().Length(), fWindowEnd);
+	for (off_t block = fWindowStart; block < reservedEnd; block++)
+		_SetCheckBitmapAt(block);
 }
 
 
 status_t
-CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
+CheckVisitor::_CheckInodeBlocks(Inode* inode, check_node& node)
 {
-	status_t status = _CheckAllocated(inode->BlockRun(), "inode");
+	status_t status = _CheckAllocated(inode->BlockRun(), "inode", node);
 	if (status != B_OK)
 		return status;
 
@@ -488,13 +682,13 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 			if (data->direct[i].IsZero())
 				break;
 
-			status = _CheckAllocated(data->direct[i], "direct");
+			status = _CheckAllocated(data->direct[i], "direct", node);
 			if (status < B_OK)
 				return status;
 
-			Control().stats.direct_block_runs++;
-			Control().stats.blocks_in_direct
-				+= data->direct[i].Length();
+			_CountFragment(data->direct[i], node);
+			node.stats.direct_block_runs++;
+			node.stats.blocks_in_direct += data->direct[i].Length();
 		}
 	}
 
@@ -503,7 +697,7 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 	// check the indirect range
 
 	if (data->max_indirect_range) {
-		status = _CheckAllocated(data->indirect, "indirect");
+		status = _CheckAllocated(data->indirect, "indirect", node);
 		if (status != B_OK)
 			return status;
 
@@ -521,15 +715,16 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 				if (runs[index].IsZero())
 					break;
 
-				status = _CheckAllocated(runs[index], "indirect->run");
+				status = _CheckAllocated(runs[index], "indirect->run",
+					node);
 				if (status < B_OK)
 					return status;
 
-				Control().stats.indirect_block_runs++;
-				Control().stats.blocks_in_indirect
-					+= runs[index].Length();
+				_CountFragment(runs[index], node);
+				node.stats.indirect_block_runs++;
+				node.stats.blocks_in_indirect += runs[index].Length();
 			}
-			Control().stats.indirect_array_blocks++;
+			node.stats.indirect_array_blocks++;
 
 			if (index < runsPerBlock)
 				break;
@@ -539,7 +734,8 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 	// check the double indirect range
 
 	if (data->max_double_indirect_range) {
-		status = _CheckAllocated(data->double_indirect, "double indirect");
+		status = _CheckAllocated(data->double_indirect, "double indirect",
+			node);
 		if (status != B_OK)
 			return status;
 
@@ -562,7 +758,7 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 			if (indirect.IsZero())
 				return B_OK;
 
-			status = _CheckAllocated(indirect, "double indirect->runs");
+			status = _CheckAllocated(indirect, "double indirect->runs", node);
 			if (status != B_OK)
 				return status;
 
@@ -584,17 +780,18 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 						return B_OK;
 
 					status = _CheckAllocated(runs[index % runsPerBlock],
-						"double indirect->runs->run");
+						"double indirect->runs->run", node);
 					if (status != B_OK)
 						return status;
 
-					Control().stats.double_indirect_block_runs++;
-					Control().stats.blocks_in_double_indirect
+					_CountFragment(runs[index % runsPerBlock], node);
+					node.stats.double_indirect_block_runs++;
+					node.stats.blocks_in_double_indirect
 						+= runs[index % runsPerBlock].Length();
 				} while ((++index % runsPerBlock) != 0);
 			}
 
-			Control().stats.double_indirect_array_blocks++;
+			node.stats.double_indirect_array_blocks++;
 		}
 	}
 
@@ -602,14 +799,64 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 }
 
 
+/*!	Counts the pieces the data stream of an inode is split into: a run that
+	does not continue right where the previous one ended starts a new one.
+*/
+void
+CheckVisitor::_CountFragment(block_run run, check_node& node)
+{
+	off_t start = GetVolume()->ToBlock(run);
+	if (node.fragments == 0 || start != node.last_run_end)
+		node.fragments++;
+
+	node.last_run_end = start + run.Length();
+}
+
+
+//!	Adds the outcome of checking the blocks of a node to Control().
+void
+CheckVisitor::_AddResult(const check_node& node)
+{
+	check_stats& stats = Control().stats;
+
+	if (Pass() == BFS_CHECK_PASS_BITMAP_WINDOW) {
+		// everything else has been counted in the first window already
+		Control().errors |= node.errors & BFS_BLOCKS_ALREADY_SET;
+		stats.already_set += node.stats.already_set;
+		return;
+	}
+
+	Control().errors |= node.errors;
+
+	stats.missing += node.stats.missing;
+	stats.already_set += node.stats.already_set;
+	stats.direct_block_runs += node.stats.direct_block_runs;
+	stats.indirect_block_runs += node.stats.indirect_block_runs;
+	stats.indirect_array_blocks += node.stats.indirect_array_blocks;
+	stats.double_indirect_block_runs += node.stats.double_indirect_block_runs;
+	stats.double_indirect_array_blocks
+		+= node.stats.double_indirect_array_blocks;
+	stats.blocks_in_direct += node.stats.blocks_in_direct;
+	stats.blocks_in_indirect += node.stats.blocks_in_indirect;
+	stats.blocks_in_double_indirect += node.stats.blocks_in_double_indirect;
+
+	if (node.inode->IsFile() && node.fragments > 0) {
+		stats.file_fragments += node.fragments;
+		if (node.fragments > 1)
+			stats.fragmented_files++;
+	}
+}
+
+
 status_t
-CheckVisitor::_CheckAllocated(block_run run, const char* type)
+CheckVisitor::_CheckAllocated(block_run run, const char* type,
+	check_node& node)
 {
 	BlockAllocator& allocator = GetVolume()->Allocator();
 
 	// make sure the block run is valid
 	if (!allocator.IsValidBlockRun(run, type)) {
-		Control().errors |= BFS_INVALID_BLOCK_RUN;
+		node.errors |= BFS_INVALID_BLOCK_RUN;
 		return B_OK;
 	}
 
@@ -618,10 +865,11 @@ CheckVisitor::_CheckAllocated(block_run run, const char* type)
 	off_t start = GetVolume()->ToBlock(run);
 	off_t end = start + run.Length();
 
-	// check if the run is allocated in the block bitmap on disk
+	// check if the run is allocated in the block bitmap on disk; this
+	// covers the whole volume in the first window already
 	off_t block = start;
 
-	while (block < end) {
+	while (Pass() == BFS_CHECK_PASS_BITMAP && block < end) {
 		off_t firstMissing;
 		status = allocator.CheckBlocks(block, end - block, true, &firstMissing);
 		if (status == B_OK)
@@ -642,30 +890,29 @@ CheckVisitor::_CheckAllocated(block_run run, const char* type)
 			type, run.AllocationGroup(), run.Start(),
 			run.Length(), firstMissing, afterLastMissing - 1));
 
-		Control().stats.missing += afterLastMissing - firstMissing;
+		node.stats.missing += afterLastMissing - firstMissing;
 
 		block = afterLastMissing;
 	}
 
 	// set bits in check bitmap, while checking if they're already set
 	off_t firstSet = -1;
+	start = max_c(start, fWindowStart);
+	end = min_c(end, fWindowEnd);
 
 	for (block = start; block < end; block++) {
-		if (_CheckBitmapIsUsedAt(block)) {
+		if (_SetCheckBitmapAt(block)) {
 			if (firstSet == -1) {
 				firstSet = block;
-				Control().errors |= BFS_BLOCKS_ALREADY_SET;
-			}
-			Control().stats.already_set++;
-		} else {
-			if (firstSet != -1) {
-				FATAL(("%s: block_run(%d, %u, %u): blocks %" B_PRIdOFF
-					" - %" B_PRIdOFF " are already set!\n", type,
-					(int)run.AllocationGroup(), run.Start(), run.Length(),
-					firstSet, block - 1));
-				firstSet = -1;
+				node.errors |= BFS_BLOCKS_ALREADY_SET;
 			}
-			_SetCheckBitmapAt(block);
+			node.stats.already_set++;
+		} else if (firstSet != -1) {
+			FATAL(("%s: block_run(%d, %u, %u): blocks %" B_PRIdOFF
+				" - %" B_PRIdOFF " are already set!\n", type,
+				(int)run.AllocationGroup(), run.Start(), run.Length(),
+				firstSet, block - 1));
+			firstSet = -1;
 		}
 	}
 
@@ -673,6 +920,156 @@ CheckVisitor::_CheckAllocated(block_run run, const char* type)
 }
 
 
+status_t
+CheckVisitor::_StartWorkers()
+{
+	uint32 count = min_c(Control().threads, kMaxCheckThreads);
+	uint32 nodeCount = count * kNodesPerThread;
+
+	fNodes = new(std::nothrow) check_node[nodeCount];
+	fWorkers = new(std::nothrow) thread_id[count];
+	fQueuedSem = create_sem(0, "bfs check queued");
+	fCheckedSem = create_sem(0, "bfs check checked");
+	if (fNodes == NULL || fWorkers == NULL || fQueuedSem < 0
+		|| fCheckedSem < 0) {
+		_StopWorkers();
+		return B_NO_MEMORY;
+	}
+
+	for (uint32 i = 0; i < nodeCount; i++)
+		fFreeNodes.Add(&fNodes[i]);
+
+	while (fWorkerCount < count) {
+		thread_id worker = spawn_kernel_thread(&CheckVisitor::_Worker,
+			"bfs check worker", B_NORMAL_PRIORITY, this);
+		if (worker < 0) {
+			// go on with the workers we got, or check serially without
+			// any, like in bfs_shell, which cannot spawn threads
+			if (fWorkerCount == 0)
+				_StopWorkers();
+			break;
+		}
+
+		fWorkers[fWorkerCount++] = worker;
+		resume_thread(worker);
+	}
+
+	fPendingNodes = 0;
+	fTraversed = false;
+	return B_OK;
+}
+
+
+void
+CheckVisitor::_StopWorkers()
+{
+	// deleting the semaphore lets the workers quit
+	sem_id queuedSem = fQueuedSem;
+	fQueuedSem = -1;
+	if (queuedSem >= 0)
+		delete_sem(queuedSem);
+
+	for (uint32 i = 0; i < fWorkerCount; i++)
+		wait_for_thread(fWorkers[i], NULL);
+	fWorkerCount = 0;
+
+	if (fCheckedSem >= 0) {
+		delete_sem(fCheckedSem);
+		fCheckedSem = -1;
+	}
+
+	// release the nodes that have not been reported
+	while (check_node* node = fQueuedNodes.RemoveHead())
+		put_vnode(GetVolume()->FSVolume(), node->inode->ID());
+	while (check_node* node = fCheckedNodes.RemoveHead())
+		put_vnode(GetVolume()->FSVolume(), node->inode->ID());
+
+	fFreeNodes.MakeEmpty();
+	fPendingNodes = 0;
+
+	delete[] fNodes;
+	fNodes = NULL;
+	delete[] fWorkers;
+	fWorkers = NULL;
+}
+
+
+/*!	Passes the inode on to the workers; the state of the node that has been
+	collected in Control() so far is reported together with its blocks.
+*/
+void
+CheckVisitor::_QueueNode(Inode* inode)
+{
+	check_node* node = fFreeNodes.RemoveHead();
+	node->Clear();
+	node->inode = inode;
+	node->errors = Control().errors;
+	strlcpy(node->name, Control().name, sizeof(node->name));
+
+	// the inode must stay in memory until it has been reported
+	acquire_vnode(GetVolume()->FSVolume(), inode->ID());
+
+	MutexLocker locker(fNodesLock);
+	fQueuedNodes.Add(node);
+	locker.Unlock();
+
+	fPendingNodes++;
+	fNodeQueued = true;
+	release_sem(fQueuedSem);
+}
+
+
+status_t
+CheckVisitor::_ReportNode()
+{
+	MutexLocker locker(fNodesLock);
+	check_node* node = fCheckedNodes.RemoveHead();
+	locker.Unlock();
+
+	Inode* inode = node->inode;
+	status_t status = node->status;
+
+	Control().inode = inode->ID();
+	Control().mode = inode->Mode();
+	Control().errors = 0;
+	strlcpy(Control().name, node->name, sizeof(Control().name));
+	_AddResult(*node);
+	Control().status = B_OK;
+
+	put_vnode(GetVolume()->FSVolume(), inode->ID());
+	fFreeNodes.Add(node);
+	fPendingNodes--;
+
+	return status;
+}
+
+
+/*static*/ status_t
+CheckVisitor::_Worker(void* _visitor)
+{
+	CheckVisitor* visitor = (CheckVisitor*)_visitor;
+
+	while (acquire_sem(visitor->fQueuedSem) == B_OK) {
+		MutexLocker locker(visitor->fNodesLock);
+		check_node* node = visitor->fQueuedNodes.RemoveHead();
+		locker.Unlock();
+
+		if (node == NULL)
+			continue;
+
+		node->status = visitor->_CheckInodeBlocks(node->inode, *node);
+
+		locker.Lock();
+		visitor->fCheckedNodes.Add(node);
+		locker.Unlock();
+
+		release_sem(visitor->fCheckedSem);
+	}
+
+	return B_OK;
+}
+
+
 status_t
 CheckVisitor::_PrepareIndices()
 {
@@ -17,8 +17,10 @@
 class BlockAllocator;
 class BPlusTree;
 struct check_index;
+struct check_node;
 
 typedef Stack<check_index*> IndexStack;
+typedef DoublyLinkedList<check_node> CheckNodeList;
 
 
 class CheckVisitor : public FileSystemVisitor {
@@ -31,7 +33,9 @@ public:
 			uint32				Pass() { return control.pass; }
 
 			status_t			StartBitmapPass();
+			status_t			NextNode();
 			status_t			WriteBackCheckBitmap();
+			status_t			StartNextWindow();
 			status_t			StartIndexPass();
 			status_t			StopChecking();
 
@@ -53,13 +57,23 @@ private:
 
 			bool				_ControlValid();
 			bool				_CheckBitmapIsUsedAt(off_t block) const;
-			void				_SetCheckBitmapAt(off_t block);
+			bool				_SetCheckBitmapAt(off_t block);
 			status_t			_CheckInodeBlocks(Inode* inode,
-									const char* name);
+									check_node& node);
 			status_t			_CheckAllocated(block_run run,
-									const char* type);
+									const char* type, check_node& node);
+			void				_CountFragment(block_run run,
+									check_node& node);
+			void				_AddResult(const check_node& node);
+
+			status_t			_StartWorkers();
+			void				_StopWorkers();
+			void				_QueueNode(Inode* inode);
+			status_t			_ReportNode();
+	static	status_t			_Worker(void* _visitor);
 
 			size_t				_BitmapSize() const;
+			void				_ClearWindow();
 
 			status_t			_PrepareIndices();
 			void				_FreeIndices();
@@ -70,6 +84,25 @@ private:
 			IndexStack			indices;
 
 			uint32*				fCheckBitmap;
+			off_t				fWindowStart;
+			off_t				fWindowEnd;
+			off_t				fWindowBlocks;
+				// the blocks the check bitmap currently covers
+			off_t				fUsedBlocks;
+
+			// checking files in parallel
+			mutex				fNodesLock;
+			check_node*			fNodes;
+			CheckNodeList		fFreeNodes;
+			CheckNodeList		fQueuedNodes;
+			CheckNodeList		fCheckedNodes;
+			sem_id				fQueuedSem;
+			sem_id				fCheckedSem;
+			thread_id*			fWorkers;
+			uint32				fWorkerCount;
+			uint32				fPendingNodes;
+			bool				fNodeQueued;
+			bool				fTraversed;
 };
 
 
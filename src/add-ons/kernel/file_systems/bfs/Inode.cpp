@@ -13,6 +13,10 @@
 #include "Index.h"
 
 
+static const off_t kMaxFilePreallocation = 16 * 1024 * 1024;
+	// appended files get up to 16 MB preallocated at once
+
+
 #if BFS_TRACING && !defined(FS_SHELL) && !defined(_BOOT_MODE)
 namespace BFSInodeTracing {
 
@@ -344,13 +348,16 @@ Inode::Inode(Volume* volume, ino_t id)
 	fTree(NULL),
 	fAttributes(NULL),
 	fCache(NULL),
-	fMap(NULL)
+	fMap(NULL),
+	fPreallocation(0),
+	fLogSequence(0)
 {
 	PRINT(("Inode::Inode(volume = %p, id = %" B_PRIdINO ") @ %p\n",
 		volume, id, this));
 
 	rw_lock_init(&fLock, "bfs inode");
 	recursive_lock_init(&fSmallDataLock, "bfs inode small data");
+	fLastAllocation.SetTo(0, 0, 0);
 
 	if (UpdateNodeFromDisk() != B_OK) {
 		// TODO: the error code gets eaten
@@ -378,13 +385,16 @@ Inode::Inode(Volume* volume, Transaction& transaction, ino_t id, mode_t mode,
 	fTree(NULL),
 	fAttributes(NULL),
 	fCache(NULL),
-	fMap(NULL)
+	fMap(NULL),
+	fPreallocation(0),
+	fLogSequence(0)
 {
 	PRINT(("Inode::Inode(volume = %p, transaction = %p, id = %" B_PRIdINO
 		") @ %p\n", volume, &transaction, id, this));
 
 	rw_lock_init(&fLock, "bfs inode");
 	recursive_lock_init(&fSmallDataLock, "bfs inode small data");
+	fLastAllocation.SetTo(0, 0, 0);
 
 	NodeGetter node(volume);
 	status_t status = node.SetToWritable(transaction, this, true);
@@ -500,6 +510,9 @@ Inode::WriteBack(Transaction& transaction)
 		return status;
 
 	memcpy(node.WritableNode(), &Node(), sizeof(bfs_inode));
+
+	// remember which log entry has to be written to make this change durable
+	atomic_set(&fLogSequence, fVolume->GetJournal(0)->LogSequence());
 	return B_OK;
 }
 
@@ -1785,6 +1798,16 @@ Inode::_GrowStream(Transaction& transaction, off_t size)
 				// 64 MB for 1 GB)
 				roundTo = size >> (fVolume->BlockShift() + 4);
 			}
+
+			// If the file already used up its last preallocation, it is
+			// being appended to: double the preallocation every time, so
+			// that the stream grows in few, large runs.
+			if (fPreallocation > 0) {
+				off_t limit = min_c(kMaxFilePreallocation
+					>> fVolume->BlockShift(), fVolume->FreeBlocks() / 16);
+				roundTo = max_c(roundTo, min_c(fPreallocation * 2, limit));
+			}
+			fPreallocation = roundTo;
 		} else if (IsIndex()) {
 			// Always preallocate 64 KB for index directories
 			roundTo = 65536 >> fVolume->BlockShift();
@@ -1799,6 +1822,16 @@ Inode::_GrowStream(Transaction& transaction, off_t size)
 		}
 	}
 
+	if (fLastAllocation.IsZero()) {
+		// let the block allocator continue where the stream ends
+		off_t end = max_c(data->MaxDirectRange(),
+			max_c(data->MaxIndirectRange(), data->MaxDoubleIndirectRange()));
+		block_run last;
+		off_t offset;
+		if (end > 0 && FindBlockRun(end - 1, last, offset) == B_OK)
+			fLastAllocation = last;
+	}
+
 	while (blocksNeeded > 0) {
 		// the requested blocks do not need to be returned with a
 		// single allocation, so we need to iterate until we have
@@ -1814,6 +1847,8 @@ Inode::_GrowStream(Transaction& transaction, off_t size)
 		if (status != B_OK)
 			return status;
 
+		fLastAllocation = run;
+
 		// okay, we have the needed blocks, so just distribute them to the
 		// different ranges of the stream (direct, indirect & double indirect)
 
@@ -2262,6 +2297,10 @@ Inode::_ShrinkStream(Transaction& transaction, off_t size)
 	}
 
 	data->size = HOST_ENDIAN_TO_BFS_INT64(size);
+
+	// the end of the stream has changed, and the file is no longer appended
+	fLastAllocation.SetTo(0, 0, 0);
+	fPreallocation = 0;
 	return B_OK;
 }
 
@@ -2386,9 +2425,28 @@ Inode::Free(Transaction& transaction)
 status_t
 Inode::Sync()
 {
-	if (FileCache())
-		return file_cache_sync(FileCache());
+	status_t status = FileCache() != NULL
+		? file_cache_sync(FileCache()) : _SyncStream();
+	if (status != B_OK || fVolume->IsReadOnly())
+		return status;
 
+	// Make the changes to the node durable as well. This only waits for the
+	// log entry they are part of, and not at all if it is already written;
+	// as the entries of a directory are not tracked that way, the current
+	// entry is committed for those.
+	Journal* journal = fVolume->GetJournal(0);
+	int32 sequence = IsContainer()
+		? journal->LogSequence() : atomic_get(&fLogSequence);
+	if (sequence == 0)
+		return B_OK;
+
+	return journal->CommitLog(sequence);
+}
+
+
+status_t
+Inode::_SyncStream()
+{
 	// We may also want to flush the attribute's data stream to
 	// disk here... (do we?)
 
@@ -155,6 +155,8 @@ public:
 			status_t			Append(Transaction& transaction, off_t bytes);
 			status_t			TrimPreallocation(Transaction& transaction);
 			bool				NeedsTrimming() const;
+			block_run			LastAllocation() const
+									{ return fLastAllocation; }
 
 			status_t			Free(Transaction& transaction);
 			status_t			Sync();
@@ -253,6 +255,7 @@ private:
 									off_t size);
 			status_t			_ShrinkStream(Transaction& transaction,
 									off_t size);
+			status_t			_SyncStream();
 
 private:
 			rw_lock				fLock;
@@ -269,6 +272,16 @@ private:
 				// we need those values to ensure we will remove
 				// the correct keys from the indices
 
+			block_run			fLastAllocation;
+				// the run the data stream was grown with last; the block
+				// allocator continues after it
+			off_t				fPreallocation;
+				// the number of blocks preallocated with the last growth
+				// of the stream, reset when it shrinks
+			int32				fLogSequence;
+				// the log entry the last change to the node is part of,
+				// zero if it has not been changed since it was loaded
+
 			mutable recursive_lock fSmallDataLock;
 			SinglyLinkedList<AttributeIterator> fIterators;
 };
@@ -164,6 +164,17 @@ add_to_iovec(iovec* vecs, int32& index, int32 max, const void* address,
 }
 
 
+/*!	Returns whether the log entry \a written comes after, or is the one with
+	the given \a sequence number; this works across the sequence wrapping
+	around.
+*/
+static inline bool
+sequence_reached(int32 written, int32 sequence)
+{
+	return (int32)((uint32)written - (uint32)sequence) >= 0;
+}
+
+
 //	#pragma mark - LogEntry
 
 
@@ -406,8 +417,11 @@ Journal::Journal(Volume* volume)
 	fMaxTransactionSize(fLogSize / 2 - 5),
 	fUsed(0),
 	fUnwrittenTransactions(0),
+	fLogSequence(1),
+	fWrittenLogSequence(0),
 	fHasSubtransaction(false),
-	fSeparateSubTransactions(false)
+	fSeparateSubTransactions(false),
+	fFlushDriveCache(true)
 {
 	recursive_lock_init(&fLock, "bfs journal");
 	mutex_init(&fEntriesLock, "bfs journal entries");
@@ -782,6 +796,7 @@ Journal::_WriteTransactionToLog()
 			cache_end_transaction(fVolume->BlockCache(), fTransactionID, NULL,
 				NULL);
 			fUnwrittenTransactions = 0;
+			_LogWritten();
 		}
 		return B_OK;
 	}
@@ -890,8 +905,7 @@ Journal::_WriteTransactionToLog()
 
 	// We need to flush the drives own cache here to ensure
 	// disk consistency.
-	// If that call fails, we can't do anything about it anyway
-	ioctl(fVolume->Device(), B_FLUSH_DRIVE_CACHE);
+	_FlushDriveCache();
 
 	// at this point, we can finally end the transaction - we're in
 	// a guaranteed valid state
@@ -917,12 +931,47 @@ Journal::_WriteTransactionToLog()
 		cache_end_transaction(fVolume->BlockCache(), fTransactionID,
 			_TransactionWritten, logEntry);
 		fUnwrittenTransactions = 0;
+		_LogWritten();
 	}
 
 	return status;
 }
 
 
+/*!	Marks the current log entry as written, and starts a new one. Must be
+	called with the lock held, after the transaction has been ended; a
+	detached sub-transaction still belongs to the current entry.
+*/
+void
+Journal::_LogWritten()
+{
+	atomic_set(&fWrittenLogSequence, fLogSequence);
+
+	// zero is never used, so that it can stand for "nothing to commit"
+	if (++fLogSequence == 0)
+		fLogSequence = 1;
+}
+
+
+/*!	Flushes the drive's own cache, so that everything written to the device
+	so far is on stable storage. If the device does not support this, it's
+	not asked again.
+*/
+void
+Journal::_FlushDriveCache()
+{
+	if (!fFlushDriveCache)
+		return;
+
+	// If that call fails, we can't do anything about it anyway
+	if (ioctl(fVolume->Device(), B_FLUSH_DRIVE_CACHE) != 0
+		&& (errno == B_DEV_INVALID_IOCTL || errno == B_NOT_SUPPORTED)) {
+		INFORM(("device does not support flushing its cache\n"));
+		fFlushDriveCache = false;
+	}
+}
+
+
 /*!	Flushes the current log entry to disk. If \a flushBlocks is \c true it will
 	also write back all dirty blocks for this volume.
 */
@@ -966,6 +1015,53 @@ Journal::FlushLogAndBlocks()
 }
 
 
+/*!	Makes sure that the log entry with the given \a sequence number, as
+	returned by LogSequence(), is on disk. Unlike FlushLogAndBlocks(), this
+	does not write back any blocks, and does nothing at all if the entry has
+	already been written.
+	Since all transactions that have been done in the mean time are part of
+	the same log entry, concurrent callers are served by a single log write
+	and a single flush of the drive's cache: whoever gets the lock first
+	writes the entry, and the others find it written when they get it.
+*/
+status_t
+Journal::CommitLog(int32 sequence)
+{
+	if (sequence_reached(atomic_get(&fWrittenLogSequence), sequence))
+		return B_OK;
+
+	status_t status = recursive_lock_lock(&fLock);
+	if (status != B_OK)
+		return status;
+
+	if (recursive_lock_get_recursion(&fLock) > 1) {
+		// we're inside a transaction, it can't be written back now
+		recursive_lock_unlock(&fLock);
+		return B_OK;
+	}
+
+	while (!sequence_reached(fWrittenLogSequence, sequence)) {
+		if (fUnwrittenTransactions == 0) {
+			// all transactions have been written or aborted already
+			_LogWritten();
+			break;
+		}
+
+		// this takes more than one write only if a sub-transaction had to
+		// be detached
+		status = _WriteTransactionToLog();
+		if (status < B_OK) {
+			FATAL(("writing current log entry failed: %s\n",
+				strerror(status)));
+			break;
+		}
+	}
+
+	recursive_lock_unlock(&fLock);
+	return status;
+}
+
+
 status_t
 Journal::Lock(Transaction* owner, bool separateSubTransactions)
 {
@@ -1116,6 +1212,9 @@ Journal::Dump()
 	kprintf("  unwritten:            %" B_PRId32 "\n", fUnwrittenTransactions);
 	kprintf("  timestamp:            %" B_PRId64 "\n", fTimestamp);
 	kprintf("  transaction ID:       %" B_PRId32 "\n", fTransactionID);
+	kprintf("  log sequence:         %" B_PRId32 "\n", fLogSequence);
+	kprintf("  written sequence:     %" B_PRId32 "\n", fWrittenLogSequence);
+	kprintf("  flush drive cache:    %d\n", fFlushDriveCache);
 	kprintf("  has subtransaction:   %d\n", fHasSubtransaction);
 	kprintf("  separate sub-trans.:  %d\n", fSeparateSubTransactions);
 	kprintf("entries:\n");
@@ -36,6 +36,9 @@ public:
 			bool			CurrentTransactionTooLarge() const;
 
 			status_t		FlushLogAndBlocks();
+			status_t		CommitLog(int32 sequence);
+			int32			LogSequence()
+								{ return atomic_get(&fLogSequence); }
 			Volume*			GetVolume() const { return fVolume; }
 			int32			TransactionID() const { return fTransactionID; }
 
@@ -52,6 +55,8 @@ private:
 			status_t		_FlushLog(bool canWait, bool flushBlocks);
 			uint32			_TransactionSize() const;
 			status_t		_WriteTransactionToLog();
+			void			_LogWritten();
+			void			_FlushDriveCache();
 			status_t		_CheckRunArray(const run_array* array);
 			status_t		_ReplayRunArray(int32* start);
 			status_t		_TransactionDone(bool success);
@@ -74,8 +79,13 @@ private:
 			LogEntryList	fEntries;
 			bigtime_t		fTimestamp;
 			int32			fTransactionID;
+			int32			fLogSequence;
+				// the sequence number of the log entry that is being built
+			int32			fWrittenLogSequence;
+				// the sequence number of the last log entry on disk
 			bool			fHasSubtransaction;
 			bool			fSeparateSubTransactions;
+			bool			fFlushDriveCache;
 
 			thread_id		fLogFlusher;
 			sem_id			fLogFlusherSem;
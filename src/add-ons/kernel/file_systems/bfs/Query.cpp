@@ -140,6 +140,27 @@ struct Query::QueryPolicy {
 		return index.KeySize();
 	}
 
+	static status_t IndexEstimatePosition(Index& index, const void* value,
+		size_t size, int32* _position)
+	{
+		int64 shiftedTime;
+		if (index.isSpecialTime) {
+			// int64 time index; convert value.
+			shiftedTime = *(int64*)value << INODE_TIME_SHIFT;
+			value = &shiftedTime;
+		}
+
+		// the position is given in the unit of the index size
+		uint32 position;
+		status_t status = index.Node()->Tree()->EstimatePosition(
+			(const uint8*)value, size, IndexGetSize(index), &position);
+		if (status != B_OK)
+			return status;
+
+		*_position = position;
+		return B_OK;
+	}
+
 	static IndexIterator* IndexCreateIterator(Index& index)
 	{
 		IndexIterator* iterator = new(std::nothrow) IndexIterator(index.Node()->Tree());
@@ -206,6 +227,11 @@ struct Query::QueryPolicy {
 		return B_OK;
 	}
 
+	static ino_t IndexIteratorGetNodeID(IndexIterator* iterator)
+	{
+		return iterator->offset;
+	}
+
 	static void IndexIteratorSkipDuplicates(IndexIterator* iterator)
 	{
 		iterator->SkipDuplicates();
@@ -347,6 +373,13 @@ Query::GetNextEntry(struct dirent* entry, size_t size)
 }
 
 
+ssize_t
+Query::Explain(char* buffer, size_t bufferSize)
+{
+	return fImpl->Explain(buffer, bufferSize);
+}
+
+
 void
 Query::LiveUpdate(Inode* inode, const char* attribute, int32 type,
 	const void* oldKey, size_t oldLength, const void* newKey, size_t newLength)
@@ -28,6 +28,7 @@ public:
 
 			status_t		Rewind();
 			status_t		GetNextEntry(struct dirent* entry, size_t size);
+			ssize_t			Explain(char* buffer, size_t bufferSize);
 
 			void			LiveUpdate(Inode* inode,
 								const char* attribute, int32 type,
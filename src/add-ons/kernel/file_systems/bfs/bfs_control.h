@@ -39,9 +39,40 @@ struct update_boot_block {
 /* The "pass" field constants */
 #define BFS_CHECK_PASS_BITMAP		0
 #define BFS_CHECK_PASS_INDEX		1
+#define BFS_CHECK_PASS_BITMAP_WINDOW	2
+	/* visits all nodes again to check the blocks of further allocation
+	 * groups, if the check bitmap could not cover the whole volume; only
+	 * the BFS_BLOCKS_ALREADY_SET error is reported in this pass
+	 */
+
+struct check_stats {
+	uint64	missing;
+	uint64	already_set;
+	uint64	freed;
+
+	uint64	direct_block_runs;
+	uint64	indirect_block_runs;
+	uint64	indirect_array_blocks;
+	uint64	double_indirect_block_runs;
+	uint64	double_indirect_array_blocks;
+	uint64	blocks_in_direct;
+	uint64	blocks_in_indirect;
+	uint64	blocks_in_double_indirect;
+	uint64	partial_block_runs;
+	uint64	file_fragments;
+	uint64	fragmented_files;
+	uint32	block_size;
+};
 
-/* All fields except "flags", and "name" must be set to zero before
- * BFS_IOCTL_START_CHECKING is called, and magic must be set.
+/* All fields except "flags", "threads", "max_bitmap_size", and "name" must
+ * be set to zero before BFS_IOCTL_START_CHECKING is called, and magic must
+ * be set.
+ * With "threads" set, that many threads check the blocks of files in
+ * parallel, and BFS_IOCTL_CHECK_NEXT_NODE reports the nodes in the order
+ * their check has been completed.
+ * "max_bitmap_size" limits the memory used for the check bitmap, in bytes;
+ * if it cannot cover all allocation groups at once, the rest of them are
+ * checked in BFS_CHECK_PASS_BITMAP_WINDOW passes. Zero selects a default.
  */
 struct check_control {
 	uint32		magic;
@@ -51,23 +82,10 @@ struct check_control {
 	ino_t		inode;
 	uint32		mode;
 	uint32		errors;
-	struct {
-		uint64	missing;
-		uint64	already_set;
-		uint64	freed;
-
-		uint64	direct_block_runs;
-		uint64	indirect_block_runs;
-		uint64	indirect_array_blocks;
-		uint64	double_indirect_block_runs;
-		uint64	double_indirect_array_blocks;
-		uint64	blocks_in_direct;
-		uint64	blocks_in_indirect;
-		uint64	blocks_in_double_indirect;
-		uint64	partial_block_runs;
-		uint32	block_size;
-	} stats;
+	struct check_stats stats;
 	status_t	status;
+	uint32		threads;
+	uint32		max_bitmap_size;
 };
 
 /* values for the flags field */
@@ -94,8 +112,8 @@ struct check_control {
 #define BFS_NAMES_DONT_MATCH	32
 #define BFS_INVALID_BPLUSTREE	64
 
-/* check control magic value */
-#define BFS_IOCTL_CHECK_MAGIC	'BChk'
+/* check control magic value, changes with the layout of check_control */
+#define BFS_IOCTL_CHECK_MAGIC	'BCk3'
 
 
 /* A "back door" to side-step the regular resize interface, primarily for
@@ -104,4 +122,19 @@ struct check_control {
 #define BFS_IOCTL_RESIZE		14205
 
 
+/* Describes how a query would be evaluated, without running it. The
+ * parameter is a struct explain_query; the description is null terminated,
+ * and "length" is set to its full length, which may exceed the buffer.
+ */
+#define BFS_IOCTL_EXPLAIN_QUERY	14206
+
+struct explain_query {
+	const char*	query;
+	size_t		query_length;
+	char*		buffer;
+	size_t		buffer_size;
+	size_t		length;
+};
+
+
 #endif	/* BFS_CONTROL_H */
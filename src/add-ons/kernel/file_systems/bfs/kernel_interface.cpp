@@ -740,14 +740,22 @@ bfs_ioctl(fs_volume* _volume, fs_vnode* _node, void* _cookie, uint32 cmd,
 
 			checker->Control().errors = 0;
 
-			status_t status = checker->Next();
-			if (status == B_ENTRY_NOT_FOUND) {
+			status_t status = checker->NextNode();
+			while (status == B_ENTRY_NOT_FOUND) {
 				checker->Control().status = B_ENTRY_NOT_FOUND;
 					// tells StopChecking() that we finished the pass
 
-				if (checker->Pass() == BFS_CHECK_PASS_BITMAP) {
-					if (checker->WriteBackCheckBitmap() == B_OK)
-						status = checker->StartIndexPass();
+				if (checker->Pass() == BFS_CHECK_PASS_INDEX
+					|| checker->WriteBackCheckBitmap() != B_OK) {
+					break;
+				}
+
+				// the check bitmap may only cover some of the allocation
+				// groups at a time
+				status = checker->StartNextWindow();
+				if (status == B_ENTRY_NOT_FOUND) {
+					status = checker->StartIndexPass();
+					break;
 				}
 			}
 
@@ -793,6 +801,63 @@ bfs_ioctl(fs_volume* _volume, fs_vnode* _node, void* _cookie, uint32 cmd,
 			ResizeVisitor resizer(volume);
 			return resizer.Resize(size, -1);
 		}
+		case BFS_IOCTL_EXPLAIN_QUERY:
+		{
+			explain_query explain;
+			if (bufferLength != sizeof(explain_query))
+				return B_BAD_VALUE;
+			if (user_memcpy(&explain, buffer, sizeof(explain_query)) != B_OK)
+				return B_BAD_ADDRESS;
+
+			// the same restrictions as for opening a query
+			if (explain.query == NULL || explain.query_length == 0
+				|| explain.buffer == NULL || explain.buffer_size == 0)
+				return B_BAD_VALUE;
+			if (explain.query_length >= 65536)
+				return B_NAME_TOO_LONG;
+			if (explain.buffer_size > 65536)
+				explain.buffer_size = 65536;
+#ifndef FS_SHELL
+			if (IS_USER_ADDRESS(buffer)
+				&& (!IS_USER_ADDRESS(explain.query)
+					|| !is_user_address_range(explain.buffer,
+						explain.buffer_size))) {
+				return B_BAD_ADDRESS;
+			}
+#endif
+
+			char* queryString = (char*)malloc(explain.query_length + 1);
+			MemoryDeleter queryDeleter(queryString);
+			char* plan = (char*)malloc(explain.buffer_size);
+			MemoryDeleter planDeleter(plan);
+			if (queryString == NULL || plan == NULL)
+				return B_NO_MEMORY;
+
+			if (user_strlcpy(queryString, explain.query,
+					explain.query_length + 1) < B_OK) {
+				return B_BAD_ADDRESS;
+			}
+
+			Query* query;
+			status_t status = Query::Create(volume, queryString, 0, -1, 0,
+				query);
+			if (status != B_OK)
+				return status;
+
+			ssize_t length = query->Explain(plan, explain.buffer_size);
+			delete query;
+			if (length < 0)
+				return length;
+
+			explain.length = length;
+			if (user_memcpy(explain.buffer, plan,
+					min_c((size_t)length + 1, explain.buffer_size)) != B_OK
+				|| user_memcpy(buffer, &explain, sizeof(explain_query))
+					!= B_OK) {
+				return B_BAD_ADDRESS;
+			}
+			return B_OK;
+		}
 
 #ifdef DEBUG_FRAGMENTER
 		case 56741:
@@ -29,6 +29,7 @@
 #include "PackageFile.h"
 #include "PackagesDirectory.h"
 #include "PackageSettings.h"
+#include "PackageSnapshot.h"
 #include "PackageSymlink.h"
 #include "Version.h"
 #include "Volume.h"
@@ -41,6 +42,7 @@ using BPackageKit::BHPKG::BFDDataReader;
 using BPackageKit::BHPKG::BPackageInfoAttributeValue;
 using BPackageKit::BHPKG::BPackageVersionData;
 using BPackageKit::BHPKG::BPrivate::PackageFileHeapReader;
+using BPackageKit::BHPKG::BPrivate::hpkg_header;
 
 // current format version types
 typedef BPackageKit::BHPKG::BPackageContentHandler BPackageContentHandler;
@@ -468,7 +470,20 @@ struct Package::CachingPackageReader : public PackageReaderImpl {
 	status_t Init(int fd, bool keepFD, uint32 flags)
 	{
 		fFD = fd;
-		return PackageReaderImpl::Init(fd, keepFD, flags);
+
+		BFdIO* file = new(std::nothrow) BFdIO(fd, keepFD);
+		if (file == NULL) {
+			if (keepFD && fd >= 0)
+				close(fd);
+			RETURN_ERROR(B_NO_MEMORY);
+		}
+
+		return PackageReaderImpl::Init(file, true, flags, &fHeader);
+	}
+
+	const hpkg_header& Header() const
+	{
+		return fHeader;
 	}
 
 	virtual status_t CreateCachedHeapReader(
@@ -504,6 +519,7 @@ struct Package::CachingPackageReader : public PackageReaderImpl {
 private:
 	HeapReaderV2*	fCachedHeapReader;
 	int				fFD;
+	hpkg_header		fHeader;
 };
 
 
@@ -567,9 +583,9 @@ Package::Init(const char* fileName)
 
 
 status_t
-Package::Load(const PackageSettings& settings)
+Package::Load(const PackageSettings& settings, PackageSnapshot* snapshot)
 {
-	status_t error = _Load(settings);
+	status_t error = _Load(settings, snapshot);
 	if (error != B_OK)
 		return error;
 
@@ -711,8 +727,12 @@ Package::CreateDataReader(const PackageData& data,
 }
 
 
+/*!	If a \a snapshot is given, and it has a valid record for the package
+	file, the content is taken from it instead of being parsed. Otherwise, the
+	parsed content is added to the snapshot.
+*/
 status_t
-Package::_Load(const PackageSettings& settings)
+Package::_Load(const PackageSettings& settings, PackageSnapshot* snapshot)
 {
 	// open package file
 	int fd = Open();
@@ -720,6 +740,11 @@ Package::_Load(const PackageSettings& settings)
 		RETURN_ERROR(fd);
 	PackageCloser packageCloser(this);
 
+	// the snapshot records are only valid for an unchanged file
+	struct stat st;
+	if (snapshot != NULL && fstat(fd, &st) != 0)
+		snapshot = NULL;
+
 	// initialize package reader
 	LoaderErrorOutput errorOutput(this);
 
@@ -735,7 +760,26 @@ Package::_Load(const PackageSettings& settings)
 			if (error != B_OK)
 				RETURN_ERROR(error);
 
-			error = packageReader.ParseContent(&handler);
+			// The package reader only reads the header and the heap index
+			// when initialized, so replaying a snapshot record saves reading,
+			// and parsing the TOC and package attributes sections.
+			error = B_ENTRY_NOT_FOUND;
+			if (snapshot != NULL) {
+				error = snapshot->Replay(st, packageReader.Header(),
+					&handler);
+			}
+
+			if (error == B_ENTRY_NOT_FOUND) {
+				PackageSnapshotRecorder recorder(&handler);
+				if (snapshot != NULL && recorder.Init() == B_OK) {
+					error = packageReader.ParseContent(&recorder);
+					if (error == B_OK) {
+						snapshot->AddPackage(st, packageReader.Header(),
+							recorder);
+					}
+				} else
+					error = packageReader.ParseContent(&handler);
+			}
 			if (error != B_OK)
 				RETURN_ERROR(error);
 
@@ -31,6 +31,7 @@ using BPackageKit::BHPKG::BAbstractBufferedDataReader;
 class PackageLinkDirectory;
 class PackagesDirectory;
 class PackageSettings;
+class PackageSnapshot;
 class Volume;
 class Version;
 
@@ -44,7 +45,8 @@ public:
 								~Package();
 
 			status_t			Init(const char* fileName);
-			status_t			Load(const PackageSettings& settings);
+			status_t			Load(const PackageSettings& settings,
+									PackageSnapshot* snapshot);
 
 			::Volume*			Volume() const		{ return fVolume; }
 			const String&		FileName() const	{ return fFileName; }
@@ -117,7 +119,8 @@ private:
 			struct CachingPackageReader;
 
 private:
-			status_t			_Load(const PackageSettings& settings);
+			status_t			_Load(const PackageSettings& settings,
+									PackageSnapshot* snapshot);
 			bool				_InitVersionedName();
 
 private:
@@ -0,0 +1,1059 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "PackageSnapshot.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <new>
+
+#include <package/hpkg/PackageData.h>
+#include <package/hpkg/PackageEntry.h>
+#include <package/hpkg/PackageEntryAttribute.h>
+
+#include <AutoDeleter.h>
+#include <PackagesDirectoryDefs.h>
+#include <syscalls.h>
+#include <util/AutoLock.h>
+#include <util/StringHash.h>
+
+#include <zlib.h>
+
+#include "DebugSupport.h"
+
+
+using namespace BPackageKit;
+using namespace BPackageKit::BHPKG;
+
+
+static const uint32 kSnapshotMagic = 'PkSn';
+static const uint32 kSnapshotVersion = 2;
+
+// sanity limits for the snapshot file, and a single package record in it
+static const size_t kMaxSnapshotSize = 64 * 1024 * 1024;
+static const size_t kMaxRecordSize = 16 * 1024 * 1024;
+
+static const char* const kSnapshotFilePath
+	= PACKAGES_DIRECTORY_ADMIN_DIRECTORY "/packagefs-snapshot";
+static const char* const kSnapshotTempFilePath
+	= PACKAGES_DIRECTORY_ADMIN_DIRECTORY "/packagefs-snapshot.tmp";
+
+// string reference of a NULL string
+static const uint32 kNoString = 0xffffffff;
+
+// event types
+enum {
+	SNAPSHOT_PACKAGE_ATTRIBUTE	= 1,
+	SNAPSHOT_ENTRY,
+	SNAPSHOT_ENTRY_ATTRIBUTE,
+	SNAPSHOT_ENTRY_DONE
+};
+
+
+/*!	The snapshot file consists of this header, followed by the package
+	records. It is only ever used on the machine that wrote it, so all values
+	are in host byte order.
+*/
+struct PackageSnapshot::FileHeader {
+	uint32	magic;
+	uint32	version;
+	uint32	checksum;
+		// CRC32 of everything following the header
+	uint32	record_count;
+	uint64	size;
+};
+
+
+/*!	A package record consists of this header, a string table, and the
+	events the package content handler received while the package was parsed.
+	Strings are referenced by their offset in the string table. Records are
+	8 byte aligned.
+	The header of the package file is kept as it is in the file, so that a
+	record is not used for a package with different heap or section sizes,
+	even if the file's size and modification time still match.
+*/
+struct PackageSnapshot::RecordHeader {
+	uint32		size;
+	uint32		strings_size;
+	uint32		events_size;
+	uint32		modified_time_nsec;
+	int64		node;
+	int64		file_size;
+	int64		modified_time;
+	hpkg_header	package_header;
+};
+
+
+struct PackageSnapshot::Record {
+	Record*				hashNext;
+	const RecordHeader*	header;
+	bool				allocated;
+};
+
+
+struct PackageSnapshot::RecordHashDefinition {
+	typedef ino_t	KeyType;
+	typedef	Record	ValueType;
+
+	size_t HashKey(ino_t key) const
+	{
+		return (size_t)key ^ (size_t)((uint64)key >> 32);
+	}
+
+	size_t Hash(const Record* value) const
+	{
+		return HashKey(value->header->node);
+	}
+
+	bool Compare(ino_t key, const Record* value) const
+	{
+		return value->header->node == key;
+	}
+
+	Record*& GetLink(Record* value) const
+	{
+		return value->hashNext;
+	}
+};
+
+
+// #pragma mark - PackageSnapshotRecorder
+
+
+struct PackageSnapshotRecorder::Buffer {
+	Buffer()
+		:
+		data(NULL),
+		size(0),
+		capacity(0)
+	{
+	}
+
+	~Buffer()
+	{
+		free(data);
+	}
+
+	bool Append(const void* bytes, size_t length)
+	{
+		if (capacity - size < length) {
+			if (length > kMaxRecordSize - size)
+				return false;
+
+			size_t newCapacity = capacity > 0 ? capacity : 4096;
+			while (newCapacity - size < length)
+				newCapacity *= 2;
+
+			uint8* newData = (uint8*)realloc(data, newCapacity);
+			if (newData == NULL)
+				return false;
+
+			data = newData;
+			capacity = newCapacity;
+		}
+
+		memcpy(data + size, bytes, length);
+		size += length;
+		return true;
+	}
+
+	uint8*	data;
+	size_t	size;
+	size_t	capacity;
+};
+
+
+struct PackageSnapshotRecorder::StringEntry {
+	StringEntry*	hashNext;
+	uint32			offset;
+	uint32			hash;
+};
+
+
+struct PackageSnapshotRecorder::StringHashDefinition {
+	typedef const char*	KeyType;
+	typedef	StringEntry	ValueType;
+
+	StringHashDefinition(const Buffer* strings)
+		:
+		fStrings(strings)
+	{
+	}
+
+	size_t HashKey(const char* key) const
+	{
+		return hash_hash_string(key);
+	}
+
+	size_t Hash(const StringEntry* value) const
+	{
+		return value->hash;
+	}
+
+	bool Compare(const char* key, const StringEntry* value) const
+	{
+		return strcmp(key, (const char*)fStrings->data + value->offset) == 0;
+	}
+
+	StringEntry*& GetLink(StringEntry* value) const
+	{
+		return value->hashNext;
+	}
+
+private:
+	const Buffer*	fStrings;
+};
+
+
+PackageSnapshotRecorder::PackageSnapshotRecorder(
+	BPackageContentHandler* target)
+	:
+	fTarget(target),
+	fStrings(NULL),
+	fEvents(NULL),
+	fStringTable(NULL),
+	fStatus(B_NO_INIT)
+{
+}
+
+
+PackageSnapshotRecorder::~PackageSnapshotRecorder()
+{
+	if (fStringTable != NULL) {
+		StringEntry* entry = fStringTable->Clear(true);
+		while (entry != NULL) {
+			StringEntry* next = entry->hashNext;
+			delete entry;
+			entry = next;
+		}
+		delete fStringTable;
+	}
+
+	delete fStrings;
+	delete fEvents;
+}
+
+
+/*!	If this fails, the recorder still passes everything on to its target,
+	it just doesn't record anything.
+*/
+status_t
+PackageSnapshotRecorder::Init()
+{
+	fStrings = new(std::nothrow) Buffer;
+	fEvents = new(std::nothrow) Buffer;
+	if (fStrings == NULL || fEvents == NULL)
+		RETURN_ERROR(fStatus = B_NO_MEMORY);
+
+	fStringTable = new(std::nothrow) StringTable(
+		StringHashDefinition(fStrings));
+	if (fStringTable == NULL)
+		RETURN_ERROR(fStatus = B_NO_MEMORY);
+
+	fStatus = fStringTable->Init();
+	if (fStatus != B_OK)
+		RETURN_ERROR(fStatus);
+
+	// the string table must not be empty, and always end with a null
+	if (!fStrings->Append("", 1))
+		RETURN_ERROR(fStatus = B_NO_MEMORY);
+
+	return B_OK;
+}
+
+
+status_t
+PackageSnapshotRecorder::HandleEntry(BPackageEntry* entry)
+{
+	_AppendUInt8(SNAPSHOT_ENTRY);
+	_AppendString(entry->Name());
+	_AppendUInt32(entry->Mode());
+	_AppendUInt64(entry->ModifiedTime().tv_sec);
+	_AppendUInt32(entry->ModifiedTime().tv_nsec);
+	_AppendString(entry->SymlinkPath());
+	_AppendData(entry->Data());
+
+	return fTarget->HandleEntry(entry);
+}
+
+
+status_t
+PackageSnapshotRecorder::HandleEntryAttribute(BPackageEntry* entry,
+	BPackageEntryAttribute* attribute)
+{
+	_AppendUInt8(SNAPSHOT_ENTRY_ATTRIBUTE);
+	_AppendString(attribute->Name());
+	_AppendUInt32(attribute->Type());
+	_AppendData(attribute->Data());
+
+	return fTarget->HandleEntryAttribute(entry, attribute);
+}
+
+
+status_t
+PackageSnapshotRecorder::HandleEntryDone(BPackageEntry* entry)
+{
+	_AppendUInt8(SNAPSHOT_ENTRY_DONE);
+
+	return fTarget->HandleEntryDone(entry);
+}
+
+
+status_t
+PackageSnapshotRecorder::HandlePackageAttribute(
+	const BPackageInfoAttributeValue& value)
+{
+	// Only record the attributes the package loader is interested in
+	switch (value.attributeID) {
+		case B_PACKAGE_INFO_NAME:
+		case B_PACKAGE_INFO_INSTALL_PATH:
+			_AppendUInt8(SNAPSHOT_PACKAGE_ATTRIBUTE);
+			_AppendUInt8(value.attributeID);
+			_AppendString(value.string);
+			break;
+
+		case B_PACKAGE_INFO_VERSION:
+			_AppendUInt8(SNAPSHOT_PACKAGE_ATTRIBUTE);
+			_AppendUInt8(value.attributeID);
+			_AppendVersion(value.version);
+			break;
+
+		case B_PACKAGE_INFO_FLAGS:
+		case B_PACKAGE_INFO_ARCHITECTURE:
+			_AppendUInt8(SNAPSHOT_PACKAGE_ATTRIBUTE);
+			_AppendUInt8(value.attributeID);
+			_AppendUInt64(value.unsignedInt);
+			break;
+
+		case B_PACKAGE_INFO_PROVIDES:
+			_AppendUInt8(SNAPSHOT_PACKAGE_ATTRIBUTE);
+			_AppendUInt8(value.attributeID);
+			_AppendString(value.resolvable.name);
+			_AppendUInt8(value.resolvable.haveVersion);
+			_AppendUInt8(value.resolvable.haveCompatibleVersion);
+			_AppendVersion(value.resolvable.version);
+			_AppendVersion(value.resolvable.compatibleVersion);
+			break;
+
+		case B_PACKAGE_INFO_REQUIRES:
+			_AppendUInt8(SNAPSHOT_PACKAGE_ATTRIBUTE);
+			_AppendUInt8(value.attributeID);
+			_AppendString(value.resolvableExpression.name);
+			_AppendUInt8(value.resolvableExpression.haveOpAndVersion);
+			_AppendUInt32(value.resolvableExpression.op);
+			_AppendVersion(value.resolvableExpression.version);
+			break;
+
+		default:
+			break;
+	}
+
+	return fTarget->HandlePackageAttribute(value);
+}
+
+
+void
+PackageSnapshotRecorder::HandleErrorOccurred()
+{
+	fStatus = B_BAD_DATA;
+	fTarget->HandleErrorOccurred();
+}
+
+
+void
+PackageSnapshotRecorder::_Append(const void* data, size_t size)
+{
+	if (fStatus != B_OK)
+		return;
+
+	if (!fEvents->Append(data, size))
+		fStatus = B_NO_MEMORY;
+}
+
+
+void
+PackageSnapshotRecorder::_AppendUInt8(uint8 value)
+{
+	_Append(&value, sizeof(value));
+}
+
+
+void
+PackageSnapshotRecorder::_AppendUInt32(uint32 value)
+{
+	_Append(&value, sizeof(value));
+}
+
+
+void
+PackageSnapshotRecorder::_AppendUInt64(uint64 value)
+{
+	_Append(&value, sizeof(value));
+}
+
+
+void
+PackageSnapshotRecorder::_AppendString(const char* string)
+{
+	if (fStatus != B_OK)
+		return;
+
+	if (string == NULL) {
+		_AppendUInt32(kNoString);
+		return;
+	}
+
+	StringEntry* entry = fStringTable->Lookup(string);
+	if (entry == NULL) {
+		entry = new(std::nothrow) StringEntry;
+		if (entry == NULL || fStrings->size >= kNoString
+			|| !fStrings->Append(string, strlen(string) + 1)) {
+			delete entry;
+			fStatus = B_NO_MEMORY;
+			return;
+		}
+
+		entry->offset = fStrings->size - strlen(string) - 1;
+		entry->hash = hash_hash_string(string);
+		fStringTable->InsertUnchecked(entry);
+	}
+
+	_AppendUInt32(entry->offset);
+}
+
+
+void
+PackageSnapshotRecorder::_AppendVersion(const BPackageVersionData& version)
+{
+	_AppendString(version.major);
+	_AppendString(version.minor);
+	_AppendString(version.micro);
+	_AppendString(version.preRelease);
+	_AppendUInt32(version.revision);
+}
+
+
+void
+PackageSnapshotRecorder::_AppendData(const BPackageData& data)
+{
+	_AppendUInt64(data.Size());
+	_AppendUInt8(data.IsEncodedInline());
+	if (data.IsEncodedInline())
+		_Append(data.InlineData(), data.Size());
+	else
+		_AppendUInt64(data.Offset());
+}
+
+
+// #pragma mark - Replayer
+
+
+/*!	Feeds the events of a package record to a content handler, just like
+	the package reader would. Without a handler, the record is only checked
+	for consistency.
+*/
+struct PackageSnapshot::Replayer {
+	Replayer(const RecordHeader* header, BPackageContentHandler* handler)
+		:
+		fHandler(handler),
+		fStrings((const char*)(header + 1)),
+		fStringsSize(header->strings_size),
+		fPosition((const uint8*)fStrings + fStringsSize),
+		fEnd(fPosition + header->events_size),
+		fEntry(NULL)
+	{
+	}
+
+	~Replayer()
+	{
+		while (fEntry != NULL)
+			_PopEntry();
+	}
+
+	status_t Run()
+	{
+		while (fPosition < fEnd) {
+			uint8 type;
+			if (!_Read(type))
+				return B_BAD_DATA;
+
+			status_t error;
+			switch (type) {
+				case SNAPSHOT_PACKAGE_ATTRIBUTE:
+					error = _PackageAttribute();
+					break;
+				case SNAPSHOT_ENTRY:
+					error = _Entry();
+					break;
+				case SNAPSHOT_ENTRY_ATTRIBUTE:
+					error = _EntryAttribute();
+					break;
+				case SNAPSHOT_ENTRY_DONE:
+					error = _EntryDone();
+					break;
+				default:
+					error = B_BAD_DATA;
+					break;
+			}
+
+			if (error != B_OK)
+				return error;
+		}
+
+		return fEntry == NULL ? B_OK : B_BAD_DATA;
+	}
+
+private:
+	status_t _PackageAttribute()
+	{
+		uint8 id;
+		if (!_Read(id))
+			return B_BAD_DATA;
+
+		BPackageInfoAttributeValue value;
+		value.attributeID = (BPackageInfoAttributeID)id;
+
+		bool valid;
+		switch (id) {
+			case B_PACKAGE_INFO_NAME:
+			case B_PACKAGE_INFO_INSTALL_PATH:
+				valid = _ReadString(value.string) && value.string != NULL;
+				break;
+
+			case B_PACKAGE_INFO_VERSION:
+				valid = _ReadVersion(value.version);
+				break;
+
+			case B_PACKAGE_INFO_FLAGS:
+			case B_PACKAGE_INFO_ARCHITECTURE:
+				valid = _Read(value.unsignedInt);
+				break;
+
+			case B_PACKAGE_INFO_PROVIDES:
+			{
+				BPackageResolvableData& resolvable = value.resolvable;
+				uint8 haveVersion;
+				uint8 haveCompatibleVersion;
+				valid = _ReadString(resolvable.name)
+					&& resolvable.name != NULL
+					&& _Read(haveVersion) && _Read(haveCompatibleVersion)
+					&& _ReadVersion(resolvable.version)
+					&& _ReadVersion(resolvable.compatibleVersion);
+				if (valid) {
+					resolvable.haveVersion = haveVersion != 0;
+					resolvable.haveCompatibleVersion
+						= haveCompatibleVersion != 0;
+				}
+				break;
+			}
+
+			case B_PACKAGE_INFO_REQUIRES:
+			{
+				BPackageResolvableExpressionData& expression
+					= value.resolvableExpression;
+				uint8 haveOpAndVersion;
+				uint32 op;
+				valid = _ReadString(expression.name) && expression.name != NULL
+					&& _Read(haveOpAndVersion) && _Read(op)
+					&& op < B_PACKAGE_RESOLVABLE_OP_ENUM_COUNT
+					&& _ReadVersion(expression.version);
+				if (valid) {
+					expression.haveOpAndVersion = haveOpAndVersion != 0;
+					expression.op = (BPackageResolvableOperator)op;
+				}
+				break;
+			}
+
+			default:
+				valid = false;
+				break;
+		}
+
+		if (!valid)
+			return B_BAD_DATA;
+
+		return fHandler != NULL ? fHandler->HandlePackageAttribute(value) : B_OK;
+	}
+
+	status_t _Entry()
+	{
+		const char* name;
+		uint32 mode;
+		uint64 modifiedTime;
+		uint32 modifiedTimeNanos;
+		const char* symlinkPath;
+		BPackageData data;
+		if (!_ReadString(name) || name == NULL || !_Read(mode)
+			|| !_Read(modifiedTime) || !_Read(modifiedTimeNanos)
+			|| !_ReadString(symlinkPath) || !_ReadData(data)) {
+			return B_BAD_DATA;
+		}
+
+		BPackageEntry* entry = new(std::nothrow) BPackageEntry(fEntry, name);
+		if (entry == NULL)
+			return B_NO_MEMORY;
+
+		entry->SetType(mode);
+		entry->SetPermissions(mode);
+		entry->SetModifiedTime(modifiedTime);
+		entry->SetModifiedTimeNanos(modifiedTimeNanos);
+		entry->SetSymlinkPath(symlinkPath);
+		entry->Data() = data;
+		fEntry = entry;
+
+		return fHandler != NULL ? fHandler->HandleEntry(entry) : B_OK;
+	}
+
+	status_t _EntryAttribute()
+	{
+		const char* name;
+		uint32 type;
+		BPackageData data;
+		if (fEntry == NULL || !_ReadString(name) || name == NULL
+			|| !_Read(type) || !_ReadData(data)) {
+			return B_BAD_DATA;
+		}
+
+		BPackageEntryAttribute attribute(name);
+		attribute.SetType(type);
+		attribute.Data() = data;
+
+		return fHandler != NULL
+			? fHandler->HandleEntryAttribute(fEntry, &attribute) : B_OK;
+	}
+
+	status_t _EntryDone()
+	{
+		if (fEntry == NULL)
+			return B_BAD_DATA;
+
+		status_t error = fHandler != NULL
+			? fHandler->HandleEntryDone(fEntry) : B_OK;
+		_PopEntry();
+		return error;
+	}
+
+	void _PopEntry()
+	{
+		BPackageEntry* entry = fEntry;
+		fEntry = const_cast<BPackageEntry*>(entry->Parent());
+		delete entry;
+	}
+
+	template<typename Type>
+	bool _Read(Type& value)
+	{
+		if ((size_t)(fEnd - fPosition) < sizeof(value))
+			return false;
+
+		memcpy(&value, fPosition, sizeof(value));
+		fPosition += sizeof(value);
+		return true;
+	}
+
+	bool _ReadString(const char*& _string)
+	{
+		uint32 offset;
+		if (!_Read(offset))
+			return false;
+
+		if (offset == kNoString) {
+			_string = NULL;
+			return true;
+		}
+
+		// the string table is null terminated, so every string in it is
+		if (offset >= fStringsSize)
+			return false;
+
+		_string = fStrings + offset;
+		return true;
+	}
+
+	bool _ReadVersion(BPackageVersionData& version)
+	{
+		return _ReadString(version.major) && _ReadString(version.minor)
+			&& _ReadString(version.micro) && _ReadString(version.preRelease)
+			&& _Read(version.revision);
+	}
+
+	bool _ReadData(BPackageData& data)
+	{
+		uint64 size;
+		uint8 encodedInline;
+		if (!_Read(size) || !_Read(encodedInline))
+			return false;
+
+		if (encodedInline != 0) {
+			if (size > B_HPKG_MAX_INLINE_DATA_SIZE
+				|| (size_t)(fEnd - fPosition) < size) {
+				return false;
+			}
+
+			data.SetData((uint8)size, fPosition);
+			fPosition += size;
+			return true;
+		}
+
+		uint64 offset;
+		if (!_Read(offset))
+			return false;
+
+		data.SetData(size, offset);
+		return true;
+	}
+
+private:
+	BPackageContentHandler*	fHandler;
+	const char*				fStrings;
+	size_t					fStringsSize;
+	const uint8*			fPosition;
+	const uint8*			fEnd;
+	BPackageEntry*			fEntry;
+};
+
+
+// #pragma mark - PackageSnapshot
+
+
+PackageSnapshot::PackageSnapshot()
+	:
+	fData(NULL),
+	fRecords(NULL),
+	fModified(false),
+	fHits(0),
+	fMisses(0)
+{
+	mutex_init(&fLock, "packagefs snapshot");
+}
+
+
+PackageSnapshot::~PackageSnapshot()
+{
+	if (fRecords != NULL) {
+		_RemoveAllRecords();
+		delete fRecords;
+	}
+
+	free(fData);
+	mutex_destroy(&fLock);
+}
+
+
+status_t
+PackageSnapshot::Init()
+{
+	fRecords = new(std::nothrow) RecordTable;
+	if (fRecords == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	return fRecords->Init();
+}
+
+
+/*!	Reads the snapshot file from the administrative directory of the given
+	packages directory. If it doesn't exist, or is not valid, the snapshot
+	stays empty, and every package will be parsed.
+*/
+status_t
+PackageSnapshot::Load(int packagesDirectoryFD)
+{
+	MutexLocker locker(fLock);
+	_Unset();
+
+	FileDescriptorCloser fd(openat(packagesDirectoryFD, kSnapshotFilePath,
+		O_RDONLY));
+	if (!fd.IsSet())
+		return errno;
+
+	struct stat st;
+	if (fstat(fd.Get(), &st) != 0)
+		return errno;
+
+	if (st.st_size < (off_t)sizeof(FileHeader)
+		|| st.st_size > (off_t)kMaxSnapshotSize) {
+		WARN("Ignoring package snapshot of invalid size\n");
+		return B_BAD_DATA;
+	}
+
+	size_t size = st.st_size;
+	uint8* data = (uint8*)malloc(size);
+	if (data == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	MemoryDeleter dataDeleter(data);
+
+	ssize_t bytesRead = read(fd.Get(), data, size);
+	if (bytesRead < 0)
+		return errno;
+	if ((size_t)bytesRead != size)
+		return B_ERROR;
+
+	const FileHeader* header = (const FileHeader*)data;
+	if (header->magic != kSnapshotMagic || header->version != kSnapshotVersion
+		|| header->size != size
+		|| crc32(0, data + sizeof(FileHeader), size - sizeof(FileHeader))
+			!= header->checksum) {
+		WARN("Ignoring invalid package snapshot\n");
+		return B_BAD_DATA;
+	}
+
+	// index the package records
+	size_t offset = sizeof(FileHeader);
+	for (uint32 i = 0; i < header->record_count; i++) {
+		const RecordHeader* record = (const RecordHeader*)(data + offset);
+		if (size - offset < sizeof(RecordHeader)
+			|| record->size < sizeof(RecordHeader)
+			|| record->size > size - offset || record->size % 8 != 0
+			|| record->strings_size == 0
+			|| (uint64)record->strings_size + record->events_size
+				> record->size - sizeof(RecordHeader)
+			|| data[offset + sizeof(RecordHeader) + record->strings_size - 1]
+				!= '\0') {
+			WARN("Ignoring invalid package snapshot\n");
+			_RemoveAllRecords();
+			return B_BAD_DATA;
+		}
+
+		status_t error = _AddRecord(record, false);
+		if (error != B_OK) {
+			_RemoveAllRecords();
+			RETURN_ERROR(error);
+		}
+
+		offset += record->size;
+	}
+
+	fData = (uint8*)dataDeleter.Detach();
+	return B_OK;
+}
+
+
+/*!	Writes a snapshot containing the records of all given packages. The
+	caller must make sure that \a packages doesn't change meanwhile.
+*/
+status_t
+PackageSnapshot::Write(int packagesDirectoryFD,
+	const PackageFileNameHashTable& packages)
+{
+	MutexLocker locker(fLock);
+
+	FileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = kSnapshotMagic;
+	header.version = kSnapshotVersion;
+	header.size = sizeof(FileHeader);
+	header.checksum = crc32(0, NULL, 0);
+
+	for (PackageFileNameHashTable::Iterator it = packages.GetIterator();
+			Package* package = it.Next();) {
+		Record* record = fRecords->Lookup(package->NodeID());
+		if (record == NULL)
+			continue;
+
+		header.checksum = crc32(header.checksum,
+			(const uint8*)record->header, record->header->size);
+		header.size += record->header->size;
+		header.record_count++;
+	}
+
+	if (header.size > kMaxSnapshotSize)
+		RETURN_ERROR(B_BUFFER_OVERFLOW);
+
+	FileDescriptorCloser fd(openat(packagesDirectoryFD, kSnapshotTempFilePath,
+		O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH));
+	if (!fd.IsSet())
+		return errno;
+
+	// An incompletely written file is detected by its checksum, so there is
+	// no need to wait for the data to hit the disk.
+	bool written = write(fd.Get(), &header, sizeof(header))
+		== (ssize_t)sizeof(header);
+	for (PackageFileNameHashTable::Iterator it = packages.GetIterator();
+			written && it.HasNext();) {
+		Record* record = fRecords->Lookup(it.Next()->NodeID());
+		if (record == NULL)
+			continue;
+
+		written = write(fd.Get(), record->header, record->header->size)
+			== (ssize_t)record->header->size;
+	}
+
+	fd.Unset();
+
+	status_t error = written ? _kern_rename(packagesDirectoryFD,
+		kSnapshotTempFilePath, packagesDirectoryFD, kSnapshotFilePath)
+		: B_IO_ERROR;
+	if (error != B_OK) {
+		unlinkat(packagesDirectoryFD, kSnapshotTempFilePath, 0);
+		RETURN_ERROR(error);
+	}
+
+	fModified = false;
+	return B_OK;
+}
+
+
+void
+PackageSnapshot::Unset()
+{
+	MutexLocker locker(fLock);
+	_Unset();
+}
+
+
+/*!	Replays the record of the package file \a st refers to to \a handler.
+	\a packageHeader is the header read from the file.
+	Returns \c B_ENTRY_NOT_FOUND, if the snapshot has no valid record for
+	the file; the handler has not been called in this case.
+*/
+status_t
+PackageSnapshot::Replay(const struct stat& st,
+	const hpkg_header& packageHeader, BPackageContentHandler* handler)
+{
+	MutexLocker locker(fLock);
+
+	Record* record = fRecords->Lookup(st.st_ino);
+	if (record != NULL) {
+		const RecordHeader* header = record->header;
+		if (header->file_size != st.st_size
+			|| header->modified_time != st.st_mtim.tv_sec
+			|| header->modified_time_nsec != (uint32)st.st_mtim.tv_nsec
+			|| memcmp(&header->package_header, &packageHeader,
+				sizeof(hpkg_header)) != 0) {
+			record = NULL;
+		} else if (Replayer(header, NULL).Run() != B_OK) {
+			WARN("Ignoring invalid package snapshot record\n");
+			record = NULL;
+		}
+	}
+
+	if (record == NULL) {
+		fMisses++;
+		return B_ENTRY_NOT_FOUND;
+	}
+
+	fHits++;
+	return Replayer(record->header, handler).Run();
+}
+
+
+/*!	Adds the content \a recorder recorded for the package file \a st refers
+	to, and whose header is \a packageHeader, replacing the previous record
+	of the file.
+*/
+status_t
+PackageSnapshot::AddPackage(const struct stat& st,
+	const hpkg_header& packageHeader, const PackageSnapshotRecorder& recorder)
+{
+	if (recorder.Status() != B_OK)
+		return recorder.Status();
+
+	size_t stringsSize = recorder.fStrings->size;
+	size_t eventsSize = recorder.fEvents->size;
+	size_t size = (sizeof(RecordHeader) + stringsSize + eventsSize + 7)
+		& ~(size_t)7;
+	if (size > kMaxRecordSize)
+		RETURN_ERROR(B_BUFFER_OVERFLOW);
+
+	RecordHeader* header = (RecordHeader*)calloc(1, size);
+	if (header == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	header->size = size;
+	header->strings_size = stringsSize;
+	header->events_size = eventsSize;
+	header->modified_time_nsec = st.st_mtim.tv_nsec;
+	header->node = st.st_ino;
+	header->file_size = st.st_size;
+	header->modified_time = st.st_mtim.tv_sec;
+	header->package_header = packageHeader;
+
+	uint8* data = (uint8*)(header + 1);
+	memcpy(data, recorder.fStrings->data, stringsSize);
+	memcpy(data + stringsSize, recorder.fEvents->data, eventsSize);
+
+	MutexLocker locker(fLock);
+
+	status_t error = _AddRecord(header, true);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	fModified = true;
+	return B_OK;
+}
+
+
+/*!	Returns whether the snapshot file needs to be written, because packages
+	have been parsed, or records of packages are no longer used.
+*/
+bool
+PackageSnapshot::IsModified() const
+{
+	MutexLocker locker(fLock);
+	return fModified || (size_t)fHits != fRecords->CountElements();
+}
+
+
+status_t
+PackageSnapshot::_AddRecord(const RecordHeader* header, bool allocated)
+{
+	Record* record = new(std::nothrow) Record;
+	if (record == NULL) {
+		if (allocated)
+			free((void*)header);
+		return B_NO_MEMORY;
+	}
+
+	record->header = header;
+	record->allocated = allocated;
+
+	Record* previous = fRecords->Lookup(header->node);
+	if (previous != NULL) {
+		fRecords->RemoveUnchecked(previous);
+		_DeleteRecord(previous);
+	}
+
+	fRecords->InsertUnchecked(record);
+	return B_OK;
+}
+
+
+void
+PackageSnapshot::_DeleteRecord(Record* record)
+{
+	if (record->allocated)
+		free((void*)record->header);
+	delete record;
+}
+
+
+void
+PackageSnapshot::_RemoveAllRecords()
+{
+	Record* record = fRecords->Clear(true);
+	while (record != NULL) {
+		Record* next = record->hashNext;
+		_DeleteRecord(record);
+		record = next;
+	}
+}
+
+
+void
+PackageSnapshot::_Unset()
+{
+	_RemoveAllRecords();
+
+	free(fData);
+	fData = NULL;
+	fModified = false;
+	fHits = 0;
+	fMisses = 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef PACKAGE_SNAPSHOT_H
+#define PACKAGE_SNAPSHOT_H
+
+
+#include <sys/stat.h>
+
+#include <package/hpkg/HPKGDefsPrivate.h>
+#include <package/hpkg/PackageContentHandler.h>
+#include <package/hpkg/PackageInfoAttributeValue.h>
+
+#include <lock.h>
+#include <util/OpenHashTable.h>
+
+#include "Package.h"
+
+
+/*!	Records everything a package content handler is told about a package,
+	while passing it on to the handler, so that it can be stored in a
+	PackageSnapshot and be replayed later without parsing the package again.
+*/
+class PackageSnapshotRecorder
+	: public BPackageKit::BHPKG::BPackageContentHandler {
+public:
+			typedef BPackageKit::BHPKG::BPackageContentHandler
+				BPackageContentHandler;
+			typedef BPackageKit::BHPKG::BPackageData BPackageData;
+			typedef BPackageKit::BHPKG::BPackageEntry BPackageEntry;
+			typedef BPackageKit::BHPKG::BPackageEntryAttribute
+				BPackageEntryAttribute;
+			typedef BPackageKit::BHPKG::BPackageInfoAttributeValue
+				BPackageInfoAttributeValue;
+			typedef BPackageKit::BHPKG::BPackageVersionData
+				BPackageVersionData;
+
+public:
+								PackageSnapshotRecorder(
+									BPackageContentHandler* target);
+	virtual						~PackageSnapshotRecorder();
+
+			status_t			Init();
+
+	virtual	status_t			HandleEntry(BPackageEntry* entry);
+	virtual	status_t			HandleEntryAttribute(BPackageEntry* entry,
+									BPackageEntryAttribute* attribute);
+	virtual	status_t			HandleEntryDone(BPackageEntry* entry);
+	virtual	status_t			HandlePackageAttribute(
+									const BPackageInfoAttributeValue& value);
+	virtual	void				HandleErrorOccurred();
+
+			status_t			Status() const	{ return fStatus; }
+
+private:
+			struct Buffer;
+			struct StringEntry;
+			struct StringHashDefinition;
+
+			typedef BOpenHashTable<StringHashDefinition> StringTable;
+
+			friend class PackageSnapshot;
+
+private:
+			void				_Append(const void* data, size_t size);
+			void				_AppendUInt8(uint8 value);
+			void				_AppendUInt32(uint32 value);
+			void				_AppendUInt64(uint64 value);
+			void				_AppendString(const char* string);
+			void				_AppendVersion(
+									const BPackageVersionData& version);
+			void				_AppendData(const BPackageData& data);
+
+private:
+			BPackageContentHandler* fTarget;
+			Buffer*				fStrings;
+			Buffer*				fEvents;
+			StringTable*		fStringTable;
+			status_t			fStatus;
+};
+
+
+/*!	A persistent snapshot of the contents of the packages of a volume. It is
+	stored in the administrative directory of the packages directory, and
+	holds one record per package, that is valid as long as the package file
+	is not changed.
+*/
+class PackageSnapshot {
+public:
+			typedef BPackageKit::BHPKG::BPackageContentHandler
+				BPackageContentHandler;
+			typedef BPackageKit::BHPKG::BPrivate::hpkg_header hpkg_header;
+
+public:
+								PackageSnapshot();
+								~PackageSnapshot();
+
+			status_t			Init();
+
+			status_t			Load(int packagesDirectoryFD);
+			status_t			Write(int packagesDirectoryFD,
+									const PackageFileNameHashTable& packages);
+			void				Unset();
+
+			status_t			Replay(const struct stat& st,
+									const hpkg_header& packageHeader,
+									BPackageContentHandler* handler);
+			status_t			AddPackage(const struct stat& st,
+									const hpkg_header& packageHeader,
+									const PackageSnapshotRecorder& recorder);
+
+			bool				IsModified() const;
+			int32				CountHits() const
+									{ return fHits; }
+			int32				CountMisses() const
+									{ return fMisses; }
+
+private:
+			struct FileHeader;
+			struct RecordHeader;
+			struct Record;
+			struct RecordHashDefinition;
+			struct Replayer;
+
+			typedef BOpenHashTable<RecordHashDefinition> RecordTable;
+
+private:
+			status_t			_AddRecord(const RecordHeader* header,
+									bool allocated);
+			void				_DeleteRecord(Record* record);
+			void				_RemoveAllRecords();
+			void				_Unset();
+
+private:
+	mutable	mutex				fLock;
+			uint8*				fData;
+			RecordTable*		fRecords;
+			bool				fModified;
+			int32				fHits;
+			int32				fMisses;
+};
+
+
+#endif	// PACKAGE_SNAPSHOT_H
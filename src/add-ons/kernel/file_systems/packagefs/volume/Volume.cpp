@@ -173,6 +173,8 @@ Volume::Volume(fs_volume* fsVolume)
 	fPackagesDirectories(),
 	fPackagesDirectoriesByNodeRef(),
 	fPackageSettings(),
+	fSnapshot(),
+	fUseSnapshot(true),
 	fNextNodeID(kRootDirectoryID + 1)
 {
 	rw_lock_init(&fLock, "packagefs volume");
@@ -251,6 +253,10 @@ Volume::Mount(const char* parameterString)
 	if (error != B_OK)
 		RETURN_ERROR(error);
 
+	error = fSnapshot.Init();
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
 	// create the name index
 	{
 		NameIndex* index = new(std::nothrow) NameIndex;
@@ -331,6 +337,8 @@ Volume::Mount(const char* parameterString)
 			"shine-through", NULL, NULL);
 		packagesState = get_driver_parameter(parameterHandle.Get(), "state",
 			NULL, NULL);
+		fUseSnapshot = get_driver_boolean_parameter(parameterHandle.Get(),
+			"snapshot", true, true);
 	}
 
 	if (packages != NULL && packages[0] == '\0') {
@@ -424,9 +432,20 @@ Volume::Mount(const char* parameterString)
 		RETURN_ERROR(error);
 
 	// add initial packages
+	bigtime_t startTime = system_time();
+	if (fUseSnapshot)
+		fSnapshot.Load(fPackagesDirectory->DirectoryFD());
+
 	error = _AddInitialPackages();
-	if (error != B_OK)
+	if (error != B_OK) {
+		fSnapshot.Unset();
 		RETURN_ERROR(error);
+	}
+
+	INFORM("Added %" B_PRIuSIZE " packages in %" B_PRIdBIGTIME " us, %"
+		B_PRId32 " of them from the snapshot\n", fPackages.CountElements(),
+		system_time() - startTime, fSnapshot.CountHits());
+	_WriteSnapshot();
 
 	// publish the root node
 	fRootDirectory->AcquireReference();
@@ -556,7 +575,16 @@ Volume::IOCtl(Node* node, uint32 operation, void* buffer, size_t size)
 			if (error != B_OK)
 				RETURN_ERROR(B_BAD_VALUE);
 
-			return _ChangeActivation(request);
+			if (fUseSnapshot)
+				fSnapshot.Load(fPackagesDirectory->DirectoryFD());
+
+			error = _ChangeActivation(request);
+			if (error == B_OK)
+				_WriteSnapshot();
+			else
+				fSnapshot.Unset();
+
+			return error;
 		}
 
 		default:
@@ -1537,7 +1565,8 @@ Volume::_LoadPackage(PackagesDirectory* packagesDirectory, const char* name,
 	if (error != B_OK)
 		return error;
 
-	error = package->Load(fPackageSettings);
+	error = package->Load(fPackageSettings,
+		fUseSnapshot ? &fSnapshot : NULL);
 	if (error != B_OK)
 		return error;
 
@@ -1707,6 +1736,28 @@ Volume::_ChangeActivation(ActivationChangeRequest& request)
 }
 
 
+/*!	Writes the package snapshot, if it is outdated, and frees the memory it
+	uses until the next time packages are loaded.
+*/
+void
+Volume::_WriteSnapshot()
+{
+	if (fUseSnapshot && fSnapshot.IsModified()) {
+		VolumeReadLocker volumeLocker(this);
+		status_t error = fSnapshot.Write(fPackagesDirectory->DirectoryFD(),
+			fPackages);
+		if (error != B_OK && error != B_READ_ONLY_DEVICE
+			&& error != B_ENTRY_NOT_FOUND) {
+			// not every packages directory has an administrative directory
+			ERROR("Failed to write the package snapshot: %s\n",
+				strerror(error));
+		}
+	}
+
+	fSnapshot.Unset();
+}
+
+
 status_t
 Volume::_InitMountType(const char* mountType)
 {
@@ -23,6 +23,7 @@
 #include "PackageLinksListener.h"
 #include "PackagesDirectory.h"
 #include "PackageSettings.h"
+#include "PackageSnapshot.h"
 #include "Query.h"
 
 
@@ -160,6 +161,8 @@ private:
 			status_t			_ChangeActivation(
 									ActivationChangeRequest& request);
 
+			void				_WriteSnapshot();
+
 			status_t			_InitMountType(const char* mountType);
 			status_t			_CreateShineThroughDirectory(Directory* parent,
 									const char* name, Directory*& _directory);
@@ -190,6 +193,8 @@ private:
 			PackagesDirectoryList fPackagesDirectories;
 			PackagesDirectoryHashTable fPackagesDirectoriesByNodeRef;
 			PackageSettings		fPackageSettings;
+			PackageSnapshot		fSnapshot;
+			bool				fUseSnapshot;
 
 			struct {
 				dev_t			deviceID;
@@ -190,6 +190,12 @@ struct Query::QueryPolicy {
 		return index.index->GetKeyLength();
 	}
 
+	static status_t IndexEstimatePosition(Index& index, const void* value,
+		size_t size, int32* _position)
+	{
+		return B_NOT_SUPPORTED;
+	}
+
 	static IndexIterator* IndexCreateIterator(Index& index)
 	{
 		IndexIterator* iterator = new(std::nothrow) IndexIterator(index.index);
@@ -225,6 +231,11 @@ struct Query::QueryPolicy {
 		return B_OK;
 	}
 
+	static ino_t IndexIteratorGetNodeID(IndexIterator* indexIterator)
+	{
+		return EntryGetNodeID(indexIterator->entry);
+	}
+
 	static void IndexIteratorSkipDuplicates(IndexIterator* indexIterator)
 	{
 		// Nothing to do.
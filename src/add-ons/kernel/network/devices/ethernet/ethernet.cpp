@@ -19,6 +19,7 @@
 #include <util/DoublyLinkedList.h>
 
 #include <KernelExport.h>
+#include <driver_settings.h>
 
 #include <errno.h>
 #include <net/if.h>
@@ -48,6 +49,39 @@ static sem_id sLinkChangeSemaphore;
 static thread_id sLinkCheckerThread;
 
 
+/*!	Receive coalescing is only used on request, via the "receive_coalescing"
+	parameter in the "ethernet" driver settings file. Without a value, or
+	with "true", it is enabled for all devices, otherwise only for the
+	devices it lists by name.
+*/
+static bool
+receive_coalescing_enabled(const char *name)
+{
+	void *handle = load_driver_settings("ethernet");
+	const driver_settings *settings = get_driver_settings(handle);
+	if (settings == NULL) {
+		unload_driver_settings(handle);
+		return false;
+	}
+
+	bool enabled = false;
+	for (int i = 0; i < settings->parameter_count && !enabled; i++) {
+		const driver_parameter &parameter = settings->parameters[i];
+		if (strcmp(parameter.name, "receive_coalescing") != 0)
+			continue;
+
+		enabled = parameter.value_count == 0;
+		for (int j = 0; j < parameter.value_count && !enabled; j++) {
+			enabled = strcmp(parameter.values[j], "true") == 0
+				|| strcmp(parameter.values[j], name) == 0;
+		}
+	}
+
+	unload_driver_settings(handle);
+	return enabled;
+}
+
+
 static status_t
 update_link_state(ethernet_device *device, bool notify = true)
 {
@@ -155,6 +189,9 @@ ethernet_init(const char *name, net_device **_device)
 	device->mtu = ETHER_MAX_FRAME_SIZE - ETHER_HEADER_LENGTH;
 	device->media = IFM_ACTIVE | IFM_ETHER;
 	device->header_length = ETHER_HEADER_LENGTH;
+	device->offload = NET_DEVICE_OFFLOAD_SEGMENTATION;
+	if (receive_coalescing_enabled(name))
+		device->offload |= NET_DEVICE_OFFLOAD_COALESCING;
 	device->fd = -1;
 
 	*_device = device;
@@ -194,6 +231,19 @@ ethernet_up(net_device *_device)
 			device->supports_net_buffer = true;
 	}
 
+	device->offload &= ~(NET_DEVICE_OFFLOAD_TSO4 | NET_DEVICE_OFFLOAD_TSO6);
+	if (device->supports_net_buffer) {
+		// Only drivers that get the whole buffer can split it themselves
+		uint32 offload;
+		if (ioctl(device->fd, ETHER_GET_OFFLOAD_CAPABILITIES, &offload,
+				sizeof(offload)) == 0) {
+			if ((offload & ETHER_OFFLOAD_TSO4) != 0)
+				device->offload |= NET_DEVICE_OFFLOAD_TSO4;
+			if ((offload & ETHER_OFFLOAD_TSO6) != 0)
+				device->offload |= NET_DEVICE_OFFLOAD_TSO6;
+		}
+	}
+
 	if (ioctl(device->fd, ETHER_GETFRAMESIZE, &device->frame_size, sizeof(uint32)) < 0) {
 		// this call is obviously optional
 		device->frame_size = ETHER_MAX_FRAME_SIZE;
@@ -274,7 +324,9 @@ ethernet_send_data(net_device *_device, net_buffer *buffer)
 	ethernet_device *device = (ethernet_device *)_device;
 
 //dprintf("try to send ethernet packet of %lu bytes (flags %ld):\n", buffer->size, buffer->flags);
-	if (buffer->size > device->frame_size || buffer->size < ETHER_HEADER_LENGTH)
+	if ((buffer->size > device->frame_size
+			&& (buffer->buffer_flags & NET_BUFFER_TCP_SEGMENTATION) == 0)
+		|| buffer->size < ETHER_HEADER_LENGTH)
 		return B_BAD_VALUE;
 
 	if (device->supports_net_buffer) {
@@ -61,6 +61,10 @@ loopback_init(const char *name, net_device **_device)
 	device->type = IFT_LOOP;
 	device->mtu = 65536;
 	device->media = IFM_ACTIVE;
+	device->offload = NET_DEVICE_OFFLOAD_TSO4 | NET_DEVICE_OFFLOAD_TSO6
+		| NET_DEVICE_OFFLOAD_COALESCING;
+		// the segments are never put on a wire, so they don't need to be
+		// split at all
 
 	*_device = device;
 	return B_OK;
@@ -1,5 +1,5 @@
 /*
- * Copyright 2012 Haiku, Inc. All rights reserved.
+ * Copyright 2012-2026 Haiku, Inc. All rights reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -9,13 +9,35 @@
 #define DEFINITIONS_H
 
 
-const char* kPortNameReq = "dns_resolver_req";
-const char* kPortNameRpl = "dns_resolver_rpl";
+#include <OS.h>
+
+
+const char* const kPortNameReq = "dns_resolver_req";
 
 enum MsgCodes {
 	MsgReply,
 	MsgError,
 	MsgGetAddrInfo,
+	MsgFlushCache,
+	MsgGetStatistics,
+};
+
+// Every request starts with this header; the answer is written to the
+// given port.
+struct request_header {
+	port_id		reply_port;
+};
+
+struct resolver_statistics {
+	uint64		lookups;
+	uint64		hits;
+	uint64		negative_hits;
+	uint64		misses;
+	uint64		coalesced;
+	uint64		evicted;
+	uint64		rejected;
+	uint32		entries;
+	uint32		pending;
 };
 
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 2012 Haiku, Inc. All rights reserved.
+ * Copyright 2012-2026 Haiku, Inc. All rights reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -10,6 +10,7 @@
 #include <net/dns_resolver.h>
 
 #include <AutoDeleter.h>
+#include <AutoDeleterOS.h>
 #include <FindDirectory.h>
 #include <lock.h>
 #include <port.h>
@@ -21,31 +22,31 @@
 
 static 	mutex		gPortLock;
 static	port_id		gPortRequest		= -1;
-static	port_id		gPortReply			= -1;
+static	team_id		gServerTeam			= -1;
 
-static	const int32	kQueueLength		= 1;
+static	const int32	kQueueLength		= 16;
 
 
+/*!	(Re)starts the server, unless that has already happened since
+	\a brokenPort was found to be unusable.
+*/
 static status_t
-dns_resolver_repair()
+dns_resolver_repair(port_id brokenPort)
 {
-	status_t result = B_OK;
+	MutexLocker locker(gPortLock);
+	if (gPortRequest != brokenPort)
+		return B_OK;
 
-	gPortRequest = create_port(kQueueLength, kPortNameReq);
-	if (gPortRequest < B_OK)
-		return gPortRequest;
+	status_t result = B_OK;
 
-	gPortReply = create_port(kQueueLength, kPortNameRpl);
-	if (gPortReply < B_OK) {
-		delete_port(gPortRequest);
-		return gPortReply;
-	}
+	port_id requestPort = create_port(kQueueLength, kPortNameReq);
+	if (requestPort < B_OK)
+		return requestPort;
 
 	char path[256];
 	if (find_directory(B_SYSTEM_SERVERS_DIRECTORY, static_cast<dev_t>(-1),
 		false, path, sizeof(path)) != B_OK) {
-		delete_port(gPortReply);
-		delete_port(gPortRequest);
+		delete_port(requestPort);
 		return B_NAME_NOT_FOUND;
 	}
 	strlcat(path, "/dns_resolver_server", sizeof(path));
@@ -54,22 +55,21 @@ dns_resolver_repair()
 	thread_id thread = load_image_etc(1, args, NULL, B_NORMAL_PRIORITY,
 		B_SYSTEM_TEAM, 0);
 	if (thread < B_OK) {
-		delete_port(gPortReply);
-		delete_port(gPortRequest);
+		delete_port(requestPort);
 		return thread;
 	}
 
-	set_port_owner(gPortRequest, thread);
-	set_port_owner(gPortReply, thread);
+	set_port_owner(requestPort, thread);
 
 	result = resume_thread(thread);
 	if (result != B_OK) {
 		kill_thread(thread);
-		delete_port(gPortReply);
-		delete_port(gPortRequest);
+		delete_port(requestPort);
 		return result;
 	}
 
+	gPortRequest = requestPort;
+	gServerTeam = thread;
 	return B_OK;
 }
 
@@ -78,7 +78,7 @@ static status_t
 dns_resolver_init()
 {
 	mutex_init(&gPortLock, NULL);
-	return dns_resolver_repair();
+	return dns_resolver_repair(gPortRequest);
 }
 
 
@@ -86,7 +86,6 @@ static status_t
 dns_resolver_uninit()
 {
 	delete_port(gPortRequest);
-	delete_port(gPortReply);
 	mutex_destroy(&gPortLock);
 
 	return B_OK;
@@ -128,13 +127,15 @@ GetAddrInfo(const char* node, const char* service,
 {
 	uint32 nodeSize = node != NULL ? strlen(node) + 1 : 1;
 	uint32 serviceSize = service != NULL ? strlen(service) + 1 : 1;
-	uint32 size = nodeSize + serviceSize + sizeof(*hints);
+	uint32 size = sizeof(request_header) + nodeSize + serviceSize
+		+ sizeof(*hints);
 	char* buffer = reinterpret_cast<char*>(malloc(size));
 	if (buffer == NULL)
 		return B_NO_MEMORY;
 	MemoryDeleter _(buffer);
 
-	off_t off = 0;
+	request_header* header = reinterpret_cast<request_header*>(buffer);
+	off_t off = sizeof(request_header);
 	if (node != NULL)
 		strcpy(buffer + off, node);
 	else
@@ -156,20 +157,35 @@ GetAddrInfo(const char* node, const char* service,
 		nullHints->ai_family = AF_UNSPEC;
 	}
 
-	MutexLocker locker(gPortLock);
+	// Requests are answered through a port of their own, so that any number
+	// of them can be handled by the server at the same time
 	do {
-		status_t result = write_port(gPortRequest, MsgGetAddrInfo, buffer,
-			size);
+		MutexLocker locker(gPortLock);
+		port_id requestPort = gPortRequest;
+		team_id serverTeam = gServerTeam;
+		locker.Unlock();
+
+		PortDeleter replyPort(create_port(1, "dns_resolver reply"));
+		if (!replyPort.IsSet())
+			return replyPort.Get();
+
+		// The reply port goes away with the server, so that we won't wait
+		// for an answer forever if it crashes
+		status_t result = set_port_owner(replyPort.Get(), serverTeam);
+		if (result == B_OK) {
+			header->reply_port = replyPort.Get();
+			result = write_port(requestPort, MsgGetAddrInfo, buffer, size);
+		}
 		if (result != B_OK) {
-			result = dns_resolver_repair();
+			result = dns_resolver_repair(requestPort);
 			if (result != B_OK)
 				return result;
 			continue;
 		}
 
-		ssize_t replySize = port_buffer_size(gPortReply);
+		ssize_t replySize = port_buffer_size(replyPort.Get());
 		if (replySize < B_OK) {
-			result = dns_resolver_repair();
+			result = dns_resolver_repair(requestPort);
 			if (result != B_OK)
 				return result;
 			continue;
@@ -180,10 +196,10 @@ GetAddrInfo(const char* node, const char* service,
 			return B_NO_MEMORY;
 
 		int32 code;
-		replySize = read_port(gPortReply, &code, reply, replySize);
+		replySize = read_port(replyPort.Get(), &code, reply, replySize);
 		if (replySize < B_OK) {
 			free(reply);
-			result = dns_resolver_repair();
+			result = dns_resolver_repair(requestPort);
 			if (result != B_OK)
 				return result;
 			continue;
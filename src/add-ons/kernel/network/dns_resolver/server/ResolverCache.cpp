@@ -0,0 +1,501 @@
+/*
+ * Copyright 2012-2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ *
+ * Authors:
+ *		Paweł Dziepak, pdziepak@quarnos.org
+ */
+
+
+#include "ResolverCache.h"
+
+#include <ctype.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/socket.h>
+
+#include <Autolock.h>
+
+
+static const int32 kMaxEntries = 1024;
+static const int kMaxTimeToLive = 24 * 60 * 60;
+	// in seconds
+static const bigtime_t kNegativeLifetime = 60000000LL;
+	// failed lookups are remembered for a minute
+
+
+static bigtime_t
+cache_lifetime(status_t status, int ttl)
+{
+	switch (status) {
+		case B_OK:
+			// Only answers from DNS are cached; the hosts file, and numeric
+			// addresses are cheap to look up again
+			if (ttl <= 0)
+				return 0;
+			return (bigtime_t)min_c(ttl, kMaxTimeToLive) * 1000000;
+
+		case EAI_NONAME:
+		case EAI_NODATA:
+			return kNegativeLifetime;
+
+		default:
+			// temporary failures must not stick
+			return 0;
+	}
+}
+
+
+status_t
+Serialize(char** _reply, uint32* _totalSize, const struct addrinfo* ai)
+{
+	uint32 addrsSize = ai == NULL ? 0 : sizeof(addrinfo);
+	uint32 namesSize = 0;
+	uint32 socksSize = 0;
+
+	const struct addrinfo* current = ai;
+	while (current != NULL) {
+		if (current->ai_canonname != NULL)
+			namesSize += strlen(current->ai_canonname) + 1;
+		if (current->ai_addr != NULL) {
+			if (current->ai_family == AF_INET)
+				socksSize += sizeof(sockaddr_in);
+			else
+				socksSize += sizeof(sockaddr_in6);
+		}
+		if (current->ai_next != NULL)
+			addrsSize += sizeof(addrinfo);
+		current = current->ai_next;
+	}
+
+	uint32 totalSize = addrsSize + namesSize + socksSize;
+	char* reply = reinterpret_cast<char*>(malloc(totalSize));
+	if (reply == NULL)
+		return B_NO_MEMORY;
+
+	uint32 addrPos = 0;
+	uint32 namePos = addrsSize;
+	uint32 sockPos = addrsSize + namesSize;
+
+	struct addrinfo temp;
+
+	current = ai;
+	while (current != NULL) {
+		memcpy(&temp, current, sizeof(addrinfo));
+
+		if (current->ai_canonname != NULL) {
+			strcpy(reply + namePos, current->ai_canonname);
+			uint32 nSize = strlen(current->ai_canonname) + 1;
+			temp.ai_canonname = reinterpret_cast<char*>(namePos);
+			namePos += nSize;
+		}
+		if (current->ai_addr != NULL) {
+			if (current->ai_family == AF_INET) {
+				memcpy(reply + sockPos, current->ai_addr, sizeof(sockaddr_in));
+				temp.ai_addr = reinterpret_cast<sockaddr*>(sockPos);
+				sockPos += sizeof(sockaddr_in);
+			} else {
+				memcpy(reply + sockPos, current->ai_addr, sizeof(sockaddr_in6));
+				temp.ai_addr = reinterpret_cast<sockaddr*>(sockPos);
+				sockPos += sizeof(sockaddr_in6);
+			}
+		}
+
+		addrinfo* next = current->ai_next;
+		if (next != NULL)
+			temp.ai_next = reinterpret_cast<addrinfo*>(addrPos) + 1;
+		else
+			temp.ai_next = NULL;
+
+		memcpy(reply + addrPos, &temp, sizeof(addrinfo));
+		addrPos += sizeof(addrinfo);
+
+		current = next;
+	}
+
+	*_reply = reply;
+	*_totalSize = totalSize;
+	return B_OK;
+}
+
+
+//	#pragma mark -
+
+
+CacheKey::CacheKey(const char* node, const char* service,
+	const struct addrinfo* hints)
+	:
+	node(node != NULL ? node : ""),
+	service(service != NULL ? service : ""),
+	flags(hints->ai_flags),
+	family(hints->ai_family),
+	socktype(hints->ai_socktype),
+	protocol(hints->ai_protocol)
+{
+}
+
+
+uint32
+CacheKey::Hash() const
+{
+	// host names are not case sensitive
+	uint32 hash = 0;
+	for (const char* c = node; c[0] != '\0'; c++)
+		hash = hash * 31 + tolower(c[0]);
+	for (const char* c = service; c[0] != '\0'; c++)
+		hash = hash * 31 + c[0];
+
+	return hash ^ ((uint32)flags << 24) ^ ((uint32)family << 16)
+		^ ((uint32)socktype << 8) ^ (uint32)protocol;
+}
+
+
+bool
+CacheKey::operator==(const CacheKey& other) const
+{
+	return flags == other.flags && family == other.family
+		&& socktype == other.socktype && protocol == other.protocol
+		&& strcasecmp(node, other.node) == 0
+		&& strcmp(service, other.service) == 0;
+}
+
+
+//	#pragma mark -
+
+
+ResolverCache::ResolverCache(resolve_func resolve, int32 workerCount,
+	int32 maxQueuedLookups)
+	:
+	fLock("resolver cache"),
+	fResolve(resolve),
+	fQueuedCount(0),
+	fMaxQueuedLookups(maxQueuedLookups),
+	fQueueSemaphore(-1),
+	fWorkers(NULL),
+	fWorkerCount(workerCount)
+{
+	memset(&fStatistics, 0, sizeof(fStatistics));
+}
+
+
+ResolverCache::~ResolverCache()
+{
+	// The workers quit once the semaphore is gone; lookups in progress are
+	// finished first
+	delete_sem(fQueueSemaphore);
+
+	if (fWorkers != NULL) {
+		for (int32 i = 0; i < fWorkerCount; i++) {
+			status_t result;
+			wait_for_thread(fWorkers[i], &result);
+		}
+		delete[] fWorkers;
+	}
+
+	CacheEntry* entry = fEntries.Clear(true);
+	while (entry != NULL) {
+		CacheEntry* next = entry->hash_next;
+		_DeleteEntry(entry);
+		entry = next;
+	}
+}
+
+
+status_t
+ResolverCache::Init()
+{
+	status_t result = fEntries.Init();
+	if (result != B_OK)
+		return result;
+
+	fQueueSemaphore = create_sem(0, "resolver queue");
+	if (fQueueSemaphore < 0)
+		return fQueueSemaphore;
+
+	fWorkers = new(std::nothrow) thread_id[fWorkerCount];
+	if (fWorkers == NULL)
+		return B_NO_MEMORY;
+
+	for (int32 i = 0; i < fWorkerCount; i++) {
+		fWorkers[i] = spawn_thread(&_WorkerThread, "resolver worker",
+			B_NORMAL_PRIORITY, this);
+		if (fWorkers[i] < 0) {
+			result = fWorkers[i];
+			fWorkerCount = i;
+			return result;
+		}
+
+		resume_thread(fWorkers[i]);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Sends the answer to the lookup to \a replyPort; either immediately from
+	the cache, or once the lookup is done.
+*/
+void
+ResolverCache::GetAddrInfo(const char* node, const char* service,
+	const struct addrinfo* hints, port_id replyPort)
+{
+	CacheKey key(node, service, hints);
+
+	BAutolock locker(fLock);
+	fStatistics.lookups++;
+
+	CacheEntry* entry = fEntries.Lookup(key);
+	if (entry != NULL && !entry->pending && entry->expires <= system_time()) {
+		fEntries.Remove(entry);
+		fCompletedEntries.Remove(entry);
+		_DeleteEntry(entry);
+		entry = NULL;
+	}
+
+	if (entry != NULL && entry->pending) {
+		// somebody is already looking up the same thing
+		if (!_AddWaiter(entry, replyPort)) {
+			_Reply(replyPort, B_NO_MEMORY, NULL, 0);
+			return;
+		}
+
+		fStatistics.coalesced++;
+		return;
+	}
+
+	if (entry != NULL) {
+		if (entry->status == B_OK)
+			fStatistics.hits++;
+		else
+			fStatistics.negative_hits++;
+
+		fCompletedEntries.Remove(entry);
+		fCompletedEntries.Add(entry);
+
+		_Reply(replyPort, entry->status, entry->reply, entry->reply_size);
+		return;
+	}
+
+	fStatistics.misses++;
+
+	if (fQueuedCount >= fMaxQueuedLookups) {
+		// all workers are busy, and enough requests are waiting for them
+		fStatistics.rejected++;
+		_Reply(replyPort, EAI_AGAIN, NULL, 0);
+		return;
+	}
+
+	entry = _CreateEntry(key);
+	if (entry == NULL || !_AddWaiter(entry, replyPort)) {
+		if (entry != NULL)
+			_DeleteEntry(entry);
+		_Reply(replyPort, B_NO_MEMORY, NULL, 0);
+		return;
+	}
+
+	fEntries.Insert(entry);
+	fQueuedEntries.Add(entry);
+	fQueuedCount++;
+	fStatistics.pending++;
+
+	_MakeRoom();
+	release_sem(fQueueSemaphore);
+}
+
+
+/*!	Forgets all answers. Lookups that are currently in progress are still
+	answered, but their result is not added to the cache.
+*/
+void
+ResolverCache::Flush()
+{
+	BAutolock locker(fLock);
+
+	while (CacheEntry* entry = fCompletedEntries.RemoveHead()) {
+		fEntries.Remove(entry);
+		_DeleteEntry(entry);
+	}
+
+	EntryTable::Iterator iterator = fEntries.GetIterator();
+	while (CacheEntry* entry = iterator.Next())
+		entry->discard = true;
+}
+
+
+void
+ResolverCache::GetStatistics(resolver_statistics& statistics)
+{
+	BAutolock locker(fLock);
+
+	statistics = fStatistics;
+	statistics.entries = fEntries.CountElements();
+}
+
+
+/*static*/ status_t
+ResolverCache::_WorkerThread(void* data)
+{
+	ResolverCache* cache = reinterpret_cast<ResolverCache*>(data);
+
+	while (acquire_sem(cache->fQueueSemaphore) == B_OK) {
+		BAutolock locker(cache->fLock);
+		CacheEntry* entry = cache->fQueuedEntries.RemoveHead();
+		if (entry == NULL)
+			continue;
+
+		cache->fQueuedCount--;
+		locker.Unlock();
+
+		cache->_Resolve(entry);
+	}
+
+	return B_OK;
+}
+
+
+void
+ResolverCache::_Resolve(CacheEntry* entry)
+{
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_flags = entry->key.flags;
+	hints.ai_family = entry->key.family;
+	hints.ai_socktype = entry->key.socktype;
+	hints.ai_protocol = entry->key.protocol;
+
+	const char* node = entry->key.node[0] != '\0' ? entry->key.node : NULL;
+	const char* service
+		= entry->key.service[0] != '\0' ? entry->key.service : NULL;
+
+	struct addrinfo* ai;
+	int ttl = -1;
+	status_t status = fResolve(node, service, &hints, &ai, &ttl);
+
+	char* reply = NULL;
+	uint32 replySize = 0;
+	if (status == B_OK) {
+		status = Serialize(&reply, &replySize, ai);
+		freeaddrinfo(ai);
+	}
+
+	BAutolock locker(fLock);
+
+	for (int32 i = 0; i < entry->waiter_count; i++)
+		_Reply(entry->waiters[i], status, reply, replySize);
+
+	free(entry->waiters);
+	entry->waiters = NULL;
+	entry->waiter_count = 0;
+	entry->pending = false;
+	fStatistics.pending--;
+
+	bigtime_t lifetime = cache_lifetime(status, ttl);
+	if (entry->discard || lifetime <= 0) {
+		fEntries.Remove(entry);
+		free(reply);
+		_DeleteEntry(entry);
+		return;
+	}
+
+	entry->status = status;
+	entry->reply = reply;
+	entry->reply_size = replySize;
+	entry->expires = system_time() + lifetime;
+	fCompletedEntries.Add(entry);
+
+	_MakeRoom();
+}
+
+
+CacheEntry*
+ResolverCache::_CreateEntry(const CacheKey& key)
+{
+	size_t nodeLength = strlen(key.node) + 1;
+	size_t serviceLength = strlen(key.service) + 1;
+
+	CacheEntry* entry = new(std::nothrow) CacheEntry(key);
+	if (entry == NULL)
+		return NULL;
+
+	entry->strings = (char*)malloc(nodeLength + serviceLength);
+	if (entry->strings == NULL) {
+		delete entry;
+		return NULL;
+	}
+
+	memcpy(entry->strings, key.node, nodeLength);
+	memcpy(entry->strings + nodeLength, key.service, serviceLength);
+
+	entry->key.node = entry->strings;
+	entry->key.service = entry->strings + nodeLength;
+	entry->expires = 0;
+	entry->status = B_OK;
+	entry->reply = NULL;
+	entry->reply_size = 0;
+	entry->pending = true;
+	entry->discard = false;
+	entry->waiters = NULL;
+	entry->waiter_count = 0;
+
+	return entry;
+}
+
+
+void
+ResolverCache::_DeleteEntry(CacheEntry* entry)
+{
+	free(entry->waiters);
+	free(entry->reply);
+	free(entry->strings);
+	delete entry;
+}
+
+
+bool
+ResolverCache::_AddWaiter(CacheEntry* entry, port_id port)
+{
+	port_id* waiters = (port_id*)realloc(entry->waiters,
+		(entry->waiter_count + 1) * sizeof(port_id));
+	if (waiters == NULL)
+		return false;
+
+	waiters[entry->waiter_count++] = port;
+	entry->waiters = waiters;
+	return true;
+}
+
+
+/*!	Evicts the least recently used entries while the cache is too large.
+	Entries with a pending lookup always stay.
+*/
+void
+ResolverCache::_MakeRoom()
+{
+	while ((int32)fEntries.CountElements() > kMaxEntries) {
+		CacheEntry* entry = fCompletedEntries.RemoveHead();
+		if (entry == NULL)
+			break;
+
+		fEntries.Remove(entry);
+		_DeleteEntry(entry);
+		fStatistics.evicted++;
+	}
+}
+
+
+/*!	Never blocks: every reply port only ever receives a single answer.
+*/
+/*static*/ void
+ResolverCache::_Reply(port_id port, status_t status, const char* reply,
+	uint32 size)
+{
+	if (status == B_OK) {
+		write_port_etc(port, MsgReply, reply, size, B_RELATIVE_TIMEOUT, 0);
+		return;
+	}
+
+	write_port_etc(port, MsgError, &status, sizeof(status),
+		B_RELATIVE_TIMEOUT, 0);
+}
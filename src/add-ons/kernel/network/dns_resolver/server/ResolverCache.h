@@ -0,0 +1,155 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef RESOLVER_CACHE_H
+#define RESOLVER_CACHE_H
+
+
+#include <netdb.h>
+
+#include <Locker.h>
+#include <OS.h>
+
+#include <util/DoublyLinkedList.h>
+#include <util/OpenHashTable.h>
+
+#include "Definitions.h"
+
+
+typedef int (*resolve_func)(const char* node, const char* service,
+	const struct addrinfo* hints, struct addrinfo** _result, int* _ttl);
+
+
+struct CacheKey {
+								CacheKey(const char* node,
+									const char* service,
+									const struct addrinfo* hints);
+
+			uint32				Hash() const;
+			bool				operator==(const CacheKey& other) const;
+
+			const char*			node;
+			const char*			service;
+			int					flags;
+			int					family;
+			int					socktype;
+			int					protocol;
+};
+
+
+class ResolverCache;
+
+
+struct CacheEntry : DoublyLinkedListLinkImpl<CacheEntry> {
+								CacheEntry(const CacheKey& key)
+									:
+									key(key)
+								{
+								}
+
+			CacheEntry*			hash_next;
+			CacheKey			key;
+			char*				strings;
+				// storage for the node and service of the key
+
+			bigtime_t			expires;
+			status_t			status;
+			char*				reply;
+			uint32				reply_size;
+
+			bool				pending;
+			bool				discard;
+			port_id*			waiters;
+			int32				waiter_count;
+};
+
+
+struct CacheEntryHashDefinition {
+	typedef CacheKey	KeyType;
+	typedef CacheEntry	ValueType;
+
+	size_t HashKey(const CacheKey& key) const
+	{
+		return key.Hash();
+	}
+
+	size_t Hash(CacheEntry* entry) const
+	{
+		return entry->key.Hash();
+	}
+
+	bool Compare(const CacheKey& key, CacheEntry* entry) const
+	{
+		return key == entry->key;
+	}
+
+	CacheEntry*& GetLink(CacheEntry* entry) const
+	{
+		return entry->hash_next;
+	}
+};
+
+
+/*!	Caches the answers of getaddrinfo() for as long as the DNS records they
+	are based on allow, and failed lookups for a short while. Concurrent
+	requests for the same answer are coalesced into a single lookup.
+	Lookups are done by a fixed number of worker threads; when too many of
+	them are waiting for a worker, further requests fail with EAI_AGAIN.
+	The answers are sent directly to the reply port of every request.
+*/
+class ResolverCache {
+public:
+								ResolverCache(resolve_func resolve,
+									int32 workerCount = 4,
+									int32 maxQueuedLookups = 64);
+								~ResolverCache();
+
+			status_t			Init();
+
+			void				GetAddrInfo(const char* node,
+									const char* service,
+									const struct addrinfo* hints,
+									port_id replyPort);
+			void				Flush();
+			void				GetStatistics(
+									resolver_statistics& statistics);
+
+private:
+	typedef BOpenHashTable<CacheEntryHashDefinition> EntryTable;
+	typedef DoublyLinkedList<CacheEntry> EntryList;
+
+	static	status_t			_WorkerThread(void* data);
+			void				_Resolve(CacheEntry* entry);
+
+			CacheEntry*			_CreateEntry(const CacheKey& key);
+			void				_DeleteEntry(CacheEntry* entry);
+			bool				_AddWaiter(CacheEntry* entry,
+									port_id port);
+			void				_MakeRoom();
+
+	static	void				_Reply(port_id port, status_t status,
+									const char* reply, uint32 size);
+
+private:
+			BLocker				fLock;
+			resolve_func		fResolve;
+			EntryTable			fEntries;
+			EntryList			fCompletedEntries;
+				// completed entries, least recently used first
+			EntryList			fQueuedEntries;
+				// entries waiting for a worker, oldest first
+			int32				fQueuedCount;
+			int32				fMaxQueuedLookups;
+			sem_id				fQueueSemaphore;
+			thread_id*			fWorkers;
+			int32				fWorkerCount;
+			resolver_statistics	fStatistics;
+};
+
+
+status_t Serialize(char** _reply, uint32* _totalSize,
+	const struct addrinfo* ai);
+
+
+#endif	// RESOLVER_CACHE_H
@@ -1,5 +1,5 @@
 /*
- * Copyright 2012 Haiku, Inc. All rights reserved.
+ * Copyright 2012-2026 Haiku, Inc. All rights reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -19,111 +19,49 @@
 #include <SupportDefs.h>
 
 #include "Definitions.h"
+#include "ResolverCache.h"
 
 
-port_id		gRequestPort;
-port_id		gReplyPort;
-
-
-status_t
-Serialize(char** _reply, uint32* _totalSize, const struct addrinfo* ai)
-{
-	uint32 addrsSize = ai == NULL ? 0 : sizeof(addrinfo);
-	uint32 namesSize = 0;
-	uint32 socksSize = 0;
-
-	const struct addrinfo* current = ai;
-	while (current != NULL) {
-		if (current->ai_canonname != NULL)
-			namesSize += strlen(current->ai_canonname) + 1;
-		if (current->ai_addr != NULL) {
-			if (current->ai_family == AF_INET)
-				socksSize += sizeof(sockaddr_in);
-			else
-				socksSize += sizeof(sockaddr_in6);
-		}
-		if (current->ai_next != NULL)
-			addrsSize += sizeof(addrinfo);
-		current = current->ai_next;
-	}
+extern "C" int __getaddrinfo_ttl(const char* hostname, const char* servname,
+	const struct addrinfo* hints, struct addrinfo** res, int* ttl);
+		// private libnetwork function
 
-	uint32 totalSize = addrsSize + namesSize + socksSize;
-	char* reply = reinterpret_cast<char*>(malloc(totalSize));
-	if (reply == NULL)
-		return B_NO_MEMORY;
-
-	uint32 addrPos = 0;
-	uint32 namePos = addrsSize;
-	uint32 sockPos = addrsSize + namesSize;
-
-	struct addrinfo temp;
-
-	current = ai;
-	while (current != NULL) {
-		memcpy(&temp, current, sizeof(addrinfo));
-
-		if (current->ai_canonname != NULL) {
-			strcpy(reply + namePos, current->ai_canonname);
-			uint32 nSize = strlen(current->ai_canonname) + 1;
-			temp.ai_canonname = reinterpret_cast<char*>(namePos);
-			namePos += nSize;
-		}
-		if (current->ai_addr != NULL) {
-			if (current->ai_family == AF_INET) {
-				memcpy(reply + sockPos, current->ai_addr, sizeof(sockaddr_in));
-				temp.ai_addr = reinterpret_cast<sockaddr*>(sockPos);
-				sockPos += sizeof(sockaddr_in);
-			} else {
-				memcpy(reply + sockPos, current->ai_addr, sizeof(sockaddr_in6));
-				temp.ai_addr = reinterpret_cast<sockaddr*>(sockPos);
-				sockPos += sizeof(sockaddr_in6);
-			}
-		}
 
-		addrinfo* next = current->ai_next;
-		if (next != NULL)
-			temp.ai_next = reinterpret_cast<addrinfo*>(addrPos) + 1;
-		else
-			temp.ai_next = NULL;
+port_id		gRequestPort;
+ResolverCache gCache(&__getaddrinfo_ttl);
 
-		memcpy(reply + addrPos, &temp, sizeof(addrinfo));
-		addrPos += sizeof(addrinfo);
 
-		current = next;
+static void
+Reply(port_id replyPort, status_t result, const void* reply, size_t size)
+{
+	if (result != B_OK) {
+		reply = &result;
+		size = sizeof(result);
 	}
 
-	*_reply = reply;
-	*_totalSize = totalSize;
-	return B_OK;
+	write_port_etc(replyPort, result == B_OK ? MsgReply : MsgError, reply,
+		size, B_RELATIVE_TIMEOUT, 0);
 }
 
 
 status_t
-GetAddrInfo(const char* buffer)
+GetAddrInfo(port_id replyPort, const char* buffer, size_t size)
 {
 	const char* node = buffer[0] == '\0' ? NULL : buffer;
-	uint32 nodeSize = node != NULL ? strlen(node) + 1 : 1;
+	uint32 nodeSize = strnlen(buffer, size) + 1;
+	if (nodeSize >= size)
+		return B_BAD_DATA;
 
 	const char* service = buffer[nodeSize] == '\0' ? NULL : buffer + nodeSize;
-	uint32 serviceSize = service != NULL ? strlen(service) + 1 : 1;
+	uint32 serviceSize = strnlen(buffer + nodeSize, size - nodeSize) + 1;
+	if (nodeSize + serviceSize + sizeof(addrinfo) > size)
+		return B_BAD_DATA;
 
 	const struct addrinfo* hints
 		= reinterpret_cast<const addrinfo*>(buffer + nodeSize + serviceSize);
 
-	struct addrinfo* ai;
-	status_t result = getaddrinfo(node, service, hints, &ai);
-	if (result != B_OK)
-		return write_port(gReplyPort, MsgError, &result, sizeof(result));
-
-	uint32 totalSize;
-	char* reply;
-	result = Serialize(&reply, &totalSize, ai);
-	freeaddrinfo(ai);
-	if (result != B_OK)
-		return write_port(gReplyPort, MsgError, &result, sizeof(result));
-	result = write_port(gReplyPort, MsgReply, reply, totalSize);
-	free(reply);
-	return result;
+	gCache.GetAddrInfo(node, service, hints, replyPort);
+	return B_OK;
 }
 
 
@@ -144,21 +82,41 @@ MainLoop()
 		size = read_port(gRequestPort, &code, buffer, size);
 		if (size < B_OK)
 			return 0;
+		if (size < (ssize_t)sizeof(request_header))
+			continue;
+
+		port_id replyPort
+			= reinterpret_cast<request_header*>(buffer)->reply_port;
+		const char* data
+			= reinterpret_cast<char*>(buffer) + sizeof(request_header);
+		size -= sizeof(request_header);
 
 		status_t result;
 		switch (code) {
 			case MsgGetAddrInfo:
-				result = GetAddrInfo(reinterpret_cast<char*>(buffer));
+				// the cache answers by itself
+				result = GetAddrInfo(replyPort, data, size);
+				if (result != B_OK)
+					Reply(replyPort, result, NULL, 0);
+				break;
+
+			case MsgFlushCache:
+				gCache.Flush();
+				Reply(replyPort, B_OK, NULL, 0);
 				break;
 
+			case MsgGetStatistics:
+			{
+				resolver_statistics statistics;
+				gCache.GetStatistics(statistics);
+				Reply(replyPort, B_OK, &statistics, sizeof(statistics));
+				break;
+			}
+
 			default:
-				result = B_BAD_VALUE;
-				write_port(gReplyPort, MsgError, &result, sizeof(result));
-				result = B_OK;
+				Reply(replyPort, B_BAD_VALUE, NULL, 0);
+				break;
 		}
-
-		if (result != B_OK)
-			return 0;
 	} while (true);
 }
 
@@ -172,12 +130,11 @@ main(int argc, char** argv)
 		return gRequestPort;
 	}
 
-	gReplyPort = find_port(kPortNameRpl);
-	if (gReplyPort < B_OK) {
-		fprintf(stderr, "%s\n", strerror(gReplyPort));
-		return gReplyPort;
+	status_t result = gCache.Init();
+	if (result != B_OK) {
+		fprintf(stderr, "%s\n", strerror(result));
+		return result;
 	}
 
 	return MainLoop();
 }
-
@@ -1600,11 +1600,14 @@ ipv4_send_routed_data(net_protocol* _protocol, struct net_route* route,
 		ntohl(destination.sin_addr.s_addr));
 
 	uint32 mtu = route->mtu ? route->mtu : interface->device->mtu;
-	if (buffer->size > mtu) {
+	if (buffer->size > mtu
+		&& (buffer->buffer_flags & NET_BUFFER_TCP_SEGMENTATION) == 0) {
 		// we need to fragment the packet
 		return send_fragments(protocol, route, buffer, mtu);
 	}
 
+	// Oversized TCP segments are split into segments in the datalink layer,
+	// or by the device itself
 	return sDatalinkModule->send_routed_data(route, buffer);
 }
 
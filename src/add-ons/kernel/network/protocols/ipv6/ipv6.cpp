@@ -1343,11 +1343,14 @@ ipv6_send_routed_data(net_protocol* _protocol, struct net_route* route,
 	TRACE_SK(protocol, "  SendRoutedData(): destination: %s", addrbuf);
 
 	uint32 mtu = route->mtu ? route->mtu : interface->device->mtu;
-	if (buffer->size > mtu) {
+	if (buffer->size > mtu
+		&& (buffer->buffer_flags & NET_BUFFER_TCP_SEGMENTATION) == 0) {
 		// we need to fragment the packet
 		return send_fragments(protocol, route, buffer, mtu);
 	}
 
+	// Oversized TCP segments are split into segments in the datalink layer,
+	// or by the device itself
 	return sDatalinkModule->send_routed_data(route, buffer);
 }
 
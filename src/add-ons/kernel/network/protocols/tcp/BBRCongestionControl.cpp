@@ -0,0 +1,383 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "TCPCongestionControl.h"
+
+#include <new>
+#include <string.h>
+
+#include <KernelExport.h>
+
+
+// References:
+//	- BBR: Congestion-Based Congestion Control, ACM Queue, Vol. 14, No. 5
+//	- draft-cardwell-iccrg-bbr-congestion-control-00
+//
+// This implements the model of BBR (version 1): the bottleneck bandwidth is
+// the maximum delivery rate over the last ten rounds, and the propagation
+// delay the minimum round trip time over the last ten seconds. Since the
+// stack cannot pace segments, the gains are applied to the congestion window
+// only, and the delivery rate is measured per round trip instead of per
+// segment.
+
+
+enum bbr_state {
+	BBR_STARTUP,
+	BBR_DRAIN,
+	BBR_PROBE_BANDWIDTH,
+	BBR_PROBE_ROUND_TRIP_TIME
+};
+
+static const char* const kStateNames[] = {
+	"startup",
+	"drain",
+	"probe bandwidth",
+	"probe round trip time"
+};
+
+// gains are in 1/1000
+static const uint32 kGainUnit = 1000;
+static const uint32 kHighGain = 2885;
+	// 2 / ln(2), the smallest gain that doubles the rate every round
+static const uint32 kProbeBandwidthGains[] = {
+	1250, 750, 1000, 1000, 1000, 1000, 1000, 1000
+};
+static const int32 kGainCycleLength = B_COUNT_OF(kProbeBandwidthGains);
+
+static const int32 kBandwidthFilterRounds = 10;
+static const int32 kFullBandwidthRounds = 3;
+static const bigtime_t kMinRoundTripTimeExpiry = 10000000;		// 10 secs
+static const bigtime_t kProbeRoundTripTimeDuration = 200000;	// 200 msecs
+static const uint32 kMinWindowSegments = 4;
+
+
+class BBRCongestionControl : public TCPCongestionControl {
+public:
+								BBRCongestionControl(uint32& window,
+									uint32& threshold,
+									const uint32& maxSegmentSize);
+
+	virtual	const char*			Name() const { return "bbr"; }
+
+	virtual	void				Init();
+	virtual	void				Acknowledged(
+									const tcp_congestion_sample& sample);
+	virtual	void				CongestionDetected(uint32 flightSize);
+	virtual	void				RecoveryFinished(uint32 flightSize);
+	virtual	void				Timeout(uint32 flightSize);
+
+	virtual	void				Dump() const;
+
+private:
+			uint64				_Bandwidth() const;
+			uint32				_TargetWindow(uint32 gain) const;
+
+			void				_UpdateRound(
+									const tcp_congestion_sample& sample,
+									bigtime_t now);
+			void				_UpdateMinRoundTripTime(
+									const tcp_congestion_sample& sample,
+									bigtime_t now);
+			void				_UpdateState(
+									const tcp_congestion_sample& sample,
+									bigtime_t now, bool roundStart);
+			void				_UpdateWindow(
+									const tcp_congestion_sample& sample);
+
+			void				_EnterProbeBandwidth(bigtime_t now);
+
+private:
+			bbr_state			fState;
+
+			uint64				fDelivered;
+			uint64				fRoundStartDelivered;
+			bigtime_t			fRoundStart;
+			tcp_sequence		fRoundEnd;
+			uint32				fRoundCount;
+			uint64				fBandwidthSamples[kBandwidthFilterRounds];
+				// in bytes per second
+
+			uint64				fFullBandwidth;
+			int32				fFullBandwidthRounds;
+			bool				fFilledPipe;
+
+			int32				fMinRoundTripTime;
+			bigtime_t			fMinRoundTripTimeStamp;
+
+			int32				fCycleIndex;
+			bigtime_t			fCycleStart;
+			bigtime_t			fProbeRoundTripTimeEnd;
+			uint32				fPriorWindow;
+};
+
+
+BBRCongestionControl::BBRCongestionControl(uint32& window, uint32& threshold,
+	const uint32& maxSegmentSize)
+	:
+	TCPCongestionControl(window, threshold, maxSegmentSize)
+{
+	Init();
+}
+
+
+void
+BBRCongestionControl::Init()
+{
+	fState = BBR_STARTUP;
+	fDelivered = 0;
+	fRoundStartDelivered = 0;
+	fRoundStart = 0;
+	fRoundEnd = 0;
+	fRoundCount = 0;
+	memset(fBandwidthSamples, 0, sizeof(fBandwidthSamples));
+	fFullBandwidth = 0;
+	fFullBandwidthRounds = 0;
+	fFilledPipe = false;
+	fMinRoundTripTime = -1;
+	fMinRoundTripTimeStamp = 0;
+	fCycleIndex = 0;
+	fCycleStart = 0;
+	fProbeRoundTripTimeEnd = 0;
+	fPriorWindow = 0;
+}
+
+
+void
+BBRCongestionControl::Acknowledged(const tcp_congestion_sample& sample)
+{
+	bigtime_t now = system_time();
+	fDelivered += sample.acknowledged;
+
+	bool roundStart = fRoundStart == 0 || sample.acknowledge >= fRoundEnd;
+	if (roundStart)
+		_UpdateRound(sample, now);
+
+	_UpdateMinRoundTripTime(sample, now);
+	_UpdateState(sample, now, roundStart);
+	_UpdateWindow(sample);
+}
+
+
+/*!	Loss does not change the model; the window is only reduced to what is
+	currently in flight for the duration of the recovery.
+*/
+void
+BBRCongestionControl::CongestionDetected(uint32 flightSize)
+{
+	fPriorWindow = max_c(fPriorWindow, fWindow);
+	fWindow = max_c(flightSize, kMinWindowSegments * fMaxSegmentSize);
+	fThreshold = fWindow;
+}
+
+
+void
+BBRCongestionControl::RecoveryFinished(uint32 flightSize)
+{
+	fWindow = max_c(fWindow, fPriorWindow);
+	fPriorWindow = 0;
+}
+
+
+void
+BBRCongestionControl::Timeout(uint32 flightSize)
+{
+	fPriorWindow = max_c(fPriorWindow, fWindow);
+	fWindow = fMaxSegmentSize;
+	fThreshold = fPriorWindow;
+}
+
+
+void
+BBRCongestionControl::Dump() const
+{
+	TCPCongestionControl::Dump();
+	kprintf("    state: %s\n", kStateNames[fState]);
+	kprintf("    bandwidth: %" B_PRIu64 " bytes/s\n", _Bandwidth());
+	kprintf("    min round trip time: %" B_PRId32 " ms\n", fMinRoundTripTime);
+	kprintf("    rounds: %" B_PRIu32 "\n", fRoundCount);
+	kprintf("    filled pipe: %s\n", fFilledPipe ? "yes" : "no");
+	if (fState == BBR_PROBE_BANDWIDTH)
+		kprintf("    gain cycle index: %" B_PRId32 "\n", fCycleIndex);
+}
+
+
+uint64
+BBRCongestionControl::_Bandwidth() const
+{
+	uint64 bandwidth = 0;
+	for (int32 i = 0; i < kBandwidthFilterRounds; i++)
+		bandwidth = max_c(bandwidth, fBandwidthSamples[i]);
+
+	return bandwidth;
+}
+
+
+/*!	Returns the bandwidth-delay product multiplied by \a gain, or 0 if there
+	is no estimate yet.
+*/
+uint32
+BBRCongestionControl::_TargetWindow(uint32 gain) const
+{
+	uint64 bandwidth = _Bandwidth();
+	if (bandwidth == 0 || fMinRoundTripTime < 0)
+		return 0;
+
+	// Timestamps only have a granularity of a millisecond
+	uint64 target = bandwidth * max_c(fMinRoundTripTime, 1) / 1000 * gain
+		/ kGainUnit;
+
+	// Allow for delayed and stretched acknowledgements
+	target += 3 * fMaxSegmentSize;
+
+	return (uint32)min_c(target, UINT32_MAX);
+}
+
+
+void
+BBRCongestionControl::_UpdateRound(const tcp_congestion_sample& sample,
+	bigtime_t now)
+{
+	if (fRoundStart != 0 && now > fRoundStart) {
+		uint64 delivered = fDelivered - fRoundStartDelivered;
+		fBandwidthSamples[fRoundCount % kBandwidthFilterRounds]
+			= delivered * 1000000 / (now - fRoundStart);
+		fRoundCount++;
+	}
+
+	fRoundStart = now;
+	fRoundStartDelivered = fDelivered;
+	fRoundEnd = sample.send_max;
+}
+
+
+void
+BBRCongestionControl::_UpdateMinRoundTripTime(
+	const tcp_congestion_sample& sample, bigtime_t now)
+{
+	bool expired = fMinRoundTripTimeStamp != 0
+		&& now > fMinRoundTripTimeStamp + kMinRoundTripTimeExpiry;
+
+	if (sample.round_trip_time >= 0 && (fMinRoundTripTime < 0
+			|| sample.round_trip_time <= fMinRoundTripTime || expired)) {
+		fMinRoundTripTime = sample.round_trip_time;
+		fMinRoundTripTimeStamp = now;
+	}
+
+	if (expired && fState != BBR_PROBE_ROUND_TRIP_TIME) {
+		// Drain the queue to measure the propagation delay again
+		fState = BBR_PROBE_ROUND_TRIP_TIME;
+		fPriorWindow = max_c(fPriorWindow, fWindow);
+		fProbeRoundTripTimeEnd = now + kProbeRoundTripTimeDuration;
+	}
+}
+
+
+void
+BBRCongestionControl::_UpdateState(const tcp_congestion_sample& sample,
+	bigtime_t now, bool roundStart)
+{
+	switch (fState) {
+		case BBR_STARTUP:
+		{
+			if (!roundStart || fRoundCount == 0)
+				break;
+
+			// the pipe is full when the bandwidth did not grow by at least
+			// 25% for three rounds
+			uint64 bandwidth = _Bandwidth();
+			if (bandwidth >= fFullBandwidth * 5 / 4) {
+				fFullBandwidth = bandwidth;
+				fFullBandwidthRounds = 0;
+			} else if (++fFullBandwidthRounds >= kFullBandwidthRounds) {
+				fFilledPipe = true;
+				fState = BBR_DRAIN;
+			}
+			break;
+		}
+
+		case BBR_DRAIN:
+			if (sample.flight_size <= _TargetWindow(kGainUnit))
+				_EnterProbeBandwidth(now);
+			break;
+
+		case BBR_PROBE_BANDWIDTH:
+			if (now - fCycleStart > max_c(fMinRoundTripTime, 1) * 1000LL) {
+				fCycleIndex = (fCycleIndex + 1) % kGainCycleLength;
+				fCycleStart = now;
+			}
+			break;
+
+		case BBR_PROBE_ROUND_TRIP_TIME:
+			if (now < fProbeRoundTripTimeEnd)
+				break;
+
+			fMinRoundTripTimeStamp = now;
+			fWindow = max_c(fWindow, fPriorWindow);
+			fPriorWindow = 0;
+
+			if (fFilledPipe)
+				_EnterProbeBandwidth(now);
+			else
+				fState = BBR_STARTUP;
+			break;
+	}
+}
+
+
+void
+BBRCongestionControl::_UpdateWindow(const tcp_congestion_sample& sample)
+{
+	const uint32 minWindow = kMinWindowSegments * fMaxSegmentSize;
+
+	if (fState == BBR_PROBE_ROUND_TRIP_TIME) {
+		fWindow = minWindow;
+		return;
+	}
+
+	uint32 gain;
+	switch (fState) {
+		case BBR_STARTUP:
+			gain = kHighGain;
+			break;
+		case BBR_PROBE_BANDWIDTH:
+			gain = kProbeBandwidthGains[fCycleIndex];
+			break;
+		default:
+			gain = kGainUnit;
+			break;
+	}
+
+	uint32 target = _TargetWindow(gain);
+	if (fFilledPipe && target != 0)
+		fWindow = min_c(fWindow + sample.acknowledged, target);
+	else if (target == 0 || fWindow < target)
+		fWindow += sample.acknowledged;
+
+	fWindow = max_c(fWindow, minWindow);
+}
+
+
+void
+BBRCongestionControl::_EnterProbeBandwidth(bigtime_t now)
+{
+	fState = BBR_PROBE_BANDWIDTH;
+	fCycleStart = now;
+
+	// do not start with the draining phase of the cycle
+	fCycleIndex = (fRoundCount % (kGainCycleLength - 1) + 2) % kGainCycleLength;
+}
+
+
+//	#pragma mark -
+
+
+TCPCongestionControl*
+create_bbr_congestion_control(uint32& window, uint32& threshold,
+	const uint32& maxSegmentSize)
+{
+	return new(std::nothrow) BBRCongestionControl(window, threshold,
+		maxSegmentSize);
+}
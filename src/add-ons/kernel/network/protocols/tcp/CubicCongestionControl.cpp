@@ -0,0 +1,211 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "TCPCongestionControl.h"
+
+#include <new>
+
+#include <KernelExport.h>
+
+
+// References:
+//	- RFC 9438 - CUBIC for Fast and Long-Distance Networks
+//
+// All computations are done in integer arithmetic, with the window in bytes,
+// and time in milliseconds.
+
+
+// multiplicative decrease factor, beta = 0.7
+static const uint32 kBetaNumerator = 7;
+static const uint32 kBetaDenominator = 10;
+
+// the time after which the window is no longer computed exactly
+static const int64 kMaxTimeOffset = 1 << 16;
+
+
+static uint32
+cube_root(uint64 value)
+{
+	// 2642245 is the largest number whose cube fits into 64 bits
+	uint64 low = 0;
+	uint64 high = 2642245;
+	while (low < high) {
+		uint64 middle = (low + high + 1) / 2;
+		if (middle * middle * middle <= value)
+			low = middle;
+		else
+			high = middle - 1;
+	}
+
+	return (uint32)low;
+}
+
+
+class CubicCongestionControl : public TCPCongestionControl {
+public:
+								CubicCongestionControl(uint32& window,
+									uint32& threshold,
+									const uint32& maxSegmentSize);
+
+	virtual	const char*			Name() const { return "cubic"; }
+
+	virtual	void				Init();
+	virtual	void				Acknowledged(
+									const tcp_congestion_sample& sample);
+	virtual	void				CongestionDetected(uint32 flightSize);
+	virtual	void				Timeout(uint32 flightSize);
+
+	virtual	void				Dump() const;
+
+private:
+			void				_Reduce(uint32 flightSize);
+			void				_StartEpoch();
+
+private:
+			uint32				fMaxWindow;
+			uint32				fOriginWindow;
+			uint32				fEstimatedWindow;
+			bigtime_t			fEpochStart;
+			int64				fTimeToOrigin;
+			int32				fRoundTripTime;
+};
+
+
+CubicCongestionControl::CubicCongestionControl(uint32& window,
+	uint32& threshold, const uint32& maxSegmentSize)
+	:
+	TCPCongestionControl(window, threshold, maxSegmentSize)
+{
+	Init();
+}
+
+
+void
+CubicCongestionControl::Init()
+{
+	fMaxWindow = 0;
+	fOriginWindow = 0;
+	fEstimatedWindow = 0;
+	fEpochStart = 0;
+	fTimeToOrigin = 0;
+	fRoundTripTime = 0;
+}
+
+
+void
+CubicCongestionControl::Acknowledged(const tcp_congestion_sample& sample)
+{
+	if (sample.round_trip_time >= 0)
+		fRoundTripTime = sample.round_trip_time;
+
+	if (fWindow < fThreshold) {
+		_SlowStart(sample.acknowledged);
+		return;
+	}
+
+	if (fEpochStart == 0)
+		_StartEpoch();
+
+	// W_cubic(t + RTT) = C * (t + RTT - K)^3 + W_max, with C = 0.4
+	int64 time = (system_time() - fEpochStart) / 1000 + fRoundTripTime
+		- fTimeToOrigin;
+	time = max_c(min_c(time, kMaxTimeOffset), -kMaxTimeOffset);
+	int64 offset = time * time * time * 4 / 10000 * fMaxSegmentSize / 1000000;
+
+	int64 target = (int64)fOriginWindow + offset;
+	if (target < (int64)fWindow)
+		target = fWindow;
+	else if (target > (int64)fWindow * 3 / 2)
+		target = (int64)fWindow * 3 / 2;
+
+	uint64 increment = (uint64)(target - fWindow) * sample.acknowledged
+		/ fWindow;
+
+	// Make sure to be at least as aggressive as Reno would be, with
+	// alpha = 3 * (1 - beta) / (1 + beta) = 9 / 17
+	fEstimatedWindow += (uint64)9 * fMaxSegmentSize * sample.acknowledged
+		/ (17 * (uint64)fWindow);
+	if (fEstimatedWindow > fWindow + increment)
+		increment = fEstimatedWindow - fWindow;
+
+	fWindow += increment;
+}
+
+
+void
+CubicCongestionControl::CongestionDetected(uint32 flightSize)
+{
+	_Reduce(flightSize);
+	fWindow = fThreshold;
+}
+
+
+void
+CubicCongestionControl::Timeout(uint32 flightSize)
+{
+	_Reduce(flightSize);
+	fWindow = fMaxSegmentSize;
+}
+
+
+void
+CubicCongestionControl::Dump() const
+{
+	TCPCongestionControl::Dump();
+	kprintf("    max window: %" B_PRIu32 "\n", fMaxWindow);
+	kprintf("    origin window: %" B_PRIu32 "\n", fOriginWindow);
+	kprintf("    estimated window: %" B_PRIu32 "\n", fEstimatedWindow);
+	kprintf("    epoch start: %" B_PRIdBIGTIME "\n", fEpochStart);
+	kprintf("    time to origin: %" B_PRId64 " ms\n", fTimeToOrigin);
+}
+
+
+void
+CubicCongestionControl::_Reduce(uint32 flightSize)
+{
+	fEpochStart = 0;
+
+	// fast convergence: release bandwidth for new flows, if the window did
+	// not even reach the previous maximum
+	if (fWindow < fMaxWindow) {
+		fMaxWindow = (uint64)fWindow * (kBetaDenominator + kBetaNumerator)
+			/ (2 * kBetaDenominator);
+	} else
+		fMaxWindow = fWindow;
+
+	fThreshold = max_c((uint64)flightSize * kBetaNumerator / kBetaDenominator,
+		2 * fMaxSegmentSize);
+}
+
+
+void
+CubicCongestionControl::_StartEpoch()
+{
+	fEpochStart = system_time();
+	fEstimatedWindow = fWindow;
+
+	if (fWindow < fMaxWindow) {
+		// K = cubic_root((W_max - cwnd) / C), in milliseconds
+		fTimeToOrigin = cube_root((uint64)(fMaxWindow - fWindow) * 2500000000ULL
+			/ fMaxSegmentSize);
+		fOriginWindow = fMaxWindow;
+	} else {
+		fTimeToOrigin = 0;
+		fOriginWindow = fWindow;
+	}
+}
+
+
+//	#pragma mark -
+
+
+TCPCongestionControl*
+create_cubic_congestion_control(uint32& window, uint32& threshold,
+	const uint32& maxSegmentSize)
+{
+	return new(std::nothrow) CubicCongestionControl(window, threshold,
+		maxSegmentSize);
+}
@@ -16,6 +16,7 @@
 #include <KernelExport.h>
 
 #include <NetUtilities.h>
+#include <smp.h>
 #include <tracing.h>
 
 #include "TCPEndpoint.h"
@@ -132,6 +133,7 @@ protected:
 
 static const uint16 kLastReservedPort = 1023;
 static const uint16 kFirstEphemeralPort = 40000;
+static const uint32 kMaxConnectionShards = 64;
 
 
 ConnectionHashDefinition::ConnectionHashDefinition(EndpointManager* manager)
@@ -175,6 +177,53 @@ ConnectionHashDefinition::GetLink(TCPEndpoint* endpoint) const
 //	#pragma mark -
 
 
+ListenerHashDefinition::ListenerHashDefinition(EndpointManager* manager)
+	:
+	fManager(manager)
+{
+}
+
+
+size_t
+ListenerHashDefinition::HashKey(const sockaddr* local) const
+{
+	return fManager->AddressModule()->get_port(local);
+}
+
+
+size_t
+ListenerHashDefinition::Hash(TCPEndpoint* endpoint) const
+{
+	return endpoint->LocalAddress().Port();
+}
+
+
+bool
+ListenerHashDefinition::Compare(const sockaddr* local,
+	TCPEndpoint* endpoint) const
+{
+	return endpoint->LocalAddress().EqualTo(local, true);
+}
+
+
+bool
+ListenerHashDefinition::CompareValues(TCPEndpoint* first,
+	TCPEndpoint* second) const
+{
+	return first->LocalAddress().EqualTo(second->LocalAddress(), true);
+}
+
+
+TCPEndpoint*&
+ListenerHashDefinition::GetLink(TCPEndpoint* endpoint) const
+{
+	return endpoint->fConnectionHashLink;
+}
+
+
+//	#pragma mark -
+
+
 size_t
 EndpointHashDefinition::HashKey(uint16 port) const
 {
@@ -214,18 +263,43 @@ EndpointHashDefinition::GetLink(TCPEndpoint* endpoint) const
 //	#pragma mark -
 
 
+EndpointManager::ConnectionShard::ConnectionShard(EndpointManager* manager)
+	:
+	table(manager)
+{
+	rw_lock_init(&lock, "TCP connection shard");
+}
+
+
+EndpointManager::ConnectionShard::~ConnectionShard()
+{
+	rw_lock_destroy(&lock);
+}
+
+
+//	#pragma mark -
+
+
 EndpointManager::EndpointManager(net_domain* domain)
 	:
 	fDomain(domain),
-	fConnectionHash(this),
+	fConnectionShards(NULL),
+	fConnectionShardCount(0),
+	fListenerHash(this),
 	fLastPort(kFirstEphemeralPort)
 {
 	rw_lock_init(&fLock, "TCP endpoint manager");
+	rw_lock_init(&fListenerLock, "TCP listeners");
 }
 
 
 EndpointManager::~EndpointManager()
 {
+	for (uint32 i = 0; i < fConnectionShardCount; i++)
+		delete fConnectionShards[i];
+	delete[] fConnectionShards;
+
+	rw_lock_destroy(&fListenerLock);
 	rw_lock_destroy(&fLock);
 }
 
@@ -233,7 +307,32 @@ EndpointManager::~EndpointManager()
 status_t
 EndpointManager::Init()
 {
-	status_t status = fConnectionHash.Init();
+	// Use a power of two number of shards, so that concurrent connections
+	// rarely end up in the same shard
+	uint32 count = 1;
+	while (count < 2 * (uint32)smp_get_num_cpus()
+		&& count < kMaxConnectionShards)
+		count <<= 1;
+
+	fConnectionShards = new(std::nothrow) ConnectionShard*[count];
+	if (fConnectionShards == NULL)
+		return B_NO_MEMORY;
+
+	for (; fConnectionShardCount < count; fConnectionShardCount++) {
+		ConnectionShard* shard = new(std::nothrow) ConnectionShard(this);
+		if (shard == NULL)
+			return B_NO_MEMORY;
+
+		fConnectionShards[fConnectionShardCount] = shard;
+
+		status_t status = shard->table.Init();
+		if (status != B_OK) {
+			fConnectionShardCount++;
+			return status;
+		}
+	}
+
+	status_t status = fListenerHash.Init();
 	if (status == B_OK)
 		status = fEndpointHash.Init();
 
@@ -244,14 +343,88 @@ EndpointManager::Init()
 //	#pragma mark - connections
 
 
+/*!	Returns the shard of the connection table that contains the connection
+	between \a local, and \a peer.
+*/
+EndpointManager::ConnectionShard&
+EndpointManager::_ShardFor(const sockaddr* local, const sockaddr* peer) const
+{
+	// The lower bits of the hash select the bucket within the shard's table,
+	// so use the upper bits here
+	uint32 hash = AddressModule()->hash_address_pair(local, peer)
+		* 0x9e3779b1;
+	return *fConnectionShards[(hash >> 16) & (fConnectionShardCount - 1)];
+}
+
+
 /*!	Returns the endpoint matching the connection.
-	You must hold the manager's lock when calling this method (either read or
-	write).
+	You must hold the lock of the connection's shard when calling this
+	method (either read or write).
 */
 TCPEndpoint*
 EndpointManager::_LookupConnection(const sockaddr* local, const sockaddr* peer)
 {
-	return fConnectionHash.Lookup(std::make_pair(local, peer));
+	return _ShardFor(local, peer).table.Lookup(std::make_pair(local, peer));
+}
+
+
+/*!	Returns the endpoint listening on \a local for a connection from \a peer.
+	If several endpoints listen on the same address (via SO_REUSEPORT), the
+	connection is assigned to one of them based on the hash of its addresses.
+	This spreads incoming connections evenly across them, and thus across the
+	threads accepting them.
+	The returned endpoint's socket has been acquired already.
+	You must hold fListenerLock when calling this method (either read or
+	write).
+*/
+TCPEndpoint*
+EndpointManager::_LookupListener(const sockaddr* local, const sockaddr* peer)
+{
+	ListenerTable::ValueIterator iterator = fListenerHash.Lookup(local);
+
+	uint32 count = 0;
+	while (iterator.HasNext()) {
+		iterator.Next();
+		count++;
+	}
+	if (count == 0)
+		return NULL;
+
+	uint32 index = 0;
+	if (count > 1)
+		index = AddressModule()->hash_address_pair(local, peer) % count;
+
+	// If the chosen endpoint is going away, try the others in order
+	for (uint32 tries = 0; tries < count; tries++) {
+		iterator.Rewind();
+		for (uint32 i = 0; i < (index + tries) % count; i++)
+			iterator.Next();
+
+		TCPEndpoint* endpoint = iterator.Next();
+		if (gSocketModule->acquire_socket(endpoint->socket))
+			return endpoint;
+	}
+
+	return NULL;
+}
+
+
+/*!	Removes the endpoint from the connection or listener table, whichever it
+	is in. Must be called before its addresses are changed.
+*/
+void
+EndpointManager::_RemoveConnection(TCPEndpoint* endpoint)
+{
+	if (endpoint->PeerAddress().IsEmpty(false)) {
+		WriteLocker _(fListenerLock);
+		fListenerHash.Remove(endpoint);
+		return;
+	}
+
+	ConnectionShard& shard = _ShardFor(*endpoint->LocalAddress(),
+		*endpoint->PeerAddress());
+	WriteLocker _(shard.lock);
+	shard.table.Remove(endpoint);
 }
 
 
@@ -261,8 +434,6 @@ EndpointManager::SetConnection(TCPEndpoint* endpoint, const sockaddr* _local,
 {
 	TRACE(("EndpointManager::SetConnection(%p)\n", endpoint));
 
-	WriteLocker _(fLock);
-
 	SocketAddressStorage local(AddressModule());
 	local.SetTo(_local);
 
@@ -272,6 +443,21 @@ EndpointManager::SetConnection(TCPEndpoint* endpoint, const sockaddr* _local,
 		local.SetPort(port);
 	}
 
+	// BOpenHashTable doesn't support inserting duplicate objects. Since
+	// BOpenHashTable is a chained hash table where the items are required to
+	// be intrusive linked list nodes, inserting the same object twice will
+	// create a cycle in the linked list, which is not handled currently.
+	//
+	// We need to makes sure to remove any existing copy of this endpoint
+	// object from the tables in order to handle calling connect() on a closed
+	// or listening socket to connect to a different remote (address, port)
+	// than it was originally used for. Since the address pair determines the
+	// shard, this has to happen before the addresses are changed.
+	_RemoveConnection(endpoint);
+
+	ConnectionShard& shard = _ShardFor(*local, peer);
+	WriteLocker _(shard.lock);
+
 	// We want to create a connection for (local, peer), so check to make sure
 	// that this pair is not already in use by an existing connection.
 	if (_LookupConnection(*local, peer) != NULL)
@@ -281,22 +467,7 @@ EndpointManager::SetConnection(TCPEndpoint* endpoint, const sockaddr* _local,
 	endpoint->PeerAddress().SetTo(peer);
 	T(Connect(endpoint));
 
-	// BOpenHashTable doesn't support inserting duplicate objects. Since
-	// BOpenHashTable is a chained hash table where the items are required to
-	// be intrusive linked list nodes, inserting the same object twice will
-	// create a cycle in the linked list, which is not handled currently.
-	//
-	// We need to makes sure to remove any existing copy of this endpoint
-	// object from the table in order to handle calling connect() on a closed
-	// socket to connect to a different remote (address, port) than it was
-	// originally used for.
-	//
-	// We use RemoveUnchecked here because we don't want the hash table to
-	// resize itself after this removal when we are planning to just add
-	// another.
-	fConnectionHash.RemoveUnchecked(endpoint);
-
-	fConnectionHash.Insert(endpoint);
+	shard.table.Insert(endpoint);
 	return B_OK;
 }
 
@@ -311,19 +482,29 @@ EndpointManager::SetPassive(TCPEndpoint* endpoint)
 		SocketAddressStorage local(AddressModule());
 		local.SetToEmpty();
 
+		endpoint->fBoundUser = geteuid();
 		status_t status = _BindToEphemeral(endpoint, *local);
 		if (status < B_OK)
 			return status;
 	}
 
-	SocketAddressStorage passive(AddressModule());
-	passive.SetToEmpty();
+	WriteLocker listenerLocker(fListenerLock);
 
-	if (_LookupConnection(*endpoint->LocalAddress(), *passive))
-		return EADDRINUSE;
+	// Several endpoints may only listen on the same address if all of them
+	// have SO_REUSEPORT set, and were bound by the same user
+	ListenerTable::ValueIterator iterator
+		= fListenerHash.Lookup(*endpoint->LocalAddress());
+	while (iterator.HasNext()) {
+		TCPEndpoint* listener = iterator.Next();
+		if (listener == endpoint
+			|| (endpoint->socket->options & SO_REUSEPORT) == 0
+			|| (listener->socket->options & SO_REUSEPORT) == 0
+			|| listener->fBoundUser != endpoint->fBoundUser)
+			return EADDRINUSE;
+	}
 
-	endpoint->PeerAddress().SetTo(*passive);
-	fConnectionHash.Insert(endpoint);
+	endpoint->PeerAddress().SetToEmpty();
+	fListenerHash.Insert(endpoint);
 	return B_OK;
 }
 
@@ -331,39 +512,39 @@ EndpointManager::SetPassive(TCPEndpoint* endpoint)
 TCPEndpoint*
 EndpointManager::FindConnection(sockaddr* local, sockaddr* peer)
 {
-	ReadLocker _(fLock);
-
-	TCPEndpoint *endpoint = _LookupConnection(local, peer);
-	if (endpoint != NULL) {
-		TRACE(("TCP: Received packet corresponds to explicit endpoint %p\n",
-			endpoint));
-		if (gSocketModule->acquire_socket(endpoint->socket))
-			return endpoint;
+	{
+		ConnectionShard& shard = _ShardFor(local, peer);
+		ReadLocker _(shard.lock);
+
+		TCPEndpoint* endpoint = _LookupConnection(local, peer);
+		if (endpoint != NULL) {
+			TRACE(("TCP: Received packet corresponds to explicit endpoint "
+				"%p\n", endpoint));
+			if (gSocketModule->acquire_socket(endpoint->socket))
+				return endpoint;
+		}
 	}
 
-	// no explicit endpoint exists, check for wildcard endpoints
+	// no explicit endpoint exists, check for listening endpoints
 
-	SocketAddressStorage wildcard(AddressModule());
-	wildcard.SetToEmpty();
+	ReadLocker _(fListenerLock);
 
-	endpoint = _LookupConnection(local, *wildcard);
+	TCPEndpoint* endpoint = _LookupListener(local, peer);
 	if (endpoint != NULL) {
 		TRACE(("TCP: Received packet corresponds to wildcard endpoint %p\n",
 			endpoint));
-		if (gSocketModule->acquire_socket(endpoint->socket))
-			return endpoint;
+		return endpoint;
 	}
 
 	SocketAddressStorage localWildcard(AddressModule());
 	localWildcard.SetToEmpty();
 	localWildcard.SetPort(AddressModule()->get_port(local));
 
-	endpoint = _LookupConnection(*localWildcard, *wildcard);
+	endpoint = _LookupListener(*localWildcard, peer);
 	if (endpoint != NULL) {
 		TRACE(("TCP: Received packet corresponds to local wildcard endpoint "
 			"%p\n", endpoint));
-		if (gSocketModule->acquire_socket(endpoint->socket))
-			return endpoint;
+		return endpoint;
 	}
 
 	// no matching endpoint exists
@@ -385,6 +566,8 @@ EndpointManager::Bind(TCPEndpoint* endpoint, const sockaddr* address)
 
 	WriteLocker locker(fLock);
 
+	endpoint->fBoundUser = geteuid();
+
 	if (AddressModule()->get_port(address) == 0)
 		return _BindToEphemeral(endpoint, address);
 
@@ -392,6 +575,10 @@ EndpointManager::Bind(TCPEndpoint* endpoint, const sockaddr* address)
 }
 
 
+/*!	Binds an endpoint spawned from a listener; it must already have taken
+	over the listener's fBoundUser, as this is not called in the context of
+	the user that bound the listener.
+*/
 status_t
 EndpointManager::BindChild(TCPEndpoint* endpoint, const sockaddr* address)
 {
@@ -448,6 +635,14 @@ EndpointManager::_BindToAddress(WriteLocker& locker, TCPEndpoint* endpoint,
 					break;
 				}
 
+				if ((endpoint->socket->options & SO_REUSEPORT) != 0
+					&& (user->socket->options & SO_REUSEPORT) != 0
+					&& user->fBoundUser == geteuid()) {
+					// both want to share the port, and belong to the same
+					// user; others must not be able to steal connections
+					continue;
+				}
+
 				if ((endpoint->socket->options & SO_REUSEADDR) == 0)
 					return EADDRINUSE;
 
@@ -532,13 +727,13 @@ EndpointManager::Unbind(TCPEndpoint* endpoint)
 		return B_BAD_VALUE;
 	}
 
+	_RemoveConnection(endpoint);
+
 	WriteLocker _(fLock);
 
 	if (!fEndpointHash.Remove(endpoint))
 		panic("bound endpoint %p not in hash!", endpoint);
 
-	fConnectionHash.Remove(endpoint);
-
 	(*endpoint->LocalAddress())->sa_len = 0;
 
 	return B_OK;
@@ -590,18 +785,28 @@ EndpointManager::Dump() const
 	kprintf("%10s %21s %21s %8s %8s %12s\n", "address", "local", "peer",
 		"recv-q", "send-q", "state");
 
-	ConnectionTable::Iterator iterator = fConnectionHash.GetIterator();
+	ListenerTable::Iterator listeners = fListenerHash.GetIterator();
+	while (listeners.HasNext())
+		_DumpEndpoint(listeners.Next());
 
-	while (iterator.HasNext()) {
-		TCPEndpoint *endpoint = iterator.Next();
+	for (uint32 i = 0; i < fConnectionShardCount; i++) {
+		ConnectionTable::Iterator iterator
+			= fConnectionShards[i]->table.GetIterator();
+		while (iterator.HasNext())
+			_DumpEndpoint(iterator.Next());
+	}
+}
 
-		char localBuf[64], peerBuf[64];
-		endpoint->LocalAddress().AsString(localBuf, sizeof(localBuf), true);
-		endpoint->PeerAddress().AsString(peerBuf, sizeof(peerBuf), true);
 
-		kprintf("%p %21s %21s %8lu %8lu %12s\n", endpoint, localBuf, peerBuf,
-			endpoint->fReceiveQueue.Available(), endpoint->fSendQueue.Used(),
-			name_for_state(endpoint->State()));
-	}
+void
+EndpointManager::_DumpEndpoint(TCPEndpoint* endpoint) const
+{
+	char localBuf[64], peerBuf[64];
+	endpoint->LocalAddress().AsString(localBuf, sizeof(localBuf), true);
+	endpoint->PeerAddress().AsString(peerBuf, sizeof(peerBuf), true);
+
+	kprintf("%p %21s %21s %8lu %8lu %12s\n", endpoint, localBuf, peerBuf,
+		endpoint->fReceiveQueue.Available(), endpoint->fSendQueue.Used(),
+		name_for_state(endpoint->State()));
 }
 
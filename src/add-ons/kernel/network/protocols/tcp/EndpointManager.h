@@ -52,6 +52,31 @@ private:
 };
 
 
+class ListenerHashDefinition {
+public:
+	typedef const sockaddr* KeyType;
+	typedef TCPEndpoint ValueType;
+
+							ListenerHashDefinition(EndpointManager* manager);
+							ListenerHashDefinition(
+									const ListenerHashDefinition& definition)
+								: fManager(definition.fManager)
+							{
+							}
+
+			size_t			HashKey(const sockaddr* local) const;
+			size_t			Hash(TCPEndpoint* endpoint) const;
+			bool			Compare(const sockaddr* local,
+								TCPEndpoint* endpoint) const;
+			bool			CompareValues(TCPEndpoint* first,
+								TCPEndpoint* second) const;
+			TCPEndpoint*&	GetLink(TCPEndpoint* endpoint) const;
+
+private:
+	EndpointManager*		fManager;
+};
+
+
 class EndpointHashDefinition {
 public:
 	typedef uint16 KeyType;
@@ -96,8 +121,26 @@ public:
 			void			Dump() const;
 
 private:
+	typedef BOpenHashTable<ConnectionHashDefinition> ConnectionTable;
+	typedef MultiHashTable<ListenerHashDefinition> ListenerTable;
+	typedef MultiHashTable<EndpointHashDefinition> EndpointTable;
+
+	struct ConnectionShard {
+								ConnectionShard(EndpointManager* manager);
+								~ConnectionShard();
+
+		rw_lock					lock;
+		ConnectionTable			table;
+	};
+
+			ConnectionShard& _ShardFor(const sockaddr* local,
+								const sockaddr* peer) const;
 			TCPEndpoint*	_LookupConnection(const sockaddr* local,
 								const sockaddr* peer);
+			TCPEndpoint*	_LookupListener(const sockaddr* local,
+								const sockaddr* peer);
+			void			_RemoveConnection(TCPEndpoint* endpoint);
+			void			_DumpEndpoint(TCPEndpoint* endpoint) const;
 			status_t		_Bind(TCPEndpoint* endpoint,
 								const sockaddr* address);
 			status_t		_BindToAddress(WriteLocker& locker,
@@ -105,12 +148,13 @@ private:
 			status_t		_BindToEphemeral(TCPEndpoint* endpoint,
 								const sockaddr* address);
 
-	typedef BOpenHashTable<ConnectionHashDefinition> ConnectionTable;
-	typedef MultiHashTable<EndpointHashDefinition> EndpointTable;
-
 	rw_lock					fLock;
+		// protects fEndpointHash and fLastPort
 	net_domain*				fDomain;
-	ConnectionTable			fConnectionHash;
+	ConnectionShard**		fConnectionShards;
+	uint32					fConnectionShardCount;
+	rw_lock					fListenerLock;
+	ListenerTable			fListenerHash;
 	EndpointTable			fEndpointHash;
 	uint16					fLastPort;
 };
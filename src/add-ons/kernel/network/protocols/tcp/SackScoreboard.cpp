@@ -0,0 +1,166 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "SackScoreboard.h"
+
+#include <KernelExport.h>
+
+
+SackScoreboard::SackScoreboard()
+	:
+	fCount(0),
+	fSackedBytes(0)
+{
+}
+
+
+void
+SackScoreboard::Clear()
+{
+	fCount = 0;
+	fSackedBytes = 0;
+}
+
+
+/*!	Forgets about everything below \a acknowledge, and adds the given SACK
+	blocks. Blocks that are outside of the data sent are ignored, as are
+	duplicate SACKs (RFC 2883).
+*/
+void
+SackScoreboard::Update(tcp_sequence acknowledge, tcp_sequence sendMax,
+	const tcp_sack* sacks, int count)
+{
+	int32 index = 0;
+	while (index < fCount && fBlocks[index].right <= acknowledge)
+		index++;
+	if (index > 0) {
+		for (int32 i = index; i < fCount; i++)
+			fBlocks[i - index] = fBlocks[i];
+		fCount -= index;
+	}
+	if (fCount > 0 && fBlocks[0].left < acknowledge)
+		fBlocks[0].left = acknowledge;
+
+	for (int i = 0; i < count; i++) {
+		tcp_sequence left = sacks[i].left_edge;
+		tcp_sequence right = sacks[i].right_edge;
+		if (right <= left || right <= acknowledge || right > sendMax)
+			continue;
+		if (left < acknowledge)
+			left = acknowledge;
+
+		_Add(left, right);
+	}
+
+	fSackedBytes = 0;
+	for (int32 i = 0; i < fCount; i++)
+		fSackedBytes += (fBlocks[i].right - fBlocks[i].left).Number();
+}
+
+
+tcp_sequence
+SackScoreboard::HighestSacked() const
+{
+	if (fCount == 0)
+		return 0;
+
+	return fBlocks[fCount - 1].right;
+}
+
+
+/*!	Returns the number of bytes in the range from \a from to \a to that have
+	not been selectively acknowledged.
+*/
+uint32
+SackScoreboard::UnsackedBytes(tcp_sequence from, tcp_sequence to) const
+{
+	if (to <= from)
+		return 0;
+
+	uint32 bytes = (to - from).Number();
+	for (int32 i = 0; i < fCount && fBlocks[i].left < to; i++) {
+		tcp_sequence left = fBlocks[i].left > from ? fBlocks[i].left : from;
+		tcp_sequence right = fBlocks[i].right < to ? fBlocks[i].right : to;
+		if (left < right)
+			bytes -= (right - left).Number();
+	}
+
+	return bytes;
+}
+
+
+/*!	Finds the first range of data at or after \a from that has not been
+	selectively acknowledged, but lies below data that has been.
+*/
+bool
+SackScoreboard::NextHole(tcp_sequence from, tcp_sequence& _start,
+	uint32& _length) const
+{
+	for (int32 i = 0; i < fCount; i++) {
+		if (from < fBlocks[i].left) {
+			_start = from;
+			_length = (fBlocks[i].left - from).Number();
+			return true;
+		}
+		if (from < fBlocks[i].right)
+			from = fBlocks[i].right;
+	}
+
+	return false;
+}
+
+
+void
+SackScoreboard::Dump() const
+{
+	kprintf("    sacked: %" B_PRIu32 " bytes in %" B_PRId32 " blocks\n",
+		fSackedBytes, fCount);
+	for (int32 i = 0; i < fCount; i++) {
+		kprintf("      %" B_PRIu32 " - %" B_PRIu32 "\n",
+			fBlocks[i].left.Number(), fBlocks[i].right.Number());
+	}
+}
+
+
+/*!	Inserts the given range, and merges it with all blocks it overlaps or
+	touches. If there is no room left, the highest block is dropped, as the
+	lower ones are the ones needed for recovery first.
+*/
+void
+SackScoreboard::_Add(tcp_sequence left, tcp_sequence right)
+{
+	int32 first = 0;
+	while (first < fCount && fBlocks[first].right < left)
+		first++;
+
+	int32 last = first;
+	while (last < fCount && fBlocks[last].left <= right) {
+		if (fBlocks[last].left < left)
+			left = fBlocks[last].left;
+		if (fBlocks[last].right > right)
+			right = fBlocks[last].right;
+		last++;
+	}
+
+	int32 merged = last - first;
+	if (merged == 0) {
+		if (fCount == kMaxBlocks) {
+			if (first == fCount)
+				return;
+			fCount--;
+		}
+		for (int32 i = fCount; i > first; i--)
+			fBlocks[i] = fBlocks[i - 1];
+		fCount++;
+	} else if (merged > 1) {
+		for (int32 i = last; i < fCount; i++)
+			fBlocks[i - merged + 1] = fBlocks[i];
+		fCount -= merged - 1;
+	}
+
+	fBlocks[first].left = left;
+	fBlocks[first].right = right;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef SACK_SCOREBOARD_H
+#define SACK_SCOREBOARD_H
+
+
+#include "tcp.h"
+
+
+/*!	Keeps track of the data the peer has selectively acknowledged, for use in
+	loss recovery on the sender side (RFC 6675).
+*/
+class SackScoreboard {
+public:
+								SackScoreboard();
+
+			void				Clear();
+			void				Update(tcp_sequence acknowledge,
+									tcp_sequence sendMax,
+									const tcp_sack* sacks, int count);
+
+			bool				IsEmpty() const { return fCount == 0; }
+			uint32				SackedBytes() const { return fSackedBytes; }
+			tcp_sequence		HighestSacked() const;
+
+			uint32				UnsackedBytes(tcp_sequence from,
+									tcp_sequence to) const;
+			bool				NextHole(tcp_sequence from,
+									tcp_sequence& _start,
+									uint32& _length) const;
+
+			void				Dump() const;
+
+private:
+			struct block {
+				tcp_sequence	left;
+				tcp_sequence	right;
+			};
+
+			void				_Add(tcp_sequence left, tcp_sequence right);
+
+private:
+	static	const int32			kMaxBlocks = 16;
+
+			block				fBlocks[kMaxBlocks];
+			int32				fCount;
+			uint32				fSackedBytes;
+};
+
+
+#endif	// SACK_SCOREBOARD_H
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "TCPCongestionControl.h"
+
+#include <new>
+#include <string.h>
+
+#include <KernelExport.h>
+
+
+typedef TCPCongestionControl* (*congestion_control_factory)(uint32& window,
+	uint32& threshold, const uint32& maxSegmentSize);
+
+struct congestion_control_info {
+	const char*					name;
+	congestion_control_factory	create;
+};
+
+static const congestion_control_info kCongestionControls[] = {
+	{"newreno", &create_new_reno_congestion_control},
+	{"cubic", &create_cubic_congestion_control},
+	{"bbr", &create_bbr_congestion_control},
+};
+static const int32 kCongestionControlCount = B_COUNT_OF(kCongestionControls);
+
+static int32 sDefaultCongestionControl = 0;
+
+
+static int32
+find_congestion_control(const char* name)
+{
+	for (int32 i = 0; i < kCongestionControlCount; i++) {
+		if (strcmp(kCongestionControls[i].name, name) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+
+//	#pragma mark - TCPCongestionControl
+
+
+TCPCongestionControl::TCPCongestionControl(uint32& window, uint32& threshold,
+	const uint32& maxSegmentSize)
+	:
+	fWindow(window),
+	fThreshold(threshold),
+	fMaxSegmentSize(maxSegmentSize)
+{
+}
+
+
+TCPCongestionControl::~TCPCongestionControl()
+{
+}
+
+
+void
+TCPCongestionControl::Init()
+{
+}
+
+
+/*!	Halves the window as NewReno does (RFC 5681 § 3.2); the endpoint inflates
+	it afterwards, if it doesn't use selective acknowledgments for recovery.
+*/
+void
+TCPCongestionControl::CongestionDetected(uint32 flightSize)
+{
+	fThreshold = max_c(flightSize / 2, 2 * fMaxSegmentSize);
+	fWindow = fThreshold;
+}
+
+
+void
+TCPCongestionControl::RecoveryFinished(uint32 flightSize)
+{
+	// deflate the window (RFC 6582 § 3.2, step 3)
+	fWindow = min_c(fThreshold, max_c(flightSize, fMaxSegmentSize)
+		+ fMaxSegmentSize);
+}
+
+
+void
+TCPCongestionControl::Timeout(uint32 flightSize)
+{
+	fThreshold = max_c(flightSize / 2, 2 * fMaxSegmentSize);
+	fWindow = fMaxSegmentSize;
+}
+
+
+void
+TCPCongestionControl::Dump() const
+{
+	kprintf("  congestion control: %s\n", Name());
+}
+
+
+void
+TCPCongestionControl::_SlowStart(uint32 acknowledged)
+{
+	fWindow += min_c(acknowledged, fMaxSegmentSize);
+}
+
+
+//	#pragma mark - NewReno
+
+
+class NewRenoCongestionControl : public TCPCongestionControl {
+public:
+	NewRenoCongestionControl(uint32& window, uint32& threshold,
+			const uint32& maxSegmentSize)
+		:
+		TCPCongestionControl(window, threshold, maxSegmentSize)
+	{
+	}
+
+	virtual const char* Name() const
+	{
+		return "newreno";
+	}
+
+	virtual void Acknowledged(const tcp_congestion_sample& sample)
+	{
+		if (fWindow < fThreshold) {
+			_SlowStart(sample.acknowledged);
+			return;
+		}
+
+		// Congestion avoidance with appropriate byte counting (RFC 3465):
+		// grow by one segment per window acknowledged.
+		uint64 increment = (uint64)fMaxSegmentSize * sample.acknowledged
+			/ fWindow;
+		fWindow += max_c(increment, 1);
+	}
+};
+
+
+TCPCongestionControl*
+create_new_reno_congestion_control(uint32& window, uint32& threshold,
+	const uint32& maxSegmentSize)
+{
+	return new(std::nothrow) NewRenoCongestionControl(window, threshold,
+		maxSegmentSize);
+}
+
+
+//	#pragma mark -
+
+
+/*!	Creates the congestion control algorithm with the given \a name, or the
+	default one, if \a name is \c NULL.
+*/
+TCPCongestionControl*
+create_congestion_control(const char* name, uint32& window, uint32& threshold,
+	const uint32& maxSegmentSize)
+{
+	int32 index = atomic_get(&sDefaultCongestionControl);
+	if (name != NULL) {
+		index = find_congestion_control(name);
+		if (index < 0)
+			return NULL;
+	}
+
+	return kCongestionControls[index].create(window, threshold,
+		maxSegmentSize);
+}
+
+
+bool
+is_congestion_control(const char* name)
+{
+	return find_congestion_control(name) >= 0;
+}
+
+
+const char*
+default_congestion_control()
+{
+	return kCongestionControls[atomic_get(&sDefaultCongestionControl)].name;
+}
+
+
+status_t
+set_default_congestion_control(const char* name)
+{
+	int32 index = find_congestion_control(name);
+	if (index < 0)
+		return B_NAME_NOT_FOUND;
+
+	atomic_set(&sDefaultCongestionControl, index);
+	return B_OK;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef TCP_CONGESTION_CONTROL_H
+#define TCP_CONGESTION_CONTROL_H
+
+
+#include "tcp.h"
+
+
+#define TCP_DEFAULT_CONGESTION_CONTROL	"cubic"
+
+
+struct tcp_congestion_sample {
+	tcp_sequence	acknowledge;
+	tcp_sequence	send_max;
+	uint32			acknowledged;
+		// number of bytes newly acknowledged
+	uint32			flight_size;
+		// bytes still in flight after this acknowledgement
+	int32			round_trip_time;
+		// in milliseconds, or -1 if the acknowledgement has no sample
+};
+
+
+/*!	A congestion control algorithm of a TCP endpoint.
+
+	It maintains the congestion window and the slow start threshold of the
+	endpoint; both are owned by the endpoint, and are passed in by reference,
+	as is its send maximum segment size. Loss recovery itself, that is, which
+	segments are retransmitted when, stays with the endpoint.
+*/
+class TCPCongestionControl {
+public:
+								TCPCongestionControl(uint32& window,
+									uint32& threshold,
+									const uint32& maxSegmentSize);
+	virtual						~TCPCongestionControl();
+
+	virtual	const char*			Name() const = 0;
+
+	virtual	void				Init();
+									// the connection has been established,
+									// and the initial window has been set
+	virtual	void				Acknowledged(
+									const tcp_congestion_sample& sample) = 0;
+									// new data has been acknowledged outside
+									// of loss recovery
+	virtual	void				CongestionDetected(uint32 flightSize);
+									// entering fast recovery
+	virtual	void				RecoveryFinished(uint32 flightSize);
+	virtual	void				Timeout(uint32 flightSize);
+
+	virtual	void				Dump() const;
+
+protected:
+			void				_SlowStart(uint32 acknowledged);
+
+protected:
+			uint32&				fWindow;
+			uint32&				fThreshold;
+			const uint32&		fMaxSegmentSize;
+};
+
+
+TCPCongestionControl* create_congestion_control(const char* name,
+	uint32& window, uint32& threshold, const uint32& maxSegmentSize);
+bool is_congestion_control(const char* name);
+
+const char* default_congestion_control();
+status_t set_default_congestion_control(const char* name);
+
+TCPCongestionControl* create_new_reno_congestion_control(uint32& window,
+	uint32& threshold, const uint32& maxSegmentSize);
+TCPCongestionControl* create_cubic_congestion_control(uint32& window,
+	uint32& threshold, const uint32& maxSegmentSize);
+TCPCongestionControl* create_bbr_congestion_control(uint32& window,
+	uint32& threshold, const uint32& maxSegmentSize);
+
+
+#endif	// TCP_CONGESTION_CONTROL_H
@@ -25,6 +25,7 @@
 
 #include <net_buffer.h>
 #include <net_datalink.h>
+#include <net_device.h>
 #include <net_stat.h>
 #include <NetBufferUtilities.h>
 #include <NetUtilities.h>
@@ -323,12 +324,17 @@ enum {
 	FLAG_RECOVERY				= 0x40,
 	FLAG_OPTION_SACK_PERMITTED	= 0x80,
 	FLAG_AUTO_RECEIVE_BUFFER_SIZE = 0x100,
+	FLAG_SACK_RECOVERY			= 0x200,
 };
 
 
 static const int kTimestampFactor = 1000;
 	// conversion factor between usec system time and msec tcp time
 
+static const uint32 kMaxSegmentationSize = 65535 - 40 - 60;
+	// the largest payload that fits into an IP packet with the largest
+	// headers
+
 
 static inline bigtime_t
 absolute_timeout(bigtime_t timeout)
@@ -440,6 +446,7 @@ TCPEndpoint::TCPEndpoint(net_socket* socket)
 	fDuplicateAcknowledgeCount(0),
 	fPreviousFlightSize(0),
 	fRecover(0),
+	fRetransmitHigh(0),
 	fRoute(NULL),
 	fReceiveNext(0),
 	fReceiveMaxAdvertised(0),
@@ -454,13 +461,18 @@ TCPEndpoint::TCPEndpoint(net_socket* socket)
 	fReceivedTimestamp(0),
 	fCongestionWindow(0),
 	fSlowStartThreshold(0),
+	fCongestionControl(NULL),
 	fState(CLOSED),
 	fFlags(FLAG_OPTION_WINDOW_SCALE | FLAG_OPTION_TIMESTAMP
-		| FLAG_OPTION_SACK_PERMITTED | FLAG_AUTO_RECEIVE_BUFFER_SIZE)
+		| FLAG_OPTION_SACK_PERMITTED | FLAG_AUTO_RECEIVE_BUFFER_SIZE),
+	fFusedPeer(NULL)
 {
 	// TODO: to be replaced with a real read/write locking strategy!
 	mutex_init(&fLock, "tcp lock");
 
+	fCongestionControl = create_congestion_control(NULL, fCongestionWindow,
+		fSlowStartThreshold, fSendMaxSegmentSize);
+
 	fReceiveCondition.Init(this, "tcp receive");
 	fSendCondition.Init(this, "tcp send");
 
@@ -500,12 +512,16 @@ TCPEndpoint::~TCPEndpoint()
 	gStackModule->wait_for_timer(&fTimeWaitTimer);
 
 	gDatalinkModule->put_route(Domain(), fRoute);
+	delete fCongestionControl;
 }
 
 
 status_t
 TCPEndpoint::InitCheck() const
 {
+	if (fCongestionControl == NULL)
+		return B_NO_MEMORY;
+
 	return B_OK;
 }
 
@@ -539,6 +555,8 @@ TCPEndpoint::Close()
 	TRACE("Close()");
 	T(APICall(this, "close"));
 
+	_Unfuse();
+
 	if (fState == LISTEN)
 		delete_sem(fAcceptSemaphore);
 
@@ -793,6 +811,8 @@ TCPEndpoint::Shutdown(int direction)
 	TRACE("Shutdown(%i)", direction);
 	T(APICall(this, "shutdown"));
 
+	_Unfuse();
+
 	if (direction == SHUT_RD || direction == SHUT_RDWR)
 		fFlags |= FLAG_NO_RECEIVE;
 
@@ -839,6 +859,16 @@ TCPEndpoint::SendData(net_buffer *buffer)
 			gStackModule->store_syscall_restart_timeout(timeout);
 	}
 
+	if ((flags & MSG_OOB) != 0)
+		_Unfuse();
+	else if (fFusedPeer != NULL || _TryFuse()) {
+		status_t status = _SendFused(buffer, left, lock, timeout);
+		if (status != B_OK)
+			return posix_error(status);
+		if (left == 0 && (flags & MSG_EOF) == 0)
+			return B_OK;
+	}
+
 	while (left > 0) {
 		while (fSendQueue.Free() < socket->send.low_water_mark) {
 			// initiate a send before waiting
@@ -906,9 +936,14 @@ TCPEndpoint::SendAvailable()
 
 	ssize_t available;
 
-	if (is_writable(fState))
+	if (is_writable(fState)) {
 		available = fSendQueue.Free();
-	else if (is_establishing(fState))
+
+		if (TCPEndpoint* peer = _LockFusedPeer()) {
+			available = peer->fReceiveQueue.Free();
+			mutex_unlock(&peer->fLock);
+		}
+	} else if (is_establishing(fState))
 		available = 0;
 	else
 		available = EPIPE;
@@ -1035,6 +1070,14 @@ TCPEndpoint::ReadData(size_t numBytes, uint32 flags, net_buffer** _buffer)
 	if (fReceiveQueue.Available() == 0 && fState == FINISH_RECEIVED)
 		socket->receive.low_water_mark = 0;
 
+	if (!clone && fFusedPeer != NULL) {
+		// there is room for the fused peer to send more
+		fFusedPeer->fSendCondition.NotifyAll();
+		gSocketModule->notify(fFusedPeer->socket, B_SELECT_WRITE,
+			fReceiveQueue.Free());
+		return receivedBytes;
+	}
+
 	// if we opened the window, check if we should send a window update
 	if (!clone) {
 		// Only send if there's less than half the window size remaining.
@@ -1085,6 +1128,17 @@ TCPEndpoint::SetReceiveBufferSize(size_t length)
 status_t
 TCPEndpoint::GetOption(int option, void* _value, int* _length)
 {
+	if (option == TCP_CONGESTION) {
+		if (*_length <= 0)
+			return B_BAD_VALUE;
+
+		MutexLocker _(fLock);
+		const char* name = fCongestionControl->Name();
+		strlcpy((char*)_value, name, *_length);
+		*_length = min_c((int)strlen(name) + 1, *_length);
+		return B_OK;
+	}
+
 	if (*_length != sizeof(int))
 		return B_BAD_VALUE;
 
@@ -1111,6 +1165,20 @@ TCPEndpoint::GetOption(int option, void* _value, int* _length)
 status_t
 TCPEndpoint::SetOption(int option, const void* _value, int length)
 {
+	if (option == TCP_CONGESTION) {
+		if (length <= 0)
+			return B_BAD_VALUE;
+
+		// the name doesn't need to be null terminated
+		char name[TCP_CA_NAME_MAX];
+		size_t nameLength = min_c((size_t)length, sizeof(name) - 1);
+		memcpy(name, _value, nameLength);
+		name[nameLength] = '\0';
+
+		MutexLocker _(fLock);
+		return _SetCongestionControl(name);
+	}
+
 	if (option != TCP_NODELAY)
 		return B_BAD_VALUE;
 
@@ -1213,6 +1281,8 @@ TCPEndpoint::_CancelConnectionTimers()
 status_t
 TCPEndpoint::_Disconnect(bool closing)
 {
+	_Unfuse();
+
 	tcp_state previousState = fState;
 
 	if (fState == SYNCHRONIZE_RECEIVED || fState == ESTABLISHED)
@@ -1324,12 +1394,25 @@ TCPEndpoint::_DuplicateAcknowledge(tcp_segment_header &segment)
 			(fSendUnacknowledged - fPreviousHighestAcknowledge) <= 4 * fSendMaxSegmentSize)) {
 			fFlags |= FLAG_RECOVERY;
 			fRecover = fSendMax.Number() - 1;
-			fSlowStartThreshold = max_c(fPreviousFlightSize / 2, 2 * fSendMaxSegmentSize);
-			fCongestionWindow = fSlowStartThreshold + 3 * fSendMaxSegmentSize;
-			fSendNext = segment.acknowledge;
-			_SendQueued();
+			fCongestionControl->CongestionDetected(fPreviousFlightSize);
+
+			if ((fFlags & FLAG_OPTION_SACK_PERMITTED) != 0
+				&& !fScoreboard.IsEmpty()) {
+				// Retransmit the first segment right away, and the other
+				// holes the peer told us about as the window allows.
+				fFlags |= FLAG_SACK_RECOVERY;
+				fRetransmitHigh = fSendUnacknowledged;
+				_RetransmitSegment(fSendUnacknowledged, fSendMaxSegmentSize);
+				_SackRecovery();
+			} else {
+				fCongestionWindow += 3 * fSendMaxSegmentSize;
+				fSendNext = segment.acknowledge;
+				_SendQueued();
+			}
 			TRACE("_DuplicateAcknowledge(): packet sent under fast restransmit on the receipt of 3rd dup ack");
 		}
+	} else if ((fFlags & FLAG_SACK_RECOVERY) != 0) {
+		_SackRecovery();
 	} else if (fDuplicateAcknowledgeCount > 3) {
 		uint32 flightSize = (fSendMax - fSendUnacknowledged).Number();
 		if ((fDuplicateAcknowledgeCount - 3) * fSendMaxSegmentSize <= flightSize)
@@ -1529,6 +1612,7 @@ TCPEndpoint::_PrepareReceivePath(tcp_segment_header& segment)
 
 	fSendMaxSegments = fCongestionWindow / fSendMaxSegmentSize;
 	fSlowStartThreshold = (uint32)segment.advertised_window << fSendWindowShift;
+	fCongestionControl->Init();
 }
 
 
@@ -1561,6 +1645,7 @@ TCPEndpoint::_Spawn(TCPEndpoint* parent, tcp_segment_header& segment,
 	T(Spawn(parent, this));
 
 	fManager = parent->fManager;
+	fBoundUser = parent->fBoundUser;
 
 	if (fManager->BindChild(this, buffer->destination) != B_OK) {
 		T(Error(this, "binding failed", __LINE__));
@@ -1574,6 +1659,10 @@ TCPEndpoint::_Spawn(TCPEndpoint* parent, tcp_segment_header& segment,
 	fOptions = parent->fOptions;
 	fAcceptSemaphore = parent->fAcceptSemaphore;
 
+	// inherit the congestion control algorithm; if that fails, we just keep
+	// the default one
+	_SetCongestionControl(parent->fCongestionControl->Name());
+
 	_PrepareReceivePath(segment);
 
 	// send SYN+ACK
@@ -1832,6 +1921,11 @@ TCPEndpoint::_Receive(tcp_segment_header& segment, net_buffer* buffer)
 		if (fSendMax < segment.acknowledge)
 			return DROP | IMMEDIATE_ACKNOWLEDGE;
 
+		if ((fFlags & FLAG_OPTION_SACK_PERMITTED) != 0) {
+			fScoreboard.Update(segment.acknowledge, fSendMax, segment.sacks,
+				(segment.options & TCP_HAS_SACK) != 0 ? segment.sackCount : 0);
+		}
+
 		if (segment.acknowledge == fSendUnacknowledged) {
 			if (buffer->size == 0 && advertisedWindow == fSendWindow
 				&& (segment.flags & TCP_FLAG_FINISH) == 0 && fSendUnacknowledged != fSendMax) {
@@ -1847,9 +1941,8 @@ TCPEndpoint::_Receive(tcp_segment_header& segment, net_buffer* buffer)
 				// deflate the window.
 				if (segment.acknowledge > fRecover) {
 					uint32 flightSize = (fSendMax - fSendUnacknowledged).Number();
-					fCongestionWindow = min_c(fSlowStartThreshold,
-						max_c(flightSize, fSendMaxSegmentSize) + fSendMaxSegmentSize);
-					fFlags &= ~FLAG_RECOVERY;
+					fCongestionControl->RecoveryFinished(flightSize);
+					fFlags &= ~(FLAG_RECOVERY | FLAG_SACK_RECOVERY);
 				}
 			}
 
@@ -1984,6 +2077,15 @@ TCPEndpoint::SegmentReceived(tcp_segment_header& segment, net_buffer* buffer)
 		(uint32)segment.advertised_window << fSendWindowShift, buffer));
 	int32 segmentAction = DROP;
 
+	if (fFusedPeer != NULL) {
+		// Only acknowledgements that were sent before the endpoints were
+		// fused can still arrive; anything else ends the fusion
+		if (segment.flags == TCP_FLAG_ACKNOWLEDGE && buffer->size == 0)
+			return DROP;
+
+		_Unfuse();
+	}
+
 	switch (fState) {
 		case LISTEN:
 			segmentAction = _ListenReceive(segment, buffer);
@@ -2129,6 +2231,13 @@ TCPEndpoint::_PrepareAndSend(tcp_segment_header& segment, net_buffer* buffer,
 	uint32 size = buffer->size, segmentLength = size;
 	segment.sequence = fSendNext.Number();
 
+	// the buffer belongs to the lower layers after sending it
+	uint32 segments = 1;
+	if ((buffer->buffer_flags & NET_BUFFER_TCP_SEGMENTATION) != 0) {
+		segments = (segmentLength + buffer->segment_size - 1)
+			/ buffer->segment_size;
+	}
+
 	TRACE("_PrepareAndSend(): buffer %p (%" B_PRIu32 " bytes) address %s to "
 		"%s flags %#" B_PRIx8 ", seq %" B_PRIu32 ", ack %" B_PRIu32
 		", rwnd %" B_PRIu16 ", cwnd %" B_PRIu32 ", ssthresh %" B_PRIu32
@@ -2172,7 +2281,7 @@ TCPEndpoint::_PrepareAndSend(tcp_segment_header& segment, net_buffer* buffer,
 	fReceiveMaxAdvertised = fReceiveNext + segment.AdvertisedWindow(fReceiveWindowShift);
 
 	if (segmentLength != 0 && fState == ESTABLISHED)
-		--fSendMaxSegments;
+		fSendMaxSegments -= min_c(segments, fSendMaxSegments);
 
 	if (fSendTime == 0 && !isRetransmit
 			&& (segmentLength != 0 || (segment.flags & TCP_FLAG_SYNCHRONIZE) != 0)) {
@@ -2270,9 +2379,15 @@ TCPEndpoint::_SendQueued(bool force)
 
 	tcp_segment_header segment = _PrepareSendSegment();
 
+	// During SACK based recovery, the congestion window only limits the data
+	// in the network, not the data the peer already holds (RFC 6675 § 5)
+	uint32 congestionWindow = fCongestionWindow;
+	if ((fFlags & FLAG_SACK_RECOVERY) != 0)
+		congestionWindow += fScoreboard.SackedBytes();
+
 	uint32 sendWindow = fSendWindow;
-	if (fCongestionWindow > 0 && fCongestionWindow < sendWindow)
-		sendWindow = fCongestionWindow;
+	if (congestionWindow > 0 && congestionWindow < sendWindow)
+		sendWindow = congestionWindow;
 
 	// fSendUnacknowledged
 	//  |    fSendNext      fSendMax
@@ -2311,11 +2426,28 @@ TCPEndpoint::_SendQueued(bool force)
 		length = min_c(length, fSendMaxSegmentSize);
 	}
 
+	const uint32 segmentationSize = _SegmentationSize();
+
 	do {
 		uint32 segmentMaxSize = fSendMaxSegmentSize
 			- tcp_options_length(segment);
 		uint32 segmentLength = min_c(length, segmentMaxSize);
 
+		if (segmentationSize != 0 && length > segmentMaxSize && !retransmit
+			&& (segment.flags & (TCP_FLAG_SYNCHRONIZE | TCP_FLAG_URGENT)) == 0
+			&& fSendUrgentOffset <= fSendNext) {
+			// Let the lower layers split the data into segments; we only
+			// pass on full segments, though, so that the last one can still
+			// be held back
+			uint32 maxSegments = segmentationSize / segmentMaxSize;
+			if (fState == ESTABLISHED)
+				maxSegments = min_c(maxSegments, fSendMaxSegments);
+			if (maxSegments > 1) {
+				segmentLength = min_c(length / segmentMaxSize, maxSegments)
+					* segmentMaxSize;
+			}
+		}
+
 		if ((fSendNext + segmentLength) == fSendQueue.LastSequence() && !force) {
 			if (state_needs_finish(fState))
 				segment.flags |= TCP_FLAG_FINISH;
@@ -2324,8 +2456,9 @@ TCPEndpoint::_SendQueued(bool force)
 		}
 
 		// Determine if we should really send this segment
-		if (!force && !retransmit && !_ShouldSendSegment(segment, segmentLength,
-				segmentMaxSize, flightSize)) {
+		if (!force && !retransmit && !_ShouldSendSegment(segment,
+				min_c(segmentLength, segmentMaxSize), segmentMaxSize,
+				flightSize)) {
 			if (fSendQueue.Available()
 				&& !gStackModule->is_timer_active(&fPersistTimer)
 				&& !gStackModule->is_timer_active(&fRetransmitTimer))
@@ -2345,6 +2478,11 @@ TCPEndpoint::_SendQueued(bool force)
 			return status;
 		}
 
+		if (segmentLength > segmentMaxSize) {
+			buffer->buffer_flags |= NET_BUFFER_TCP_SEGMENTATION;
+			buffer->segment_size = segmentMaxSize;
+		}
+
 		sendWindow -= buffer->size;
 
 		status = _PrepareAndSend(segment, buffer, retransmit);
@@ -2379,6 +2517,30 @@ TCPEndpoint::_MaxSegmentSize(const sockaddr* address) const
 }
 
 
+/*!	Returns how much data can be passed to the lower layers at once, if the
+	device behind the route can split it into segments, or 0 if it cannot.
+*/
+uint32
+TCPEndpoint::_SegmentationSize() const
+{
+	if (fRoute == NULL || fRoute->interface_address == NULL
+		|| fRoute->interface_address->interface == NULL)
+		return 0;
+
+	net_device* device = fRoute->interface_address->interface->device;
+	if (device == NULL)
+		return 0;
+
+	uint32 offload = NET_DEVICE_OFFLOAD_SEGMENTATION;
+	offload |= Domain()->family == AF_INET6
+		? NET_DEVICE_OFFLOAD_TSO6 : NET_DEVICE_OFFLOAD_TSO4;
+	if ((device->offload & offload) == 0)
+		return 0;
+
+	return kMaxSegmentationSize;
+}
+
+
 status_t
 TCPEndpoint::_PrepareSendPath(const sockaddr* peer)
 {
@@ -2448,31 +2610,48 @@ TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 			fRecover = segment.acknowledge - 1;
 		}
 
+		int32 roundTripTime = -1;
+		if (fFlags & FLAG_OPTION_TIMESTAMP) {
+			roundTripTime = tcp_diff_timestamp(segment.timestamp_reply);
+			_UpdateRoundTripTime(roundTripTime,
+				expectedSamples > 0 ? expectedSamples : 1);
+		} else if (fSendTime != 0 && fRoundTripStartSequence < segment.acknowledge) {
+			roundTripTime = tcp_diff_timestamp(fSendTime);
+			_UpdateRoundTripTime(roundTripTime, 1);
+			fSendTime = 0;
+		}
+
 		// the acknowledgment of the SYN/ACK MUST NOT increase the size of the congestion window
 		if (fSendUnacknowledged != fInitialSendSequence) {
-			if (fCongestionWindow < fSlowStartThreshold)
-				fCongestionWindow += min_c(bytesAcknowledged, fSendMaxSegmentSize);
-			else {
-				uint32 increment = fSendMaxSegmentSize * fSendMaxSegmentSize;
-
-				if (increment < fCongestionWindow)
-					increment = 1;
-				else
-					increment /= fCongestionWindow;
-
-				fCongestionWindow += increment;
+			if ((fFlags & FLAG_RECOVERY) == 0) {
+				tcp_congestion_sample sample;
+				sample.acknowledge = fSendUnacknowledged;
+				sample.send_max = fSendMax;
+				sample.acknowledged = bytesAcknowledged;
+				sample.flight_size = flightSize;
+				sample.round_trip_time = roundTripTime;
+				fCongestionControl->Acknowledged(sample);
 			}
 
 			fSendMaxSegments = UINT32_MAX;
 		}
 
-		if ((fFlags & FLAG_RECOVERY) != 0) {
+		if ((fFlags & FLAG_SACK_RECOVERY) != 0) {
+			// a partial acknowledgement, keep on repairing the holes
+			_SackRecovery();
+		} else if ((fFlags & FLAG_RECOVERY) != 0) {
 			fSendNext = fSendUnacknowledged;
 			_SendQueued();
-			fCongestionWindow -= bytesAcknowledged;
 
+			// deflate the window by the amount of new data acknowledged, and
+			// add back one segment, if at least one was (RFC 6582 § 3.2)
+			if (bytesAcknowledged < fCongestionWindow)
+				fCongestionWindow -= bytesAcknowledged;
+			else
+				fCongestionWindow = 0;
 			if (bytesAcknowledged > fSendMaxSegmentSize)
 				fCongestionWindow += fSendMaxSegmentSize;
+			fCongestionWindow = max_c(fCongestionWindow, fSendMaxSegmentSize);
 
 			fSendNext = fSendMax;
 		} else
@@ -2481,14 +2660,6 @@ TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 		if (fSendNext < fSendUnacknowledged)
 			fSendNext = fSendUnacknowledged;
 
-		if (fFlags & FLAG_OPTION_TIMESTAMP) {
-			_UpdateRoundTripTime(tcp_diff_timestamp(segment.timestamp_reply),
-				expectedSamples > 0 ? expectedSamples : 1);
-		} else if (fSendTime != 0 && fRoundTripStartSequence < segment.acknowledge) {
-			_UpdateRoundTripTime(tcp_diff_timestamp(fSendTime), 1);
-			fSendTime = 0;
-		}
-
 		if (fSendUnacknowledged == fSendMax) {
 			TRACE("all acknowledged, cancelling retransmission timer.");
 			gStackModule->cancel_timer(&fRetransmitTimer);
@@ -2534,8 +2705,98 @@ TCPEndpoint::_Retransmit()
 	_SendQueued();
 
 	fRecover = fSendNext.Number() - 1;
-	if ((fFlags & FLAG_RECOVERY) != 0)
-		fFlags &= ~FLAG_RECOVERY;
+	fFlags &= ~(FLAG_RECOVERY | FLAG_SACK_RECOVERY);
+}
+
+
+/*!	Retransmits the holes below the highest selectively acknowledged data as
+	long as the congestion window allows, followed by new data (RFC 6675 § 5).
+*/
+void
+TCPEndpoint::_SackRecovery()
+{
+	if (fRetransmitHigh < fSendUnacknowledged)
+		fRetransmitHigh = fSendUnacknowledged;
+
+	// Estimate the data still in the network: everything that has neither
+	// been selectively acknowledged, nor is considered lost, that is, lies
+	// in a hole that has not been retransmitted yet.
+	uint32 flightSize = (fSendMax - fSendUnacknowledged).Number();
+	uint32 accounted = fScoreboard.SackedBytes();
+	if (!fScoreboard.IsEmpty()) {
+		accounted += fScoreboard.UnsackedBytes(fRetransmitHigh,
+			fScoreboard.HighestSacked());
+	}
+	uint32 pipe = flightSize > accounted ? flightSize - accounted : 0;
+
+	tcp_sequence start;
+	uint32 length;
+	while (pipe + fSendMaxSegmentSize <= fCongestionWindow
+		&& fScoreboard.NextHole(fRetransmitHigh, start, length)) {
+		uint32 sent = _RetransmitSegment(start, length);
+		if (sent == 0)
+			break;
+
+		pipe += sent;
+	}
+
+	if (pipe + fSendMaxSegmentSize <= fCongestionWindow
+		&& fSendQueue.Available(fSendMax) != 0) {
+		fSendNext = fSendMax;
+		_SendQueued();
+	}
+}
+
+
+/*!	Retransmits a single segment of at most \a length bytes at \a start,
+	and returns the number of bytes sent.
+*/
+uint32
+TCPEndpoint::_RetransmitSegment(tcp_sequence start, uint32 length)
+{
+	tcp_segment_header segment = _PrepareSendSegment();
+	length = min_c(length, fSendMaxSegmentSize - tcp_options_length(segment));
+	length = min_c(length, fSendQueue.Available(start));
+	if (length == 0)
+		return 0;
+
+	net_buffer* buffer = gBufferModule->create(256);
+	if (buffer == NULL)
+		return 0;
+
+	if (fSendQueue.Get(buffer, start, length) != B_OK) {
+		gBufferModule->free(buffer);
+		return 0;
+	}
+
+	tcp_sequence sendNext = fSendNext;
+	fSendNext = start;
+	status_t status = _PrepareAndSend(segment, buffer, true);
+	fSendNext = sendNext;
+	if (status != B_OK)
+		return 0;
+
+	if (fRetransmitHigh < start + length)
+		fRetransmitHigh = start + length;
+
+	return length;
+}
+
+
+status_t
+TCPEndpoint::_SetCongestionControl(const char* name)
+{
+	if (strcmp(name, fCongestionControl->Name()) == 0)
+		return B_OK;
+
+	TCPCongestionControl* congestionControl = create_congestion_control(name,
+		fCongestionWindow, fSlowStartThreshold, fSendMaxSegmentSize);
+	if (congestionControl == NULL)
+		return is_congestion_control(name) ? B_NO_MEMORY : B_ENTRY_NOT_FOUND;
+
+	delete fCongestionControl;
+	fCongestionControl = congestionControl;
+	return B_OK;
 }
 
 
@@ -2574,9 +2835,207 @@ TCPEndpoint::_UpdateRoundTripTime(int32 roundTripTime, int32 expectedSamples)
 void
 TCPEndpoint::_ResetSlowStart()
 {
-	fSlowStartThreshold = max_c((fSendMax - fSendUnacknowledged).Number() / 2,
-		2 * fSendMaxSegmentSize);
-	fCongestionWindow = fSendMaxSegmentSize;
+	fCongestionControl->Timeout((fSendMax - fSendUnacknowledged).Number());
+
+	// the peer may have reneged on what it selectively acknowledged
+	fScoreboard.Clear();
+}
+
+
+//	#pragma mark - fusion
+
+
+/*!	Fuses this endpoint with its peer, if both live on this machine, and
+	the connection is idle in both directions. From then on, data is passed
+	directly between the endpoints, instead of going through the IP layer
+	and the loopback device (this is known as "TCP fusion").
+	The caller must hold the endpoint's lock.
+*/
+bool
+TCPEndpoint::_TryFuse()
+{
+	if (!IsLocal() || fState != ESTABLISHED || fSendQueue.Used() > 0
+		|| (fFlags & FLAG_NO_RECEIVE) != 0 || !fReceiveQueue.IsContiguous()
+		|| gSocketModule->has_parent(socket))
+		return false;
+
+	TCPEndpoint* peer = fManager->FindConnection(*PeerAddress(),
+		*LocalAddress());
+	if (peer == NULL)
+		return false;
+
+	// We never wait for the peer's lock here, as we don't know yet in which
+	// state it is: we'll just try again with the next send.
+	bool fuse = false;
+	if (peer != this && mutex_trylock(&peer->fLock) == B_OK) {
+		// Both sides must agree on what has been transferred so far; an
+		// endpoint that has not been accepted yet would never be closed.
+		fuse = peer->fState == ESTABLISHED && peer->fFusedPeer == NULL
+			&& peer->fSendQueue.Used() == 0
+			&& (peer->fFlags & FLAG_NO_RECEIVE) == 0
+			&& peer->fReceiveQueue.IsContiguous()
+			&& peer->fReceiveNext == fSendNext
+			&& peer->fSendNext == fReceiveNext
+			&& !gSocketModule->has_parent(peer->socket)
+			&& gSocketModule->acquire_socket(socket);
+		if (fuse) {
+			TRACE("  _TryFuse(): fused with %p", peer);
+			fFusedPeer = peer;
+			peer->fFusedPeer = this;
+		}
+
+		mutex_unlock(&peer->fLock);
+	}
+
+	if (!fuse)
+		gSocketModule->release_socket(peer->socket);
+
+	return fuse;
+}
+
+
+/*!	Lets the endpoints go through the full stack again. Both sides send a
+	window update, so that they learn about the state of each other.
+	The caller must hold the endpoint's lock, which may be released
+	temporarily.
+*/
+void
+TCPEndpoint::_Unfuse()
+{
+	TCPEndpoint* peer = _LockFusedPeer();
+	if (peer == NULL)
+		return;
+
+	TRACE("  _Unfuse(): unfused from %p", peer);
+
+	fFusedPeer = NULL;
+	peer->fFusedPeer = NULL;
+
+	_SendAcknowledge(true);
+	peer->_SendAcknowledge(true);
+
+	// senders waiting for room in the other's queue will now use their own
+	fSendCondition.NotifyAll();
+	peer->fSendCondition.NotifyAll();
+
+	mutex_unlock(&peer->fLock);
+
+	// Neither socket can go away here: they are still in use by whoever
+	// called us, respectively not closed yet, as that would have unfused us.
+	gSocketModule->release_socket(peer->socket);
+	gSocketModule->release_socket(socket);
+}
+
+
+/*!	Locks the fused peer in addition to this endpoint, and returns it, or
+	\c NULL if the endpoint is not fused (anymore).
+	If the peer's lock cannot be acquired right away, our own lock is
+	released, and both are acquired in the order of their addresses, as
+	the peer might try to do the same.
+*/
+TCPEndpoint*
+TCPEndpoint::_LockFusedPeer()
+{
+	TCPEndpoint* peer = fFusedPeer;
+	if (peer == NULL)
+		return NULL;
+
+	if (mutex_trylock(&peer->fLock) == B_OK)
+		return peer;
+
+	// keep the peer alive while we don't hold our lock
+	gSocketModule->acquire_socket(peer->socket);
+	mutex_unlock(&fLock);
+
+	if (peer < this) {
+		mutex_lock(&peer->fLock);
+		mutex_lock(&fLock);
+	} else {
+		mutex_lock(&fLock);
+		mutex_lock(&peer->fLock);
+	}
+
+	bool fused = fFusedPeer == peer;
+	if (!fused)
+		mutex_unlock(&peer->fLock);
+
+	gSocketModule->release_socket(peer->socket);
+	return fused ? peer : NULL;
+}
+
+
+/*!	Passes the data of \a buffer directly to the receive queue of the fused
+	peer, waiting for room in there as needed. When the endpoints are
+	unfused in the mean time, \a left is still larger than zero, and the
+	rest of the data must go through the normal send path.
+*/
+status_t
+TCPEndpoint::_SendFused(net_buffer* buffer, size_t& left, MutexLocker& locker,
+	bigtime_t timeout)
+{
+	while (left > 0) {
+		TCPEndpoint* peer = _LockFusedPeer();
+		if (peer == NULL)
+			return is_writable(fState) ? B_OK : EPIPE;
+
+		size_t size = peer->fReceiveQueue.Free();
+		if (size == 0 || size < socket->send.low_water_mark) {
+			// Wait until the peer has read enough; since we are added to
+			// the condition before its lock is released, we can't miss it.
+			ConditionVariableEntry entry;
+			fSendCondition.Add(&entry);
+
+			mutex_unlock(&peer->fLock);
+			locker.Unlock();
+
+			status_t status = entry.Wait(B_ABSOLUTE_TIMEOUT | B_CAN_INTERRUPT,
+				timeout);
+			locker.Lock();
+			if (status != B_OK)
+				return status;
+
+			continue;
+		}
+
+		net_buffer* data = buffer;
+		if (size < left) {
+			data = gBufferModule->clone(buffer, false);
+			if (data == NULL) {
+				mutex_unlock(&peer->fLock);
+				return ENOBUFS;
+			}
+
+			status_t status = gBufferModule->trim(data, size);
+			if (status != B_OK) {
+				gBufferModule->free(data);
+				mutex_unlock(&peer->fLock);
+				return status;
+			}
+
+			gBufferModule->remove_header(buffer, size);
+		} else
+			size = left;
+
+		left -= size;
+
+		LocalAddress().CopyTo(data->source);
+		PeerAddress().CopyTo(data->destination);
+
+		peer->fReceiveQueue.Add(data, peer->fReceiveNext);
+		peer->fReceiveNext = peer->fReceiveQueue.NextSequence();
+		peer->fReceiveQueue.SetPushPointer();
+		peer->_NotifyReader();
+
+		// the data counts as sent, and acknowledged
+		fSendNext += size;
+		fSendMax = fSendNext;
+		fSendUnacknowledged = fSendNext;
+		fSendQueue.SetInitialSequence(fSendNext);
+
+		mutex_unlock(&peer->fLock);
+	}
+
+	return B_OK;
 }
 
 
@@ -2679,6 +3138,7 @@ TCPEndpoint::Dump() const
 	kprintf("  socket: %p\n", socket);
 	kprintf("  state: %s\n", name_for_state(fState));
 	kprintf("  flags: 0x%" B_PRIx32 "\n", fFlags);
+	kprintf("  fused peer: %p\n", fFusedPeer);
 #if KDEBUG
 	kprintf("  lock: { %p, holder: %" B_PRId32 " }\n", &fLock, fLock.holder);
 #endif
@@ -2724,5 +3184,11 @@ TCPEndpoint::Dump() const
 	kprintf("  retransmit timeout: %" B_PRId64 "\n", fRetransmitTimeout);
 	kprintf("  congestion window: %" B_PRIu32 "\n", fCongestionWindow);
 	kprintf("  slow start threshold: %" B_PRIu32 "\n", fSlowStartThreshold);
+	fCongestionControl->Dump();
+	if ((fFlags & FLAG_SACK_RECOVERY) != 0) {
+		kprintf("  SACK recovery, retransmitted up to: %" B_PRIu32 "\n",
+			fRetransmitHigh.Number());
+	}
+	fScoreboard.Dump();
 }
 
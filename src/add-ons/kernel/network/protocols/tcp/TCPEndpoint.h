@@ -13,6 +13,8 @@
 
 #include "BufferQueue.h"
 #include "EndpointManager.h"
+#include "SackScoreboard.h"
+#include "TCPCongestionControl.h"
 #include "tcp.h"
 
 #include <ProtocolUtilities.h>
@@ -107,6 +109,7 @@ private:
 			bool		_AddData(tcp_segment_header& segment,
 							net_buffer* buffer);
 			int			_MaxSegmentSize(const struct sockaddr* address) const;
+			uint32		_SegmentationSize() const;
 			void		_PrepareReceivePath(tcp_segment_header& segment);
 			status_t	_PrepareSendPath(const sockaddr* peer);
 			void		_Acknowledged(tcp_segment_header& segment);
@@ -114,6 +117,15 @@ private:
 			void		_UpdateRoundTripTime(int32 roundTripTime, int32 expectedSamples);
 			void		_ResetSlowStart();
 			void		_DuplicateAcknowledge(tcp_segment_header& segment);
+			void		_SackRecovery();
+			uint32		_RetransmitSegment(tcp_sequence start, uint32 length);
+			status_t	_SetCongestionControl(const char* name);
+
+			bool		_TryFuse();
+			void		_Unfuse();
+			TCPEndpoint* _LockFusedPeer();
+			status_t	_SendFused(net_buffer* buffer, size_t& left,
+							MutexLocker& locker, bigtime_t timeout);
 
 	static	void		_TimeWaitTimer(net_timer* timer, void* _endpoint);
 	static	void		_RetransmitTimer(net_timer* timer, void* _endpoint);
@@ -126,9 +138,13 @@ private:
 
 private:
 	TCPEndpoint*	fConnectionHashLink;
+		// also used for the listener hash
 	TCPEndpoint*	fEndpointHashLink;
+	uid_t			fBoundUser;
+		// the effective user ID that bound the endpoint
 	friend class	EndpointManager;
 	friend struct	ConnectionHashDefinition;
+	friend class	ListenerHashDefinition;
 	friend class	EndpointHashDefinition;
 
 	mutex			fLock;
@@ -158,6 +174,8 @@ private:
 	uint32			fDuplicateAcknowledgeCount;
 	uint32			fPreviousFlightSize;
 	uint32			fRecover;
+	SackScoreboard	fScoreboard;
+	tcp_sequence	fRetransmitHigh;
 
 	net_route		*fRoute;
 		// TODO: don't use a net_route, but a net_route_info!!!
@@ -186,10 +204,16 @@ private:
 
 	uint32			fCongestionWindow;
 	uint32			fSlowStartThreshold;
+	TCPCongestionControl*
+					fCongestionControl;
 
 	tcp_state		fState;
 	uint32			fFlags;
 
+	TCPEndpoint*	fFusedPeer;
+		// the endpoint on the other side of a local connection, while data
+		// is passed to it directly; we own a reference to its socket
+
 	// timer
 	net_timer		fRetransmitTimer;
 	net_timer		fPersistTimer;
@@ -10,12 +10,14 @@
 
 
 #include "EndpointManager.h"
+#include "TCPCongestionControl.h"
 #include "TCPEndpoint.h"
 #include "tcp.h"
 
 #include <net_protocol.h>
 #include <net_stat.h>
 
+#include <driver_settings.h>
 #include <KernelExport.h>
 #include <util/list.h>
 
@@ -433,8 +435,11 @@ add_tcp_header(net_address_module_info* addressModule,
 		"win %u\n", buffer, segment.flags, segment.sequence,
 		segment.acknowledge, segment.urgent_offset, segment.advertised_window));
 
-	*TCPChecksumField(buffer) = Checksum::PseudoHeader(addressModule,
-		gBufferModule, buffer, IPPROTO_TCP);
+	// Oversized segments get their checksums when they are split up
+	if ((buffer->buffer_flags & NET_BUFFER_TCP_SEGMENTATION) == 0) {
+		*TCPChecksumField(buffer) = Checksum::PseudoHeader(addressModule,
+			gBufferModule, buffer, IPPROTO_TCP);
+	}
 	buffer->buffer_flags |= NET_BUFFER_L4_CHECKSUM_VALID;
 
 	return B_OK;
@@ -818,6 +823,18 @@ tcp_init()
 	if (status < B_OK)
 		return status;
 
+	// the system wide default congestion control algorithm
+	void* settings = load_driver_settings("tcp");
+	const char* congestionControl = get_driver_parameter(settings,
+		"congestion_control", TCP_DEFAULT_CONGESTION_CONTROL,
+		TCP_DEFAULT_CONGESTION_CONTROL);
+	if (set_default_congestion_control(congestionControl) != B_OK) {
+		dprintf("tcp: unknown congestion control \"%s\", using \"%s\"\n",
+			congestionControl, TCP_DEFAULT_CONGESTION_CONTROL);
+		set_default_congestion_control(TCP_DEFAULT_CONGESTION_CONTROL);
+	}
+	unload_driver_settings(settings);
+
 	add_debugger_command("tcp_endpoints", dump_endpoints,
 		"lists all open TCP endpoints");
 	add_debugger_command("tcp_endpoint", dump_endpoint,
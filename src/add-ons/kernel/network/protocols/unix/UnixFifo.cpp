@@ -10,7 +10,9 @@
 #include <AutoDeleter.h>
 
 #include <net_stack.h>
+#include <team.h>
 #include <util/ring_buffer.h>
+#include <vm/vm.h>
 
 #include "unix.h"
 
@@ -20,6 +22,12 @@
 #include "UnixDebug.h"
 
 
+static const size_t kMinDirectWriteSize = 16 * 1024;
+	// smaller writes are always copied into the buffer
+static const size_t kMaxDirectWriteSize = 1024 * 1024;
+	// the most memory a writer locks at once
+
+
 // #pragma mark - UnixRequest
 
 
@@ -344,8 +352,11 @@ UnixFifo::UnixFifo(size_t capacity, UnixFifoType type)
 	fWriters(),
 	fReadRequested(0),
 	fWriteRequested(0),
-	fShutdown(0)
-
+	fShutdown(0),
+	fType(type),
+	fDirectTeam(-1),
+	fDirectAddress(0),
+	fDirectSize(0)
 {
 	fReadCondition.Init(this, "unix fifo read");
 	fWriteCondition.Init(this, "unix fifo write");
@@ -390,7 +401,7 @@ UnixFifo::Read(const iovec* vecs, size_t vecCount,
 	TRACE("[%" B_PRId32 "] %p->UnixFifo::Read(%p, %ld, %" B_PRIdBIGTIME ")\n",
 		find_thread(NULL), this, vecs, vecCount, timeout);
 
-	if (IsReadShutdown() && fBuffer.Readable() == 0)
+	if (IsReadShutdown() && _BytesAvailable() == 0)
 		RETURN_ERROR(UNIX_FIFO_SHUTDOWN);
 
 	UnixRequest request(vecs, vecCount, NULL, address);
@@ -403,7 +414,7 @@ UnixFifo::Read(const iovec* vecs, size_t vecCount,
 	fReaders.Remove(&request);
 	fReadRequested -= request.TotalSize();
 
-	if (firstInQueue && !fReaders.IsEmpty() && fBuffer.Readable() > 0
+	if (firstInQueue && !fReaders.IsEmpty() && _BytesAvailable() > 0
 			&& !IsReadShutdown()) {
 		// There's more to read, other readers, and we were first in the queue.
 		// So we need to notify the others.
@@ -480,7 +491,7 @@ UnixFifo::Write(const iovec* vecs, size_t vecCount,
 size_t
 UnixFifo::Readable() const
 {
-	size_t readable = fBuffer.Readable();
+	size_t readable = _BytesAvailable();
 	return (off_t)readable > fReadRequested ? readable - fReadRequested : 0;
 }
 
@@ -527,7 +538,7 @@ UnixFifo::_Read(UnixRequest& request, bigtime_t timeout)
 		RETURN_ERROR(B_WOULD_BLOCK);
 
 	while (fReaders.Head() != &request
-		&& !(IsReadShutdown() && fBuffer.Readable() == 0)) {
+		&& !(IsReadShutdown() && _BytesAvailable() == 0)) {
 		ConditionVariableEntry entry;
 		fReadCondition.Add(&entry);
 
@@ -540,7 +551,7 @@ UnixFifo::_Read(UnixRequest& request, bigtime_t timeout)
 			RETURN_ERROR(error);
 	}
 
-	if (fBuffer.Readable() == 0) {
+	if (_BytesAvailable() == 0) {
 		if (IsReadShutdown())
 			RETURN_ERROR(UNIX_FIFO_SHUTDOWN);
 
@@ -553,7 +564,7 @@ UnixFifo::_Read(UnixRequest& request, bigtime_t timeout)
 
 	// wait for any data to become available
 // TODO: Support low water marks!
-	while (fBuffer.Readable() == 0
+	while (_BytesAvailable() == 0
 			&& !IsReadShutdown() && !IsWriteShutdown()) {
 		ConditionVariableEntry entry;
 		fReadCondition.Add(&entry);
@@ -567,14 +578,58 @@ UnixFifo::_Read(UnixRequest& request, bigtime_t timeout)
 			RETURN_ERROR(error);
 	}
 
-	if (fBuffer.Readable() == 0) {
+	if (_BytesAvailable() == 0) {
 		if (IsReadShutdown())
 			RETURN_ERROR(UNIX_FIFO_SHUTDOWN);
 		if (IsWriteShutdown())
 			RETURN_ERROR(0);
 	}
 
-	RETURN_ERROR(fBuffer.Read(request));
+	status_t error = fBuffer.Read(request);
+
+	// only once the buffer is empty, the data of a direct writer is next
+	if (error == B_OK && fDirectSize > 0 && fBuffer.Readable() == 0)
+		error = _ReadDirectly(request);
+
+	RETURN_ERROR(error);
+}
+
+
+/*!	Copies the data of the writer waiting in _WriteDirectly() into
+	\a request, straight from the writer's (locked) memory.
+*/
+status_t
+UnixFifo::_ReadDirectly(UnixRequest& request)
+{
+	bool user = gStackModule->is_syscall();
+	void* data;
+	size_t size;
+
+	while (fDirectSize > 0 && request.GetCurrentChunk(data, size)) {
+		if (size > fDirectSize)
+			size = fDirectSize;
+
+		physical_entry table[8];
+		uint32 entries = B_COUNT_OF(table);
+		status_t error = get_memory_map_etc(fDirectTeam,
+			(void*)fDirectAddress, size, table, &entries);
+		if (error != B_OK && error != B_BUFFER_OVERFLOW)
+			RETURN_ERROR(error);
+
+		for (uint32 i = 0; i < entries; i++) {
+			error = vm_memcpy_from_physical(data, table[i].address,
+				table[i].size, user);
+			if (error != B_OK)
+				RETURN_ERROR(error);
+
+			data = (uint8*)data + table[i].size;
+			fDirectAddress += table[i].size;
+			fDirectSize -= table[i].size;
+			request.AddBytesTransferred(table[i].size);
+		}
+	}
+
+	return B_OK;
 }
 
 
@@ -608,8 +663,18 @@ UnixFifo::_Write(UnixRequest& request, bigtime_t timeout)
 		return 0;
 
 	status_t error = B_OK;
+	bool direct = fType == UnixFifoType::Stream && gStackModule->is_syscall();
 
 	while (error == B_OK && request.BytesRemaining() > 0) {
+		if (direct && fBuffer.Writable() == 0
+			&& request.BytesRemaining() >= (off_t)kMinDirectWriteSize
+			&& request.AncillaryData() == NULL) {
+			// Instead of waiting for room in the buffer, let the readers
+			// copy the data from our memory; this saves one copy.
+			error = _WriteDirectly(request, timeout, direct);
+			continue;
+		}
+
 		// wait for any space to become available
 		while (error == B_OK && fBuffer.Writable() < _MinimumWritableSize(request)
 				&& !IsWriteShutdown() && !IsReadShutdown()) {
@@ -636,6 +701,10 @@ UnixFifo::_Write(UnixRequest& request, bigtime_t timeout)
 		if (error == B_OK) {
 // TODO: Whenever we've successfully written a part, we should reset the
 // timeout!
+			if (request.BytesRemaining() > 0) {
+				// the readers need to make room for the rest
+				fReadCondition.NotifyAll();
+			}
 		}
 	}
 
@@ -643,6 +712,63 @@ UnixFifo::_Write(UnixRequest& request, bigtime_t timeout)
 }
 
 
+/*!	Offers the current chunk of \a request to the readers, which copy it
+	directly from the writer's memory, and waits until they have done so.
+	If the memory cannot be locked, \a _direct is set to \c false, and
+	the data must go through the buffer.
+*/
+status_t
+UnixFifo::_WriteDirectly(UnixRequest& request, bigtime_t timeout,
+	bool& _direct)
+{
+	void* data;
+	size_t size;
+	if (!request.GetCurrentChunk(data, size))
+		return B_OK;
+	if (size > kMaxDirectWriteSize)
+		size = kMaxDirectWriteSize;
+
+	team_id team = team_get_current_team_id();
+	if (lock_memory_etc(team, data, size, B_READ_DEVICE) != B_OK) {
+		_direct = false;
+		return B_OK;
+	}
+
+	fDirectTeam = team;
+	fDirectAddress = (addr_t)data;
+	fDirectSize = size;
+	fReadCondition.NotifyAll();
+
+	status_t error = B_OK;
+	while (fDirectSize > 0 && !IsWriteShutdown() && !IsReadShutdown()) {
+		ConditionVariableEntry entry;
+		fWriteCondition.Add(&entry);
+
+		mutex_unlock(&fLock);
+		error = entry.Wait(B_ABSOLUTE_TIMEOUT | B_CAN_INTERRUPT, timeout);
+		mutex_lock(&fLock);
+
+		if (error != B_OK)
+			break;
+	}
+
+	// take back what the readers didn't get
+	request.AddBytesTransferred(size - fDirectSize);
+	fDirectSize = 0;
+
+	unlock_memory_etc(team, data, size, B_READ_DEVICE);
+
+	if (error != B_OK)
+		RETURN_ERROR(error);
+	if (IsWriteShutdown())
+		RETURN_ERROR(UNIX_FIFO_SHUTDOWN);
+	if (IsReadShutdown())
+		RETURN_ERROR(EPIPE);
+
+	return B_OK;
+}
+
+
 status_t
 UnixFifo::_WriteNonBlocking(UnixRequest& request)
 {
@@ -149,10 +149,18 @@ private:
 
 private:
 	status_t _Read(UnixRequest& request, bigtime_t timeout);
+	status_t _ReadDirectly(UnixRequest& request);
 	status_t _Write(UnixRequest& request, bigtime_t timeout);
+	status_t _WriteDirectly(UnixRequest& request, bigtime_t timeout,
+		bool& _direct);
 	status_t _WriteNonBlocking(UnixRequest& request);
 	size_t _MinimumWritableSize(const UnixRequest& request) const;
 
+	size_t _BytesAvailable() const
+	{
+		return fBuffer.Readable() + fDirectSize;
+	}
+
 private:
 	mutex				fLock;
 	UnixBufferQueue		fBuffer;
@@ -164,6 +172,11 @@ private:
 	ConditionVariable	fWriteCondition;
 	uint32				fShutdown;
 	UnixFifoType		fType;
+
+	// memory of a writer waiting in _WriteDirectly()
+	team_id				fDirectTeam;
+	addr_t				fDirectAddress;
+	size_t				fDirectSize;
 };
 
 
@@ -27,6 +27,7 @@
 #include "device_interfaces.h"
 #include "domains.h"
 #include "interfaces.h"
+#include "offload.h"
 #include "routes.h"
 #include "stack_private.h"
 #include "utility.h"
@@ -695,11 +696,8 @@ interface_protocol_uninit(net_datalink_protocol* protocol)
 
 
 static status_t
-interface_protocol_send_data(net_datalink_protocol* _protocol,
-	net_buffer* buffer)
+send_to_device(void* _protocol, net_buffer* buffer)
 {
-	TRACE("%s(%p, buffer %p)\n", __FUNCTION__, _protocol, buffer);
-
 	interface_protocol* protocol = (interface_protocol*)_protocol;
 	Interface* interface = (Interface*)protocol->interface;
 
@@ -713,6 +711,33 @@ interface_protocol_send_data(net_datalink_protocol* _protocol,
 }
 
 
+static status_t
+interface_protocol_send_data(net_datalink_protocol* _protocol,
+	net_buffer* buffer)
+{
+	TRACE("%s(%p, buffer %p)\n", __FUNCTION__, _protocol, buffer);
+
+	interface_protocol* protocol = (interface_protocol*)_protocol;
+
+	if ((buffer->buffer_flags & NET_BUFFER_TCP_SEGMENTATION) != 0
+		&& !device_can_segment(protocol->device, buffer)) {
+		// split the segment as late as possible
+		return segment_tcp_buffer(buffer, protocol->device->header_length,
+			&send_to_device, protocol);
+	}
+
+	status_t status = send_to_device(protocol, buffer);
+	if (status == B_BUFFER_OVERFLOW
+		&& (buffer->buffer_flags & NET_BUFFER_TCP_SEGMENTATION) != 0) {
+		// the device cannot take this segment in one piece
+		return segment_tcp_buffer(buffer, protocol->device->header_length,
+			&send_to_device, protocol);
+	}
+
+	return status;
+}
+
+
 static status_t
 interface_protocol_up(net_datalink_protocol* protocol)
 {
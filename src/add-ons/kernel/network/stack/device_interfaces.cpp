@@ -10,6 +10,7 @@
 #include "device_interfaces.h"
 #include "domains.h"
 #include "interfaces.h"
+#include "offload.h"
 #include "stack_private.h"
 #include "utility.h"
 
@@ -36,6 +37,8 @@
 #endif
 
 
+static const int32 kMaxCoalescedBuffers = 64;
+
 static mutex sLock;
 static DeviceInterfaceList sInterfaces;
 static uint32 sDeviceIndex;
@@ -93,11 +96,56 @@ device_reader_thread(void* _interface)
 }
 
 
+static void
+deliver_buffer(void* _interface, net_buffer* buffer)
+{
+	net_device_interface* interface = (net_device_interface*)_interface;
+	net_device* device = interface->device;
+
+	buffer->buffer_flags &= ~NET_BUFFER_TCP_SEGMENTATION;
+
+	if (buffer->interface_address != NULL) {
+		// If the interface is already specified, this buffer was
+		// delivered locally.
+		if (buffer->interface_address->domain->module->receive_data(buffer)
+				== B_OK)
+			buffer = NULL;
+	} else {
+		sockaddr_dl& linkAddress = *(sockaddr_dl*)buffer->source;
+		int32 genericType = buffer->type;
+		int32 specificType = B_NET_FRAME_TYPE(linkAddress.sdl_type,
+			ntohs(linkAddress.sdl_e_type));
+
+		buffer->index = interface->device->index;
+
+		// Find handler for this packet
+
+		RecursiveLocker locker(interface->receive_lock);
+
+		DeviceHandlerList::Iterator iterator
+			= interface->receive_funcs.GetIterator();
+		while (buffer != NULL && iterator.HasNext()) {
+			net_device_handler* handler = iterator.Next();
+
+			// If the handler returns B_OK, it consumed the buffer - first
+			// handler wins.
+			if ((handler->type == genericType
+					|| handler->type == specificType)
+				&& handler->func(handler->cookie, device, buffer) == B_OK)
+				buffer = NULL;
+		}
+	}
+
+	if (buffer != NULL)
+		gNetBufferModule.free(buffer);
+}
+
+
 static status_t
 device_consumer_thread(void* _interface)
 {
 	net_device_interface* interface = (net_device_interface*)_interface;
-	net_device* device = interface->device;
+	TCPSegmentCoalescer coalescer(&deliver_buffer, interface);
 	net_buffer* buffer;
 
 	while (atomic_get(&interface->ref_count) > 0) {
@@ -109,40 +157,21 @@ device_consumer_thread(void* _interface)
 			break;
 		}
 
-		if (buffer->interface_address != NULL) {
-			// If the interface is already specified, this buffer was
-			// delivered locally.
-			if (buffer->interface_address->domain->module->receive_data(buffer)
-					== B_OK)
-				buffer = NULL;
-		} else {
-			sockaddr_dl& linkAddress = *(sockaddr_dl*)buffer->source;
-			int32 genericType = buffer->type;
-			int32 specificType = B_NET_FRAME_TYPE(linkAddress.sdl_type,
-				ntohs(linkAddress.sdl_e_type));
-
-			buffer->index = interface->device->index;
-
-			// Find handler for this packet
-
-			RecursiveLocker locker(interface->receive_lock);
-
-			DeviceHandlerList::Iterator iterator
-				= interface->receive_funcs.GetIterator();
-			while (buffer != NULL && iterator.HasNext()) {
-				net_device_handler* handler = iterator.Next();
-
-				// If the handler returns B_OK, it consumed the buffer - first
-				// handler wins.
-				if ((handler->type == genericType
-						|| handler->type == specificType)
-					&& handler->func(handler->cookie, device, buffer) == B_OK)
-					buffer = NULL;
-			}
+		if ((interface->device->offload & NET_DEVICE_OFFLOAD_COALESCING)
+				== 0) {
+			deliver_buffer(interface, buffer);
+			continue;
 		}
 
-		if (buffer != NULL)
-			gNetBufferModule.free(buffer);
+		// Coalesce what has been queued already, but don't wait for more
+		int32 count = 0;
+		do {
+			coalescer.Add(buffer);
+		} while (++count < kMaxCoalescedBuffers
+			&& fifo_dequeue_buffer(&interface->receive_queue, MSG_DONTWAIT, 0,
+				&buffer) == B_OK);
+
+		coalescer.Flush();
 	}
 
 	return B_OK;
@@ -53,6 +53,11 @@
 #define DATA_NODE_READ_ONLY		0x1
 #define DATA_NODE_STORED_HEADER	0x2
 
+#define DATA_HEADER_EXTERNAL	0x1
+
+#define MAX_EXTERNAL_NODE_SIZE	32768
+	// data_node::used is only 16 bit wide
+
 struct header_space {
 	uint16	size;
 	uint16	free;
@@ -70,6 +75,17 @@ struct data_header {
 	uint8*			data_end;
 	header_space	space;
 	uint16			tail_space;
+	uint16			flags;
+};
+
+/*!	A data header that does not contain the data itself, but refers to
+	memory owned by someone else. The owner is notified via \c release once
+	the last node referring to it is gone.
+*/
+struct external_data_header {
+	data_header				header;
+	net_buffer_release_func	release;
+	void*					cookie;
 };
 
 struct data_node {
@@ -153,6 +169,7 @@ struct net_buffer_private : net_buffer {
 
 static object_cache* sNetBufferCache;
 static object_cache* sDataNodeCache;
+static object_cache* sExternalDataHeaderCache;
 
 
 static status_t append_data(net_buffer* buffer, const void* data, size_t size);
@@ -814,6 +831,7 @@ create_data_header(size_t headerSpace)
 	header->tail_space = (uint8*)header + BUFFER_SIZE - header->data_end
 		- headerSpace;
 	header->first_free = NULL;
+	header->flags = 0;
 
 	TRACE(("%d:   create new data header %p\n", find_thread(NULL), header));
 	T2(CreateDataHeader(header));
@@ -821,6 +839,34 @@ create_data_header(size_t headerSpace)
 }
 
 
+static data_header*
+create_external_data_header(net_buffer_release_func release, void* cookie)
+{
+	external_data_header* external = (external_data_header*)object_cache_alloc(
+		sExternalDataHeaderCache, 0);
+	if (external == NULL)
+		return NULL;
+
+	data_header* header = &external->header;
+	header->ref_count = 1;
+	header->physical_address = 0;
+	header->space.size = 0;
+	header->space.free = 0;
+	header->data_end = NULL;
+	header->tail_space = 0;
+	header->first_free = NULL;
+	header->flags = DATA_HEADER_EXTERNAL;
+
+	external->release = release;
+	external->cookie = cookie;
+
+	TRACE(("%d:   create new external data header %p\n", find_thread(NULL),
+		header));
+	T2(CreateDataHeader(header));
+	return header;
+}
+
+
 static void
 release_data_header(data_header* header)
 {
@@ -830,6 +876,14 @@ release_data_header(data_header* header)
 		return;
 
 	TRACE(("%d:   free header %p\n", find_thread(NULL), header));
+
+	if ((header->flags & DATA_HEADER_EXTERNAL) != 0) {
+		external_data_header* external = (external_data_header*)header;
+		external->release(external->cookie);
+		object_cache_free(sExternalDataHeaderCache, external, 0);
+		return;
+	}
+
 	free_data_header(header);
 }
 
@@ -1076,6 +1130,7 @@ copy_metadata(net_buffer* destination, const net_buffer* source)
 
 	destination->msg_flags = source->msg_flags;
 	destination->buffer_flags = source->buffer_flags;
+	destination->segment_size = source->segment_size;
 	destination->interface_address = source->interface_address;
 	if (destination->interface_address != NULL)
 		((InterfaceAddress*)destination->interface_address)->AcquireReference();
@@ -1130,6 +1185,7 @@ create_buffer(size_t headerSpace)
 	buffer->offset = 0;
 	buffer->msg_flags = 0;
 	buffer->buffer_flags = 0;
+	buffer->segment_size = 0;
 	buffer->size = 0;
 
 	CHECK_BUFFER(buffer);
@@ -1416,7 +1472,8 @@ merge_buffer(net_buffer* _buffer, net_buffer* _with, bool after)
 		if (node == NULL)
 			break;
 
-		if ((uint8*)node > (uint8*)node->header
+		if ((node->header->flags & DATA_HEADER_EXTERNAL) == 0
+			&& (uint8*)node > (uint8*)node->header
 			&& (uint8*)node < (uint8*)node->header + BUFFER_SIZE) {
 			// The node is already in the buffer, we can just move it
 			// over to the new owner
@@ -2011,6 +2068,71 @@ append_cloned_data(net_buffer* _buffer, net_buffer* _source, uint32 offset,
 }
 
 
+/*!	Appends the memory described by \a vecs to the buffer without copying
+	it. The memory must stay valid and unchanged until \a release is called
+	with \a cookie, which happens once the last buffer referring to it has
+	been freed, or trimmed. It is always called, even if this function fails.
+	The memory must be accessible from any context the buffer is used in,
+	ie. it must be kernel memory.
+*/
+static status_t
+append_external_data(net_buffer* _buffer, const iovec* vecs, uint32 vecCount,
+	net_buffer_release_func release, void* cookie)
+{
+	net_buffer_private* buffer = (net_buffer_private*)_buffer;
+	TRACE(("%d: append_external_data(buffer %p, vecs %p, count %" B_PRIu32
+		")\n", find_thread(NULL), buffer, vecs, vecCount));
+
+	data_header* header = create_external_data_header(release, cookie);
+	if (header == NULL) {
+		release(cookie);
+		return B_NO_MEMORY;
+	}
+
+	ParanoiaChecker _(buffer);
+
+	size_t sizeAppended = 0;
+	status_t status = B_OK;
+
+	for (uint32 i = 0; i < vecCount && status == B_OK; i++) {
+		uint8* data = (uint8*)vecs[i].iov_base;
+		size_t bytes = vecs[i].iov_len;
+
+		while (bytes > 0) {
+			data_node* node = add_data_node(buffer, header);
+			if (node == NULL) {
+				status = ENOBUFS;
+				break;
+			}
+
+			node->offset = buffer->size;
+			node->start = data;
+			node->used = min_c(bytes, MAX_EXTERNAL_NODE_SIZE);
+			node->flags = DATA_NODE_READ_ONLY;
+
+			list_add_item(&buffer->buffers, node);
+
+			data += node->used;
+			bytes -= node->used;
+			buffer->size += node->used;
+			sizeAppended += node->used;
+		}
+	}
+
+	if (status != B_OK)
+		remove_trailer(buffer, sizeAppended);
+
+	// The nodes keep the header alive from now on
+	release_data_header(header);
+
+	CHECK_BUFFER(buffer);
+	SET_PARANOIA_CHECK(PARANOIA_SUSPICIOUS, buffer, &buffer->size,
+		sizeof(buffer->size));
+
+	return status;
+}
+
+
 void
 set_ancillary_data(net_buffer* buffer, ancillary_data_container* container)
 {
@@ -2327,6 +2449,14 @@ std_ops(int32 op, ...)
 				return B_NO_MEMORY;
 			}
 
+			sExternalDataHeaderCache = create_object_cache(
+				"external data header cache", sizeof(external_data_header), 0);
+			if (sExternalDataHeaderCache == NULL) {
+				delete_object_cache(sNetBufferCache);
+				delete_object_cache(sDataNodeCache);
+				return B_NO_MEMORY;
+			}
+
 #if ENABLE_STATS
 			add_debugger_command_etc("net_buffer_stats", &dump_net_buffer_stats,
 				"Print net buffer statistics",
@@ -2348,6 +2478,7 @@ std_ops(int32 op, ...)
 #endif
 			delete_object_cache(sNetBufferCache);
 			delete_object_cache(sDataNodeCache);
+			delete_object_cache(sExternalDataHeaderCache);
 			return B_OK;
 
 		default:
@@ -2380,6 +2511,7 @@ net_buffer_module_info gNetBufferModule = {
 	remove_trailer,
 	trim_data,
 	append_cloned_data,
+	append_external_data,
 
 	NULL,	// associate_data
 
@@ -26,8 +26,10 @@
 #include <util/list.h>
 #include <WeakReferenceable.h>
 
+#include <condition_variable.h>
 #include <fs/select_sync_pool.h>
 #include <kernel.h>
+#include <vm/vm.h>
 
 #include <net_protocol.h>
 #include <net_stack.h>
@@ -71,6 +73,29 @@ struct net_socket_private : net_socket,
 };
 
 
+#if B_HAIKU_64_BIT
+#define MAX_ZERO_COPY_PAGES	16
+
+struct zero_copy_request {
+	mutex				lock;
+	ConditionVariable	condition;
+	int32				ref_count;
+	team_id				team;
+	addr_t				address;
+	size_t				length;
+};
+
+struct zero_copy_pages {
+	zero_copy_request*	request;
+	uint32				count;
+	addr_t				addresses[MAX_ZERO_COPY_PAGES];
+	void*				handles[MAX_ZERO_COPY_PAGES];
+};
+
+static const size_t kMinZeroCopySize = 4 * B_PAGE_SIZE;
+#endif
+
+
 int socket_bind(net_socket* socket, const struct sockaddr* address,
 	socklen_t addressLength);
 int socket_setsockopt(net_socket* socket, int level, int option,
@@ -1239,12 +1264,233 @@ socket_receive(net_socket* socket, msghdr* header, void* data, size_t length,
 }
 
 
+/*!	Sends the memory described by \a vecs as a single buffer without copying
+	it. \a release is always called with \a cookie once the stack no longer
+	needs the memory, even if sending fails.
+*/
+static ssize_t
+send_external_buffer(net_socket* socket, const sockaddr* address,
+	socklen_t addressLength, const iovec* vecs, size_t vecCount,
+	net_buffer_release_func release, void* cookie, int flags, bool nosignal)
+{
+	net_buffer* buffer = gNetBufferModule.create(256);
+	if (buffer == NULL) {
+		release(cookie);
+		return ENOBUFS;
+	}
+
+	status_t status = gNetBufferModule.append_external(buffer, vecs, vecCount,
+		release, cookie);
+	if (status != B_OK) {
+		gNetBufferModule.free(buffer);
+		return status;
+	}
+
+	size_t bufferSize = buffer->size;
+	buffer->msg_flags = flags;
+	memcpy(buffer->source, &socket->address, socket->address.ss_len);
+	memcpy(buffer->destination, address, addressLength);
+	buffer->destination->sa_len = addressLength;
+
+	status = socket->first_info->send_data(socket->first_protocol, buffer);
+	if (status != B_OK) {
+		// we only send signals when called from userland
+		if (status == EPIPE && is_syscall() && !nosignal)
+			send_signal(find_thread(NULL), SIGPIPE);
+
+		size_t sizeAfterSend = buffer->size;
+		gNetBufferModule.free(buffer);
+
+		if (sizeAfterSend != bufferSize
+			&& (status == B_INTERRUPTED || status == B_WOULD_BLOCK)) {
+			// this appears to be a partial write
+			return bufferSize - sizeAfterSend;
+		}
+		return status;
+	}
+
+	return bufferSize;
+}
+
+
+#if B_HAIKU_64_BIT
+static void
+put_zero_copy_request(zero_copy_request* request)
+{
+	MutexLocker locker(request->lock);
+
+	int32 refCount = --request->ref_count;
+	if (refCount == 1) {
+		// only the sender is left
+		request->condition.NotifyAll();
+	}
+	if (refCount > 0)
+		return;
+
+	locker.Unlock();
+
+	unlock_memory_etc(request->team, (void*)request->address, request->length,
+		B_READ_DEVICE);
+	mutex_destroy(&request->lock);
+	delete request;
+}
+
+
+static void
+release_zero_copy_pages(void* cookie)
+{
+	zero_copy_pages* pages = (zero_copy_pages*)cookie;
+
+	for (uint32 i = 0; i < pages->count; i++)
+		vm_put_physical_page(pages->addresses[i], pages->handles[i]);
+
+	put_zero_copy_request(pages->request);
+	free(pages);
+}
+
+
+/*!	Maps the pages of the locked user memory at \a address, and sends them
+	as a single buffer. Returns the number of bytes sent.
+*/
+static ssize_t
+send_zero_copy_pages(net_socket* socket, const sockaddr* address,
+	socklen_t addressLength, zero_copy_request* request, addr_t data,
+	size_t length, int flags, bool nosignal)
+{
+	zero_copy_pages* pages = (zero_copy_pages*)malloc(sizeof(zero_copy_pages));
+	if (pages == NULL)
+		return B_NO_MEMORY;
+
+	pages->request = request;
+	pages->count = 0;
+
+	physical_entry table[MAX_ZERO_COPY_PAGES];
+	uint32 entries = MAX_ZERO_COPY_PAGES;
+	status_t status = get_memory_map_etc(request->team, (void*)data, length,
+		table, &entries);
+	if (status != B_OK) {
+		free(pages);
+		return status;
+	}
+
+	iovec vecs[MAX_ZERO_COPY_PAGES];
+	size_t mapped = 0;
+
+	for (uint32 i = 0; i < entries && status == B_OK; i++) {
+		phys_addr_t physicalAddress = table[i].address;
+		phys_size_t size = table[i].size;
+
+		while (size > 0 && pages->count < MAX_ZERO_COPY_PAGES) {
+			uint32 index = pages->count;
+			size_t pageOffset = physicalAddress % B_PAGE_SIZE;
+			size_t bytes = min_c(size, B_PAGE_SIZE - pageOffset);
+
+			status = vm_get_physical_page(physicalAddress - pageOffset,
+				&pages->addresses[index], &pages->handles[index]);
+			if (status != B_OK)
+				break;
+
+			vecs[index].iov_base = (void*)(pages->addresses[index]
+				+ pageOffset);
+			vecs[index].iov_len = bytes;
+			pages->count++;
+
+			physicalAddress += bytes;
+			size -= bytes;
+			mapped += bytes;
+		}
+	}
+
+	if (pages->count == 0) {
+		free(pages);
+		return status != B_OK ? status : B_BAD_ADDRESS;
+	}
+
+	atomic_add(&request->ref_count, 1);
+	return send_external_buffer(socket, address, addressLength, vecs,
+		pages->count, &release_zero_copy_pages, pages, flags, nosignal);
+}
+
+
+/*!	Sends userland memory without copying it, by handing its pages to the
+	stack directly. Since the caller may only reuse its memory once the
+	stack is done with it, this waits until all of the data has been
+	released, ie. acknowledged by the peer in case of TCP.
+	If waiting is interrupted, the memory stays locked until the stack
+	releases it; the caller must not change it in the meantime.
+*/
+static ssize_t
+send_zero_copy(net_socket* socket, const sockaddr* address,
+	socklen_t addressLength, const void* data, size_t length, int flags,
+	bool nosignal)
+{
+	zero_copy_request* request = new(std::nothrow) zero_copy_request;
+	if (request == NULL)
+		return B_NO_MEMORY;
+
+	request->team = team_get_current_team_id();
+	request->address = (addr_t)data;
+	request->length = length;
+
+	// the device only reads from the memory
+	status_t status = lock_memory_etc(request->team, (void*)data, length,
+		B_READ_DEVICE);
+	if (status != B_OK) {
+		delete request;
+		return status;
+	}
+
+	mutex_init(&request->lock, "zero copy send");
+	request->condition.Init(request, "zero copy send");
+	request->ref_count = 1;
+		// the sender's reference
+
+	ssize_t bytesSent = 0;
+	while ((size_t)bytesSent < length) {
+		addr_t chunk = (addr_t)data + bytesSent;
+		size_t bytes = min_c(length - bytesSent,
+			MAX_ZERO_COPY_PAGES * B_PAGE_SIZE - chunk % B_PAGE_SIZE);
+
+		ssize_t sent = send_zero_copy_pages(socket, address, addressLength,
+			request, chunk, bytes, flags, nosignal);
+		if (sent < 0) {
+			if (bytesSent == 0)
+				bytesSent = sent;
+			break;
+		}
+
+		bytesSent += sent;
+		if ((size_t)sent < bytes)
+			break;
+	}
+
+	MutexLocker locker(request->lock);
+	while (request->ref_count > 1) {
+		ConditionVariableEntry entry;
+		request->condition.Add(&entry);
+		locker.Unlock();
+
+		status = entry.Wait(B_CAN_INTERRUPT);
+		locker.Lock();
+
+		if (status != B_OK)
+			break;
+	}
+	locker.Unlock();
+
+	put_zero_copy_request(request);
+	return bytesSent;
+}
+#endif	// B_HAIKU_64_BIT
+
+
 ssize_t
 socket_send(net_socket* socket, msghdr* header, const void* data, size_t length,
 	int flags)
 {
 	const bool nosignal = ((flags & MSG_NOSIGNAL) != 0);
-	flags &= ~MSG_NOSIGNAL;
+	const bool zeroCopy = ((flags & MSG_ZEROCOPY) != 0);
+	flags &= ~(MSG_NOSIGNAL | MSG_ZEROCOPY);
 
 	size_t bytesLeft = length;
 	if (length > SSIZE_MAX)
@@ -1336,6 +1582,19 @@ socket_send(net_socket* socket, msghdr* header, const void* data, size_t length,
 		}
 	}
 
+#if B_HAIKU_64_BIT
+	// Only larger writes to streams are worth the overhead of locking and
+	// mapping the memory
+	if (zeroCopy && header == NULL && ancillaryData == NULL
+		&& socket->type == SOCK_STREAM && length >= kMinZeroCopySize
+		&& IS_USER_ADDRESS(data)) {
+		return send_zero_copy(socket, address, addressLength, data, length,
+			flags, nosignal);
+	}
+#else
+	(void)zeroCopy;
+#endif
+
 	ssize_t bytesSent = 0;
 	size_t vecOffset = 0;
 	uint32 vecIndex = 0;
@@ -1417,6 +1676,50 @@ socket_send(net_socket* socket, msghdr* header, const void* data, size_t length,
 }
 
 
+/*!	Sends the kernel memory described by \a vecs without copying it, if the
+	protocol supports that. \a release is called with \a cookie once the
+	memory is no longer needed, which for TCP is when it has been
+	acknowledged. It is always called, even if sending fails.
+*/
+ssize_t
+socket_send_external(net_socket* socket, const iovec* vecs, size_t vecCount,
+	net_buffer_release_func release, void* cookie, int flags)
+{
+	const bool nosignal = ((flags & MSG_NOSIGNAL) != 0);
+	flags &= ~(MSG_NOSIGNAL | MSG_ZEROCOPY);
+
+	status_t status = B_OK;
+	if (socket->type != SOCK_STREAM)
+		status = B_UNSUPPORTED;
+	else if (socket->peer.ss_len == 0)
+		status = ENOTCONN;
+	if (status != B_OK) {
+		release(cookie);
+		return status;
+	}
+
+	const sockaddr* address = (const sockaddr*)&socket->peer;
+	socklen_t addressLength = socket->peer.ss_len;
+
+	if (socket->first_info->send_data_no_buffer != NULL) {
+		// The protocol does not use buffers, and has to copy the data
+		ssize_t written = socket->first_info->send_data_no_buffer(
+			socket->first_protocol, (iovec*)vecs, vecCount, NULL, address,
+			addressLength, flags);
+		release(cookie);
+
+		// we only send signals when called from userland
+		if (written == EPIPE && is_syscall() && !nosignal)
+			send_signal(find_thread(NULL), SIGPIPE);
+
+		return written;
+	}
+
+	return send_external_buffer(socket, address, addressLength, vecs,
+		vecCount, release, cookie, flags, nosignal);
+}
+
+
 status_t
 socket_set_option(net_socket* socket, int level, int option, const void* value,
 	int length)
@@ -1699,6 +2002,7 @@ net_socket_module_info gNetSocketModule = {
 	socket_listen,
 	socket_receive,
 	socket_send,
+	socket_send_external,
 	socket_setsockopt,
 	socket_shutdown,
 	socket_socketpair
@@ -0,0 +1,496 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+//!	Generic TCP segmentation and receive coalescing
+
+
+#include "offload.h"
+
+#include <net_stack.h>
+
+#include <ByteOrder.h>
+#include <KernelExport.h>
+
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/ip6.h>
+#include <netinet/tcp.h>
+#include <string.h>
+
+#include "stack_private.h"
+#include "utility.h"
+
+
+//#define TRACE_OFFLOAD
+#ifdef TRACE_OFFLOAD
+#	define TRACE(x...) dprintf(STACK_DEBUG_PREFIX x)
+#else
+#	define TRACE(x...) ;
+#endif
+
+
+// TCP header flags
+#define TCP_FLAG_FINISH			0x01
+#define TCP_FLAG_PUSH			0x08
+#define TCP_FLAG_ACKNOWLEDGE	0x10
+#define TCP_FLAG_CWR			0x80
+
+// the largest IP packet whose length can be described in its header
+static const uint32 kMaxPacketSize = 65535;
+
+
+static inline size_t
+tcp_header_length(const uint8* tcp)
+{
+	return (tcp[12] >> 4) * 4;
+}
+
+
+/*!	Reads the IP and TCP headers of the packet that starts at \a offset in
+	\a buffer to \a data, which must be able to hold MAX_TCP_HEADERS_LENGTH
+	bytes. Only IPv4 without options or fragmentation, and IPv6 without
+	extension headers are supported.
+*/
+static status_t
+read_tcp_headers(net_buffer* buffer, size_t offset, uint8* data,
+	tcp_headers& info)
+{
+	if (buffer->size < offset + sizeof(struct ip) + sizeof(tcphdr))
+		return B_BAD_DATA;
+
+	size_t available = min_c(buffer->size - offset, MAX_TCP_HEADERS_LENGTH);
+	if (gNetBufferModule.read(buffer, offset, data, available) != B_OK)
+		return B_BAD_DATA;
+
+	switch (data[0] >> 4) {
+		case 4:
+		{
+			const struct ip* header = (const struct ip*)data;
+			if ((data[0] & 0xf) != sizeof(struct ip) / 4
+				|| header->ip_p != IPPROTO_TCP
+				|| (ntohs(header->ip_off) & (IP_MF | IP_OFFMASK)) != 0)
+				return B_BAD_DATA;
+
+			info.family = AF_INET;
+			info.ip_length = sizeof(struct ip);
+			break;
+		}
+
+		case 6:
+		{
+			const ip6_hdr* header = (const ip6_hdr*)data;
+			if (header->ip6_nxt != IPPROTO_TCP)
+				return B_BAD_DATA;
+
+			info.family = AF_INET6;
+			info.ip_length = sizeof(ip6_hdr);
+			break;
+		}
+
+		default:
+			return B_BAD_DATA;
+	}
+
+	if (available < info.ip_length + sizeof(tcphdr))
+		return B_BAD_DATA;
+
+	size_t tcpLength = tcp_header_length(data + info.ip_length);
+	if (tcpLength < sizeof(tcphdr) || info.ip_length + tcpLength > available)
+		return B_BAD_DATA;
+
+	info.length = info.ip_length + tcpLength;
+	return B_OK;
+}
+
+
+/*!	Computes the checksum of the TCP segment at \a offset in \a buffer,
+	including the pseudo header built from the IP header \a ip.
+	If the checksum field of the segment is filled in, the result is 0 for a
+	valid segment.
+*/
+static int32
+tcp_checksum(net_buffer* buffer, size_t offset, size_t length, const uint8* ip,
+	int family)
+{
+	uint32 sum;
+	if (family == AF_INET) {
+		const struct ip* header = (const struct ip*)ip;
+		sum = compute_checksum((uint8*)&header->ip_src, 8);
+	} else {
+		const ip6_hdr* header = (const ip6_hdr*)ip;
+		sum = compute_checksum((uint8*)&header->ip6_src, 32);
+	}
+	sum += htons(IPPROTO_TCP) + htons((uint16)length);
+
+	int32 data = gNetBufferModule.checksum(buffer, offset, length, false);
+	if (data < 0)
+		return data;
+
+	// the buffer checksum is relative to its start
+	if ((offset & 1) != 0)
+		data = __swap_int16((uint16)data);
+	sum += data;
+
+	while ((sum >> 16) != 0)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return (uint16)~sum;
+}
+
+
+static void
+set_ip_length(uint8* ip, const tcp_headers& info, size_t size)
+{
+	if (info.family == AF_INET) {
+		struct ip* header = (struct ip*)ip;
+		header->ip_len = htons(size);
+		header->ip_sum = 0;
+		header->ip_sum = checksum(ip, sizeof(struct ip));
+	} else
+		((ip6_hdr*)ip)->ip6_plen = htons(size - sizeof(ip6_hdr));
+}
+
+
+//	#pragma mark - segmentation
+
+
+/*!	Returns whether or not the \a device can split the oversized TCP segment
+	in \a buffer itself.
+*/
+bool
+device_can_segment(net_device* device, net_buffer* buffer)
+{
+	uint32 offload = device->offload
+		& (NET_DEVICE_OFFLOAD_TSO4 | NET_DEVICE_OFFLOAD_TSO6);
+	if (offload == 0)
+		return false;
+
+	uint8 version;
+	if (gNetBufferModule.read(buffer, device->header_length, &version,
+			sizeof(version)) != B_OK)
+		return false;
+
+	switch (version >> 4) {
+		case 4:
+			return (offload & NET_DEVICE_OFFLOAD_TSO4) != 0;
+		case 6:
+			return (offload & NET_DEVICE_OFFLOAD_TSO6) != 0;
+	}
+	return false;
+}
+
+
+/*!	Splits the oversized TCP segment in \a buffer into segments with at most
+	net_buffer::segment_size bytes of payload each, and passes them one by one
+	to \a send. The payload is not copied, but shared with \a buffer.
+
+	\a buffer must start with a link header of \a linkHeaderLength bytes, and
+	is freed if this function succeeds. Otherwise, \a buffer is left to the
+	caller, even though some segments might have been sent already.
+*/
+status_t
+segment_tcp_buffer(net_buffer* buffer, size_t linkHeaderLength,
+	segment_send_func send, void* cookie)
+{
+	uint8 headers[MAX_TCP_HEADERS_LENGTH];
+	tcp_headers info;
+	status_t status = read_tcp_headers(buffer, linkHeaderLength, headers,
+		info);
+	if (status != B_OK)
+		return status;
+
+	const size_t headerLength = linkHeaderLength + info.length;
+	const uint32 segmentSize = buffer->segment_size;
+	if (segmentSize == 0 || buffer->size <= headerLength)
+		return B_BAD_VALUE;
+
+	uint8* ip = headers;
+	tcphdr* tcp = (tcphdr*)(headers + info.ip_length);
+	const uint32 sequence = ntohl(tcp->th_seq);
+	const uint8 flags = tcp->th_flags;
+	uint16 id = 0;
+	if (info.family == AF_INET)
+		id = ntohs(((struct ip*)ip)->ip_id);
+
+	// After this, the buffer only contains the payload, and the template
+	// only the headers
+	net_buffer* headerTemplate = gNetBufferModule.split(buffer, headerLength);
+	if (headerTemplate == NULL)
+		return B_NO_MEMORY;
+
+	headerTemplate->buffer_flags &= ~NET_BUFFER_TCP_SEGMENTATION;
+	headerTemplate->segment_size = 0;
+
+	TRACE("segment %" B_PRIu32 " bytes into %" B_PRIu32 " byte segments\n",
+		buffer->size, segmentSize);
+
+	uint32 offset = 0;
+	while (offset < buffer->size) {
+		uint32 length = min_c(segmentSize, buffer->size - offset);
+		bool last = offset + length == buffer->size;
+
+		net_buffer* segment = gNetBufferModule.duplicate(headerTemplate);
+		if (segment == NULL) {
+			status = B_NO_MEMORY;
+			break;
+		}
+
+		status = gNetBufferModule.append_cloned(segment, buffer, offset,
+			length);
+
+		if (status == B_OK) {
+			// Fix the headers for this segment; FIN and PSH only belong to the
+			// last one, CWR only to the first one
+			if (info.family == AF_INET)
+				((struct ip*)ip)->ip_id = htons(id++);
+			set_ip_length(ip, info, info.length + length);
+
+			tcp->th_seq = htonl(sequence + offset);
+			tcp->th_flags = flags;
+			if (!last)
+				tcp->th_flags &= ~(TCP_FLAG_FINISH | TCP_FLAG_PUSH);
+			if (offset != 0)
+				tcp->th_flags &= ~TCP_FLAG_CWR;
+			tcp->th_sum = 0;
+
+			status = gNetBufferModule.write(segment, linkHeaderLength,
+				headers, info.length);
+		}
+		if (status == B_OK) {
+			size_t tcpOffset = linkHeaderLength + info.ip_length;
+			int32 sum = tcp_checksum(segment, tcpOffset,
+				segment->size - tcpOffset, ip, info.family);
+			if (sum < 0)
+				status = sum;
+			else {
+				tcp->th_sum = sum;
+				status = gNetBufferModule.write(segment,
+					tcpOffset + offsetof(tcphdr, th_sum), &tcp->th_sum,
+					sizeof(tcp->th_sum));
+			}
+		}
+		if (status == B_OK) {
+			segment->buffer_flags |= NET_BUFFER_L3_CHECKSUM_VALID
+				| NET_BUFFER_L4_CHECKSUM_VALID;
+			status = send(cookie, segment);
+		}
+		if (status != B_OK) {
+			gNetBufferModule.free(segment);
+			break;
+		}
+
+		offset += length;
+	}
+
+	if (status != B_OK) {
+		// give the caller back what it handed in
+		gNetBufferModule.merge(buffer, headerTemplate, false);
+		return status;
+	}
+
+	gNetBufferModule.free(headerTemplate);
+	gNetBufferModule.free(buffer);
+	return B_OK;
+}
+
+
+//	#pragma mark - TCPSegmentCoalescer
+
+
+TCPSegmentCoalescer::TCPSegmentCoalescer(segment_deliver_func deliver,
+	void* cookie)
+	:
+	fDeliver(deliver),
+	fCookie(cookie),
+	fBuffer(NULL)
+{
+}
+
+
+TCPSegmentCoalescer::~TCPSegmentCoalescer()
+{
+	Flush();
+}
+
+
+/*!	Adds the received \a buffer, and takes over ownership of it. It is either
+	merged with the previous segment, held back for the next one, or delivered
+	right away.
+*/
+void
+TCPSegmentCoalescer::Add(net_buffer* buffer)
+{
+	uint8 headers[MAX_TCP_HEADERS_LENGTH];
+	tcp_headers info;
+	if (!_IsCandidate(buffer, headers, info)) {
+		Flush();
+		fDeliver(fCookie, buffer);
+		return;
+	}
+
+	bool flush;
+	if (fBuffer != NULL && _Merge(buffer, headers, info, flush)) {
+		if (flush)
+			Flush();
+		return;
+	}
+
+	Flush();
+	_Start(buffer, headers, info);
+}
+
+
+/*!	Delivers the segment that is currently being held back, if any. */
+void
+TCPSegmentCoalescer::Flush()
+{
+	if (fBuffer == NULL)
+		return;
+
+	net_buffer* buffer = fBuffer;
+	fBuffer = NULL;
+
+	if (fSegmentCount > 1) {
+		set_ip_length(fHeaders, fInfo, buffer->size);
+		gNetBufferModule.write(buffer, 0, fHeaders, fInfo.length);
+
+		TRACE("coalesced %" B_PRIu32 " segments to %" B_PRIu32 " bytes\n",
+			fSegmentCount, buffer->size);
+	}
+
+	fDeliver(fCookie, buffer);
+}
+
+
+/*!	Checks whether \a buffer contains a TCP segment with data that could be
+	merged with others, and verifies its checksums, if that has not been done
+	already. After merging, there would be no way to do so anymore.
+*/
+bool
+TCPSegmentCoalescer::_IsCandidate(net_buffer* buffer, uint8* headers,
+	tcp_headers& info)
+{
+	if (buffer->interface_address == NULL
+		&& buffer->type != B_NET_FRAME_TYPE_IPV4
+		&& buffer->type != B_NET_FRAME_TYPE_IPV6)
+		return false;
+
+	if (read_tcp_headers(buffer, 0, headers, info) != B_OK)
+		return false;
+
+	size_t packetLength;
+	if (info.family == AF_INET)
+		packetLength = ntohs(((struct ip*)headers)->ip_len);
+	else {
+		packetLength = ntohs(((ip6_hdr*)headers)->ip6_plen)
+			+ sizeof(ip6_hdr);
+	}
+	if (packetLength != buffer->size || packetLength <= info.length)
+		return false;
+
+	const tcphdr* tcp = (const tcphdr*)(headers + info.ip_length);
+	if ((tcp->th_flags & ~TCP_FLAG_PUSH) != TCP_FLAG_ACKNOWLEDGE)
+		return false;
+
+	if (info.family == AF_INET
+		&& (buffer->buffer_flags & NET_BUFFER_L3_CHECKSUM_VALID) == 0) {
+		if (checksum(headers, sizeof(struct ip)) != 0)
+			return false;
+		buffer->buffer_flags |= NET_BUFFER_L3_CHECKSUM_VALID;
+	}
+
+	if ((buffer->buffer_flags & NET_BUFFER_L4_CHECKSUM_VALID) == 0) {
+		if (tcp_checksum(buffer, info.ip_length,
+				buffer->size - info.ip_length, headers, info.family) != 0)
+			return false;
+		buffer->buffer_flags |= NET_BUFFER_L4_CHECKSUM_VALID;
+	}
+
+	return true;
+}
+
+
+bool
+TCPSegmentCoalescer::_Merge(net_buffer* buffer, const uint8* headers,
+	const tcp_headers& info, bool& _flush)
+{
+	if (info.family != fInfo.family || info.length != fInfo.length
+		|| buffer->interface_address != fBuffer->interface_address
+		|| buffer->type != fBuffer->type)
+		return false;
+
+	// Everything but the length, identification, and checksum of the IP
+	// header must match
+	if (info.family == AF_INET) {
+		if (memcmp(headers, fHeaders, 2) != 0
+			|| memcmp(headers + 6, fHeaders + 6, 4) != 0
+			|| memcmp(headers + 12, fHeaders + 12, 8) != 0)
+			return false;
+	} else {
+		if (memcmp(headers, fHeaders, 4) != 0
+			|| memcmp(headers + 6, fHeaders + 6, sizeof(ip6_hdr) - 6) != 0)
+			return false;
+	}
+
+	// The same goes for the TCP header, apart from the sequence number,
+	// flags, and checksum; the options must be identical as well
+	const uint8* tcp = headers + info.ip_length;
+	const uint8* first = fHeaders + fInfo.ip_length;
+	const size_t tcpLength = info.length - info.ip_length;
+	if (memcmp(tcp, first, 4) != 0
+		|| memcmp(tcp + 8, first + 8, 5) != 0
+		|| memcmp(tcp + 14, first + 14, 2) != 0
+		|| memcmp(tcp + 18, first + 18, tcpLength - 18) != 0)
+		return false;
+
+	const tcphdr* header = (const tcphdr*)tcp;
+	if (ntohl(header->th_seq) != fNextSequence)
+		return false;
+
+	uint32 payload = buffer->size - info.length;
+	if (payload > fSegmentSize || fBuffer->size + payload > kMaxPacketSize)
+		return false;
+
+	if (gNetBufferModule.remove_header(buffer, info.length) != B_OK
+		|| gNetBufferModule.merge(fBuffer, buffer, true) != B_OK) {
+		// The headers are gone already; drop the segment, it will be
+		// retransmitted
+		gNetBufferModule.free(buffer);
+		_flush = true;
+		return true;
+	}
+
+	fNextSequence += payload;
+	fSegmentCount++;
+
+	// A pushed segment, or one that is shorter than the previous ones ends
+	// the run
+	_flush = (header->th_flags & TCP_FLAG_PUSH) != 0 || payload < fSegmentSize;
+	if ((header->th_flags & TCP_FLAG_PUSH) != 0)
+		((tcphdr*)(fHeaders + fInfo.ip_length))->th_flags |= TCP_FLAG_PUSH;
+
+	return true;
+}
+
+
+void
+TCPSegmentCoalescer::_Start(net_buffer* buffer, const uint8* headers,
+	const tcp_headers& info)
+{
+	const tcphdr* tcp = (const tcphdr*)(headers + info.ip_length);
+	if ((tcp->th_flags & TCP_FLAG_PUSH) != 0) {
+		// nothing can follow this segment
+		fDeliver(fCookie, buffer);
+		return;
+	}
+
+	fBuffer = buffer;
+	memcpy(fHeaders, headers, info.length);
+	fInfo = info;
+	fSegmentSize = buffer->size - info.length;
+	fNextSequence = ntohl(tcp->th_seq) + fSegmentSize;
+	fSegmentCount = 1;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef OFFLOAD_H
+#define OFFLOAD_H
+
+
+#include <net_buffer.h>
+#include <net_device.h>
+
+
+// The largest IP (without options) and TCP headers
+#define MAX_TCP_HEADERS_LENGTH	(40 + 60)
+
+
+struct tcp_headers {
+	int			family;
+	size_t		ip_length;
+	size_t		length;
+		// of both the IP and the TCP header
+};
+
+
+typedef status_t (*segment_send_func)(void* cookie, net_buffer* segment);
+typedef void (*segment_deliver_func)(void* cookie, net_buffer* buffer);
+
+
+/*!	Merges consecutive in-order TCP segments of the same connection into a
+	single buffer, before they are passed to the protocols. Only directly
+	consecutive segments are merged; anything that does not fit ends the
+	current run, so that the order of the buffers is always preserved.
+*/
+class TCPSegmentCoalescer {
+public:
+								TCPSegmentCoalescer(
+									segment_deliver_func deliver,
+									void* cookie);
+								~TCPSegmentCoalescer();
+
+			void				Add(net_buffer* buffer);
+			void				Flush();
+
+private:
+			bool				_IsCandidate(net_buffer* buffer,
+									uint8* headers, tcp_headers& info);
+			bool				_Merge(net_buffer* buffer,
+									const uint8* headers,
+									const tcp_headers& info,
+									bool& _flush);
+			void				_Start(net_buffer* buffer,
+									const uint8* headers,
+									const tcp_headers& info);
+
+private:
+			segment_deliver_func fDeliver;
+			void*				fCookie;
+
+			net_buffer*			fBuffer;
+			uint8				fHeaders[MAX_TCP_HEADERS_LENGTH];
+			tcp_headers			fInfo;
+			uint32				fNextSequence;
+			uint32				fSegmentSize;
+			uint32				fSegmentCount;
+};
+
+
+bool device_can_segment(net_device* device, net_buffer* buffer);
+status_t segment_tcp_buffer(net_buffer* buffer, size_t linkHeaderLength,
+	segment_send_func send, void* cookie);
+
+
+#endif	// OFFLOAD_H
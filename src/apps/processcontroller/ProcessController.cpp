@@ -468,8 +468,11 @@ ProcessController::MessageReceived(BMessage *message)
 			BMenuItem* source;
 			if (message->FindPointer("source", (void**)&source) != B_OK)
 				break;
+			int32 mode;
+			if (message->FindInt32("mode", &mode) != B_OK)
+				break;
 			if (!source->IsMarked())
-				set_scheduler_mode(SCHEDULER_MODE_POWER_SAVING);
+				set_scheduler_mode(mode);
 			else
 				set_scheduler_mode(SCHEDULER_MODE_LOW_LATENCY);
 			Preferences preferences(kPreferencesFileName);
@@ -850,11 +853,20 @@ thread_popup(void *arg)
 		currentMode = get_scheduler_mode();
 	}
 	BMessage* msg = new BMessage('Schd');
+	msg->AddInt32("mode", SCHEDULER_MODE_POWER_SAVING);
 	item = new BMenuItem(B_TRANSLATE("Power saving"), msg);
 	if ((uint32)currentMode == SCHEDULER_MODE_POWER_SAVING)
 		item->SetMarked(true);
 	item->SetTarget(gPCView);
 	addtopbottom(item);
+
+	msg = new BMessage('Schd');
+	msg->AddInt32("mode", SCHEDULER_MODE_THROUGHPUT);
+	item = new BMenuItem(B_TRANSLATE("Throughput"), msg);
+	if ((uint32)currentMode == SCHEDULER_MODE_THROUGHPUT)
+		item->SetMarked(true);
+	item->SetTarget(gPCView);
+	addtopbottom(item);
 	addtopbottom(new BSeparatorItem());
 
 	if (!be_roster->IsRunning(kTrackerSig)) {
@@ -38,6 +38,7 @@ static const FlagsTypeHandler::FlagInfo kRecvFlagInfos[] = {
 	FLAG_INFO_ENTRY(MSG_MCAST),
 	FLAG_INFO_ENTRY(MSG_EOF),
 	FLAG_INFO_ENTRY(MSG_NOSIGNAL),
+	FLAG_INFO_ENTRY(MSG_ZEROCOPY),
 	{ 0, NULL }
 };
 
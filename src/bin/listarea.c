@@ -16,6 +16,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <syscalls.h>
+#include <vm_defs.h>
+
 
 static void list_areas_for_id(team_id team);
 static void list_areas_for_name(const char *teamName);
@@ -34,8 +37,16 @@ show_memory_totals(void)
 		used = info.used_pages * 4;
 	}
 
+	large_page_info largePages;
+
 	printf("memory: total: %4" B_PRId32 "KB, used: %4" B_PRId32 "KB, left: %4"
 		B_PRId32 "KB\n", max, used, max - used);
+
+	if (_kern_get_large_page_info(-1, &largePages) == B_OK
+		&& largePages.page_size != 0) {
+		printf("large pages: %" B_PRIuSIZE " (%" B_PRIuSIZE "KB each)\n",
+			largePages.count, largePages.page_size / 1024);
+	}
 }
 
 
@@ -54,13 +65,17 @@ list_areas_for_id(team_id id)
 
 	printf("\n%s (team %" B_PRId32 ")\n", teamInfo.args, id);
 	printf("   ID                             name   address     size   alloc."
-		" #-cow  #-in #-out\n");
+		" #-cow  #-in #-out #-large\n");
 	printf("------------------------------------------------------------------"
-		"------------------\n");
+		"--------------------------\n");
 
 	while (get_next_area_info(id, &cookie, &areaInfo) == B_OK) {
+		large_page_info largePages;
+		if (_kern_get_large_page_info(areaInfo.area, &largePages) != B_OK)
+			largePages.count = 0;
+
 		printf("%5" B_PRId32 " %32s  %p %8" B_PRIxSIZE " %8" B_PRIx32 " %5"
-			B_PRId32 " %5" B_PRId32 " %5" B_PRId32 "\n",
+			B_PRId32 " %5" B_PRId32 " %5" B_PRId32 " %7" B_PRIuSIZE "\n",
 			areaInfo.area,
 			areaInfo.name,
 			areaInfo.address,
@@ -68,7 +83,8 @@ list_areas_for_id(team_id id)
 			areaInfo.ram_size,
 			areaInfo.copy_count,
 			areaInfo.in_count,
-			areaInfo.out_count);
+			areaInfo.out_count,
+			largePages.count);
 	}
 }
 
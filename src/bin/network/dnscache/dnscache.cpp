@@ -0,0 +1,127 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AutoDeleterOS.h>
+#include <OS.h>
+
+#include "Definitions.h"
+
+
+extern const char* __progname;
+const char* kProgramName = __progname;
+
+
+static void
+usage(int status)
+{
+	printf("usage: %s [--flush]\n\n"
+		"Shows the statistics of the cache of the DNS resolver server, or\n"
+		"empties it.\n", kProgramName);
+
+	exit(status);
+}
+
+
+static status_t
+send_request(int32 code, void* reply, size_t replySize)
+{
+	port_id requestPort = find_port(kPortNameReq);
+	if (requestPort < B_OK)
+		return requestPort;
+
+	PortDeleter replyPort(create_port(1, "dnscache reply"));
+	if (!replyPort.IsSet())
+		return replyPort.Get();
+
+	request_header header;
+	header.reply_port = replyPort.Get();
+
+	status_t status = write_port(requestPort, code, &header, sizeof(header));
+	if (status != B_OK)
+		return status;
+
+	char buffer[256];
+	int32 replyCode;
+	ssize_t bytesRead = read_port_etc(replyPort.Get(), &replyCode, buffer,
+		sizeof(buffer), B_RELATIVE_TIMEOUT, 5000000);
+	if (bytesRead < 0)
+		return bytesRead;
+
+	if (replyCode == MsgError) {
+		if (bytesRead < (ssize_t)sizeof(status_t))
+			return B_BAD_DATA;
+		return *(status_t*)buffer;
+	}
+
+	if (replyCode != MsgReply || (size_t)bytesRead < replySize)
+		return B_BAD_DATA;
+
+	memcpy(reply, buffer, replySize);
+	return B_OK;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	bool flush = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--flush") || !strcmp(argv[i], "-f"))
+			flush = true;
+		else if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h"))
+			usage(0);
+		else
+			usage(1);
+	}
+
+	if (flush) {
+		status_t status = send_request(MsgFlushCache, NULL, 0);
+		if (status != B_OK) {
+			fprintf(stderr, "%s: Could not flush the cache: %s\n",
+				kProgramName, strerror(status));
+			return 1;
+		}
+		return 0;
+	}
+
+	resolver_statistics statistics;
+	status_t status = send_request(MsgGetStatistics, &statistics,
+		sizeof(statistics));
+	if (status != B_OK) {
+		if (status == B_NAME_NOT_FOUND) {
+			fprintf(stderr, "%s: The DNS resolver server is not running.\n",
+				kProgramName);
+		} else {
+			fprintf(stderr, "%s: Could not get the statistics: %s\n",
+				kProgramName, strerror(status));
+		}
+		return 1;
+	}
+
+	printf("entries:        %" B_PRIu32 "\n", statistics.entries);
+	printf("pending:        %" B_PRIu32 "\n", statistics.pending);
+	printf("lookups:        %" B_PRIu64 "\n", statistics.lookups);
+	printf("hits:           %" B_PRIu64 "\n", statistics.hits);
+	printf("negative hits:  %" B_PRIu64 "\n", statistics.negative_hits);
+	printf("misses:         %" B_PRIu64 "\n", statistics.misses);
+	printf("coalesced:      %" B_PRIu64 "\n", statistics.coalesced);
+	printf("evicted:        %" B_PRIu64 "\n", statistics.evicted);
+	printf("rejected:       %" B_PRIu64 "\n", statistics.rejected);
+
+	if (statistics.lookups > 0) {
+		uint64 answered = statistics.hits + statistics.negative_hits
+			+ statistics.coalesced;
+		printf("hit rate:       %.1f%%\n",
+			100.0 * answered / statistics.lookups);
+	}
+
+	return 0;
+}
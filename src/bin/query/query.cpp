@@ -14,6 +14,7 @@
  */
 
 
+#include <Directory.h>
 #include <Entry.h>
 #include <LocaleRoster.h>
 #include <Path.h>
@@ -22,11 +23,15 @@
 #include <Volume.h>
 #include <VolumeRoster.h>
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
 
+#include "bfs_control.h"
 #include "FilteredQuery.h"
 
 extern const char *__progname;
@@ -63,6 +68,7 @@ FilterByFolder(const entry_ref *ref, void *arg)
 // Option variables.
 static bool sAllVolumes = false;		// Query all volumes?
 static bool sEscapeMetaChars = true;	// Escape metacharacters?
+static bool sExplain = false;			// Only explain the query plan?
 static bool sFilesOnly = false;			// Show only files?
 static bool sLocalizedAppNames = false;	// match localized names
 static bool sSubFolders = false;		// Include sub-folders?
@@ -71,9 +77,10 @@ static bool sSubFolders = false;		// Include sub-folders?
 void
 usage(void)
 {
-	printf("usage: %s [ -ef ] [ -p <path-to-search> ] [ -s ] [ -a || -v <path-to-volume> ] expression\n"
+	printf("usage: %s [ -efx ] [ -p <path-to-search> ] [ -s ] [ -a || -v <path-to-volume> ] expression\n"
 		"  -e\t\tdon't escape meta-characters\n"
 		"  -f\t\tshow only files (ie. no directories or symbolic links)\n"
+		"  -x\t\texplain how the query would be evaluated (BFS only)\n"
 		"  -l\t\tmatch expression with localized application names\n"
 		"  -p <path>\tsearch only in the given path.\n"
 		"  -s\t\tinclude subfolders (only meaningful when used with \"-p\")\n"
@@ -86,9 +93,50 @@ usage(void)
 }
 
 
+void
+print_query_plan(BVolume &volume, const char *predicate)
+{
+	BDirectory root;
+	BEntry entry;
+	BPath path;
+	if (volume.GetRootDirectory(&root) != B_OK
+		|| root.GetEntry(&entry) != B_OK || entry.GetPath(&path) != B_OK) {
+		fprintf(stderr, "%s: could not get volume root\n", kProgramName);
+		return;
+	}
+
+	int fd = open(path.Path(), O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "%s: could not open %s: %s\n", kProgramName,
+			path.Path(), strerror(errno));
+		return;
+	}
+
+	char plan[16384];
+	explain_query explain;
+	explain.query = predicate;
+	explain.query_length = strlen(predicate);
+	explain.buffer = plan;
+	explain.buffer_size = sizeof(plan);
+
+	if (ioctl(fd, BFS_IOCTL_EXPLAIN_QUERY, &explain, sizeof(explain)) != 0) {
+		fprintf(stderr, "%s: could not explain query on %s: %s\n",
+			kProgramName, path.Path(), strerror(errno));
+	} else
+		printf("%s:\n%s", path.Path(), plan);
+
+	close(fd);
+}
+
+
 void
 perform_query(BVolume &volume, const char *predicate, const char *filterpath)
 {
+	if (sExplain) {
+		print_query_plan(volume, predicate);
+		return;
+	}
+
 	TFilteredQuery query;
 	query.SetVolume(&volume);
 
@@ -167,7 +215,7 @@ main(int argc, char **argv)
 
 	// Parse command-line arguments.
 	int opt;
-	while ((opt = getopt(argc, argv, "efsalv:p:")) != -1) {
+	while ((opt = getopt(argc, argv, "efxsalv:p:")) != -1) {
 		switch(opt) {
 			case 'e':
 				sEscapeMetaChars = false;
@@ -175,6 +223,9 @@ main(int argc, char **argv)
 			case 'f':
 				sFilesOnly = true;
 				break;
+			case 'x':
+				sExplain = true;
+				break;
 			case 's':
 				sSubFolders = true;
 				break;
@@ -0,0 +1,291 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <scheduler_defs.h>
+#include <syscalls.h>
+
+
+static struct option const kLongOptions[] = {
+	{"all", no_argument, 0, 'a'},
+	{"cpu", required_argument, 0, 'c'},
+	{"periodic", no_argument, 0, 'p'},
+	{"rate", required_argument, 0, 'r'},
+	{"help", no_argument, 0, 'h'},
+	{NULL}
+};
+
+static const char* const kBandNames[SCHEDULER_PRIORITY_BANDS] = {
+	"low",
+	"normal",
+	"display",
+	"urgent",
+	"real-time"
+};
+
+extern const char *__progname;
+static const char *kProgramName = __progname;
+
+
+void
+usage(int status)
+{
+	fprintf(stderr, "usage: %s [-a] [-c <cpu>] [-p] [-r <time>]\n"
+		"Shows the scheduler statistics of all CPUs since boot.\n"
+		" -a,--all\tAlso shows the wakeup latency and run queue depth\n"
+		"\t\thistograms, and the times per priority band.\n"
+		" -c,--cpu\tOnly shows the statistics of the given CPU.\n"
+		" -p,--periodic\tDumps changes periodically every second.\n"
+		" -r,--rate\tDumps changes periodically every <time> milli seconds.\n",
+		kProgramName);
+
+	exit(status);
+}
+
+
+static bool
+get_stats(int32 cpu, scheduler_cpu_stats& stats)
+{
+	status_t status = _kern_get_scheduler_cpu_stats(cpu, &stats,
+		sizeof(stats));
+	if (status != B_OK) {
+		fprintf(stderr, "%s: Could not get statistics of CPU %" B_PRId32
+			": %s\n", kProgramName, cpu, strerror(status));
+		return false;
+	}
+	return true;
+}
+
+
+/*!	Adds \a other to \a stats, or subtracts it, if \a factor is -1.
+	The maximum latency is not changed by subtracting.
+*/
+static void
+add_stats(scheduler_cpu_stats& stats, const scheduler_cpu_stats& other,
+	int64 factor = 1)
+{
+	stats.context_switches += factor * other.context_switches;
+	stats.migrations += factor * other.migrations;
+	stats.wakeups += factor * other.wakeups;
+	stats.total_wakeup_latency += factor * other.total_wakeup_latency;
+	if (factor > 0 && other.max_wakeup_latency > stats.max_wakeup_latency)
+		stats.max_wakeup_latency = other.max_wakeup_latency;
+
+	for (int32 i = 0; i < SCHEDULER_LATENCY_BUCKETS; i++)
+		stats.wakeup_latencies[i] += factor * other.wakeup_latencies[i];
+	for (int32 i = 0; i < SCHEDULER_QUEUE_DEPTH_BUCKETS; i++)
+		stats.queue_depths[i] += factor * other.queue_depths[i];
+
+	for (int32 i = 0; i < SCHEDULER_PRIORITY_BANDS; i++) {
+		stats.dispatches[i] += factor * other.dispatches[i];
+		stats.queue_time[i] += factor * other.queue_time[i];
+		stats.run_time[i] += factor * other.run_time[i];
+	}
+}
+
+
+/*!	Returns the upper bound of the histogram bucket that contains the given
+	\a fraction of all wakeups.
+*/
+static bigtime_t
+latency_percentile(const scheduler_cpu_stats& stats, double fraction)
+{
+	uint64 wanted = (uint64)(stats.wakeups * fraction);
+	uint64 count = 0;
+	for (int32 i = 0; i < SCHEDULER_LATENCY_BUCKETS - 1; i++) {
+		count += stats.wakeup_latencies[i];
+		if (count > wanted)
+			return (bigtime_t)1 << i;
+	}
+
+	return stats.max_wakeup_latency;
+}
+
+
+static void
+print_header()
+{
+	puts(" cpu      switches    migrations       wakeups   avg lat   p99 lat"
+		"   max lat");
+}
+
+
+static void
+print_line(const char* name, const scheduler_cpu_stats& stats)
+{
+	bigtime_t average = stats.wakeups > 0
+		? stats.total_wakeup_latency / stats.wakeups : 0;
+
+	printf("%4s  %12" B_PRIu64 "  %12" B_PRIu64 "  %12" B_PRIu64 "  %8"
+		B_PRId64 "  %8" B_PRId64 "  %8" B_PRId64 "\n", name,
+		stats.context_switches, stats.migrations, stats.wakeups, average,
+		latency_percentile(stats, 0.99), stats.max_wakeup_latency);
+}
+
+
+static void
+print_details(const scheduler_cpu_stats& stats)
+{
+	puts("\nwakeup latency       wakeups");
+	for (int32 i = 0; i < SCHEDULER_LATENCY_BUCKETS; i++) {
+		if (stats.wakeup_latencies[i] == 0)
+			continue;
+
+		if (i == SCHEDULER_LATENCY_BUCKETS - 1) {
+			printf("  >= %8" B_PRId64 " us", (bigtime_t)1 << (i - 1));
+		} else
+			printf("   < %8" B_PRId64 " us", (bigtime_t)1 << i);
+		printf("  %12" B_PRIu64 "\n", stats.wakeup_latencies[i]);
+	}
+
+	puts("\nrun queue depth   dispatches");
+	for (int32 i = 0; i < SCHEDULER_QUEUE_DEPTH_BUCKETS; i++) {
+		if (i == 0)
+			printf("%15s", "0");
+		else if (i == SCHEDULER_QUEUE_DEPTH_BUCKETS - 1)
+			printf("%12s%3d", ">= ", 1 << (i - 1));
+		else
+			printf("%8d - %4d", 1 << (i - 1), (1 << i) - 1);
+		printf("  %11" B_PRIu64 "\n", stats.queue_depths[i]);
+	}
+
+	puts("\npriority band   dispatches  avg queue time      run time");
+	for (int32 i = 0; i < SCHEDULER_PRIORITY_BANDS; i++) {
+		bigtime_t average = stats.dispatches[i] > 0
+			? stats.queue_time[i] / stats.dispatches[i] : 0;
+		printf("%13s  %11" B_PRIu64 "  %11" B_PRId64 " us  %9" B_PRId64
+			" ms\n", kBandNames[i], stats.dispatches[i], average,
+			stats.run_time[i] / 1000);
+	}
+}
+
+
+static bool
+get_all_stats(scheduler_cpu_stats* stats, int32 first, int32 count)
+{
+	for (int32 i = 0; i < count; i++) {
+		if (!get_stats(first + i, stats[i]))
+			return false;
+	}
+	return true;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	bool all = false;
+	bool periodically = false;
+	bigtime_t rate = 1000000LL;
+	int32 onlyCPU = -1;
+
+	int c;
+	while ((c = getopt_long(argc, argv, "ac:pr:h", kLongOptions, NULL))
+			!= -1) {
+		switch (c) {
+			case 0:
+				break;
+			case 'a':
+				all = true;
+				break;
+			case 'c':
+				onlyCPU = atoi(optarg);
+				break;
+			case 'p':
+				periodically = true;
+				break;
+			case 'r':
+				rate = atoi(optarg) * 1000LL;
+				if (rate <= 0) {
+					fprintf(stderr, "%s: Invalid rate: %s\n",
+						kProgramName, optarg);
+					return 1;
+				}
+				periodically = true;
+				break;
+			case 'h':
+				usage(0);
+				break;
+			default:
+				usage(1);
+				break;
+		}
+	}
+
+	system_info info;
+	get_system_info(&info);
+
+	int32 first = 0;
+	int32 count = info.cpu_count;
+	if (onlyCPU >= 0) {
+		if (onlyCPU >= (int32)info.cpu_count) {
+			fprintf(stderr, "%s: Invalid CPU: %" B_PRId32 "\n", kProgramName,
+				onlyCPU);
+			return 1;
+		}
+		first = onlyCPU;
+		count = 1;
+	}
+
+	scheduler_cpu_stats* stats = (scheduler_cpu_stats*)malloc(
+		sizeof(scheduler_cpu_stats) * count * 2);
+	if (stats == NULL) {
+		fprintf(stderr, "%s: Out of memory\n", kProgramName);
+		return 1;
+	}
+	scheduler_cpu_stats* lastStats = stats + count;
+
+	if (!get_all_stats(stats, first, count))
+		return 1;
+
+	char name[16];
+	scheduler_cpu_stats total;
+	memset(&total, 0, sizeof(total));
+
+	print_header();
+	for (int32 i = 0; i < count; i++) {
+		snprintf(name, sizeof(name), "%" B_PRId32, stats[i].cpu);
+		print_line(name, stats[i]);
+		add_stats(total, stats[i]);
+	}
+	if (count > 1) {
+		strlcpy(name, "all", sizeof(name));
+		print_line(name, total);
+	}
+
+	if (all)
+		print_details(total);
+
+	while (periodically) {
+		memcpy(lastStats, stats, sizeof(scheduler_cpu_stats) * count);
+		snooze(rate);
+
+		if (!get_all_stats(stats, first, count))
+			return 1;
+
+		// the maximum latency is still the one since boot
+		memset(&total, 0, sizeof(total));
+		for (int32 i = 0; i < count; i++) {
+			add_stats(total, stats[i]);
+			add_stats(total, lastStats[i], -1);
+		}
+
+		puts("");
+		print_header();
+		print_line(name, total);
+		if (all)
+			print_details(total);
+	}
+
+	free(stats);
+	return 0;
+}
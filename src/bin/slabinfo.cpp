@@ -0,0 +1,189 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <syscalls.h>
+#include <vm_defs.h>
+
+
+enum sort_order {
+	SORT_BY_USAGE,
+	SORT_BY_LOCK_WAITS,
+	SORT_BY_MISSES,
+	SORT_BY_NAME
+};
+
+
+static struct option const kLongOptions[] = {
+	{"sort", required_argument, 0, 's'},
+	{"depot", no_argument, 0, 'd'},
+	{"help", no_argument, 0, 'h'},
+	{NULL}
+};
+
+extern const char *__progname;
+static const char *kProgramName = __progname;
+
+
+void
+usage(int status)
+{
+	fprintf(stderr, "usage: %s [-d] [-s <order>] [<name>]\n"
+		"Lists the kernel's object caches, or those whose name contains "
+		"<name>.\n"
+		" -d,--depot\tOnly list caches that have an object depot.\n"
+		" -s,--sort\tSorts by \"usage\" (default), \"waits\", \"misses\", or\n"
+		"\t\t\"name\".\n", kProgramName);
+
+	exit(status);
+}
+
+
+static uint64
+lock_waits(const object_cache_info& info)
+{
+	return info.lock_waits + info.depot_lock_waits;
+}
+
+
+static bool
+compare_usage(const object_cache_info& a, const object_cache_info& b)
+{
+	return a.usage > b.usage;
+}
+
+
+static bool
+compare_lock_waits(const object_cache_info& a, const object_cache_info& b)
+{
+	return lock_waits(a) > lock_waits(b);
+}
+
+
+static bool
+compare_misses(const object_cache_info& a, const object_cache_info& b)
+{
+	return a.depot_misses > b.depot_misses;
+}
+
+
+static bool
+compare_name(const object_cache_info& a, const object_cache_info& b)
+{
+	return strcmp(a.name, b.name) < 0;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	sort_order order = SORT_BY_USAGE;
+	bool depotOnly = false;
+
+	int c;
+	while ((c = getopt_long(argc, argv, "ds:h", kLongOptions, NULL)) != -1) {
+		switch (c) {
+			case 0:
+				break;
+			case 'd':
+				depotOnly = true;
+				break;
+			case 's':
+				if (!strcmp(optarg, "usage"))
+					order = SORT_BY_USAGE;
+				else if (!strcmp(optarg, "waits"))
+					order = SORT_BY_LOCK_WAITS;
+				else if (!strcmp(optarg, "misses"))
+					order = SORT_BY_MISSES;
+				else if (!strcmp(optarg, "name"))
+					order = SORT_BY_NAME;
+				else {
+					fprintf(stderr, "%s: Invalid sort order: %s\n",
+						kProgramName, optarg);
+					usage(1);
+				}
+				break;
+			case 'h':
+				usage(0);
+				break;
+			default:
+				usage(1);
+				break;
+		}
+	}
+
+	const char* filter = optind < argc ? argv[optind] : NULL;
+
+	std::vector<object_cache_info> caches;
+
+	int32 cookie = 0;
+	object_cache_info info;
+	status_t status;
+	while ((status = _kern_get_next_object_cache_info(&cookie, &info))
+			== B_OK) {
+		if (depotOnly && info.magazine_capacity == 0)
+			continue;
+		if (filter != NULL && strstr(info.name, filter) == NULL)
+			continue;
+
+		caches.push_back(info);
+	}
+
+	if (status != B_ENTRY_NOT_FOUND) {
+		fprintf(stderr, "%s: Could not get object cache info: %s\n",
+			kProgramName, strerror(status));
+		return 1;
+	}
+
+	switch (order) {
+		case SORT_BY_USAGE:
+			std::stable_sort(caches.begin(), caches.end(), &compare_usage);
+			break;
+		case SORT_BY_LOCK_WAITS:
+			std::stable_sort(caches.begin(), caches.end(),
+				&compare_lock_waits);
+			break;
+		case SORT_BY_MISSES:
+			std::stable_sort(caches.begin(), caches.end(), &compare_misses);
+			break;
+		case SORT_BY_NAME:
+			std::stable_sort(caches.begin(), caches.end(), &compare_name);
+			break;
+	}
+
+	printf("%-26s %7s %8s %8s %9s %7s %8s  %4s %6s %9s %8s\n", "name",
+		"objsize", "used", "total", "usage KB", "slabs", "waits", "mag",
+		"hit %", "misses", "d-waits");
+
+	for (size_t i = 0; i < caches.size(); i++) {
+		const object_cache_info& cache = caches[i];
+
+		printf("%-26.26s %7" B_PRIu64 " %8" B_PRIu64 " %8" B_PRIu64 " %9"
+			B_PRIu64 " %7" B_PRIu64 " %8" B_PRIu64, cache.name,
+			cache.object_size, cache.used_objects, cache.total_objects,
+			cache.usage / 1024, cache.slab_allocations, cache.lock_waits);
+
+		if (cache.magazine_capacity == 0) {
+			printf("  %4s %6s %9s %8s\n", "-", "-", "-", "-");
+			continue;
+		}
+
+		uint64 operations = cache.depot_hits + cache.depot_misses;
+		printf("  %4" B_PRIu32 " %6.1f %9" B_PRIu64 " %8" B_PRIu64 "\n",
+			cache.magazine_capacity,
+			operations > 0 ? 100.0 * cache.depot_hits / operations : 0.0,
+			cache.depot_misses, cache.depot_lock_waits);
+	}
+
+	return 0;
+}
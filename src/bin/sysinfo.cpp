@@ -13,6 +13,8 @@
 #include <string.h>
 
 #include <cpu_type.h>
+#include <syscalls.h>
+#include <vm_defs.h>
 
 
 // TODO: -disable_cpu_sn option is not yet implemented
@@ -743,6 +745,30 @@ dump_mem(system_info *info)
 		B_PAGE_SIZE * (uint64)info->max_pages);
 	printf("                           (cached   %10" B_PRIu64 ")\n",
 		B_PAGE_SIZE * (uint64)info->cached_pages);
+
+	memory_node_info node;
+	if (_kern_get_memory_node_info(0, &node) != B_OK || node.node_count < 2)
+		return;
+
+	for (uint32 i = 0; i < node.node_count; i++) {
+		if (_kern_get_memory_node_info(i, &node) != B_OK)
+			break;
+
+		printf("           node %-2" B_PRIu32 " %10" B_PRIu64
+			" bytes free  (max %10" B_PRIu64 "), CPUs", node.node,
+			B_PAGE_SIZE * node.free_pages, B_PAGE_SIZE * node.total_pages);
+		for (uint32 cpu = 0; cpu < B_COUNT_OF(node.cpus) * 64; cpu++) {
+			if ((node.cpus[cpu / 64] & (1ULL << (cpu % 64))) != 0)
+				printf(" %" B_PRIu32, cpu);
+		}
+
+		printf(", distances");
+		for (uint32 j = 0; j < node.node_count && j < B_COUNT_OF(node.distance);
+				j++) {
+			printf(" %u", node.distance[j]);
+		}
+		putchar('\n');
+	}
 }
 
 
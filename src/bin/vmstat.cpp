@@ -9,7 +9,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <syscalls.h>
 #include <system_info.h>
+#include <vm_defs.h>
 
 
 static struct option const kLongOptions[] = {
@@ -85,6 +87,46 @@ main(int argc, char** argv)
 		info.free_swap_pages * B_PAGE_SIZE);
 	printf("page faults:\t\t%" B_PRIu32 "\n", info.page_faults);
 
+	large_page_info largePages;
+	if (_kern_get_large_page_info(-1, &largePages) == B_OK
+		&& largePages.page_size != 0) {
+		printf("large pages:\t\t%" B_PRIuSIZE " (%" B_PRIuSIZE " bytes each)\n",
+			largePages.count, largePages.page_size);
+	}
+
+	compressed_swap_info compressed;
+	if (_kern_get_compressed_swap_info(&compressed) == B_OK
+		&& compressed.max_size != 0) {
+		printf("compressed swap:\t%" B_PRIu64 " of %" B_PRIu64 "\n",
+			compressed.used_size, compressed.max_size);
+		printf("compressed pages:\t%" B_PRIu64 " (ratio %.2f)\n",
+			compressed.stored_pages, compressed.used_size > 0
+				? (double)compressed.stored_pages * B_PAGE_SIZE
+					/ compressed.used_size : 0.0);
+		printf("compressed stores:\t%" B_PRIu64 " (%" B_PRIu64 " rejected, %"
+			B_PRIu64 " demoted)\n", compressed.stores, compressed.rejected,
+			compressed.demotions);
+		printf("compressed hits:\t%" B_PRIu64 " (%" B_PRIu64 " misses)\n",
+			compressed.hits, compressed.misses);
+	}
+
+	memory_node_info node;
+	if (_kern_get_memory_node_info(0, &node) == B_OK && node.node_count > 1) {
+		puts("\nnode  cpus  total memory   free memory  local allocs"
+			"  remote allocs");
+
+		for (uint32 i = 0; i < node.node_count; i++) {
+			if (_kern_get_memory_node_info(i, &node) != B_OK)
+				break;
+
+			printf("%4" B_PRIu32 "  %4" B_PRIu32 "  %12" B_PRIu64 "  %12"
+				B_PRIu64 "  %12" B_PRIu64 "  %13" B_PRIu64 "\n", node.node,
+				node.cpu_count, node.total_pages * B_PAGE_SIZE,
+				node.free_pages * B_PAGE_SIZE, node.local_allocations,
+				node.remote_allocations);
+		}
+	}
+
 	if (periodically) {
 		puts("\npage faults  used memory    used swap  block cache");
 		system_info lastInfo = info;
@@ -124,6 +124,7 @@ SettingsWindow::SettingsWindow()
 	fSwapEnabledCheckBox(NULL),
 	fSwapAutomaticCheckBox(NULL),
 	fSizeSlider(NULL),
+	fCompressedSizeSlider(NULL),
 	fDefaultsButton(NULL),
 	fRevertButton(NULL),
 	fWarningStringView(NULL),
@@ -198,6 +199,20 @@ SettingsWindow::SettingsWindow()
 	fSizeSlider->SetViewColor(255, 0, 255);
 	fSizeSlider->SetExplicitAlignment(align);
 
+	// Swapped out pages may be kept compressed in up to half of the memory
+	system_info systemInfo;
+	get_system_info(&systemInfo);
+	off_t maxCompressedSize = (off_t)systemInfo.max_pages * B_PAGE_SIZE / 2;
+	char sizeStr[16];
+
+	fCompressedSizeSlider = new SizeSlider("compressed size slider",
+		B_TRANSLATE("Compressed memory size:"),
+		new BMessage(kMsgSliderUpdate), 0, maxCompressedSize / kMegaByte,
+		B_WILL_DRAW | B_FRAME_EVENTS);
+	fCompressedSizeSlider->SetLimitLabels(B_TRANSLATE("Off"),
+		string_for_size(maxCompressedSize, sizeStr, sizeof(sizeStr)));
+	fCompressedSizeSlider->SetExplicitAlignment(align);
+
 	fWarningStringView = new BStringView("warning",
 		B_TRANSLATE("Changes will take effect upon reboot."));
 
@@ -210,6 +225,7 @@ SettingsWindow::SettingsWindow()
 		.Add(fSwapAutomaticCheckBox)
 		.Add(fVolumeMenuField)
 		.Add(fSizeSlider)
+		.Add(fCompressedSizeSlider)
 		.Add(fWarningStringView)
 		.View());
 
@@ -419,6 +435,8 @@ SettingsWindow::_RecordChoices()
 	fSettings.SetSwapAutomatic(fSwapAutomaticCheckBox->Value());
 	fSettings.SetSwapEnabled(fSwapEnabledCheckBox->Value());
 	fSettings.SetSwapSize((off_t)fSizeSlider->Value() * kMegaByte);
+	fSettings.SetCompressedSwapSize(
+		(off_t)fCompressedSizeSlider->Value() * kMegaByte);
 	fSettings.SetSwapVolume(((VolumeMenuItem*)fVolumeMenuField
 		->Menu()->FindMarked())->Volume().Device());
 }
@@ -463,6 +481,9 @@ SettingsWindow::_Update()
 	} else
 		fSizeSlider->SetEnabled(false);
 
+	fCompressedSizeSlider->SetValue(
+		fSettings.CompressedSwapSize() / kMegaByte);
+
 	bool revertable = fSettings.IsRevertable();
 	if (revertable)
 		fWarningStringView->Show();
@@ -481,6 +502,9 @@ SettingsWindow::_Update()
 		&& !fSwapAutomaticCheckBox->Value());
 	fVolumeMenuField->SetEnabled(fSettings.SwapEnabled()
 		&& !fSwapAutomaticCheckBox->Value());
+
+	// The compressed store sits in front of the swap file
+	fCompressedSizeSlider->SetEnabled(fSettings.SwapEnabled());
 }
 
 
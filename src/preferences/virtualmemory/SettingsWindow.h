@@ -77,6 +77,7 @@ private:
 			BCheckBox*		fSwapEnabledCheckBox;
 			BCheckBox*		fSwapAutomaticCheckBox;
 			BSlider*		fSizeSlider;
+			BSlider*		fCompressedSizeSlider;
 			BButton*		fDefaultsButton;
 			BButton*		fRevertButton;
 			BStringView*	fWarningStringView;
@@ -0,0 +1,224 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "acpi.h"
+
+#include <boot/stage2.h>
+#include <boot/arch/x86/arch_numa.h>
+
+#include <string.h>
+
+
+//#define TRACE_NUMA
+#ifdef TRACE_NUMA
+#	define TRACE(x...) dprintf(x)
+#else
+#	define TRACE(x...) ;
+#endif
+
+
+static uint32 sProximityDomains[MAX_MEMORY_NODES];
+
+
+/*!	Maps the ACPI proximity domain \a domain to a node index, allocating a
+	new one for domains we haven't seen yet.
+	\return The node index, or -1 if there are too many nodes.
+*/
+static int32
+node_for_proximity_domain(uint32 domain)
+{
+	for (uint32 i = 0; i < gKernelArgs.num_memory_nodes; i++) {
+		if (sProximityDomains[i] == domain)
+			return i;
+	}
+
+	if (gKernelArgs.num_memory_nodes == MAX_MEMORY_NODES) {
+		dprintf("numa: too many proximity domains, ignoring %" B_PRIu32 "\n",
+			domain);
+		return -1;
+	}
+
+	sProximityDomains[gKernelArgs.num_memory_nodes] = domain;
+	return gKernelArgs.num_memory_nodes++;
+}
+
+
+static void
+set_cpu_node(uint32 apicID, uint32 domain)
+{
+	for (uint32 cpu = 0; cpu < gKernelArgs.num_cpus; cpu++) {
+		if (gKernelArgs.arch_args.cpu_apic_id[cpu] != apicID)
+			continue;
+
+		int32 node = node_for_proximity_domain(domain);
+		if (node >= 0)
+			gKernelArgs.cpu_memory_node[cpu] = node;
+
+		TRACE("numa: cpu %" B_PRIu32 " (APIC %" B_PRIu32 ") -> node %" B_PRId32
+			"\n", cpu, apicID, node);
+		return;
+	}
+}
+
+
+static void
+add_memory_range(uint64 base, uint64 length, uint32 domain)
+{
+	if (gKernelArgs.num_memory_node_ranges == MAX_MEMORY_NODE_RANGES) {
+		dprintf("numa: too many memory ranges, ignoring %#" B_PRIx64 " - %#"
+			B_PRIx64 "\n", base, base + length);
+		return;
+	}
+
+	int32 node = node_for_proximity_domain(domain);
+	if (node < 0)
+		return;
+
+	uint32 index = gKernelArgs.num_memory_node_ranges++;
+	gKernelArgs.memory_node_range[index].start = base;
+	gKernelArgs.memory_node_range[index].size = length;
+	gKernelArgs.memory_node_range_node[index] = node;
+
+	TRACE("numa: memory %#" B_PRIx64 " - %#" B_PRIx64 " -> node %" B_PRId32
+		"\n", base, base + length, node);
+}
+
+
+static void
+parse_srat(acpi_srat* srat)
+{
+	uint8* entry = (uint8*)srat + sizeof(acpi_srat);
+	uint8* end = (uint8*)srat + srat->header.length;
+
+	// Collect the memory ranges first, so that node 0 is the one containing
+	// the lowest memory, as long as the firmware lists it first.
+	for (int32 pass = 0; pass < 2; pass++) {
+		for (uint8* current = entry; current + sizeof(acpi_srat_entry) <= end;
+				current += ((acpi_srat_entry*)current)->length) {
+			acpi_srat_entry* header = (acpi_srat_entry*)current;
+			if (header->length == 0)
+				break;
+
+			switch (header->type) {
+				case ACPI_SRAT_MEMORY_AFFINITY:
+				{
+					acpi_srat_memory_affinity* memory
+						= (acpi_srat_memory_affinity*)current;
+					if (pass != 0
+						|| (memory->flags & ACPI_SRAT_AFFINITY_ENABLED) == 0
+						|| memory->address_length == 0) {
+						break;
+					}
+
+					add_memory_range(memory->base_address,
+						memory->address_length, memory->proximity_domain);
+					break;
+				}
+
+				case ACPI_SRAT_LOCAL_APIC_AFFINITY:
+				{
+					acpi_srat_local_apic_affinity* apic
+						= (acpi_srat_local_apic_affinity*)current;
+					if (pass != 1
+						|| (apic->flags & ACPI_SRAT_AFFINITY_ENABLED) == 0) {
+						break;
+					}
+
+					uint32 domain = apic->proximity_domain_low
+						| (uint32)apic->proximity_domain_high[0] << 8
+						| (uint32)apic->proximity_domain_high[1] << 16
+						| (uint32)apic->proximity_domain_high[2] << 24;
+					set_cpu_node(apic->apic_id, domain);
+					break;
+				}
+
+				case ACPI_SRAT_LOCAL_X2_APIC_AFFINITY:
+				{
+					acpi_srat_local_x2_apic_affinity* apic
+						= (acpi_srat_local_x2_apic_affinity*)current;
+					if (pass != 1
+						|| (apic->flags & ACPI_SRAT_AFFINITY_ENABLED) == 0) {
+						break;
+					}
+
+					set_cpu_node(apic->x2apic_id, apic->proximity_domain);
+					break;
+				}
+
+				default:
+					break;
+			}
+		}
+	}
+}
+
+
+static void
+parse_slit(acpi_slit* slit)
+{
+	const uint32 nodeCount = gKernelArgs.num_memory_nodes;
+
+	// default: local access costs 10, remote access twice as much
+	for (uint32 i = 0; i < nodeCount; i++) {
+		for (uint32 j = 0; j < nodeCount; j++)
+			gKernelArgs.memory_node_distance[i][j] = i == j ? 10 : 20;
+	}
+
+	if (slit == NULL)
+		return;
+
+	uint64 count = slit->locality_count;
+	if (sizeof(acpi_slit) + count * count > slit->header.length) {
+		dprintf("numa: invalid SLIT\n");
+		return;
+	}
+
+	// The SLIT is indexed by proximity domain, our nodes are not
+	for (uint32 i = 0; i < nodeCount; i++) {
+		for (uint32 j = 0; j < nodeCount; j++) {
+			uint64 from = sProximityDomains[i];
+			uint64 to = sProximityDomains[j];
+			if (from >= count || to >= count)
+				continue;
+
+			uint8 distance = slit->entries[from * count + to];
+			if (distance >= 10 && distance != 0xff)
+				gKernelArgs.memory_node_distance[i][j] = distance;
+		}
+	}
+}
+
+
+void
+numa_init(void)
+{
+	gKernelArgs.num_memory_nodes = 0;
+	gKernelArgs.num_memory_node_ranges = 0;
+	memset(gKernelArgs.cpu_memory_node, 0,
+		sizeof(gKernelArgs.cpu_memory_node));
+
+	acpi_srat* srat = (acpi_srat*)acpi_find_table(ACPI_SRAT_SIGNATURE);
+	if (srat == NULL) {
+		TRACE("numa: no SRAT found\n");
+		return;
+	}
+
+	parse_srat(srat);
+
+	if (gKernelArgs.num_memory_nodes < 2) {
+		// nothing to gain from knowing about a single node
+		gKernelArgs.num_memory_nodes = 0;
+		gKernelArgs.num_memory_node_ranges = 0;
+		memset(gKernelArgs.cpu_memory_node, 0,
+			sizeof(gKernelArgs.cpu_memory_node));
+		return;
+	}
+
+	parse_slit((acpi_slit*)acpi_find_table(ACPI_SLIT_SIGNATURE));
+
+	dprintf("numa: found %" B_PRIu32 " memory nodes\n",
+		gKernelArgs.num_memory_nodes);
+}
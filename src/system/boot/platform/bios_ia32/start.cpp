@@ -12,6 +12,7 @@
 
 #include <boot/arch/x86/arch_cpu.h>
 #include <boot/arch/x86/arch_hpet.h>
+#include <boot/arch/x86/arch_numa.h>
 #include <boot/platform.h>
 #include <boot/heap.h>
 #include <boot/stage2.h>
@@ -203,6 +204,7 @@ _start(void)
 	apm_init();
 	acpi_init();
 	smp_init();
+	numa_init();
 	hpet_init();
 	dump_multiboot_info();
 	main(&args);
@@ -18,6 +18,7 @@
 #include <boot/platform.h>
 #include <boot/stage2.h>
 #include <boot/menu.h>
+#include <boot/arch/x86/arch_numa.h>
 #include <arch/x86/apic.h>
 #include <arch/x86/arch_cpu.h>
 #include <arch/x86/arch_system_info.h>
@@ -411,6 +412,7 @@ arch_smp_init(void)
 	// multiple cores or hyper threading.
 	if (acpi_do_smp_config() == B_OK) {
 		TRACE("smp init success\n");
+		numa_init();
 		return;
 	}
 
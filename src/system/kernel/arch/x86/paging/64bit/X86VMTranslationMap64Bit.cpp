@@ -11,6 +11,7 @@
 
 #include "paging/64bit/X86VMTranslationMap64Bit.h"
 
+#include <heap.h>
 #include <interrupts.h>
 #include <slab/Slab.h>
 #include <thread.h>
@@ -33,6 +34,18 @@
 #endif
 
 
+/*!	A chunk of the address space that is mapped by a single large page. The
+	page table that mapped the chunk before is kept around, so that the large
+	page can be split up again without having to allocate memory.
+*/
+struct X86VMTranslationMap64Bit::LargePage
+	: DoublyLinkedListLinkImpl<LargePage> {
+	addr_t			address;
+	phys_addr_t		pageTable;
+		// 0, if the object is currently unused
+};
+
+
 // #pragma mark - X86VMTranslationMap64Bit
 
 
@@ -94,6 +107,10 @@ X86VMTranslationMap64Bit::~X86VMTranslationMap64Bit()
 					if ((virtualPageDir[k] & X86_64_PDE_PRESENT) == 0)
 						continue;
 
+					// The page tables of large pages are freed below.
+					if ((virtualPageDir[k] & X86_64_PDE_LARGE_PAGE) != 0)
+						continue;
+
 					address = virtualPageDir[k] & X86_64_PDE_ADDRESS_MASK;
 					page = vm_lookup_page(address / B_PAGE_SIZE);
 					if (page == NULL) {
@@ -142,6 +159,23 @@ X86VMTranslationMap64Bit::~X86VMTranslationMap64Bit()
 		}
 	}
 
+	while (LargePage* largePage = fLargePages.RemoveHead()) {
+		if (largePage->pageTable != 0) {
+			page = vm_lookup_page(largePage->pageTable / B_PAGE_SIZE);
+			if (page == NULL) {
+				panic("page table of large page %#" B_PRIxADDR " on invalid "
+					"page %#" B_PRIxPHYSADDR "\n", largePage->address,
+					largePage->pageTable);
+			}
+
+			DEBUG_PAGE_ACCESS_START(page);
+			vm_page_free_etc(NULL, page, &reservation);
+			atomic_add(&gMappedLargePagesCount, -1);
+		}
+
+		delete largePage;
+	}
+
 	vm_page_unreserve_pages(&reservation);
 
 	fPageMapper->Delete();
@@ -277,6 +311,8 @@ X86VMTranslationMap64Bit::Unmap(addr_t start, addr_t end)
 	TRACE("X86VMTranslationMap64Bit::Unmap(%#" B_PRIxADDR ", %#" B_PRIxADDR
 		")\n", start, end);
 
+	_DemoteRange(start, end);
+
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
@@ -327,6 +363,8 @@ X86VMTranslationMap64Bit::DebugMarkRangePresent(addr_t start, addr_t end,
 	TRACE("X86VMTranslationMap64Bit::DebugMarkRangePresent(%#" B_PRIxADDR
 		", %#" B_PRIxADDR ")\n", start, end);
 
+	_DemoteRange(start, end);
+
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
@@ -378,6 +416,8 @@ X86VMTranslationMap64Bit::UnmapPage(VMArea* area, addr_t address,
 
 	TRACE("X86VMTranslationMap64Bit::UnmapPage(%#" B_PRIxADDR ")\n", address);
 
+	_DemoteRange(address, address);
+
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	// Look up the page table for the virtual address.
@@ -458,6 +498,9 @@ X86VMTranslationMap64Bit::UnmapPages(VMArea* area, addr_t base, size_t size,
 	VMAreaMappings queue;
 
 	RecursiveLocker locker(fLock);
+
+	_DemoteRange(start, end);
+
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
@@ -603,9 +646,42 @@ X86VMTranslationMap64Bit::Protect(addr_t start, addr_t end, uint32 attributes,
 	} else if ((attributes & B_KERNEL_WRITE_AREA) != 0)
 		newProtectionFlags = X86_64_PTE_WRITABLE;
 
+	uint64 memoryTypeFlags
+		= X86PagingMethod64Bit::MemoryTypeToPageTableEntryFlags(memoryType);
+
+	// Large pages that are completely covered by the range can just be
+	// changed as a whole, all others need to be split up.
+	bool hasLargePages = false;
+	if (fLargePageCount != 0) {
+		RecursiveLocker locker(fLock);
+
+		for (LargePageList::Iterator it = fLargePages.GetIterator();
+				LargePage* largePage = it.Next();) {
+			if (largePage->pageTable == 0 || largePage->address > end
+				|| largePage->address + (k64BitPageTableRange - 1) < start) {
+				continue;
+			}
+
+			if (largePage->address < start
+				|| largePage->address + (k64BitPageTableRange - 1) > end
+				|| !_ProtectLargePage(largePage,
+					newProtectionFlags | memoryTypeFlags)) {
+				_DemoteLargePage(largePage);
+			}
+		}
+
+		hasLargePages = fLargePageCount != 0;
+	}
+
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
+		if (hasLargePages && _LargePageAt(start) != NULL) {
+			// Already taken care of above.
+			start = ROUNDUP(start + 1, k64BitPageTableRange);
+			continue;
+		}
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -633,9 +709,7 @@ X86VMTranslationMap64Bit::Protect(addr_t start, addr_t end, uint32 attributes,
 					&pageTable[index],
 					(entry & ~(X86_64_PTE_PROTECTION_MASK
 							| X86_64_PTE_MEMORY_TYPE_MASK))
-						| newProtectionFlags
-						| X86PagingMethod64Bit::MemoryTypeToPageTableEntryFlags(
-							memoryType),
+						| newProtectionFlags | memoryTypeFlags,
 					entry);
 				if (oldEntry == entry)
 					break;
@@ -661,6 +735,8 @@ X86VMTranslationMap64Bit::ClearFlags(addr_t address, uint32 flags)
 	TRACE("X86VMTranslationMap64Bit::ClearFlags(%#" B_PRIxADDR ", %#" B_PRIx32
 		")\n", address, flags);
 
+	_DemoteRange(address, address);
+
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
@@ -692,6 +768,9 @@ X86VMTranslationMap64Bit::ClearAccessedAndModified(VMArea* area, addr_t address,
 		")\n", address);
 
 	RecursiveLocker locker(fLock);
+
+	_DemoteRange(address, address);
+
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
@@ -761,6 +840,78 @@ X86VMTranslationMap64Bit::ClearAccessedAndModified(VMArea* area, addr_t address,
 }
 
 
+size_t
+X86VMTranslationMap64Bit::LargePageSize() const
+{
+	return k64BitPageTableRange;
+}
+
+
+int32
+X86VMTranslationMap64Bit::PromoteLargePages(addr_t start, addr_t end)
+{
+	TRACE("X86VMTranslationMap64Bit::PromoteLargePages(%#" B_PRIxADDR ", %#"
+		B_PRIxADDR ")\n", start, end);
+
+	RecursiveLocker locker(fLock);
+
+	int32 promoted = 0;
+	for (addr_t address = ROUNDUP(start, k64BitPageTableRange);
+			address >= start && address + (k64BitPageTableRange - 1) <= end;
+			address += k64BitPageTableRange) {
+		if (_PromoteLargePage(address))
+			promoted++;
+	}
+
+	return promoted;
+}
+
+
+void
+X86VMTranslationMap64Bit::DemoteLargePages(addr_t start, addr_t end)
+{
+	TRACE("X86VMTranslationMap64Bit::DemoteLargePages(%#" B_PRIxADDR ", %#"
+		B_PRIxADDR ")\n", start, end);
+
+	RecursiveLocker locker(fLock);
+
+	bool demoted = false;
+	for (LargePageList::Iterator it = fLargePages.GetIterator();
+			LargePage* largePage = it.Next();) {
+		if (largePage->pageTable == 0 || largePage->address > end
+			|| largePage->address + (k64BitPageTableRange - 1) < start) {
+			continue;
+		}
+
+		_DemoteLargePage(largePage);
+		demoted = true;
+	}
+
+	if (demoted) {
+		Flush();
+			// flush explicitly, since we directly use the lock
+	}
+}
+
+
+int32
+X86VMTranslationMap64Bit::CountLargePages(addr_t start, addr_t end)
+{
+	RecursiveLocker locker(fLock);
+
+	int32 count = 0;
+	for (LargePageList::Iterator it = fLargePages.GetIterator();
+			LargePage* largePage = it.Next();) {
+		if (largePage->pageTable != 0 && largePage->address <= end
+			&& largePage->address + (k64BitPageTableRange - 1) >= start) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+
 bool
 X86VMTranslationMap64Bit::DebugGetReverseMappingInfo(phys_addr_t physicalAddress,
 	ReverseMappingInfoCallback& callback)
@@ -857,3 +1008,226 @@ X86VMTranslationMap64Bit::PagingStructures() const
 {
 	return fPagingStructures;
 }
+
+
+/*!	Returns the large page the given address lies in, if any.
+	The map must be locked.
+*/
+X86VMTranslationMap64Bit::LargePage*
+X86VMTranslationMap64Bit::_LargePageAt(addr_t address)
+{
+	address = ROUNDDOWN(address, k64BitPageTableRange);
+
+	for (LargePageList::Iterator it = fLargePages.GetIterator();
+			LargePage* largePage = it.Next();) {
+		if (largePage->pageTable != 0 && largePage->address == address)
+			return largePage;
+	}
+
+	return NULL;
+}
+
+
+/*!	Replaces the page table mapping the large page sized chunk at \a address
+	by a single large page, if all of its pages are mapped with the same
+	attributes, and are physically contiguous and suitably aligned.
+	The map must be locked.
+*/
+bool
+X86VMTranslationMap64Bit::_PromoteLargePage(addr_t address)
+{
+	// Get an unused large page object first, as we cannot allocate memory
+	// while being pinned.
+	LargePage* largePage = NULL;
+	for (LargePageList::Iterator it = fLargePages.GetIterator();
+			LargePage* otherPage = it.Next();) {
+		if (otherPage->pageTable == 0) {
+			largePage = otherPage;
+			break;
+		}
+	}
+
+	if (largePage == NULL) {
+		largePage = new(malloc_flags(CACHE_DONT_WAIT_FOR_MEMORY
+			| CACHE_DONT_LOCK_KERNEL_SPACE)) LargePage;
+		if (largePage == NULL)
+			return false;
+
+		largePage->pageTable = 0;
+		fLargePages.Add(largePage);
+	}
+
+	ThreadCPUPinner pinner(thread_get_current_thread());
+
+	uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+		fPagingStructures->VirtualPMLTop(), address, fIsKernelMap, false,
+		NULL, fPageMapper, fMapCount);
+	if (pde == NULL || (*pde & X86_64_PDE_PRESENT) == 0
+		|| (*pde & X86_64_PDE_LARGE_PAGE) != 0) {
+		return false;
+	}
+
+	const phys_addr_t physicalPageTable = *pde & X86_64_PDE_ADDRESS_MASK;
+	uint64* pageTable = (uint64*)fPageMapper->GetPageTableAt(
+		physicalPageTable);
+
+	// The PAT bit of a page table entry is the large page bit of a page
+	// directory entry, so we leave pages using it alone. All other attributes
+	// are at the same position in both entries.
+	const uint64 attributeMask = ~(X86_64_PTE_ADDRESS_MASK
+		| X86_64_PTE_ACCESSED | X86_64_PTE_DIRTY);
+	const uint64 firstEntry = pageTable[0];
+	const phys_addr_t physicalAddress = firstEntry & X86_64_PTE_ADDRESS_MASK;
+	if ((firstEntry & X86_64_PTE_PRESENT) == 0
+		|| (firstEntry & X86_64_PTE_PAT) != 0
+		|| physicalAddress % k64BitPageTableRange != 0) {
+		return false;
+	}
+
+	uint64 accessedAndDirty = 0;
+	for (uint32 index = 0; index < k64BitTableEntryCount; index++) {
+		const uint64 entry = pageTable[index];
+		if ((entry & X86_64_PTE_ADDRESS_MASK)
+				!= physicalAddress + index * B_PAGE_SIZE
+			|| (entry & attributeMask) != (firstEntry & attributeMask)) {
+			return false;
+		}
+
+		accessedAndDirty |= entry & (X86_64_PTE_ACCESSED | X86_64_PTE_DIRTY);
+	}
+
+	X86PagingMethod64Bit::SetTableEntry(pde, physicalAddress
+		| (firstEntry & attributeMask) | accessedAndDirty
+		| X86_64_PDE_LARGE_PAGE);
+
+	// Another CPU might have written to one of the pages via a cached entry in
+	// the meantime.
+	if ((accessedAndDirty & X86_64_PTE_DIRTY) == 0) {
+		for (uint32 index = 0; index < k64BitTableEntryCount; index++) {
+			if ((pageTable[index] & X86_64_PTE_DIRTY) != 0) {
+				X86PagingMethod64Bit::SetTableEntryFlags(pde,
+					X86_64_PDE_DIRTY);
+				break;
+			}
+		}
+	}
+
+	// The TLBs must not keep the small and the large page mappings at the
+	// same time.
+	for (uint32 index = 0; index < k64BitTableEntryCount; index++)
+		InvalidatePage(address + index * B_PAGE_SIZE);
+
+	largePage->address = address;
+	largePage->pageTable = physicalPageTable;
+
+	fLargePageCount++;
+	atomic_add(&gMappedLargePagesCount, 1);
+
+	TRACE("X86VMTranslationMap64Bit::_PromoteLargePage(): %#" B_PRIxADDR
+		" -> %#" B_PRIxPHYSADDR "\n", address, physicalAddress);
+
+	return true;
+}
+
+
+/*!	Splits up the given large page again, reusing the page table that was
+	replaced by it. The current attributes of the large page are applied to all
+	of its pages; since there is only one dirty flag for the large page, all
+	pages are considered modified, if it is set.
+	The map must be locked.
+*/
+void
+X86VMTranslationMap64Bit::_DemoteLargePage(LargePage* largePage)
+{
+	TRACE("X86VMTranslationMap64Bit::_DemoteLargePage(%#" B_PRIxADDR ")\n",
+		largePage->address);
+
+	ThreadCPUPinner pinner(thread_get_current_thread());
+
+	uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+		fPagingStructures->VirtualPMLTop(), largePage->address, fIsKernelMap,
+		false, NULL, fPageMapper, fMapCount);
+	ASSERT(pde != NULL && (*pde & X86_64_PDE_LARGE_PAGE) != 0);
+
+	uint64* pageTable = (uint64*)fPageMapper->GetPageTableAt(
+		largePage->pageTable);
+	const uint64 tableEntry = (largePage->pageTable & X86_64_PDE_ADDRESS_MASK)
+		| X86_64_PDE_PRESENT
+		| X86_64_PDE_WRITABLE
+		| X86_64_PDE_USER;
+
+	uint64 oldEntry = *pde;
+	while (true) {
+		const phys_addr_t physicalAddress = oldEntry & X86_64_PDE_ADDRESS_MASK;
+		const uint64 attributes = oldEntry
+			& ~(X86_64_PDE_ADDRESS_MASK | X86_64_PDE_LARGE_PAGE);
+
+		for (uint32 index = 0; index < k64BitTableEntryCount; index++) {
+			X86PagingMethod64Bit::SetTableEntry(&pageTable[index],
+				(physicalAddress + index * B_PAGE_SIZE) | attributes);
+		}
+
+		// the accessed or dirty flag might have been set in the meantime
+		uint64 entry = X86PagingMethod64Bit::TestAndSetTableEntry(pde,
+			tableEntry, oldEntry);
+		if (entry == oldEntry)
+			break;
+
+		oldEntry = entry;
+	}
+
+	// invalidating any address of the large page is enough
+	InvalidatePage(largePage->address);
+
+	largePage->pageTable = 0;
+
+	fLargePageCount--;
+	atomic_add(&gMappedLargePagesCount, -1);
+}
+
+
+/*!	Changes the protection and memory type of the given large page as a whole.
+	Returns \c false, if the large page cannot represent the new attributes,
+	and needs to be split up instead.
+	The map must be locked.
+*/
+bool
+X86VMTranslationMap64Bit::_ProtectLargePage(LargePage* largePage,
+	uint64 protectionFlags)
+{
+	if ((protectionFlags & X86_64_PTE_PAT) != 0)
+		return false;
+
+	ThreadCPUPinner pinner(thread_get_current_thread());
+
+	uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+		fPagingStructures->VirtualPMLTop(), largePage->address, fIsKernelMap,
+		false, NULL, fPageMapper, fMapCount);
+	ASSERT(pde != NULL && (*pde & X86_64_PDE_LARGE_PAGE) != 0);
+
+	uint64 entry = *pde;
+	uint64 oldEntry;
+	while (true) {
+		oldEntry = X86PagingMethod64Bit::TestAndSetTableEntry(pde,
+			(entry & ~(X86_64_PTE_PROTECTION_MASK
+					| X86_64_PTE_MEMORY_TYPE_MASK))
+				| protectionFlags,
+			entry);
+		if (oldEntry == entry)
+			break;
+		entry = oldEntry;
+	}
+
+	if ((oldEntry & X86_64_PDE_ACCESSED) != 0)
+		InvalidatePage(largePage->address);
+
+	return true;
+}
+
+
+void
+X86VMTranslationMap64Bit::_DemoteRange(addr_t start, addr_t end)
+{
+	if (fLargePageCount != 0)
+		DemoteLargePages(start, end);
+}
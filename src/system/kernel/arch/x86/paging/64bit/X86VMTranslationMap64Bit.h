@@ -7,6 +7,8 @@
 #define KERNEL_ARCH_X86_PAGING_64BIT_X86_VM_TRANSLATION_MAP_64BIT_H
 
 
+#include <util/DoublyLinkedList.h>
+
 #include "paging/X86VMTranslationMap.h"
 
 
@@ -56,6 +58,11 @@ struct X86VMTranslationMap64Bit final : X86VMTranslationMap {
 									bool unmapIfUnaccessed,
 									bool& _modified);
 
+	virtual	size_t				LargePageSize() const;
+	virtual	int32				PromoteLargePages(addr_t start, addr_t end);
+	virtual	void				DemoteLargePages(addr_t start, addr_t end);
+	virtual	int32				CountLargePages(addr_t start, addr_t end);
+
 	virtual	bool				DebugGetReverseMappingInfo(
 									phys_addr_t physicalAddress,
 									ReverseMappingInfoCallback& callback);
@@ -64,9 +71,21 @@ struct X86VMTranslationMap64Bit final : X86VMTranslationMap {
 	inline	X86PagingStructures64Bit* PagingStructures64Bit() const
 									{ return fPagingStructures; }
 
+private:
+			struct LargePage;
+			typedef DoublyLinkedList<LargePage> LargePageList;
+
+			LargePage*			_LargePageAt(addr_t address);
+			bool				_PromoteLargePage(addr_t address);
+			void				_DemoteLargePage(LargePage* largePage);
+			bool				_ProtectLargePage(LargePage* largePage,
+									uint64 protectionFlags);
+	inline	void				_DemoteRange(addr_t start, addr_t end);
+
 private:
 			X86PagingStructures64Bit* fPagingStructures;
 			bool				fLA57;
+			LargePageList		fLargePages;
 };
 
 
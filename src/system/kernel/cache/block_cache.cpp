@@ -170,18 +170,24 @@ cache_notification::operator delete(void* block)
 }
 
 
+static const uint32 kBlockTableStripeShift = 4;
+static const uint32 kBlockTableStripes = 1 << kBlockTableStripeShift;
+
+
 struct BlockHash {
 	typedef off_t			KeyType;
 	typedef	cached_block	ValueType;
 
 	size_t HashKey(KeyType key) const
 	{
-		return key;
+		// the lower bits select the stripe, and are therefore the same for
+		// all blocks in a single stripe's table
+		return key >> kBlockTableStripeShift;
 	}
 
 	size_t Hash(ValueType* block) const
 	{
-		return block->block_number;
+		return HashKey(block->block_number);
 	}
 
 	bool Compare(KeyType key, ValueType* block) const
@@ -195,7 +201,199 @@ struct BlockHash {
 	}
 };
 
-typedef BOpenHashTable<BlockHash> BlockTable;
+
+/*!	The block hash table of a block_cache, split into a number of stripes
+	that each have their own lock.
+
+	All changes to the table are done with the block_cache's lock held, and
+	additionally write lock the affected stripe. Therefore, anyone holding the
+	block_cache's lock may look up blocks without further locking. The
+	AcquireCached() and ReleaseCached() fast paths, on the other hand, only
+	read lock a single stripe, so that referencing blocks that are already
+	in use does not need to serialize on the block_cache's lock.
+*/
+class BlockTable {
+public:
+	typedef BOpenHashTable<BlockHash> StripeTable;
+
+	class Iterator {
+	public:
+		Iterator(const BlockTable* table)
+			:
+			fTable(table),
+			fStripe(0),
+			fIterator(&table->fStripes[0].table)
+		{
+			_Skip();
+		}
+
+		bool HasNext() const
+		{
+			return fIterator.HasNext();
+		}
+
+		cached_block* Next()
+		{
+			cached_block* block = fIterator.Next();
+			_Skip();
+			return block;
+		}
+
+	private:
+		void _Skip()
+		{
+			while (!fIterator.HasNext() && fStripe + 1 < kBlockTableStripes) {
+				fIterator = StripeTable::Iterator(
+					&fTable->fStripes[++fStripe].table);
+			}
+		}
+
+	private:
+		const BlockTable*		fTable;
+		uint32					fStripe;
+		StripeTable::Iterator	fIterator;
+	};
+
+public:
+	BlockTable()
+	{
+		for (uint32 i = 0; i < kBlockTableStripes; i++)
+			rw_lock_init(&fStripes[i].lock, "block cache stripe");
+	}
+
+	~BlockTable()
+	{
+		for (uint32 i = 0; i < kBlockTableStripes; i++)
+			rw_lock_destroy(&fStripes[i].lock);
+	}
+
+	status_t Init(size_t initialSize)
+	{
+		size_t stripeSize = initialSize / kBlockTableStripes;
+		for (uint32 i = 0; i < kBlockTableStripes; i++) {
+			status_t status = fStripes[i].table.Init(stripeSize);
+			if (status != B_OK)
+				return status;
+		}
+		return B_OK;
+	}
+
+	/*!	The block_cache must be locked. */
+	cached_block* Lookup(off_t blockNumber) const
+	{
+		return _StripeFor(blockNumber).table.Lookup(blockNumber);
+	}
+
+	/*!	The block_cache must be locked. */
+	status_t Insert(cached_block* block)
+	{
+		Stripe& stripe = _StripeFor(block->block_number);
+		WriteLocker locker(stripe.lock);
+		return stripe.table.Insert(block);
+	}
+
+	/*!	The block_cache must be locked. */
+	bool Remove(cached_block* block)
+	{
+		Stripe& stripe = _StripeFor(block->block_number);
+		WriteLocker locker(stripe.lock);
+		return stripe.table.Remove(block);
+	}
+
+	/*!	The block_cache must be locked. Returns all blocks linked via their
+		cached_block::next member.
+	*/
+	cached_block* Clear()
+	{
+		cached_block* result = NULL;
+		for (uint32 i = 0; i < kBlockTableStripes; i++) {
+			WriteLocker locker(fStripes[i].lock);
+			cached_block* block = fStripes[i].table.Clear(true);
+			while (block != NULL) {
+				cached_block* next = block->next;
+				block->next = result;
+				result = block;
+				block = next;
+			}
+		}
+		return result;
+	}
+
+	/*!	Acquires another reference to an already referenced block without
+		locking the block_cache. Blocks that are not referenced yet may be
+		busy, unused, or part of a transaction; they always have to be
+		acquired with the block_cache locked.
+		\return The block, or \c NULL if the block_cache must be locked to
+			acquire it.
+	*/
+	cached_block* AcquireCached(off_t blockNumber)
+	{
+		Stripe& stripe = _StripeFor(blockNumber);
+		ReadLocker locker(stripe.lock);
+
+		cached_block* block = stripe.table.Lookup(blockNumber);
+		if (block == NULL)
+			return NULL;
+
+		while (true) {
+			int32 count = atomic_get(&block->ref_count);
+			if (count < 1)
+				return NULL;
+			if (atomic_test_and_set(&block->ref_count, count + 1, count)
+					== count) {
+				break;
+			}
+		}
+
+		block->last_accessed = system_time() / 1000000L;
+		return block;
+	}
+
+	/*!	Releases a reference to a block without locking the block_cache,
+		unless it is the last one. Putting the last reference changes the
+		block's state, which requires the block_cache's lock.
+		\return \c true, if the reference has been released, \c false, if the
+			block_cache must be locked to do so.
+	*/
+	bool ReleaseCached(off_t blockNumber)
+	{
+		Stripe& stripe = _StripeFor(blockNumber);
+		ReadLocker locker(stripe.lock);
+
+		cached_block* block = stripe.table.Lookup(blockNumber);
+		if (block == NULL)
+			return false;
+
+		while (true) {
+			int32 count = atomic_get(&block->ref_count);
+			if (count < 2)
+				return false;
+			if (atomic_test_and_set(&block->ref_count, count - 1, count)
+					== count) {
+				return true;
+			}
+		}
+	}
+
+private:
+	struct Stripe {
+		rw_lock		lock;
+		StripeTable	table;
+	};
+
+	Stripe& _StripeFor(off_t blockNumber)
+	{
+		return fStripes[blockNumber & (kBlockTableStripes - 1)];
+	}
+
+	const Stripe& _StripeFor(off_t blockNumber) const
+	{
+		return fStripes[blockNumber & (kBlockTableStripes - 1)];
+	}
+
+private:
+	Stripe			fStripes[kBlockTableStripes];
+};
 
 
 struct TransactionHash {
@@ -2088,7 +2286,9 @@ put_cached_block(block_cache* cache, cached_block* block)
 		return;
 	}
 
-	if (--block->ref_count == 0
+	// References might concurrently be acquired and released through the
+	// BlockTable fast paths, but those never touch the last one.
+	if (atomic_add(&block->ref_count, -1) == 1
 		&& block->transaction == NULL && block->previous_transaction == NULL) {
 		// This block is not used anymore, and not part of any transaction
 		block->is_writing = false;
@@ -2203,7 +2403,7 @@ retry:
 		mark_block_unbusy_reading(cache, block);
 	}
 
-	block->ref_count++;
+	atomic_add(&block->ref_count, 1);
 	block->last_accessed = system_time() / 1000000L;
 
 	*_block = block;
@@ -3664,7 +3864,7 @@ block_cache_delete(void* _cache, bool allowWrites)
 
 	// free all blocks
 
-	cached_block* block = cache->hash->Clear(true);
+	cached_block* block = cache->hash->Clear();
 	while (block != NULL) {
 		cached_block* next = block->next;
 		cache->FreeBlock(block);
@@ -3900,10 +4100,23 @@ status_t
 block_cache_get_etc(void* _cache, off_t blockNumber, const void** _block)
 {
 	block_cache* cache = (block_cache*)_cache;
+
+#if !BLOCK_CACHE_DEBUG_CHANGED
+	// fast path: the block is already in use by someone else
+	cached_block* block = cache->hash->AcquireCached(blockNumber);
+	if (block != NULL) {
+		TB(Get(cache, block));
+
+		*_block = block->current_data;
+		return B_OK;
+	}
+#else
+	cached_block* block;
+#endif
+
 	MutexLocker locker(&cache->lock);
 	bool allocated;
 
-	cached_block* block;
 	status_t status = get_cached_block(cache, blockNumber, &allocated, true,
 		&block);
 	if (status != B_OK)
@@ -3967,6 +4180,15 @@ void
 block_cache_put(void* _cache, off_t blockNumber)
 {
 	block_cache* cache = (block_cache*)_cache;
+
+#if !BLOCK_CACHE_DEBUG_CHANGED
+	// fast path: this is not the last reference to the block
+	if (blockNumber >= 0 && blockNumber < cache->max_blocks
+		&& cache->hash->ReleaseCached(blockNumber)) {
+		return;
+	}
+#endif
+
 	MutexLocker locker(&cache->lock);
 
 	put_cached_block(cache, blockNumber);
@@ -10,6 +10,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+
 #include <AutoDeleter.h>
 #include <KernelExport.h>
 #include <fs_cache.h>
@@ -42,6 +44,31 @@
 #define BYPASS_IO_SIZE		65536
 #define LAST_ACCESSES		3
 
+// read-ahead window limits
+#define MIN_READ_AHEAD_SIZE			(64 * 1024)
+#define DEFAULT_MAX_READ_AHEAD_SIZE	(2 * 1024 * 1024)
+#define MAX_READ_AHEAD_SIZE			(16 * 1024 * 1024)
+#define MAX_STRIDED_RECORDS			16
+
+// how long a low resource notification limits the read-ahead window
+#define READ_AHEAD_LOW_RESOURCE_PERIOD	5000000LL	// 5 secs
+
+struct read_ahead_state {
+	off_t			last_offset;
+		// offset of the last read
+	off_t			next_offset;
+		// end of the last read, where a sequential read would continue
+	off_t			stride;
+		// distance between the last two reads, if they weren't sequential
+	off_t			window_start;
+	off_t			window_end;
+		// the range the asynchronous reads have been scheduled for
+	size_t			window_size;
+		// current size of the read-ahead window, 0 if not in a stream
+	uint32			stream_length;
+		// number of consecutive sequential or strided reads
+};
+
 struct file_cache_ref {
 	VMCache			*cache;
 	struct vnode	*vnode;
@@ -51,6 +78,8 @@ struct file_cache_ref {
 		//	write vs. read)
 	int32			last_access_index;
 	uint16			disabled_count;
+	read_ahead_state read_ahead;
+		// protected by the cache lock
 
 	inline void SetLastAccess(int32 index, off_t access, bool isWrite)
 	{
@@ -113,6 +142,15 @@ static const size_t kZeroVecSize = kZeroVecCount * B_PAGE_SIZE;
 static phys_addr_t sZeroPage;
 static generic_io_vec sZeroVecs[kZeroVecCount];
 
+static size_t sMaxReadAheadSize = DEFAULT_MAX_READ_AHEAD_SIZE;
+static int32 sReadAheadLowResourceLevel = B_NO_LOW_RESOURCE;
+static bigtime_t sReadAheadLowResourceTime;
+
+static int64 sReadAheadHits;
+static int64 sReadAheadMisses;
+static int64 sPagesReadAhead;
+static int64 sReadAheadPagesWasted;
+
 
 //	#pragma mark -
 
@@ -284,6 +322,258 @@ push_access(file_cache_ref* ref, off_t offset, generic_size_t bytes,
 }
 
 
+/*!	Schedules asynchronous reads for all pages in the given range that are
+	not yet in the cache. \a offset and \a size must be page aligned.
+	The cache must be locked; it will be unlocked temporarily while the I/O
+	requests are issued.
+	\return The number of pages reads have been scheduled for.
+*/
+static size_t
+precache_range(file_cache_ref* ref, off_t offset, size_t size,
+	vm_page_reservation* reservation)
+{
+	VMCache* cache = ref->cache;
+	size_t pagesScheduled = 0;
+	size_t bytesToRead = 0;
+	off_t lastOffset = offset;
+
+	while (true) {
+		// check if this page is already in memory
+		if (size > 0) {
+			vm_page* page = cache->LookupPage(offset);
+
+			offset += B_PAGE_SIZE;
+			size -= B_PAGE_SIZE;
+
+			if (page == NULL) {
+				bytesToRead += B_PAGE_SIZE;
+				continue;
+			}
+		}
+		if (bytesToRead != 0) {
+			// read the part before the current page (or the end of the request)
+			PrecacheIO* io = new(std::nothrow) PrecacheIO(ref, lastOffset,
+				bytesToRead);
+			if (io == NULL || io->Prepare(reservation) != B_OK) {
+				delete io;
+				break;
+			}
+
+			// we must not have the cache locked during I/O
+			cache->Unlock();
+			io->ReadAsync();
+			cache->Lock();
+
+			pagesScheduled += bytesToRead / B_PAGE_SIZE;
+			bytesToRead = 0;
+		}
+
+		if (size == 0) {
+			// we have reached the end of the request
+			break;
+		}
+
+		lastOffset = offset;
+	}
+
+	return pagesScheduled;
+}
+
+
+/*!	Returns the maximum read-ahead window size, taking the current memory
+	situation into account. Returns 0, if no read-ahead should be done at all.
+*/
+static size_t
+max_read_ahead_size()
+{
+	size_t maxSize = sMaxReadAheadSize;
+
+	int32 level = atomic_get(&sReadAheadLowResourceLevel);
+	if (level != B_NO_LOW_RESOURCE) {
+		if (system_time() - sReadAheadLowResourceTime
+				> READ_AHEAD_LOW_RESOURCE_PERIOD) {
+			// the last notification is long ago, the situation has relaxed
+			atomic_set(&sReadAheadLowResourceLevel, B_NO_LOW_RESOURCE);
+		} else {
+			switch (level) {
+				case B_LOW_RESOURCE_NOTE:
+					maxSize /= 2;
+					break;
+				case B_LOW_RESOURCE_WARNING:
+					maxSize /= 8;
+					break;
+				case B_LOW_RESOURCE_CRITICAL:
+					return 0;
+			}
+		}
+	}
+
+	if (maxSize < MIN_READ_AHEAD_SIZE)
+		return 0;
+
+	return ROUNDDOWN(maxSize, B_PAGE_SIZE);
+}
+
+
+static void
+read_ahead_low_resource_handler(void* /*data*/, uint32 resources,
+	int32 level)
+{
+	sReadAheadLowResourceTime = system_time();
+	atomic_set(&sReadAheadLowResourceLevel, level);
+}
+
+
+/*!	Reserves pages for, and schedules asynchronous reads of, the given range.
+	The cache must be locked; it will be unlocked temporarily.
+	\return \c false, if there weren't enough pages left to do so.
+*/
+static bool
+schedule_read_ahead(file_cache_ref* ref, off_t offset, size_t size)
+{
+	VMCache* cache = ref->cache;
+
+	if ((off_t)(offset + size) > cache->virtual_end)
+		size = ROUNDUP(cache->virtual_end - offset, B_PAGE_SIZE);
+
+	const size_t pageCount = size / B_PAGE_SIZE;
+	if (pageCount == 0)
+		return true;
+	if (vm_page_num_unused_pages() < 2 * pageCount)
+		return false;
+
+	// reserve the pages without holding the cache lock
+	cache->Unlock();
+
+	vm_page_reservation reservation;
+	bool reserved = vm_page_try_reserve_pages(&reservation, pageCount,
+		VM_PRIORITY_USER);
+
+	cache->Lock();
+
+	if (!reserved)
+		return false;
+
+	size_t scheduled = precache_range(ref, offset, size, &reservation);
+	atomic_add64(&sPagesReadAhead, scheduled);
+
+	vm_page_unreserve_pages(&reservation);
+	return true;
+}
+
+
+/*!	Feeds a read of the given range into the read-ahead state machine of
+	\a ref. If the file is read sequentially or with a constant stride, this
+	schedules asynchronous reads ahead of the reader. For sequential streams
+	the window grows exponentially up to max_read_ahead_size(); it is
+	shrunk again when memory gets tight.
+	The cache must be locked; it might be unlocked temporarily.
+*/
+static void
+read_ahead(file_cache_ref* ref, off_t offset, size_t size)
+{
+	read_ahead_state& state = ref->read_ahead;
+	const off_t end = offset + size;
+
+	const bool sequential = offset == state.next_offset;
+	const bool strided = !sequential && state.stride > (off_t)size
+		&& offset - state.last_offset == state.stride;
+
+	if (state.window_size != 0) {
+		if (offset >= state.window_start && end <= state.window_end)
+			atomic_add64(&sReadAheadHits, 1);
+		else if (sequential || strided)
+			atomic_add64(&sReadAheadMisses, 1);
+	}
+
+	if (!sequential && !strided) {
+		// The stream ended -- whatever we read ahead beyond the last read is
+		// most likely wasted.
+		if (state.window_size != 0 && state.window_end > state.next_offset) {
+			off_t unused = state.window_end
+				- std::max(state.next_offset, state.window_start);
+			atomic_add64(&sReadAheadPagesWasted, unused / B_PAGE_SIZE);
+		}
+
+		state.stride = offset - state.last_offset;
+		state.window_start = state.window_end = 0;
+		state.window_size = 0;
+		state.stream_length = 0;
+		state.last_offset = offset;
+		state.next_offset = end;
+		return;
+	}
+
+	state.stream_length++;
+	state.last_offset = offset;
+	state.next_offset = end;
+
+	const size_t maxSize = max_read_ahead_size();
+	if (maxSize == 0) {
+		state.window_start = state.window_end = 0;
+		state.window_size = 0;
+		return;
+	}
+
+	if (state.window_size == 0) {
+		state.window_size = std::max((size_t)MIN_READ_AHEAD_SIZE,
+			(size_t)ROUNDUP(size * 2, B_PAGE_SIZE));
+	}
+	state.window_size = std::min(state.window_size, maxSize);
+
+	if (sequential) {
+		// Only schedule more once the reader has consumed half of what is
+		// ahead of it, so that we issue few, large requests.
+		if (state.window_end - end >= (off_t)state.window_size / 2)
+			return;
+
+		off_t start = std::max(state.window_end,
+			(off_t)ROUNDDOWN(offset, B_PAGE_SIZE));
+		off_t target = ROUNDUP(end + state.window_size, B_PAGE_SIZE);
+		if (target > ref->cache->virtual_end)
+			target = ROUNDUP(ref->cache->virtual_end, B_PAGE_SIZE);
+		if (start >= target)
+			return;
+
+		if (!schedule_read_ahead(ref, start, target - start)) {
+			state.window_size = std::max(state.window_size / 2,
+				(size_t)MIN_READ_AHEAD_SIZE);
+			return;
+		}
+
+		if (state.window_end <= offset)
+			state.window_start = start;
+		state.window_end = target;
+
+		// grow the window for the next round
+		state.window_size = std::min(state.window_size * 2, maxSize);
+		return;
+	}
+
+	// strided access: read ahead the next few records
+	int32 records = std::min((size_t)MAX_STRIDED_RECORDS,
+		std::max(state.window_size / size, (size_t)1));
+	off_t recordOffset = std::max(offset + state.stride, state.window_end);
+	const off_t lastRecord = offset + records * state.stride;
+
+	if (state.window_end <= offset)
+		state.window_start = offset + state.stride;
+	for (; recordOffset <= lastRecord; recordOffset += state.stride) {
+		off_t start = ROUNDDOWN(recordOffset, B_PAGE_SIZE);
+		off_t recordEnd = ROUNDUP(recordOffset + size, B_PAGE_SIZE);
+		if (start >= ref->cache->virtual_end)
+			break;
+
+		if (!schedule_read_ahead(ref, start, recordEnd - start)) {
+			state.window_size = std::max(state.window_size / 2,
+				(size_t)MIN_READ_AHEAD_SIZE);
+			break;
+		}
+		state.window_end = recordOffset + size;
+	}
+}
+
+
 static void
 reserve_pages(file_cache_ref* ref, vm_page_reservation* reservation,
 	size_t reservePages, bool isWrite)
@@ -995,6 +1285,43 @@ file_cache_control(const char* subsystem, uint32 function, void* buffer,
 
 			return status;
 		}
+
+		case CACHE_GET_READ_AHEAD_STATS:
+		{
+			if (buffer == NULL || !IS_USER_ADDRESS(buffer)
+				|| bufferSize < sizeof(file_cache_read_ahead_stats))
+				return B_BAD_VALUE;
+
+			file_cache_read_ahead_stats stats;
+			stats.hits = atomic_get64(&sReadAheadHits);
+			stats.misses = atomic_get64(&sReadAheadMisses);
+			stats.pages_read_ahead = atomic_get64(&sPagesReadAhead);
+			stats.pages_wasted = atomic_get64(&sReadAheadPagesWasted);
+			stats.max_window_size = sMaxReadAheadSize;
+			stats.effective_max_window_size = max_read_ahead_size();
+
+			return user_memcpy(buffer, &stats, sizeof(stats));
+		}
+
+		case CACHE_SET_READ_AHEAD_MAX:
+		{
+			if (geteuid() != 0)
+				return B_NOT_ALLOWED;
+
+			uint32 maxSize;
+			if (buffer == NULL || !IS_USER_ADDRESS(buffer)
+				|| bufferSize != sizeof(maxSize)
+				|| user_memcpy(&maxSize, buffer, sizeof(maxSize)) != B_OK)
+				return B_BAD_ADDRESS;
+
+			if (maxSize > MAX_READ_AHEAD_SIZE)
+				return B_BAD_VALUE;
+
+			dprintf("cache_control: set maximum read-ahead to %" B_PRIu32
+				" bytes\n", maxSize);
+			sMaxReadAheadSize = maxSize;
+			return B_OK;
+		}
 	}
 
 	return B_BAD_HANDLER;
@@ -1038,54 +1365,127 @@ cache_prefetch_vnode(struct vnode* vnode, off_t offset, size_t size)
 		return;
 	}
 
-	size_t bytesToRead = 0;
-	off_t lastOffset = offset;
-
 	vm_page_reservation reservation;
 	vm_page_reserve_pages(&reservation, pagesCount, VM_PRIORITY_USER);
 
 	cache->Lock();
 
-	while (true) {
-		// check if this page is already in memory
-		if (size > 0) {
-			vm_page* page = cache->LookupPage(offset);
+	precache_range(ref, offset, size, &reservation);
 
-			offset += B_PAGE_SIZE;
-			size -= B_PAGE_SIZE;
+	cache->ReleaseRefAndUnlock();
+	vm_page_unreserve_pages(&reservation);
+}
 
-			if (page == NULL) {
-				bytesToRead += B_PAGE_SIZE;
-				continue;
-			}
-		}
-		if (bytesToRead != 0) {
-			// read the part before the current page (or the end of the request)
-			PrecacheIO* io = new(std::nothrow) PrecacheIO(ref, lastOffset,
-				bytesToRead);
-			if (io == NULL || io->Prepare(&reservation) != B_OK) {
-				delete io;
-				break;
-			}
 
-			// we must not have the cache locked during I/O
-			cache->Unlock();
-			io->ReadAsync();
-			cache->Lock();
+/*!	Reads the given range of the file into its cache, and wires the pages
+	covering it, so that they can be used directly, for example to send them
+	over the network without copying them.
+	At most \a _count pages are wired; wiring stops at the first page that
+	could not be read into the cache. On return, \a _size contains the
+	number of bytes covered by the wired pages, which is 0 at the end of the
+	file. The cache is returned with a reference in \a _cache, and has to be
+	passed to cache_unwire_pages() together with the pages once they are no
+	longer used.
+	Returns \c B_UNSUPPORTED if the file does not use a file cache, or if
+	caching has been disabled for it.
+*/
+extern "C" status_t
+cache_wire_pages(struct vnode* vnode, void* cookie, off_t offset,
+	size_t* _size, VMCache** _cache, vm_page** pages, uint32* _count)
+{
+	VMCache* cache;
+	if (vfs_get_vnode_cache(vnode, &cache, false) != B_OK)
+		return B_UNSUPPORTED;
 
-			bytesToRead = 0;
-		}
+	file_cache_ref* ref = NULL;
+	if (cache->type == CACHE_TYPE_VNODE)
+		ref = ((VMVnodeCache*)cache)->FileCacheRef();
+	if (ref == NULL || ref->disabled_count > 0) {
+		cache->ReleaseRef();
+		return B_UNSUPPORTED;
+	}
 
-		if (size == 0) {
-			// we have reached the end of the request
+	const int32 pageOffset = offset % B_PAGE_SIZE;
+	size_t size = min_c(*_size, *_count * B_PAGE_SIZE - pageOffset);
+
+	if (sMaxReadAheadSize != 0) {
+		AutoLocker<VMCache> locker(cache);
+		read_ahead(ref, offset, size);
+	}
+
+	// Only read the missing pages into the cache, without copying them
+	status_t status = cache_io(ref, cookie, offset, 0, &size, false);
+	if (status != B_OK) {
+		cache->ReleaseRef();
+		return status;
+	}
+
+	cache->Lock();
+
+	uint32 count = 0;
+	off_t end = min_c(offset + (off_t)size, cache->virtual_end);
+	for (off_t pageStart = offset - pageOffset; pageStart < end;
+			pageStart += B_PAGE_SIZE) {
+		vm_page* page = cache->LookupPage(pageStart);
+		if (page == NULL || page->busy)
 			break;
+
+		if (!page->IsMapped())
+			atomic_add(&gMappedPagesCount, 1);
+		page->IncrementWiredCount();
+		page->io_wired_count++;
+
+		// Wired pages must not stay in the cached queue
+		if (page->State() == PAGE_STATE_CACHED
+			|| page->State() == PAGE_STATE_INACTIVE) {
+			DEBUG_PAGE_ACCESS_START(page);
+			vm_page_set_state(page, PAGE_STATE_ACTIVE);
+			DEBUG_PAGE_ACCESS_END(page);
 		}
 
-		lastOffset = offset;
+		pages[count++] = page;
+	}
+
+	if (count == 0)
+		size = 0;
+	else {
+		size = min_c((off_t)count * B_PAGE_SIZE - pageOffset,
+			end - offset);
+	}
+
+	cache->Unlock();
+
+	*_size = size;
+	*_count = count;
+	*_cache = cache;
+	return B_OK;
+}
+
+
+/*!	Unwires the pages that were wired by cache_wire_pages(), and releases
+	the reference to their cache.
+	Pages that have been removed from the cache in the mean time, because
+	the file was truncated, are freed when they are no longer wired.
+*/
+extern "C" void
+cache_unwire_pages(VMCache* cache, vm_page** pages, uint32 count)
+{
+	cache->Lock();
+
+	for (uint32 i = 0; i < count; i++) {
+		vm_page* page = pages[i];
+		page->io_wired_count--;
+		page->DecrementWiredCount();
+		if (!page->IsMapped())
+			atomic_add(&gMappedPagesCount, -1);
+
+		if (page->CacheRef() == NULL && !page->IsMapped()) {
+			DEBUG_PAGE_ACCESS_START(page);
+			vm_page_free(NULL, page);
+		}
 	}
 
 	cache->ReleaseRefAndUnlock();
-	vm_page_unreserve_pages(&reservation);
 }
 
 
@@ -1181,6 +1581,9 @@ file_cache_init(void)
 		sZeroVecs[i].length = B_PAGE_SIZE;
 	}
 
+	register_low_resource_handler(&read_ahead_low_resource_handler, NULL,
+		B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY, 0);
+
 	register_generic_syscall(CACHE_SYSCALLS, file_cache_control, 1, 0);
 	return B_OK;
 }
@@ -1202,6 +1605,7 @@ file_cache_create(dev_t mountID, ino_t vnodeID, off_t size)
 	memset(ref->last_access, 0, sizeof(ref->last_access));
 	ref->last_access_index = 0;
 	ref->disabled_count = 0;
+	memset(&ref->read_ahead, 0, sizeof(ref->read_ahead));
 
 	// TODO: delay VMCache creation until data is
 	//	requested/written for the first time? Listing lots of
@@ -1365,6 +1769,11 @@ file_cache_read(void* _cacheRef, void* cookie, off_t offset, void* buffer,
 		return error;
 	}
 
+	if (sMaxReadAheadSize != 0) {
+		AutoLocker<VMCache> locker(ref->cache);
+		read_ahead(ref, offset, *_size);
+	}
+
 	return cache_io(ref, cookie, offset, (addr_t)buffer, _size, false);
 }
 
@@ -793,6 +793,7 @@ IORequest::Init(off_t offset, generic_size_t firstVecOffset,
 	fRelativeParentOffset = 0;
 	fTransferSize = 0;
 	fFlags = flags;
+	fDeadline = 0;
 	Thread* thread = thread_get_current_thread();
 	fTeam = thread->team->id;
 	fThread = thread->id;
@@ -1038,6 +1039,20 @@ IORequest::SetStatusAndNotify(status_t status)
 }
 
 
+/*!	Lets the request fail with \a status, unless it already has a status.
+	Unlike SetStatusAndNotify(), this doesn't finish the request; it is done
+	when its pending operations are.
+*/
+void
+IORequest::SetFailed(status_t status)
+{
+	MutexLocker _(fLock);
+
+	if (fStatus == 1)
+		fStatus = status;
+}
+
+
 void
 IORequest::OperationFinished(IOOperation* operation)
 {
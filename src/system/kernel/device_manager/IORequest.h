@@ -231,6 +231,11 @@ struct IORequest : IORequestChunk, DoublyLinkedListLinkImpl<IORequest> {
 									{ fOwner = owner; }
 			IORequestOwner*		Owner() const	{ return fOwner; }
 
+			void				SetDeadline(bigtime_t deadline)
+									{ fDeadline = deadline; }
+			bigtime_t			Deadline() const	{ return fDeadline; }
+									// only used by the I/O scheduler
+
 			status_t			CreateSubRequest(off_t parentOffset,
 									off_t offset, generic_size_t length,
 									IORequest*& subRequest);
@@ -253,6 +258,7 @@ struct IORequest : IORequestChunk, DoublyLinkedListLinkImpl<IORequest> {
 			void				NotifyFinished();
 			bool				HasCallbacks() const;
 			void				SetStatusAndNotify(status_t status);
+			void				SetFailed(status_t status);
 
 			void				OperationFinished(IOOperation* operation);
 			void				SubRequestFinished(IORequest* request,
@@ -264,6 +270,8 @@ struct IORequest : IORequestChunk, DoublyLinkedListLinkImpl<IORequest> {
 									{ return fRemainingBytes; }
 			generic_size_t		TransferredBytes() const
 									{ return fTransferSize; }
+			bool				HasPendingOperations() const
+									{ return fPendingChildren > 0; }
 			bool				IsPartialTransfer() const
 									{ return fPartialTransfer; }
 			void				SetTransferredBytes(bool partialTransfer,
@@ -339,6 +347,7 @@ private:
 			IORequestChunkList	fChildren;
 			int32				fPendingChildren;
 			uint32				fFlags;
+			bigtime_t			fDeadline;
 			team_id				fTeam;
 			thread_id			fThread;
 			bool				fIsWrite;
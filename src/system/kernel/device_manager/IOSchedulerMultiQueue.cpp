@@ -0,0 +1,717 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	An I/O scheduler for devices that can take requests from any CPU at any
+	time, like devices with several hardware submission queues.
+
+	There is no scheduler thread: requests are prepared and passed to the
+	driver directly by the thread that scheduled them, using the queue that
+	belongs to the CPU it runs on. Only when operations are completed from an
+	interrupt handler, or when more work has piled up than the submitting
+	thread should handle, the rest is done by a DPC.
+
+	Requests are sorted into three classes: interactive, best effort, and
+	background. Each class has a deadline by which its requests should be
+	done, and a budget of operations it may have in flight while other
+	classes are waiting. Requests that missed their deadline are always
+	served first.
+*/
+
+
+#include "IOSchedulerMultiQueue.h"
+
+#include <stdio.h>
+
+#include <smp.h>
+#include <thread.h>
+#include <util/AutoLock.h>
+
+#include "IOSchedulerRoster.h"
+
+
+//#define TRACE_IO_SCHEDULER
+#ifdef TRACE_IO_SCHEDULER
+#	define TRACE(x...) dprintf(x)
+#else
+#	define TRACE(x...) ;
+#endif
+
+
+static const bigtime_t kClassDeadlines[IO_CLASS_COUNT] = {
+	5000,		// interactive
+	50000,		// best effort
+	500000		// background
+};
+
+// the share of the queue depth a class may use while others are waiting,
+// in quarters
+static const uint32 kClassBudgets[IO_CLASS_COUNT] = {
+	4,			// interactive
+	3,			// best effort
+	1			// background
+};
+
+static const char* const kClassNames[IO_CLASS_COUNT] = {
+	"interactive",
+	"best effort",
+	"background"
+};
+
+static const int32 kMaxInlinePasses = 4;
+	// how often the submitting thread itself may look for more work, before
+	// it is handed over to the DPC
+
+
+struct IOSchedulerMultiQueue::RequestClass : IORequestOwner {
+	Queue*			queue;
+	int32			index;
+	uint32			budget;
+	uint32			in_flight;
+
+	uint64			request_count;
+	uint64			missed_deadlines;
+	bigtime_t		total_latency;
+	bigtime_t		max_latency;
+};
+
+
+struct IOSchedulerMultiQueue::Operation : IOOperation {
+	RequestClass*	request_class;
+};
+
+
+struct IOSchedulerMultiQueue::Queue : DPCCallback {
+	IOSchedulerMultiQueue* scheduler;
+	uint32			index;
+	mutex			lock;
+	RequestClass	classes[IO_CLASS_COUNT];
+	Operation*		operations;
+	IOOperationList	unused_operations;
+	uint32			in_flight;
+	int32			waiting_for_resources;
+
+	spinlock		completed_lock;
+	IOOperationList	completed_operations;
+	int32			running;
+		// number of threads in _Run(), protected by the completed_lock
+
+	virtual void DoDPC(DPCQueue* queue)
+	{
+		scheduler->_Run(this, false);
+	}
+};
+
+
+// #pragma mark -
+
+
+IOSchedulerMultiQueue::IOSchedulerMultiQueue(DMAResource* resource,
+	uint32 queueCount, uint32 queueDepth)
+	:
+	IOScheduler(resource),
+	fQueueCount(queueCount),
+	fQueueDepth(queueDepth),
+	fQueues(NULL),
+	fDPCQueueInitialized(false),
+	fWaitingQueues(0)
+{
+	if (fQueueCount == 0)
+		fQueueCount = 1;
+
+	if (fQueueDepth == 0) {
+		fQueueDepth = fDMAResource != NULL
+			? fDMAResource->BufferCount() / fQueueCount : 16;
+		if (fQueueDepth == 0)
+			fQueueDepth = 1;
+	}
+}
+
+
+IOSchedulerMultiQueue::~IOSchedulerMultiQueue()
+{
+	if (fDPCQueueInitialized)
+		fDPCQueue.Close(false);
+
+	if (fQueues == NULL)
+		return;
+
+	for (uint32 i = 0; i < fQueueCount; i++) {
+		Queue& queue = fQueues[i];
+		mutex_destroy(&queue.lock);
+		delete[] queue.operations;
+	}
+
+	delete[] fQueues;
+}
+
+
+status_t
+IOSchedulerMultiQueue::Init(const char* name)
+{
+	status_t error = IOScheduler::Init(name);
+	if (error != B_OK)
+		return error;
+
+	fQueues = new(std::nothrow) Queue[fQueueCount];
+	if (fQueues == NULL)
+		return B_NO_MEMORY;
+
+	for (uint32 i = 0; i < fQueueCount; i++) {
+		Queue& queue = fQueues[i];
+		queue.scheduler = this;
+		queue.index = i;
+		mutex_init(&queue.lock, "I/O queue");
+		B_INITIALIZE_SPINLOCK(&queue.completed_lock);
+		queue.in_flight = 0;
+		queue.waiting_for_resources = 0;
+		queue.running = 0;
+
+		for (int32 j = 0; j < IO_CLASS_COUNT; j++) {
+			RequestClass& requestClass = queue.classes[j];
+			requestClass.team = -1;
+			requestClass.thread = -1;
+			requestClass.priority = B_IDLE_PRIORITY;
+			requestClass.hash_link = NULL;
+			requestClass.queue = &queue;
+			requestClass.index = j;
+			requestClass.budget = fQueueDepth * kClassBudgets[j] / 4;
+			if (requestClass.budget == 0)
+				requestClass.budget = 1;
+			requestClass.in_flight = 0;
+			requestClass.request_count = 0;
+			requestClass.missed_deadlines = 0;
+			requestClass.total_latency = 0;
+			requestClass.max_latency = 0;
+		}
+
+		queue.operations = new(std::nothrow) Operation[fQueueDepth];
+		if (queue.operations == NULL)
+			return B_NO_MEMORY;
+
+		for (uint32 j = 0; j < fQueueDepth; j++) {
+			queue.operations[j].request_class = NULL;
+			queue.unused_operations.Add(&queue.operations[j]);
+		}
+	}
+
+	char buffer[B_OS_NAME_LENGTH];
+	snprintf(buffer, sizeof(buffer), "%s scheduler %" B_PRId32, name, fID);
+
+	error = fDPCQueue.Init(buffer, B_NORMAL_PRIORITY + 2, 0);
+	if (error != B_OK)
+		return error;
+
+	fDPCQueueInitialized = true;
+	return B_OK;
+}
+
+
+status_t
+IOSchedulerMultiQueue::ScheduleRequest(IORequest* request)
+{
+	TRACE("%p->IOSchedulerMultiQueue::ScheduleRequest(%p)\n", this, request);
+
+	IOBuffer* buffer = request->Buffer();
+
+	if (buffer->IsVirtual()) {
+		status_t status = buffer->LockMemory(request->TeamID(),
+			request->IsWrite());
+		if (status != B_OK) {
+			request->SetStatusAndNotify(status);
+			return status;
+		}
+	}
+
+	int32 classIndex = _ClassFor(request);
+	Queue* queue = &fQueues[smp_get_current_cpu() % fQueueCount];
+	RequestClass* requestClass = &queue->classes[classIndex];
+
+	MutexLocker locker(queue->lock);
+
+	request->SetOwner(requestClass);
+	request->SetDeadline(system_time() + kClassDeadlines[classIndex]);
+	requestClass->requests.Add(request);
+
+	locker.Unlock();
+
+	IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_REQUEST_SCHEDULED, this,
+		request);
+
+	_Run(queue, true);
+	return B_OK;
+}
+
+
+void
+IOSchedulerMultiQueue::AbortRequest(IORequest* request, status_t status)
+{
+	RequestClass* requestClass = static_cast<RequestClass*>(request->Owner());
+	if (requestClass == NULL)
+		return;
+
+	Queue* queue = requestClass->queue;
+	MutexLocker locker(queue->lock);
+
+	if (request->Owner() != requestClass)
+		return;
+
+	IORequestList finishedRequests;
+	_RemoveRequest(queue, request, finishedRequests);
+
+	if (request->HasPendingOperations()) {
+		// Don't prepare any more operations; the request is finished as a
+		// partial transfer with the given status once the pending ones are
+		// done.
+		request->SetTransferredBytes(true, request->TransferredBytes());
+		request->SetFailed(status);
+		return;
+	}
+
+	locker.Unlock();
+
+	_NotifyFinished(finishedRequests, status);
+}
+
+
+void
+IOSchedulerMultiQueue::OperationCompleted(IOOperation* operation,
+	status_t status, generic_size_t transferredBytes)
+{
+	Queue* queue = _QueueFor(operation);
+	if (queue == NULL) {
+		panic("IOSchedulerMultiQueue: unknown operation %p\n", operation);
+		return;
+	}
+
+	InterruptsSpinLocker locker(queue->completed_lock);
+
+	// finish operation only once
+	if (operation->Status() <= 0)
+		return;
+
+	operation->SetStatus(status, transferredBytes);
+	queue->completed_operations.Add(operation);
+
+	// If nobody is going to look at the queue anymore, the DPC has to do it.
+	if (queue->running == 0)
+		fDPCQueue.Add(queue);
+}
+
+
+void
+IOSchedulerMultiQueue::Dump() const
+{
+	kprintf("IOSchedulerMultiQueue at %p\n", this);
+	kprintf("  DMA resource:   %p\n", fDMAResource);
+	kprintf("  queues:         %" B_PRIu32 "\n", fQueueCount);
+	kprintf("  queue depth:    %" B_PRIu32 "\n", fQueueDepth);
+	kprintf("  waiting queues: %" B_PRId32 "\n", fWaitingQueues);
+
+	for (uint32 i = 0; i < fQueueCount; i++) {
+		const Queue& queue = fQueues[i];
+		kprintf("  queue %" B_PRIu32 ": %" B_PRIu32 " in flight%s\n", i,
+			queue.in_flight,
+			queue.waiting_for_resources != 0 ? ", waiting for resources" : "");
+
+		for (int32 j = 0; j < IO_CLASS_COUNT; j++) {
+			const RequestClass& requestClass = queue.classes[j];
+			bigtime_t average = requestClass.request_count > 0
+				? requestClass.total_latency / requestClass.request_count : 0;
+
+			kprintf("    %-12s %p: %" B_PRIu32 "/%" B_PRIu32 " in flight, "
+				"%" B_PRIu64 " requests, %" B_PRIu64 " missed deadlines, "
+				"latency avg %" B_PRId64 ", max %" B_PRId64 "\n",
+				kClassNames[j], &requestClass, requestClass.in_flight,
+				requestClass.budget, requestClass.request_count,
+				requestClass.missed_deadlines, average,
+				requestClass.max_latency);
+		}
+	}
+}
+
+
+uint32
+IOSchedulerMultiQueue::QueueIndex(IOOperation* operation) const
+{
+	Queue* queue = _QueueFor(operation);
+	return queue != NULL ? queue->index : 0;
+}
+
+
+IOSchedulerMultiQueue::Queue*
+IOSchedulerMultiQueue::_QueueFor(IOOperation* _operation) const
+{
+	Operation* operation = static_cast<Operation*>(_operation);
+
+	for (uint32 i = 0; i < fQueueCount; i++) {
+		Queue* queue = &fQueues[i];
+		if (operation >= queue->operations
+			&& operation < queue->operations + fQueueDepth) {
+			return queue;
+		}
+	}
+
+	return NULL;
+}
+
+
+int32
+IOSchedulerMultiQueue::_ClassFor(IORequest* request) const
+{
+	if ((request->Flags() & B_VIP_IO_REQUEST) != 0)
+		return IO_CLASS_INTERACTIVE;
+
+	int32 priority = thread_get_io_priority(request->ThreadID());
+	if (priority < 0)
+		return IO_CLASS_BEST_EFFORT;
+	if (priority >= B_DISPLAY_PRIORITY)
+		return IO_CLASS_INTERACTIVE;
+	if (priority < B_NORMAL_PRIORITY)
+		return IO_CLASS_BACKGROUND;
+
+	return IO_CLASS_BEST_EFFORT;
+}
+
+
+/*!	Finishes completed operations, and passes new ones to the driver, until
+	there is nothing left to do.
+	If \a inlined is \c true, the caller is the thread that scheduled a
+	request; it only does a few rounds, and leaves the rest to the DPC.
+*/
+void
+IOSchedulerMultiQueue::_Run(Queue* queue, bool inlined)
+{
+	InterruptsSpinLocker locker(queue->completed_lock);
+	queue->running++;
+	locker.Unlock();
+
+	bool dispatched = true;
+	for (int32 pass = 0; ; pass++) {
+		IOOperationList completed;
+
+		locker.Lock();
+		completed.TakeFrom(&queue->completed_operations);
+
+		if (completed.IsEmpty() && !dispatched) {
+			queue->running--;
+			return;
+		}
+
+		if (inlined && pass >= kMaxInlinePasses) {
+			queue->completed_operations.TakeFrom(&completed);
+			queue->running--;
+			locker.Unlock();
+
+			fDPCQueue.Add(queue);
+			return;
+		}
+
+		locker.Unlock();
+
+		_FinishOperations(queue, completed);
+
+		IOOperationList operations;
+		IORequest* failedRequest = NULL;
+		status_t status = _Dispatch(queue, operations, failedRequest);
+		if (status != B_OK)
+			AbortRequest(failedRequest, status);
+
+		dispatched = !operations.IsEmpty() || failedRequest != NULL;
+
+		while (IOOperation* operation = operations.RemoveHead()) {
+			TRACE("IOSchedulerMultiQueue::_Run(): queue %" B_PRIu32 ", "
+				"operation %p\n", queue->index, operation);
+
+			IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_OPERATION_STARTED,
+				this, operation->Parent(), operation);
+
+			fIOCallback(fIOCallbackData, operation);
+		}
+	}
+}
+
+
+/*!	Chooses the class the next operation of \a queue is taken from. Requests
+	that missed their deadline come first, then the classes that did not yet
+	use up their budget, in the order of their priority. Only if there are no
+	such classes, a class may go over its budget.
+	The queue must be locked.
+*/
+IOSchedulerMultiQueue::RequestClass*
+IOSchedulerMultiQueue::_NextRequestClass(Queue* queue) const
+{
+	bool canPrepare = !queue->unused_operations.IsEmpty();
+	bigtime_t now = system_time();
+
+	RequestClass* expired = NULL;
+	RequestClass* withinBudget = NULL;
+	RequestClass* overBudget = NULL;
+
+	for (int32 i = 0; i < IO_CLASS_COUNT; i++) {
+		RequestClass* requestClass = &queue->classes[i];
+		IORequest* request = canPrepare ? requestClass->requests.Head() : NULL;
+		if (request == NULL && requestClass->operations.IsEmpty())
+			continue;
+
+		if (request != NULL && request->Deadline() <= now
+			&& (expired == NULL
+				|| request->Deadline()
+					< expired->requests.Head()->Deadline())) {
+			expired = requestClass;
+		}
+
+		if (requestClass->in_flight < requestClass->budget) {
+			if (withinBudget == NULL)
+				withinBudget = requestClass;
+		} else if (overBudget == NULL)
+			overBudget = requestClass;
+	}
+
+	if (expired != NULL)
+		return expired;
+	if (withinBudget != NULL)
+		return withinBudget;
+	return overBudget;
+}
+
+
+/*!	Collects the operations that can be passed to the driver right now in
+	\a operations. If preparing an operation fails for any other reason than
+	a temporary lack of DMA buffers, the request is returned in
+	\a _failedRequest, and has to be aborted by the caller.
+*/
+status_t
+IOSchedulerMultiQueue::_Dispatch(Queue* queue, IOOperationList& operations,
+	IORequest*& _failedRequest)
+{
+	MutexLocker locker(queue->lock);
+
+	bool waiting = false;
+	while (queue->in_flight < fQueueDepth) {
+		RequestClass* requestClass = _NextRequestClass(queue);
+		if (requestClass == NULL)
+			break;
+
+		// There might still be unfinished operations.
+		Operation* operation
+			= static_cast<Operation*>(requestClass->operations.RemoveHead());
+		if (operation == NULL) {
+			IORequest* request = requestClass->requests.Head();
+			operation = static_cast<Operation*>(
+				queue->unused_operations.RemoveHead());
+
+			status_t status = _PrepareOperation(request, operation);
+			if (status != B_OK) {
+				operation->SetParent(NULL);
+				queue->unused_operations.Add(operation, false);
+
+				// B_BUSY means some resource (DMABuffers or
+				// DMABounceBuffers) was temporarily unavailable. We'll be
+				// kicked when another queue recycles them. Since that could
+				// have happened before we were marked waiting, we need to
+				// try once more afterwards.
+				if (status == B_BUSY) {
+					if (waiting)
+						break;
+
+					if (atomic_get_and_set(&queue->waiting_for_resources, 1)
+							== 0) {
+						atomic_add(&fWaitingQueues, 1);
+					}
+					waiting = true;
+					continue;
+				}
+
+				_failedRequest = request;
+				return status;
+			}
+
+			operation->request_class = requestClass;
+
+			if (waiting) {
+				// we got the resources after all
+				if (atomic_get_and_set(&queue->waiting_for_resources, 0)
+						!= 0) {
+					atomic_add(&fWaitingQueues, -1);
+				}
+				waiting = false;
+			}
+
+			if (request->RemainingBytes() == 0) {
+				// Everything has been prepared, so we don't pick it up again.
+				requestClass->requests.Remove(request);
+				requestClass->completed_requests.Add(request);
+			}
+		}
+
+		requestClass->in_flight++;
+		queue->in_flight++;
+		operations.Add(operation);
+	}
+
+	return B_OK;
+}
+
+
+status_t
+IOSchedulerMultiQueue::_PrepareOperation(IORequest* request,
+	IOOperation* operation)
+{
+	if (fDMAResource != NULL)
+		return fDMAResource->TranslateNext(request, operation, 0);
+
+	// Without a DMA resource, the device has no restrictions we would know
+	// of, and gets the request as a whole.
+	status_t status = operation->Prepare(request);
+	if (status != B_OK)
+		return status;
+
+	operation->SetOriginalRange(request->Offset(), request->Length());
+	request->Advance(request->Length());
+	return B_OK;
+}
+
+
+void
+IOSchedulerMultiQueue::_FinishOperations(Queue* queue,
+	IOOperationList& operations)
+{
+	IORequestList finishedRequests;
+
+	while (Operation* operation
+			= static_cast<Operation*>(operations.RemoveHead())) {
+		TRACE("IOSchedulerMultiQueue::_FinishOperations(): operation: %p\n",
+			operation);
+
+		bool operationFinished = operation->Finish();
+
+		IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_OPERATION_FINISHED,
+			this, operation->Parent(), operation);
+			// Notify for every time the operation is passed to the I/O hook,
+			// not only when it is fully finished.
+
+		RequestClass* requestClass = operation->request_class;
+		IORequest* request = operation->Parent();
+
+		MutexLocker locker(queue->lock);
+
+		requestClass->in_flight--;
+		queue->in_flight--;
+
+		if (!operationFinished) {
+			TRACE("  operation: %p not finished yet\n", operation);
+			requestClass->operations.Add(operation);
+			continue;
+		}
+
+		request->OperationFinished(operation);
+		_RecycleOperation(queue, operation);
+
+		if (!request->IsFinished())
+			continue;
+
+		if (request->Owner() != NULL && request->Status() == B_OK
+			&& request->RemainingBytes() > 0) {
+			// The request has been processed OK so far, but it isn't really
+			// finished yet.
+			request->SetUnfinished();
+			continue;
+		}
+
+		if (request->Owner() != NULL) {
+			_UpdateStatistics(requestClass, request);
+			_RemoveRequest(queue, request, finishedRequests);
+		} else
+			finishedRequests.Add(request);
+	}
+
+	_NotifyFinished(finishedRequests, B_OK);
+}
+
+
+/*!	Removes \a request from its class, and adds it to \a finishedRequests.
+	The queue must be locked.
+*/
+void
+IOSchedulerMultiQueue::_RemoveRequest(Queue* queue, IORequest* request,
+	IORequestList& finishedRequests)
+{
+	RequestClass* requestClass = static_cast<RequestClass*>(request->Owner());
+
+	// Requests stay in the list of their class until all of their operations
+	// have been prepared.
+	if (request->RemainingBytes() > 0)
+		requestClass->requests.Remove(request);
+	else
+		requestClass->completed_requests.Remove(request);
+
+	request->SetOwner(NULL);
+
+	if (!request->HasPendingOperations())
+		finishedRequests.Add(request);
+}
+
+
+/*!	Must not be called with a queue locked, as the request callbacks might
+	schedule new requests.
+*/
+void
+IOSchedulerMultiQueue::_NotifyFinished(IORequestList& finishedRequests,
+	status_t status)
+{
+	while (IORequest* request = finishedRequests.RemoveHead()) {
+		IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_REQUEST_FINISHED,
+			this, request);
+
+		if (request->IsFinished())
+			request->NotifyFinished();
+		else
+			request->SetStatusAndNotify(status);
+	}
+}
+
+
+void
+IOSchedulerMultiQueue::_UpdateStatistics(RequestClass* requestClass,
+	IORequest* request)
+{
+	bigtime_t now = system_time();
+	bigtime_t latency = now
+		- (request->Deadline() - kClassDeadlines[requestClass->index]);
+
+	requestClass->request_count++;
+	requestClass->total_latency += latency;
+	if (latency > requestClass->max_latency)
+		requestClass->max_latency = latency;
+	if (now > request->Deadline())
+		requestClass->missed_deadlines++;
+}
+
+
+/*!	The queue must be locked. */
+void
+IOSchedulerMultiQueue::_RecycleOperation(Queue* queue, Operation* operation)
+{
+	operation->request_class = NULL;
+	queue->unused_operations.Add(operation);
+
+	if (fDMAResource == NULL)
+		return;
+
+	fDMAResource->RecycleBuffer(operation->Buffer());
+
+	// Kick the queues that ran out of DMA buffers
+	if (atomic_get(&fWaitingQueues) == 0)
+		return;
+
+	for (uint32 i = 0; i < fQueueCount; i++) {
+		Queue* waiting = &fQueues[i];
+		if (atomic_get_and_set(&waiting->waiting_for_resources, 0) != 0) {
+			atomic_add(&fWaitingQueues, -1);
+			fDPCQueue.Add(waiting);
+		}
+	}
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef IO_SCHEDULER_MULTI_QUEUE_H
+#define IO_SCHEDULER_MULTI_QUEUE_H
+
+
+#include <KernelExport.h>
+
+#include <DPC.h>
+#include <lock.h>
+
+#include "dma_resources.h"
+#include "IOScheduler.h"
+
+
+enum {
+	IO_CLASS_INTERACTIVE	= 0,
+	IO_CLASS_BEST_EFFORT,
+	IO_CLASS_BACKGROUND,
+
+	IO_CLASS_COUNT
+};
+
+
+class IOSchedulerMultiQueue : public IOScheduler {
+public:
+								IOSchedulerMultiQueue(DMAResource* resource,
+									uint32 queueCount, uint32 queueDepth);
+	virtual						~IOSchedulerMultiQueue();
+
+	virtual	status_t			Init(const char* name);
+
+	virtual	status_t			ScheduleRequest(IORequest* request);
+
+	virtual	void				AbortRequest(IORequest* request,
+									status_t status = B_CANCELED);
+	virtual	void				OperationCompleted(IOOperation* operation,
+									status_t status,
+									generic_size_t transferredBytes);
+									// called by the driver when the operation
+									// has been completed successfully or failed
+									// for some reason
+
+	virtual	void				Dump() const;
+
+			uint32				QueueCount() const	{ return fQueueCount; }
+			uint32				QueueIndex(IOOperation* operation) const;
+									// the hardware queue the driver shall
+									// submit the operation to
+
+private:
+			struct RequestClass;
+			struct Operation;
+			struct Queue;
+
+			Queue*				_QueueFor(IOOperation* operation) const;
+			int32				_ClassFor(IORequest* request) const;
+
+			void				_Run(Queue* queue, bool inlined);
+			RequestClass*		_NextRequestClass(Queue* queue) const;
+			status_t			_Dispatch(Queue* queue,
+									IOOperationList& operations,
+									IORequest*& _failedRequest);
+			status_t			_PrepareOperation(IORequest* request,
+									IOOperation* operation);
+			void				_FinishOperations(Queue* queue,
+									IOOperationList& operations);
+			void				_RemoveRequest(Queue* queue,
+									IORequest* request,
+									IORequestList& finishedRequests);
+			void				_NotifyFinished(
+									IORequestList& finishedRequests,
+									status_t status);
+			void				_UpdateStatistics(
+									RequestClass* requestClass,
+									IORequest* request);
+			void				_RecycleOperation(Queue* queue,
+									Operation* operation);
+
+private:
+			uint32				fQueueCount;
+			uint32				fQueueDepth;
+			Queue*				fQueues;
+			DPCQueue			fDPCQueue;
+			bool				fDPCQueueInitialized;
+			int32				fWaitingQueues;
+};
+
+
+#endif	// IO_SCHEDULER_MULTI_QUEUE_H
@@ -7,8 +7,12 @@
 
 #include "IOSchedulerRoster.h"
 
+#include <smp.h>
 #include <util/AutoLock.h>
 
+#include "IOSchedulerMultiQueue.h"
+#include "IOSchedulerSimple.h"
+
 
 /*static*/ IOSchedulerRoster IOSchedulerRoster::sDefaultInstance;
 
@@ -30,6 +34,23 @@ IOSchedulerRoster::~IOSchedulerRoster()
 }
 
 
+/*static*/ IOScheduler*
+IOSchedulerRoster::CreateScheduler(DMAResource* resource,
+	uint32 hardwareQueues, uint32 queueDepth)
+{
+	if (hardwareQueues == 0)
+		return new(std::nothrow) IOSchedulerSimple(resource);
+
+	// There is no point in having more queues than CPUs
+	uint32 cpuCount = smp_get_num_cpus();
+	if (hardwareQueues > cpuCount)
+		hardwareQueues = cpuCount;
+
+	return new(std::nothrow) IOSchedulerMultiQueue(resource, hardwareQueues,
+		queueDepth);
+}
+
+
 void
 IOSchedulerRoster::AddScheduler(IOScheduler* scheduler)
 {
@@ -30,6 +30,16 @@ public:
 	static	void				Init();
 	static	IOSchedulerRoster*	Default()	{ return &sDefaultInstance; }
 
+	static	IOScheduler*		CreateScheduler(DMAResource* resource,
+									uint32 hardwareQueues = 0,
+									uint32 queueDepth = 0);
+									// Drivers that can take operations from
+									// any CPU opt in to the multi-queue
+									// scheduler by passing their number of
+									// hardware queues. Their I/O callback
+									// must only start the operation, as it
+									// is called by the submitting thread.
+
 			bool				Lock()	{ return mutex_lock(&fLock) == B_OK; }
 			void				Unlock()	{ mutex_unlock(&fLock); }
 
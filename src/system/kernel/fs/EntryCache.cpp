@@ -4,6 +4,21 @@
  */
 
 
+/*!	The entry cache maps (directory, name) pairs to node IDs.
+
+	Lookups don't acquire any lock: they run with interrupts disabled, and
+	validate what they found against fSequenceLock, which is write locked
+	around every change to the hash table. Entries that have been removed
+	from the table are not freed before all CPUs have had their interrupts
+	enabled again, so a lookup can never look at freed memory.
+
+	The cache ages its entries in generations. A hit only moves an entry to
+	the current generation (which requires fLock) when it was in an older
+	one, so that the frequently used entries can be looked up without writing
+	to any shared memory.
+*/
+
+
 #include "EntryCache.h"
 
 #include <new>
@@ -11,8 +26,16 @@
 #include <slab/Slab.h>
 
 
-static const int32 kEntryNotInArray = -1;
-static const int32 kEntryRemoved = -2;
+static const int32 kMaxLookupTries = 8;
+	// after that many collisions with changes, Lookup() acquires the lock
+static const int32 kMaxPendingEntries = 256;
+	// removed entries that may wait to be freed
+
+
+static void
+synchronize_cpu(void* /*cookie*/, int /*cpu*/)
+{
+}
 
 
 // #pragma mark - EntryCacheGeneration
@@ -52,9 +75,12 @@ EntryCache::EntryCache()
 	:
 	fGenerationCount(0),
 	fGenerations(NULL),
-	fCurrentGeneration(0)
+	fCurrentGeneration(0),
+	fPendingEntries(NULL),
+	fPendingEntryCount(0)
 {
-	rw_lock_init(&fLock, "entry cache");
+	mutex_init(&fLock, "entry cache");
+	B_INITIALIZE_SEQLOCK(&fSequenceLock);
 
 	new(&fEntries) EntryTable;
 }
@@ -71,17 +97,19 @@ EntryCache::~EntryCache()
 	}
 	delete[] fGenerations;
 
-	rw_lock_destroy(&fLock);
+	while (fPendingEntries != NULL) {
+		entry = fPendingEntries;
+		fPendingEntries = entry->free_link;
+		free(entry);
+	}
+
+	mutex_destroy(&fLock);
 }
 
 
 status_t
 EntryCache::Init()
 {
-	status_t error = fEntries.Init();
-	if (error != B_OK)
-		return error;
-
 	int32 entriesSize = 1024;
 	fGenerationCount = 8;
 
@@ -92,7 +120,19 @@ EntryCache::Init()
 		fGenerationCount = 16;
 	}
 
+	// The table cannot be resized, since Lookup() doesn't lock it. Two
+	// entries per bucket at most are fine, as the hash values are compared
+	// first.
+	status_t error = fEntries.Init(entriesSize * fGenerationCount / 2);
+	if (error != B_OK)
+		return error;
+
 	fGenerations = new(std::nothrow) EntryCacheGeneration[fGenerationCount];
+	if (fGenerations == NULL) {
+		fGenerationCount = 0;
+		return B_NO_MEMORY;
+	}
+
 	for (int32 i = 0; i < fGenerationCount; i++) {
 		error = fGenerations[i].Init(entriesSize);
 		if (error != B_OK)
@@ -108,20 +148,22 @@ EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
 {
 	EntryCacheKey key(dirID, name);
 
-	WriteLocker _(fLock);
+	MutexLocker _(fLock);
 
 	if (fGenerationCount == 0)
 		return B_NO_MEMORY;
 
 	EntryCacheEntry* entry = fEntries.Lookup(key);
 	if (entry != NULL) {
-		entry->node_id = nodeID;
-		entry->missing = missing;
+		if (entry->node_id != nodeID || entry->missing != missing) {
+			InterruptsWriteSequentialLocker locker(fSequenceLock);
+			entry->node_id = nodeID;
+			entry->missing = missing;
+		}
+
 		if (entry->generation != fCurrentGeneration) {
-			if (entry->index >= 0) {
-				fGenerations[entry->generation].entries[entry->index] = NULL;
-				_AddEntryToCurrentGeneration(entry);
-			}
+			fGenerations[entry->generation].entries[entry->index] = NULL;
+			_AddEntryToCurrentGeneration(entry);
 		}
 		return B_OK;
 	}
@@ -134,18 +176,23 @@ EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
 	if (entry == NULL)
 		return B_NO_MEMORY;
 
+	entry->hash_link = NULL;
+	entry->free_link = NULL;
 	entry->node_id = nodeID;
 	entry->dir_id = dirID;
 	entry->hash = EntryCacheKey::Hash(dirID, name);
 	entry->missing = missing;
 	entry->generation = fCurrentGeneration;
-	entry->index = kEntryNotInArray;
+	entry->index = -1;
 	memcpy(entry->name, name, nameLen + 1);
 
-	fEntries.Insert(entry);
-
 	_AddEntryToCurrentGeneration(entry);
 
+	// The entry must be completely initialized before Lookup() can find it,
+	// which the memory barrier of the seqlock ensures.
+	InterruptsWriteSequentialLocker locker(fSequenceLock);
+	fEntries.InsertUnchecked(entry);
+
 	return B_OK;
 }
 
@@ -155,24 +202,17 @@ EntryCache::Remove(ino_t dirID, const char* name)
 {
 	EntryCacheKey key(dirID, name);
 
-	WriteLocker writeLocker(fLock);
+	MutexLocker _(fLock);
 
 	EntryCacheEntry* entry = fEntries.Lookup(key);
 	if (entry == NULL)
 		return B_ENTRY_NOT_FOUND;
 
-	fEntries.Remove(entry);
+	fGenerations[entry->generation].entries[entry->index] = NULL;
+	_RemoveEntry(entry);
 
-	if (entry->index >= 0) {
-		// remove the entry from its generation and delete it
-		fGenerations[entry->generation].entries[entry->index] = NULL;
-		free(entry);
-	} else {
-		// We can't free it, since another thread is about to try to move it
-		// to another generation. We mark it removed and the other thread will
-		// take care of deleting it.
-		entry->index = kEntryRemoved;
-	}
+	if (fPendingEntryCount >= kMaxPendingEntries)
+		_FreePendingEntries();
 
 	return B_OK;
 }
@@ -184,52 +224,53 @@ EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID,
 {
 	EntryCacheKey key(dirID, name);
 
-	ReadLocker readLocker(fLock);
+	bool found = false;
+	bool locked = true;
+	int32 generation = 0;
 
-	EntryCacheEntry* entry = fEntries.Lookup(key);
-	if (entry == NULL)
-		return false;
-
-	const int32 oldGeneration = atomic_get_and_set(&entry->generation,
-		fCurrentGeneration);
-	if (oldGeneration == fCurrentGeneration || entry->index < 0) {
-		// The entry is already in the current generation or is being moved to
-		// it by another thread.
-		_nodeID = entry->node_id;
-		_missing = entry->missing;
-		return true;
-	}
+	InterruptsLocker interruptsLocker;
 
-	// remove from old generation array
-	fGenerations[oldGeneration].entries[entry->index] = NULL;
-	entry->index = kEntryNotInArray;
+	for (int32 tries = 0; tries < kMaxLookupTries; tries++) {
+		uint32 count = acquire_read_seqlock(&fSequenceLock);
+		if (count % 2 != 0) {
+			// a change is in progress
+			cpu_pause();
+			continue;
+		}
 
-	// add to the current generation
-	const int32 index = atomic_add(&fGenerations[fCurrentGeneration].next_index, 1);
-	if (index < fGenerations[fCurrentGeneration].entries_size) {
-		fGenerations[fCurrentGeneration].entries[index] = entry;
-		entry->index = index;
-		_nodeID = entry->node_id;
-		_missing = entry->missing;
-		return true;
+		EntryCacheEntry* entry = fEntries.Lookup(key);
+		found = entry != NULL;
+		if (found) {
+			_nodeID = entry->node_id;
+			_missing = entry->missing;
+			generation = entry->generation;
+		}
+
+		if (release_read_seqlock(&fSequenceLock, count)) {
+			locked = false;
+			break;
+		}
 	}
 
-	// The current generation is full, so we probably need to clear the oldest
-	// one to make room. We need the write lock for that.
-	readLocker.Unlock();
-	WriteLocker writeLocker(fLock);
+	interruptsLocker.Unlock();
 
-	if (entry->index == kEntryRemoved) {
-		// the entry has been removed in the meantime
-		free(entry);
-		return false;
+	if (locked) {
+		// We kept colliding with changes; wait for them to be done.
+		MutexLocker _(fLock);
+
+		EntryCacheEntry* entry = fEntries.Lookup(key);
+		found = entry != NULL;
+		if (found) {
+			_nodeID = entry->node_id;
+			_missing = entry->missing;
+			generation = entry->generation;
+		}
 	}
 
-	_AddEntryToCurrentGeneration(entry);
+	if (found && generation != fCurrentGeneration)
+		_Touch(key);
 
-	_nodeID = entry->node_id;
-	_missing = entry->missing;
-	return true;
+	return found;
 }
 
 
@@ -249,10 +290,27 @@ EntryCache::DebugReverseLookup(ino_t nodeID, ino_t& _dirID)
 }
 
 
+/*!	Moves the entry for \a key to the current generation, if it is still
+	in the cache.
+*/
+void
+EntryCache::_Touch(const EntryCacheKey& key)
+{
+	MutexLocker _(fLock);
+
+	EntryCacheEntry* entry = fEntries.Lookup(key);
+	if (entry == NULL || entry->generation == fCurrentGeneration)
+		return;
+
+	fGenerations[entry->generation].entries[entry->index] = NULL;
+	_AddEntryToCurrentGeneration(entry);
+}
+
+
 void
 EntryCache::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
 {
-	ASSERT_WRITE_LOCKED_RW_LOCK(&fLock);
+	ASSERT_LOCKED_MUTEX(&fLock);
 
 	// the generation might not be full yet
 	int32 index = fGenerations[fCurrentGeneration].next_index++;
@@ -271,10 +329,11 @@ EntryCache::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
 			continue;
 
 		fGenerations[newGeneration].entries[i] = NULL;
-		fEntries.Remove(otherEntry);
-		free(otherEntry);
+		_RemoveEntry(otherEntry);
 	}
 
+	_FreePendingEntries();
+
 	// set the new generation and add the entry
 	fCurrentGeneration = newGeneration;
 	fGenerations[newGeneration].entries[0] = entry;
@@ -282,3 +341,43 @@ EntryCache::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
 	entry->generation = newGeneration;
 	entry->index = 0;
 }
+
+
+/*!	Removes \a entry from the hash table. It is freed later on, by
+	_FreePendingEntries().
+*/
+void
+EntryCache::_RemoveEntry(EntryCacheEntry* entry)
+{
+	ASSERT_LOCKED_MUTEX(&fLock);
+
+	InterruptsWriteSequentialLocker locker(fSequenceLock);
+	fEntries.RemoveUnchecked(entry);
+	locker.Unlock();
+
+	entry->free_link = fPendingEntries;
+	fPendingEntries = entry;
+	fPendingEntryCount++;
+}
+
+
+void
+EntryCache::_FreePendingEntries()
+{
+	ASSERT_LOCKED_MUTEX(&fLock);
+
+	if (fPendingEntries == NULL)
+		return;
+
+	// Lookup() keeps interrupts disabled while it is looking at the entries,
+	// so once every CPU has run this, none of them can be in use anymore.
+	call_all_cpus_sync(&synchronize_cpu, NULL);
+
+	while (fPendingEntries != NULL) {
+		EntryCacheEntry* entry = fPendingEntries;
+		fPendingEntries = entry->free_link;
+		free(entry);
+	}
+
+	fPendingEntryCount = 0;
+}
@@ -8,6 +8,8 @@
 
 #include <stdlib.h>
 
+#include <lock.h>
+#include <smp.h>
 #include <util/AutoLock.h>
 #include <util/DoublyLinkedList.h>
 #include <util/OpenHashTable.h>
@@ -38,6 +40,7 @@ struct EntryCacheKey {
 
 struct EntryCacheEntry {
 	EntryCacheEntry*	hash_link;
+	EntryCacheEntry*	free_link;
 	ino_t				node_id;
 	ino_t				dir_id;
 	uint32				hash;
@@ -107,19 +110,28 @@ public:
 			const char*			DebugReverseLookup(ino_t nodeID, ino_t& _dirID);
 
 private:
-			typedef BOpenHashTable<EntryCacheHashDefinition> EntryTable;
+			typedef BOpenHashTable<EntryCacheHashDefinition, false>
+				EntryTable;
 			typedef DoublyLinkedList<EntryCacheEntry> EntryList;
 
 private:
+			void				_Touch(const EntryCacheKey& key);
 			void				_AddEntryToCurrentGeneration(
 									EntryCacheEntry* entry);
+			void				_RemoveEntry(EntryCacheEntry* entry);
+			void				_FreePendingEntries();
 
 private:
-			rw_lock				fLock;
+			mutex				fLock;
+				// serializes all changes
+			seqlock				fSequenceLock;
+				// guards changes to fEntries against Lookup()
 			EntryTable			fEntries;
 			int32				fGenerationCount;
 			EntryCacheGeneration* fGenerations;
 			int32				fCurrentGeneration;
+			EntryCacheEntry*	fPendingEntries;
+			int32				fPendingEntryCount;
 };
 
 
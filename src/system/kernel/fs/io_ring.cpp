@@ -0,0 +1,376 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Batched submission of I/O operations via a ring shared with userland.
+
+	The ring lives in an area in the team's address space. Userland fills in
+	submissions and advances the submission tail, and then calls
+	_user_io_ring_enter() once to have all of them executed. The results are
+	posted to the completion queue of the same area, where userland can reap
+	them without entering the kernel again.
+*/
+
+
+#include <fs/io_ring.h>
+
+#include <algorithm>
+#include <fcntl.h>
+#include <new>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include <KernelExport.h>
+
+#include <AutoDeleter.h>
+#include <AutoDeleterDrivers.h>
+
+#include <fs/fd.h>
+#include <lock.h>
+#include <team.h>
+#include <util/AutoLock.h>
+#include <vfs.h>
+#include <vm/vm.h>
+
+
+//#define TRACE_IO_RING
+#ifdef TRACE_IO_RING
+#	define TRACE(x...) dprintf("io_ring: " x)
+#else
+#	define TRACE(x...) do {} while (false)
+#endif
+
+
+namespace {
+
+struct io_ring {
+	mutex			lock;
+	team_id			team;
+	area_id			area;
+	addr_t			address;
+
+	uint32			submission_count;
+	uint32			completion_count;
+	addr_t			submissions;
+	addr_t			completions;
+
+	// The indices owned by the kernel. The copies in the header are
+	// only written, never trusted.
+	uint32			submission_head;
+	uint32			completion_tail;
+};
+
+} // namespace
+
+
+static status_t
+user_get_index(addr_t address, uint32& _index)
+{
+	return user_memcpy(&_index, (void*)address, sizeof(uint32));
+}
+
+
+static status_t
+user_set_index(addr_t address, uint32 index)
+{
+	return user_memcpy((void*)address, &index, sizeof(uint32));
+}
+
+
+/*!	Executes a single submission, and returns its result. */
+static int64
+execute_submission(const io_ring_submission& submission)
+{
+	switch (submission.opcode) {
+		case IO_RING_OP_NOP:
+			return B_OK;
+
+		case IO_RING_OP_READ:
+			return _user_read(submission.fd, submission.offset,
+				submission.buffer, submission.length);
+
+		case IO_RING_OP_WRITE:
+			return _user_write(submission.fd, submission.offset,
+				submission.buffer, submission.length);
+
+		case IO_RING_OP_FSYNC:
+			return _user_fsync(submission.fd);
+
+		case IO_RING_OP_STAT:
+			return _user_read_stat(submission.fd, submission.path,
+				(submission.flags & IO_RING_SUBMISSION_NO_LINK_STAT) == 0,
+				(struct stat*)submission.buffer, submission.length);
+
+		case IO_RING_OP_SEND:
+			return _user_send(submission.fd, submission.buffer,
+				submission.length, submission.op_flags);
+
+		case IO_RING_OP_RECV:
+			return _user_recv(submission.fd, submission.buffer,
+				submission.length, submission.op_flags);
+
+		case IO_RING_OP_CLOSE:
+			return _user_close(submission.fd);
+	}
+
+	return B_BAD_VALUE;
+}
+
+
+/*!	Processes up to \a count pending submissions of the ring, and posts their
+	completions. Stops early when the completion queue is full, or when a
+	submission asks for it.
+	\return The number of submissions processed, or an error code, if none
+		could be processed.
+*/
+static ssize_t
+process_submissions(io_ring* ring, uint32 count)
+{
+	MutexLocker locker(ring->lock);
+
+	const addr_t header = ring->address;
+
+	uint32 submissionTail;
+	uint32 completionHead;
+	if (user_get_index(header + offsetof(io_ring_header, submission_tail),
+			submissionTail) != B_OK
+		|| user_get_index(header + offsetof(io_ring_header, completion_head),
+			completionHead) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	// The tail is under userland's control -- make sure it's sane
+	uint32 pending = submissionTail - ring->submission_head;
+	if (pending > ring->submission_count)
+		return B_BAD_DATA;
+	count = std::min(count, pending);
+
+	uint32 processed = 0;
+	status_t status = B_OK;
+
+	while (processed < count) {
+		uint32 used = ring->completion_tail - completionHead;
+		if (used >= ring->completion_count) {
+			// the completion queue is full, userland needs to reap first
+			break;
+		}
+
+		uint32 index = ring->submission_head & (ring->submission_count - 1);
+		io_ring_submission submission;
+		status = user_memcpy(&submission,
+			(io_ring_submission*)ring->submissions + index,
+			sizeof(io_ring_submission));
+		if (status != B_OK)
+			break;
+
+		io_ring_completion completion;
+		completion.user_data = submission.user_data;
+		completion.result = execute_submission(submission);
+
+		TRACE("%p: op %u on fd %" B_PRId32 " -> %" B_PRId64 "\n", ring,
+			submission.opcode, submission.fd, completion.result);
+
+		index = ring->completion_tail & (ring->completion_count - 1);
+		status = user_memcpy((io_ring_completion*)ring->completions + index,
+			&completion, sizeof(io_ring_completion));
+		if (status != B_OK)
+			break;
+
+		ring->submission_head++;
+		ring->completion_tail++;
+		processed++;
+
+		if (completion.result < 0
+			&& ((submission.flags & IO_RING_SUBMISSION_STOP_ON_ERROR) != 0
+				|| completion.result == B_INTERRUPTED)) {
+			// also give a pending signal a chance to be handled
+			break;
+		}
+	}
+
+	// publish the new indices -- the entries must be visible first
+	memory_write_barrier();
+	if (user_set_index(header + offsetof(io_ring_header, completion_tail),
+			ring->completion_tail) != B_OK
+		|| user_set_index(header + offsetof(io_ring_header, submission_head),
+			ring->submission_head) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	if (processed == 0 && status != B_OK)
+		return status;
+
+	return processed;
+}
+
+
+//	#pragma mark - File descriptor ops
+
+
+static status_t
+io_ring_close(file_descriptor* descriptor)
+{
+	io_ring* ring = (io_ring*)descriptor->cookie;
+
+	// The team might already be gone, in which case the area is, too.
+	vm_delete_area(ring->team, ring->area, true);
+	return B_OK;
+}
+
+
+static void
+io_ring_free(file_descriptor* descriptor)
+{
+	io_ring* ring = (io_ring*)descriptor->cookie;
+
+	mutex_destroy(&ring->lock);
+	delete ring;
+}
+
+
+static struct fd_ops sIORingFDOps = {
+	&io_ring_close,
+	&io_ring_free
+};
+
+
+static status_t
+get_ring_descriptor(int fd, file_descriptor*& descriptor)
+{
+	if (fd < 0)
+		return B_FILE_ERROR;
+
+	descriptor = get_fd(get_current_io_context(false), fd);
+	if (descriptor == NULL)
+		return B_FILE_ERROR;
+
+	if (descriptor->ops != &sIORingFDOps) {
+		put_fd(descriptor);
+		return B_BAD_VALUE;
+	}
+
+	return B_OK;
+}
+
+
+//	#pragma mark - User syscalls
+
+
+int
+_user_io_ring_create(uint32 entries, int openFlags, void** _userAddress)
+{
+	if (entries == 0 || entries > IO_RING_MAX_ENTRIES
+		|| (entries & (entries - 1)) != 0) {
+		return B_BAD_VALUE;
+	}
+	if (_userAddress == NULL || !IS_USER_ADDRESS(_userAddress))
+		return B_BAD_ADDRESS;
+
+	io_ring* ring = new(std::nothrow) io_ring;
+	if (ring == NULL)
+		return B_NO_MEMORY;
+	ObjectDeleter<io_ring> ringDeleter(ring);
+
+	// The completion queue is twice as large as the submission queue, so
+	// that we have more room to post completions before userland reaps them.
+	ring->submission_count = entries;
+	ring->completion_count = entries * 2;
+	ring->submission_head = 0;
+	ring->completion_tail = 0;
+
+	const size_t submissionOffset = ROUNDUP(sizeof(io_ring_header), 64);
+	const size_t completionOffset = ROUNDUP(submissionOffset
+		+ entries * sizeof(io_ring_submission), 64);
+	const size_t size = ROUNDUP(completionOffset
+		+ ring->completion_count * sizeof(io_ring_completion), B_PAGE_SIZE);
+
+	// Create the area in the team's address space. It's a kernel area, so
+	// that userland cannot delete or resize it under our feet.
+	ring->team = team_get_current_team_id();
+
+	void* address;
+	virtual_address_restrictions virtualRestrictions = {};
+	virtualRestrictions.address_specification = B_RANDOMIZED_ANY_ADDRESS;
+	physical_address_restrictions physicalRestrictions = {};
+	ring->area = create_area_etc(ring->team, "io ring", size, B_NO_LOCK,
+		B_READ_AREA | B_WRITE_AREA | B_KERNEL_AREA, 0, 0,
+		&virtualRestrictions, &physicalRestrictions, &address);
+	if (ring->area < 0)
+		return ring->area;
+
+	ring->address = (addr_t)address;
+	ring->submissions = ring->address + submissionOffset;
+	ring->completions = ring->address + completionOffset;
+
+	io_ring_header header = {};
+	header.submission_count = ring->submission_count;
+	header.submission_offset = submissionOffset;
+	header.completion_count = ring->completion_count;
+	header.completion_offset = completionOffset;
+
+	if (user_memcpy(address, &header, sizeof(header)) != B_OK
+		|| user_memcpy(_userAddress, &address, sizeof(void*)) != B_OK) {
+		vm_delete_area(ring->team, ring->area, true);
+		return B_BAD_ADDRESS;
+	}
+
+	mutex_init(&ring->lock, "io ring");
+
+	file_descriptor* descriptor = alloc_fd();
+	if (descriptor == NULL) {
+		mutex_destroy(&ring->lock);
+		vm_delete_area(ring->team, ring->area, true);
+		return B_NO_MEMORY;
+	}
+
+	descriptor->ops = &sIORingFDOps;
+	descriptor->cookie = ring;
+	descriptor->open_mode = O_RDWR | openFlags;
+
+	io_context* context = get_current_io_context(false);
+	int fd = new_fd(context, descriptor);
+	if (fd < 0) {
+		free(descriptor);
+		mutex_destroy(&ring->lock);
+		vm_delete_area(ring->team, ring->area, true);
+		return fd;
+	}
+
+	rw_lock_write_lock(&context->lock);
+	fd_set_close_on_exec(context, fd, (openFlags & O_CLOEXEC) != 0);
+	rw_lock_write_unlock(&context->lock);
+
+	TRACE("created ring %p, fd %d, area %" B_PRId32 " at %p\n", ring, fd,
+		ring->area, address);
+
+	ringDeleter.Detach();
+	return fd;
+}
+
+
+ssize_t
+_user_io_ring_enter(int fd, uint32 toSubmit, uint32 flags)
+{
+	if (flags != 0)
+		return B_BAD_VALUE;
+
+	file_descriptor* descriptor;
+	status_t status = get_ring_descriptor(fd, descriptor);
+	if (status != B_OK)
+		return status;
+	FileDescriptorPutter _(descriptor);
+
+	io_ring* ring = (io_ring*)descriptor->cookie;
+
+	// The area is only mapped in the team that created the ring (a forked
+	// child only has a copy of it).
+	if (ring->team != team_get_current_team_id())
+		return B_NOT_ALLOWED;
+
+	if (toSubmit == 0)
+		return 0;
+
+	return process_submissions(ring, toSubmit);
+}
@@ -18,12 +18,14 @@
 #include <syscall_utils.h>
 
 #include <fd.h>
+#include <file_cache.h>
 #include <kernel.h>
 #include <lock.h>
 #include <syscall_restart.h>
 #include <util/AutoLock.h>
 #include <util/iovec_support.h>
 #include <vfs.h>
+#include <vm/vm.h>
 
 #include <net_stack_interface.h>
 #include <net_stat.h>
@@ -42,6 +44,20 @@
 
 #define FD_SOCKET(descriptor) ((net_socket*)descriptor->cookie)
 
+#define SENDFILE_CHUNK_PAGES		16
+#define SENDFILE_CHUNK_SIZE			(SENDFILE_CHUNK_PAGES * B_PAGE_SIZE)
+
+
+#if B_HAIKU_64_BIT
+struct sendfile_pages {
+	VMCache*	cache;
+	uint32		count;
+	vm_page*	pages[SENDFILE_CHUNK_PAGES];
+	addr_t		addresses[SENDFILE_CHUNK_PAGES];
+	void*		handles[SENDFILE_CHUNK_PAGES];
+};
+#endif
+
 
 static net_stack_interface_module_info* sStackInterface = NULL;
 static int32 sStackInterfaceConsumers = 0;
@@ -580,6 +596,176 @@ common_sendmsg(int fd, const struct msghdr *message, int flags, bool kernel)
 }
 
 
+#if B_HAIKU_64_BIT
+static void
+release_sendfile_pages(void* cookie)
+{
+	sendfile_pages* pages = (sendfile_pages*)cookie;
+
+	for (uint32 i = 0; i < pages->count; i++)
+		vm_put_physical_page(pages->addresses[i], pages->handles[i]);
+
+	cache_unwire_pages(pages->cache, pages->pages, pages->count);
+	free(pages);
+}
+
+
+/*!	Hands the file cache pages of the given range over to the socket,
+	without copying them. They stay wired until the stack has released them,
+	which is when the peer acknowledged them in case of TCP.
+	Returns 0 if no pages could be wired, and \c B_UNSUPPORTED if either the
+	file or the socket do not support this.
+*/
+static ssize_t
+send_file_pages(net_socket* socket, file_descriptor* file, off_t offset,
+	size_t size)
+{
+	sendfile_pages* pages = (sendfile_pages*)malloc(sizeof(sendfile_pages));
+	if (pages == NULL)
+		return B_NO_MEMORY;
+
+	pages->count = SENDFILE_CHUNK_PAGES;
+	status_t status = cache_wire_pages(file->u.vnode, file->cookie, offset,
+		&size, &pages->cache, pages->pages, &pages->count);
+	if (status != B_OK) {
+		free(pages);
+		return status;
+	}
+
+	iovec vecs[SENDFILE_CHUNK_PAGES];
+	size_t pageOffset = offset % B_PAGE_SIZE;
+	uint32 mapped = 0;
+
+	for (; mapped < pages->count; mapped++) {
+		status = vm_get_physical_page(
+			(phys_addr_t)pages->pages[mapped]->physical_page_number
+				* B_PAGE_SIZE,
+			&pages->addresses[mapped], &pages->handles[mapped]);
+		if (status != B_OK)
+			break;
+
+		size_t bytes = min_c(size, B_PAGE_SIZE - pageOffset);
+		vecs[mapped].iov_base = (void*)(pages->addresses[mapped] + pageOffset);
+		vecs[mapped].iov_len = bytes;
+
+		size -= bytes;
+		pageOffset = 0;
+	}
+
+	if (mapped < pages->count || pages->count == 0) {
+		uint32 count = pages->count;
+		pages->count = mapped;
+		for (uint32 i = 0; i < mapped; i++)
+			vm_put_physical_page(pages->addresses[i], pages->handles[i]);
+
+		cache_unwire_pages(pages->cache, pages->pages, count);
+		free(pages);
+		return status;
+	}
+
+	return sStackInterface->send_external(socket, vecs, pages->count,
+		&release_sendfile_pages, pages, 0);
+}
+#endif	// B_HAIKU_64_BIT
+
+
+static ssize_t
+send_file_data(net_socket* socket, file_descriptor* file, off_t offset,
+	size_t size, void* buffer)
+{
+	status_t status = file->ops->fd_read(file, offset, buffer, &size);
+	if (status != B_OK)
+		return status;
+	if (size == 0)
+		return 0;
+
+	return sStackInterface->send(socket, buffer, size, 0);
+}
+
+
+/*!	Sends \a count bytes of the file \a fd, starting at \a _offset, or at
+	the file position, if \a _offset is \c NULL. Whatever is in the file
+	cache is passed to the stack without copying it; everything else is
+	read into a temporary buffer first.
+*/
+static ssize_t
+common_sendfile(int socketFD, int fd, off_t* _offset, size_t count,
+	bool kernel)
+{
+	file_descriptor* descriptor;
+	GET_SOCKET_FD_OR_RETURN(socketFD, kernel, descriptor);
+	FileDescriptorPutter _(descriptor);
+
+	FileDescriptorPutter file(get_fd(get_current_io_context(kernel), fd));
+	if (!file.IsSet())
+		return EBADF;
+	if (!fd_is_file(file.Get()) || (file->open_mode & O_RWMASK) == O_WRONLY)
+		return EBADF;
+
+	off_t offset = _offset != NULL ? *_offset : file->pos;
+	if (offset < 0)
+		return B_BAD_VALUE;
+	if (count > SSIZE_MAX)
+		count = SSIZE_MAX;
+
+	net_socket* socket = FD_SOCKET(descriptor);
+	MemoryDeleter bufferDeleter;
+	ssize_t bytesSent = 0;
+#if B_HAIKU_64_BIT
+	bool zeroCopy = true;
+#endif
+
+	while ((size_t)bytesSent < count) {
+		size_t size = min_c(count - bytesSent,
+			SENDFILE_CHUNK_SIZE - offset % B_PAGE_SIZE);
+		ssize_t sent = 0;
+
+#if B_HAIKU_64_BIT
+		if (zeroCopy) {
+			sent = send_file_pages(socket, file.Get(), offset, size);
+			if (sent == B_UNSUPPORTED) {
+				zeroCopy = false;
+				sent = 0;
+			}
+		}
+#endif
+
+		if (sent == 0) {
+			// copy whatever could not be sent from the cache
+			if (!bufferDeleter.IsSet())
+				bufferDeleter.SetTo(malloc(SENDFILE_CHUNK_SIZE));
+			if (!bufferDeleter.IsSet())
+				sent = B_NO_MEMORY;
+			else {
+				sent = send_file_data(socket, file.Get(), offset, size,
+					bufferDeleter.Get());
+			}
+		}
+
+		if (sent <= 0) {
+			if (bytesSent == 0)
+				bytesSent = sent;
+			break;
+		}
+
+		bytesSent += sent;
+		offset += sent;
+
+		if ((size_t)sent < size)
+			break;
+	}
+
+	if (bytesSent > 0) {
+		if (_offset != NULL)
+			*_offset = offset;
+		else
+			file->pos = offset;
+	}
+
+	return bytesSent;
+}
+
+
 static status_t
 common_getsockopt(int fd, int level, int option, void *value,
 	socklen_t *_length, bool kernel)
@@ -802,6 +988,14 @@ sendmsg(int socket, const struct msghdr *message, int flags)
 }
 
 
+ssize_t
+sendfile(int socket, int fd, off_t *_offset, size_t count)
+{
+	SyscallFlagUnsetter _;
+	RETURN_AND_SET_ERRNO(common_sendfile(socket, fd, _offset, count, true));
+}
+
+
 int
 getsockopt(int socket, int level, int option, void *value, socklen_t *_length)
 {
@@ -1157,6 +1351,29 @@ _user_sendmsg(int socket, const struct msghdr *userMessage, int flags)
 }
 
 
+ssize_t
+_user_sendfile(int socket, int fd, off_t *userOffset, size_t count)
+{
+	off_t offset;
+	if (userOffset != NULL) {
+		if (!IS_USER_ADDRESS(userOffset)
+			|| user_memcpy(&offset, userOffset, sizeof(off_t)) != B_OK) {
+			return B_BAD_ADDRESS;
+		}
+	}
+
+	SyscallRestartWrapper<ssize_t> result;
+	result = common_sendfile(socket, fd, userOffset != NULL ? &offset : NULL,
+		count, false);
+	if (result > 0 && userOffset != NULL
+		&& user_memcpy(userOffset, &offset, sizeof(off_t)) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return result;
+}
+
+
 status_t
 _user_getsockopt(int socket, int level, int option, void *userValue,
 	socklen_t *_length)
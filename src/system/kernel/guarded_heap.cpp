@@ -1094,4 +1094,11 @@ slab_init_post_thread()
 }
 
 
+status_t
+_user_get_next_object_cache_info(int32* cookie, object_cache_info* info)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
 #endif	// USE_GUARDED_HEAP_FOR_OBJECT_CACHE
@@ -90,12 +90,29 @@
 
 namespace {
 
+struct port_transfer {
+	enum State {
+		kQueued = 0,
+		kReading,
+		kDone
+	};
+
+	ConditionVariable	condition;
+	physical_entry*		entries;
+	uint32				entry_count;
+	int32				state;
+		// protected by the lock of the port the message was written to
+};
+
 struct port_message : DoublyLinkedListLinkImpl<port_message> {
 	int32				code;
 	size_t				size;
 	uid_t				sender;
 	gid_t				sender_group;
 	team_id				sender_team;
+	port_transfer*		transfer;
+		// if not NULL, the message contents are not in the buffer, but
+		// in the sender's (locked) memory
 	char				buffer[0];
 };
 
@@ -444,6 +461,11 @@ static const size_t kBufferGrowRate = kInitialPortBufferSize;
 
 #define MAX_QUEUE_LENGTH 4096
 #define PORT_MAX_MESSAGE_SIZE (256 * 1024)
+#define PORT_MAX_ZERO_COPY_MESSAGE_SIZE (16 * 1024 * 1024)
+
+// messages below this size are always copied, even if the sender asked for
+// B_ZERO_COPY_PORT_MESSAGE
+static const size_t kMinZeroCopyMessageSize = 16 * 1024;
 
 static int32 sMaxPorts = 4096;
 static int32 sUsedPorts;
@@ -669,7 +691,9 @@ is_port_closed(Port* port)
 static void
 put_port_message(port_message* message)
 {
-	const size_t size = sizeof(port_message) + message->size;
+	size_t size = sizeof(port_message);
+	if (message->transfer == NULL)
+		size += message->size;
 	free(message);
 
 	atomic_add(&sTotalSpaceCommited, -size);
@@ -737,6 +761,7 @@ get_port_message(int32 code, size_t bufferSize, uint32 flags, bigtime_t timeout,
 		if (message != NULL) {
 			message->code = code;
 			message->size = bufferSize;
+			message->transfer = NULL;
 
 			*_message = message;
 			return B_OK;
@@ -779,19 +804,147 @@ copy_port_message(port_message* message, int32* _code, void* buffer,
 	if (_code != NULL)
 		*_code = message->code;
 
-	if (size > 0) {
-		if (userCopy) {
-			status_t status = user_memcpy(buffer, message->buffer, size);
+	if (size == 0)
+		return 0;
+
+	if (message->transfer != NULL) {
+		// copy directly from the sender's pages
+		port_transfer* transfer = message->transfer;
+		size_t bytesLeft = size;
+		for (uint32 i = 0; i < transfer->entry_count && bytesLeft > 0; i++) {
+			size_t bytes = std::min(bytesLeft,
+				(size_t)transfer->entries[i].size);
+			status_t status = vm_memcpy_from_physical(buffer,
+				transfer->entries[i].address, bytes, userCopy);
 			if (status != B_OK)
 				return status;
-		} else
-			memcpy(buffer, message->buffer, size);
-	}
+
+			buffer = (uint8*)buffer + bytes;
+			bytesLeft -= bytes;
+		}
+	} else if (userCopy) {
+		status_t status = user_memcpy(buffer, message->buffer, size);
+		if (status != B_OK)
+			return status;
+	} else
+		memcpy(buffer, message->buffer, size);
 
 	return size;
 }
 
 
+static void unlock_port_transfer_memory(const iovec* vecs, size_t vecCount,
+	size_t bufferSize);
+
+
+/*!	Locks the memory of the given vectors, and retrieves the physical pages
+	backing it, so that a receiver can copy the message directly from there.
+	Must be undone by freeing the entries, and calling
+	unlock_port_transfer_memory().
+*/
+static status_t
+init_port_transfer(port_transfer& transfer, const iovec* vecs,
+	size_t vecCount, size_t bufferSize)
+{
+	transfer.condition.Init(&transfer, "port transfer");
+	transfer.state = port_transfer::kQueued;
+	transfer.entry_count = 0;
+
+	size_t maxEntries = bufferSize / B_PAGE_SIZE + 2 * vecCount;
+	transfer.entries = (physical_entry*)malloc(
+		maxEntries * sizeof(physical_entry));
+	if (transfer.entries == NULL)
+		return B_NO_MEMORY;
+
+	size_t bytesLeft = bufferSize;
+	for (uint32 i = 0; i < vecCount && bytesLeft > 0; i++) {
+		size_t bytes = std::min(bytesLeft, vecs[i].iov_len);
+		if (bytes == 0)
+			continue;
+
+		// we only need to read from the memory, hence B_READ_DEVICE
+		status_t status = lock_memory_etc(B_CURRENT_TEAM, vecs[i].iov_base,
+			bytes, B_READ_DEVICE);
+		if (status == B_OK) {
+			uint32 entryCount = maxEntries - transfer.entry_count;
+			status = get_memory_map_etc(B_CURRENT_TEAM, vecs[i].iov_base,
+				bytes, transfer.entries + transfer.entry_count, &entryCount);
+			if (status != B_OK) {
+				unlock_memory_etc(B_CURRENT_TEAM, vecs[i].iov_base, bytes,
+					B_READ_DEVICE);
+			} else
+				transfer.entry_count += entryCount;
+		}
+		if (status != B_OK) {
+			unlock_port_transfer_memory(vecs, i, bufferSize);
+			free(transfer.entries);
+			return status;
+		}
+
+		bytesLeft -= bytes;
+	}
+
+	return B_OK;
+}
+
+
+static void
+unlock_port_transfer_memory(const iovec* vecs, size_t vecCount,
+	size_t bufferSize)
+{
+	for (uint32 i = 0; i < vecCount && bufferSize > 0; i++) {
+		size_t bytes = std::min(bufferSize, vecs[i].iov_len);
+		if (bytes == 0)
+			continue;
+
+		unlock_memory_etc(B_CURRENT_TEAM, vecs[i].iov_base, bytes,
+			B_READ_DEVICE);
+		bufferSize -= bytes;
+	}
+}
+
+
+/*!	Waits until the receiver has read the message, or removes it from the
+	port again if that didn't happen until the wait failed.
+	The port must be locked.
+*/
+static status_t
+wait_for_port_transfer(Port* port, port_message* message,
+	ConditionVariableEntry& entry, MutexLocker& locker, uint32 flags,
+	bigtime_t timeout)
+{
+	port_transfer* transfer = message->transfer;
+
+	locker.Unlock();
+	status_t status = entry.Wait(flags, timeout);
+	locker.Lock();
+
+	if (transfer->state == port_transfer::kQueued) {
+		// Nobody has picked up the message yet -- we either timed out, got
+		// interrupted, or the port has been deleted.
+		port->messages.Remove(message);
+		port->read_count--;
+		port->write_count++;
+		notify_port_select_events(port, B_EVENT_WRITE);
+		port->write_condition.NotifyOne();
+
+		put_port_message(message);
+		return status != B_OK ? status : B_BAD_PORT_ID;
+	}
+
+	// The message has been dequeued already; the reader is accessing our
+	// memory, so we have to wait for it in any case.
+	while (transfer->state != port_transfer::kDone) {
+		transfer->condition.Add(&entry);
+		locker.Unlock();
+		entry.Wait();
+		locker.Lock();
+	}
+
+	return B_OK;
+}
+
+
 static void
 uninit_port(Port* port)
 {
@@ -804,6 +957,15 @@ uninit_port(Port* port)
 	// read_port() will see the B_BAD_PORT_ID return value, and act accordingly
 	port->read_condition.NotifyAll(B_BAD_PORT_ID);
 	port->write_condition.NotifyAll(B_BAD_PORT_ID);
+
+	// Zero-copy senders are waiting for their messages to be read, which
+	// won't happen anymore; they will remove the messages themselves.
+	for (MessageList::Iterator it = port->messages.GetIterator();
+			port_message* message = it.Next();) {
+		if (message->transfer != NULL)
+			message->transfer->condition.NotifyAll(B_BAD_PORT_ID);
+	}
+
 	sNotificationService.Notify(PORT_REMOVED, port->id);
 }
 
@@ -1517,6 +1679,10 @@ read_port_etc(port_id id, int32* _code, void* buffer, size_t bufferSize,
 	portRef->write_count++;
 	portRef->read_count--;
 
+	port_transfer* transfer = message->transfer;
+	if (transfer != NULL)
+		transfer->state = port_transfer::kReading;
+
 	notify_port_select_events(portRef, B_EVENT_WRITE);
 	portRef->write_condition.NotifyOne();
 		// make one spot in queue available again for write
@@ -1528,6 +1694,15 @@ read_port_etc(port_id id, int32* _code, void* buffer, size_t bufferSize,
 	size_t size = copy_port_message(message, _code, buffer, bufferSize,
 		userCopy);
 
+	if (transfer != NULL) {
+		// let the sender continue; it owns the transfer, so we must not
+		// touch it anymore after unlocking
+		locker.Lock();
+		transfer->state = port_transfer::kDone;
+		transfer->condition.NotifyAll();
+		locker.Unlock();
+	}
+
 	put_port_message(message);
 	return size;
 }
@@ -1552,17 +1727,11 @@ write_port_etc(port_id id, int32 msgCode, const void* buffer,
 }
 
 
-status_t
-writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
-	size_t vecCount, size_t bufferSize, uint32 flags, bigtime_t timeout)
+static status_t
+writev_port_message(port_id id, int32 msgCode, const iovec* msgVecs,
+	size_t vecCount, size_t bufferSize, bool userCopy,
+	port_transfer* transfer, uint32 flags, bigtime_t timeout)
 {
-	if (!sPortsActive || id < 0)
-		return B_BAD_PORT_ID;
-	if (bufferSize > PORT_MAX_MESSAGE_SIZE)
-		return B_BAD_VALUE;
-
-	bool userCopy = (flags & PORT_FLAG_USE_USER_MEMCPY) != 0;
-
 	// mask irrelevant flags (for acquire_sem() usage)
 	flags &= B_CAN_INTERRUPT | B_KILL_CAN_INTERRUPT | B_RELATIVE_TIMEOUT
 		| B_ABSOLUTE_TIMEOUT;
@@ -1576,6 +1745,7 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 
 	status_t status;
 	port_message* message = NULL;
+	ConditionVariableEntry transferEntry;
 
 	// get the port
 	BReference<Port> portRef = get_locked_port(id);
@@ -1623,8 +1793,8 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 	} else
 		portRef->write_count--;
 
-	status = get_port_message(msgCode, bufferSize, flags, timeout,
-		&message, *portRef);
+	status = get_port_message(msgCode, transfer != NULL ? 0 : bufferSize,
+		flags, timeout, &message, *portRef);
 	if (status != B_OK) {
 		if (status == B_BAD_PORT_ID) {
 			// the port had to be unlocked and is now no longer there
@@ -1640,7 +1810,10 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 	message->sender_group = getegid();
 	message->sender_team = team_get_current_team_id();
 
-	if (bufferSize > 0) {
+	if (transfer != NULL) {
+		message->size = bufferSize;
+		message->transfer = transfer;
+	} else if (bufferSize > 0) {
 		size_t offset = 0;
 		for (uint32 i = 0; i < vecCount; i++) {
 			size_t bytes = msgVecs[i].iov_len;
@@ -1665,6 +1838,9 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 		}
 	}
 
+	if (transfer != NULL)
+		transfer->condition.Add(&transferEntry);
+
 	portRef->messages.Add(message);
 	portRef->read_count++;
 
@@ -1673,6 +1849,13 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 
 	notify_port_select_events(portRef, B_EVENT_READ);
 	portRef->read_condition.NotifyOne();
+
+	if (transfer != NULL) {
+		// we must not return before the receiver is done with our memory
+		return wait_for_port_transfer(portRef, message, transferEntry, locker,
+			flags, timeout);
+	}
+
 	return B_OK;
 
 error:
@@ -1687,6 +1870,43 @@ error:
 }
 
 
+status_t
+writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
+	size_t vecCount, size_t bufferSize, uint32 flags, bigtime_t timeout)
+{
+	if (!sPortsActive || id < 0)
+		return B_BAD_PORT_ID;
+
+	bool userCopy = (flags & PORT_FLAG_USE_USER_MEMCPY) != 0;
+	bool zeroCopy = (flags & B_ZERO_COPY_PORT_MESSAGE) != 0
+		&& bufferSize >= kMinZeroCopyMessageSize;
+
+	if (bufferSize > (zeroCopy
+			? PORT_MAX_ZERO_COPY_MESSAGE_SIZE : PORT_MAX_MESSAGE_SIZE))
+		return B_BAD_VALUE;
+
+	// Lock the sender's memory before acquiring the port, since that might
+	// need to page in memory.
+	port_transfer transfer;
+	if (zeroCopy) {
+		status_t status = init_port_transfer(transfer, msgVecs, vecCount,
+			bufferSize);
+		if (status != B_OK)
+			return status;
+	}
+
+	status_t status = writev_port_message(id, msgCode, msgVecs, vecCount,
+		bufferSize, userCopy, zeroCopy ? &transfer : NULL, flags, timeout);
+
+	if (zeroCopy) {
+		unlock_port_transfer_memory(msgVecs, vecCount, bufferSize);
+		free(transfer.entries);
+	}
+
+	return status;
+}
+
+
 status_t
 set_port_owner(port_id id, team_id newTeamID)
 {
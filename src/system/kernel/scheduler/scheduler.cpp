@@ -28,6 +28,7 @@
 #include <smp.h>
 #include <timer.h>
 #include <util/Random.h>
+#include <vm/vm_page.h>
 
 #include "scheduler_common.h"
 #include "scheduler_cpu.h"
@@ -50,6 +51,7 @@ scheduler_mode gCurrentModeID;
 scheduler_mode_operations* gCurrentMode;
 
 bool gSingleCore;
+bool gMultipleMemoryNodes;
 bool gTrackCoreLoad;
 bool gTrackCPULoad;
 
@@ -66,6 +68,7 @@ spinlock gSchedulerListenersLock = B_SPINLOCK_INITIALIZER;
 static scheduler_mode_operations* sSchedulerModes[] = {
 	&gSchedulerLowLatencyMode,
 	&gSchedulerPowerSavingMode,
+	&gSchedulerThroughputMode,
 };
 
 // Since CPU IDs used internally by the kernel bear no relation to the actual
@@ -548,7 +551,8 @@ status_t
 scheduler_set_operation_mode(scheduler_mode mode)
 {
 	if (mode != SCHEDULER_MODE_LOW_LATENCY
-		&& mode != SCHEDULER_MODE_POWER_SAVING) {
+		&& mode != SCHEDULER_MODE_POWER_SAVING
+		&& mode != SCHEDULER_MODE_THROUGHPUT) {
 		return B_BAD_VALUE;
 	}
 
@@ -688,6 +692,7 @@ init()
 
 	// disable parts of the scheduler logic that are not needed
 	gSingleCore = coreCount == 1;
+	gMultipleMemoryNodes = vm_page_memory_node_count() > 1;
 	scheduler_update_policy();
 
 	gCoreCount = coreCount;
@@ -718,7 +723,7 @@ init()
 		PackageEntry* package = &gPackageEntries[sCPUToPackage[i]];
 
 		package->Init(sCPUToPackage[i]);
-		core->Init(sCPUToCore[i], package);
+		core->Init(sCPUToCore[i], package, vm_page_cpu_memory_node(i));
 		gCPUEntries[i].Init(i, core);
 
 		core->AddCPU(&gCPUEntries[i]);
@@ -873,3 +878,23 @@ _user_get_scheduler_mode()
 	return gCurrentModeID;
 }
 
+
+status_t
+_user_get_scheduler_cpu_stats(int32 cpu, scheduler_cpu_stats* userStats,
+	size_t size)
+{
+	if (userStats == NULL || !IS_USER_ADDRESS(userStats))
+		return B_BAD_ADDRESS;
+	if (size != sizeof(scheduler_cpu_stats))
+		return B_BAD_VALUE;
+	if (cpu < 0 || cpu >= smp_get_num_cpus())
+		return B_BAD_INDEX;
+
+	scheduler_cpu_stats stats;
+	CPUEntry::GetCPU(cpu)->GetStatistics(stats);
+
+	if (user_memcpy(userStats, &stats, sizeof(stats)) != B_OK)
+		return B_BAD_ADDRESS;
+
+	return B_OK;
+}
@@ -43,6 +43,7 @@ const int kVeryHighLoad = (kMaxLoad + kHighLoad) / 2;
 const int kLoadDifference = kMaxLoad * 20 / 100;
 
 extern bool gSingleCore;
+extern bool gMultipleMemoryNodes;
 extern bool gTrackCoreLoad;
 extern bool gTrackCPULoad;
 
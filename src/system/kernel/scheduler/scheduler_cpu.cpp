@@ -56,6 +56,36 @@ static CPUPriorityHeap sDebugCPUHeap;
 static CoreLoadHeap sDebugCoreHeap;
 
 
+/*!	Returns the number of bits needed to represent \a value, but at most
+	\a bucketCount - 1, which makes it the histogram bucket for it.
+*/
+static inline int32
+histogram_bucket(bigtime_t value, int32 bucketCount)
+{
+	int32 bucket = 0;
+	while (value > 0 && bucket < bucketCount - 1) {
+		value >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+
+static inline int32
+priority_band(int32 priority)
+{
+	if (priority < B_NORMAL_PRIORITY)
+		return SCHEDULER_BAND_LOW;
+	if (priority < B_DISPLAY_PRIORITY)
+		return SCHEDULER_BAND_NORMAL;
+	if (priority < B_URGENT_DISPLAY_PRIORITY)
+		return SCHEDULER_BAND_DISPLAY;
+	if (priority < B_FIRST_REAL_TIME_PRIORITY)
+		return SCHEDULER_BAND_URGENT;
+	return SCHEDULER_BAND_REAL_TIME;
+}
+
+
 void
 ThreadRunQueue::Dump() const
 {
@@ -86,6 +116,8 @@ CPUEntry::CPUEntry()
 {
 	B_INITIALIZE_RW_SPINLOCK(&fSchedulerModeLock);
 	B_INITIALIZE_SPINLOCK(&fQueueLock);
+
+	memset(&fStats, 0, sizeof(fStats));
 }
 
 
@@ -94,6 +126,8 @@ CPUEntry::Init(int32 id, CoreEntry* core)
 {
 	fCPUNumber = id;
 	fCore = core;
+
+	fStats.cpu = id;
 }
 
 
@@ -277,8 +311,14 @@ CPUEntry::TrackActivity(ThreadData* oldThreadData, ThreadData* nextThreadData)
 		fCore->IncreaseActiveTime(active);
 
 		oldThreadData->UpdateActivity(active);
+
+		fStats.run_time[priority_band(oldThreadData->GetEffectivePriority())]
+			+= active;
 	}
 
+	if (nextThreadData != oldThreadData)
+		_TrackDispatch(nextThreadData);
+
 	if (gTrackCPULoad) {
 		if (!cpuEntry->disabled)
 			ComputeLoad();
@@ -295,6 +335,16 @@ CPUEntry::TrackActivity(ThreadData* oldThreadData, ThreadData* nextThreadData)
 }
 
 
+void
+CPUEntry::GetStatistics(scheduler_cpu_stats& stats) const
+{
+	// The counters are only changed by this CPU, without any locking. Since
+	// they are only ever increased, reading them from another CPU at worst
+	// gets some slightly outdated values.
+	memcpy(&stats, &fStats, sizeof(stats));
+}
+
+
 void
 CPUEntry::StartQuantumTimer(ThreadData* thread, bool wasPreempted)
 {
@@ -348,6 +398,46 @@ CPUEntry::_RequestPerformanceLevel(ThreadData* threadData)
 }
 
 
+void
+CPUEntry::_TrackDispatch(ThreadData* threadData)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	fStats.context_switches++;
+
+	fStats.queue_depths[histogram_bucket(fCore->QueuedThreadCount(),
+		SCHEDULER_QUEUE_DEPTH_BUCKETS)]++;
+
+	Thread* thread = threadData->GetThread();
+	if (thread_is_idle_thread(thread))
+		return;
+
+	// previous_cpu is only updated once the thread is switched to
+	if (thread->previous_cpu != NULL
+		&& CoreEntry::GetCore(thread->previous_cpu->cpu_num) != fCore) {
+		fStats.migrations++;
+	}
+
+	bool wokenUp;
+	bigtime_t queueTime = threadData->LeavesRunQueue(wokenUp);
+	if (queueTime < 0)
+		return;
+
+	int32 band = priority_band(threadData->GetEffectivePriority());
+	fStats.dispatches[band]++;
+	fStats.queue_time[band] += queueTime;
+
+	if (wokenUp) {
+		fStats.wakeups++;
+		fStats.total_wakeup_latency += queueTime;
+		fStats.max_wakeup_latency
+			= std::max(fStats.max_wakeup_latency, queueTime);
+		fStats.wakeup_latencies[histogram_bucket(queueTime,
+			SCHEDULER_LATENCY_BUCKETS)]++;
+	}
+}
+
+
 /* static */ int32
 CPUEntry::_RescheduleEvent(timer* /* unused */)
 {
@@ -402,6 +492,7 @@ CPUPriorityHeap::Dump()
 
 CoreEntry::CoreEntry()
 	:
+	fMemoryNode(0),
 	fCPUCount(0),
 	fIdleCPUCount(0),
 	fThreadCount(0),
@@ -420,10 +511,11 @@ CoreEntry::CoreEntry()
 
 
 void
-CoreEntry::Init(int32 id, PackageEntry* package)
+CoreEntry::Init(int32 id, PackageEntry* package, uint32 memoryNode)
 {
 	fCoreID = id;
 	fPackage = package;
+	fMemoryNode = memoryNode;
 }
 
 
@@ -714,9 +806,10 @@ DebugDumper::DumpCoreLoadHeapEntry(CoreEntry* entry)
 	thread_map(DebugDumper::_AnalyzeCoreThreads, &threadsData);
 
 	kprintf("%4" B_PRId32 " %11" B_PRId32 "%% %11" B_PRId32 "%% %11" B_PRId32
-		"%% %7" B_PRId32 " %5" B_PRIu32 "\n", entry->ID(), entry->fLoad / 10,
-		entry->fCurrentLoad / 10, threadsData.fLoad, entry->ThreadCount(),
-		entry->fLoadMeasurementEpoch);
+		"%% %7" B_PRId32 " %5" B_PRIu32 " %4" B_PRIu32 "\n", entry->ID(),
+		entry->fLoad / 10, entry->fCurrentLoad / 10, threadsData.fLoad,
+		entry->ThreadCount(), entry->fLoadMeasurementEpoch,
+		entry->fMemoryNode);
 }
 
 
@@ -769,7 +862,7 @@ dump_run_queue(int /* argc */, char** /* argv */)
 static int
 dump_cpu_heap(int /* argc */, char** /* argv */)
 {
-	kprintf("core average_load current_load threads_load threads epoch\n");
+	kprintf("core average_load current_load threads_load threads epoch node\n");
 	gCoreLoadHeap.Dump();
 	kprintf("\n");
 	gCoreHighLoadHeap.Dump();
@@ -15,6 +15,7 @@
 #include <util/MinMaxHeap.h>
 
 #include <cpufreq.h>
+#include <scheduler_defs.h>
 
 #include "RunQueue.h"
 #include "scheduler_common.h"
@@ -86,11 +87,15 @@ public:
 						void			StartQuantumTimer(ThreadData* thread,
 											bool wasPreempted);
 
+						void			GetStatistics(
+											scheduler_cpu_stats& stats) const;
+
 	static inline		CPUEntry*		GetCPU(int32 cpu);
 
 private:
 						void			_RequestPerformanceLevel(
 											ThreadData* threadData);
+						void			_TrackDispatch(ThreadData* threadData);
 
 	static				int32			_RescheduleEvent(timer* /* unused */);
 	static				int32			_UpdateLoadEvent(timer* /* unused */);
@@ -110,6 +115,9 @@ private:
 
 						bool			fUpdateLoadEvent;
 
+						scheduler_cpu_stats	fStats;
+							// only changed by the CPU itself
+
 						friend class DebugDumper;
 } CACHE_LINE_ALIGN;
 
@@ -126,10 +134,13 @@ class CoreEntry : public MinMaxHeapLinkImpl<CoreEntry, int32>,
 public:
 										CoreEntry();
 
-						void			Init(int32 id, PackageEntry* package);
+						void			Init(int32 id, PackageEntry* package,
+											uint32 memoryNode);
 
 	inline				int32			ID() const	{ return fCoreID; }
 	inline				PackageEntry*	Package() const	{ return fPackage; }
+	inline				uint32			MemoryNode() const
+											{ return fMemoryNode; }
 	inline				int32			CPUCount() const
 											{ return fCPUCount; }
 	inline				const CPUSet&	CPUMask() const
@@ -141,6 +152,8 @@ public:
 	inline				CPUPriorityHeap*	CPUHeap();
 
 	inline				int32			ThreadCount() const;
+	inline				int32			QueuedThreadCount() const
+											{ return fThreadCount; }
 
 	inline				void			LockRunQueue();
 	inline				void			UnlockRunQueue();
@@ -183,6 +196,7 @@ private:
 
 						int32			fCoreID;
 						PackageEntry*	fPackage;
+						uint32			fMemoryNode;
 
 						int32			fCPUCount;
 						CPUSet			fCPUSet;
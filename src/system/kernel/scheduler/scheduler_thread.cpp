@@ -28,6 +28,9 @@ ThreadData::_InitBase()
 	fEnqueued = false;
 	fReady = false;
 
+	fEnqueueTime = 0;
+	fWokenUp = false;
+
 	fPriorityPenalty = 0;
 	fAdditionalPenalty = 0;
 
@@ -48,7 +51,7 @@ ThreadData::_ChooseCore() const
 	SCHEDULER_ENTER_FUNCTION();
 
 	ASSERT(!gSingleCore);
-	return gCurrentMode->choose_core(this);
+	return _PreferMemoryNode(gCurrentMode->choose_core(this));
 }
 
 
@@ -95,6 +98,48 @@ ThreadData::_ChooseCPU(CoreEntry* core, bool& rescheduleNeeded) const
 }
 
 
+/*!	Returns the least loaded core on the thread's memory node instead of
+	\a core, as long as it isn't considerably more loaded than \a core.
+	Running on another node than the one its memory is on makes every cache
+	miss of the thread a remote memory access.
+*/
+CoreEntry*
+ThreadData::_PreferMemoryNode(CoreEntry* core) const
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	if (!gMultipleMemoryNodes || fMemoryNode < 0
+		|| core->MemoryNode() == (uint32)fMemoryNode) {
+		return core;
+	}
+
+	CPUSet mask = GetCPUMask();
+	const bool useMask = !mask.IsEmpty();
+
+	CoreEntry* localCore = NULL;
+	int32 localLoad = 0;
+	for (int32 i = 0; i < gCoreCount; i++) {
+		CoreEntry* candidate = &gCoreEntries[i];
+		if (candidate->MemoryNode() != (uint32)fMemoryNode
+			|| candidate->CPUCount() == 0
+			|| (useMask && !candidate->CPUMask().Matches(mask))) {
+			continue;
+		}
+
+		int32 load = candidate->GetLoad();
+		if (localCore == NULL || load < localLoad) {
+			localCore = candidate;
+			localLoad = load;
+		}
+	}
+
+	if (localCore != NULL && localLoad <= core->GetLoad() + kLoadDifference)
+		return localCore;
+
+	return core;
+}
+
+
 ThreadData::ThreadData(Thread* thread)
 	:
 	fThread(thread)
@@ -107,6 +152,7 @@ ThreadData::Init()
 {
 	_InitBase();
 	fCore = NULL;
+	fMemoryNode = -1;
 
 	Thread* currentThread = thread_get_current_thread();
 	ThreadData* currentThreadData = currentThread->scheduler_data;
@@ -128,6 +174,7 @@ ThreadData::Init(CoreEntry* core)
 	_InitBase();
 
 	fCore = core;
+	fMemoryNode = core->MemoryNode();
 	fReady = true;
 	fNeededLoad = 0;
 }
@@ -153,6 +200,7 @@ ThreadData::Dump() const
 	kprintf("\twent_sleep_active:\t%" B_PRId64 "\n", fWentSleepActive);
 	kprintf("\tcore:\t\t\t%" B_PRId32 "\n",
 		fCore != NULL ? fCore->ID() : -1);
+	kprintf("\tmemory_node:\t\t%" B_PRId32 "\n", fMemoryNode);
 	if (fCore != NULL && HasCacheExpired())
 		kprintf("\tcache affinity has expired\n");
 }
@@ -196,6 +244,12 @@ ThreadData::ChooseCoreAndCPU(CoreEntry*& targetCore, CPUEntry*& targetCPU)
 	}
 
 	fCore = targetCore;
+
+	// Pages are allocated from the node of the CPU that asks for them, so
+	// where a thread runs first is where most of its memory ends up.
+	if (fMemoryNode < 0)
+		fMemoryNode = targetCore->MemoryNode();
+
 	return rescheduleNeeded;
 }
 
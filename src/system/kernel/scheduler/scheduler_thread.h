@@ -28,6 +28,7 @@ private:
 	inline	CoreEntry*	_ChooseCore() const;
 	inline	CPUEntry*	_ChooseCPU(CoreEntry* core,
 							bool& rescheduleNeeded) const;
+			CoreEntry*	_PreferMemoryNode(CoreEntry* core) const;
 
 public:
 						ThreadData(Thread* thread);
@@ -77,6 +78,7 @@ public:
 	inline	void		PutBack();
 	inline	void		Enqueue(bool& wasRunQueueEmpty);
 	inline	bool		Dequeue();
+	inline	bigtime_t	LeavesRunQueue(bool& _wokenUp);
 
 	inline	void		UpdateActivity(bigtime_t active);
 
@@ -86,6 +88,7 @@ public:
 	inline	int32		GetLoad() const	{ return fNeededLoad; }
 
 	inline	CoreEntry*	Core() const	{ return fCore; }
+	inline	int32		MemoryNode() const	{ return fMemoryNode; }
 			void		UnassignCore(bool running = false);
 
 	static	void		ComputeQuantumLengths();
@@ -112,6 +115,9 @@ private:
 			bool		fEnqueued;
 			bool		fReady;
 
+			bigtime_t	fEnqueueTime;
+			bool		fWokenUp;
+
 			Thread*		fThread;
 
 			int32		fPriorityPenalty;
@@ -130,6 +136,10 @@ private:
 			uint32		fLoadMeasurementEpoch;
 
 			CoreEntry*	fCore;
+			int32		fMemoryNode;
+							// the node the thread's memory is most likely
+							// on, -1 until the thread has run for the
+							// first time
 };
 
 class ThreadProcessing {
@@ -183,7 +193,7 @@ ThreadData::Rebalance() const
 	SCHEDULER_ENTER_FUNCTION();
 
 	ASSERT(!gSingleCore);
-	return gCurrentMode->rebalance(this);
+	return _PreferMemoryNode(gCurrentMode->rebalance(this));
 }
 
 
@@ -387,6 +397,9 @@ ThreadData::PutBack()
 
 	int32 priority = GetEffectivePriority();
 
+	fEnqueueTime = system_time();
+	fWokenUp = false;
+
 	if (fThread->pinned_to_cpu > 0) {
 		ASSERT(fThread->cpu != NULL);
 		CPUEntry* cpu = CPUEntry::GetCPU(fThread->cpu->cpu_num);
@@ -411,9 +424,13 @@ ThreadData::Enqueue(bool& wasRunQueueEmpty)
 {
 	SCHEDULER_ENTER_FUNCTION();
 
+	bigtime_t now = system_time();
+	fEnqueueTime = now;
+	fWokenUp = !fReady;
+
 	if (!fReady) {
 		if (gTrackCoreLoad) {
-			bigtime_t timeSlept = system_time() - fWentSleep;
+			bigtime_t timeSlept = now - fWentSleep;
 			bool updateLoad = timeSlept > 0;
 
 			fCore->AddLoad(fNeededLoad, fLoadMeasurementEpoch, !updateLoad);
@@ -481,6 +498,26 @@ ThreadData::Dequeue()
 }
 
 
+/*!	Returns how long the thread has been waiting in a run queue before it is
+	run now, or -1 if it hasn't been in one since it ran the last time.
+	\a _wokenUp is set to whether the thread had been waiting for something
+	else before.
+*/
+inline bigtime_t
+ThreadData::LeavesRunQueue(bool& _wokenUp)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	if (fEnqueueTime == 0)
+		return -1;
+
+	bigtime_t queueTime = system_time() - fEnqueueTime;
+	_wokenUp = fWokenUp;
+	fEnqueueTime = 0;
+	return queueTime;
+}
+
+
 inline void
 ThreadData::UpdateActivity(bigtime_t active)
 {
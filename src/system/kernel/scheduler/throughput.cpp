@@ -0,0 +1,203 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	The throughput mode is meant for batch workloads like compiling, where
+	it doesn't matter much how fast a single thread reacts, but how much work
+	gets done in total. Threads get longer quanta, and stay on the core they
+	ran on before for as long as their data can be expected to still be in
+	its caches. Threads are only moved to another core when the loads differ
+	a lot.
+*/
+
+
+#include <util/AutoLock.h>
+
+#include "scheduler_common.h"
+#include "scheduler_cpu.h"
+#include "scheduler_modes.h"
+#include "scheduler_profiler.h"
+#include "scheduler_thread.h"
+
+
+using namespace Scheduler;
+
+
+const bigtime_t kCacheExpire = 500000;
+const int32 kRebalanceLoadDifference = kLoadDifference * 2;
+
+
+static void
+switch_to_mode()
+{
+}
+
+
+static void
+set_cpu_enabled(int32 /* cpu */, bool /* enabled */)
+{
+}
+
+
+static bool
+has_cache_expired(const ThreadData* threadData)
+{
+	SCHEDULER_ENTER_FUNCTION();
+	if (threadData->WentSleepActive() == 0)
+		return false;
+	CoreEntry* core = threadData->Core();
+	bigtime_t activeTime = core->GetActiveTime();
+	return activeTime - threadData->WentSleepActive() > kCacheExpire;
+}
+
+
+static CoreEntry*
+get_least_loaded_core(const CPUSet& mask)
+{
+	const bool useMask = !mask.IsEmpty();
+
+	ReadSpinLocker coreLocker(gCoreHeapsLock);
+
+	int32 index = 0;
+	CoreEntry* core;
+	do {
+		core = gCoreLoadHeap.PeekMinimum(index++);
+	} while (useMask && core != NULL && !core->CPUMask().Matches(mask));
+
+	if (core == NULL) {
+		index = 0;
+		do {
+			core = gCoreHighLoadHeap.PeekMinimum(index++);
+		} while (useMask && core != NULL && !core->CPUMask().Matches(mask));
+	}
+
+	return core;
+}
+
+
+static CoreEntry*
+choose_core(const ThreadData* threadData)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	CPUSet mask = threadData->GetCPUMask();
+	const bool useMask = !mask.IsEmpty();
+
+	// Unlike in low latency mode, we don't wake up idle packages and cores
+	// right away: the least loaded core is just as good, as long as it
+	// isn't busy already.
+	CoreEntry* core = get_least_loaded_core(mask);
+	if (core != NULL && core->GetLoad() < kHighLoad)
+		return core;
+
+	PackageEntry* package = gIdlePackageList.Last();
+	if (package == NULL)
+		package = PackageEntry::GetMostIdlePackage();
+
+	if (package != NULL) {
+		int32 index = 0;
+		CoreEntry* idleCore;
+		do {
+			idleCore = package->GetIdleCore(index++);
+		} while (useMask && idleCore != NULL
+			&& !idleCore->CPUMask().Matches(mask));
+
+		if (idleCore != NULL)
+			core = idleCore;
+	}
+
+	ASSERT(core != NULL);
+	return core;
+}
+
+
+static CoreEntry*
+rebalance(const ThreadData* threadData)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	CoreEntry* core = threadData->Core();
+	ASSERT(core != NULL);
+
+	// Moving a thread costs it its cache contents, so leave it where it is
+	// unless its core is very busy.
+	int32 coreLoad = core->GetLoad();
+	if (coreLoad < kHighLoad)
+		return core;
+
+	CoreEntry* other = get_least_loaded_core(threadData->GetCPUMask());
+	ASSERT(other != NULL);
+
+	int32 otherLoad = other->GetLoad();
+	if (other == core || otherLoad + kRebalanceLoadDifference >= coreLoad)
+		return core;
+
+	// Only migrate the thread if the loads would still not have crossed over
+	// afterwards.
+	int32 difference = coreLoad - otherLoad - kRebalanceLoadDifference;
+	ASSERT(difference > 0);
+
+	int32 threadLoad = threadData->GetLoad() / core->CPUCount();
+	return difference >= threadLoad ? other : core;
+}
+
+
+static void
+rebalance_irqs(bool idle)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	if (idle)
+		return;
+
+	cpu_ent* cpu = get_cpu_struct();
+	SpinLocker locker(cpu->irqs_lock);
+
+	irq_assignment* chosen = NULL;
+	irq_assignment* irq = (irq_assignment*)list_get_first_item(&cpu->irqs);
+
+	int32 totalLoad = 0;
+	while (irq != NULL) {
+		if (chosen == NULL || chosen->load < irq->load)
+			chosen = irq;
+		totalLoad += irq->load;
+		irq = (irq_assignment*)list_get_next_item(&cpu->irqs, irq);
+	}
+
+	locker.Unlock();
+
+	if (chosen == NULL || totalLoad < kMediumLoad)
+		return;
+
+	CoreEntry* other = get_least_loaded_core(CPUSet());
+	ASSERT(other != NULL);
+
+	CoreEntry* core = CoreEntry::GetCore(cpu->cpu_num);
+	if (other == core)
+		return;
+	if (other->GetLoad() + kRebalanceLoadDifference >= core->GetLoad())
+		return;
+
+	int32 newCPU = other->CPUHeap()->PeekRoot()->ID();
+	assign_io_interrupt_to_cpu(chosen->irq, newCPU);
+}
+
+
+scheduler_mode_operations gSchedulerThroughputMode = {
+	"throughput",
+
+	5000,
+	1000,
+	{ 4, 10 },
+
+	50000,
+
+	switch_to_mode,
+	set_cpu_enabled,
+	has_cache_expired,
+	choose_core,
+	rebalance,
+	rebalance_irqs,
+};
@@ -28,7 +28,7 @@ object_cache_return_object_wrapper(object_depot* depot, void* cookie,
 {
 	ObjectCache* cache = (ObjectCache*)cookie;
 
-	MutexLocker _(cache->lock);
+	ObjectCacheLocker _(cache);
 	cache->ReturnObjectToSlab(cache->ObjectSlab(object), object, flags);
 }
 
@@ -83,6 +83,9 @@ ObjectCache::Init(const char* name, size_t objectSize, size_t alignment,
 
 	this->flags = flags;
 
+	slab_allocations = 0;
+	lock_waits = 0;
+
 	resize_request = NULL;
 	resize_entry_can_wait = NULL;
 	resize_entry_dont_wait = NULL;
@@ -12,6 +12,7 @@
 #include <lock.h>
 #include <slab/ObjectDepot.h>
 #include <slab/Slab.h>
+#include <util/AutoLock.h>
 #include <util/DoublyLinkedList.h>
 
 #include "kernel_debug_config.h"
@@ -64,6 +65,9 @@ struct ObjectCache : DoublyLinkedListLinkImpl<ObjectCache> {
 			size_t				maximum;
 			uint32				flags;
 
+			uint64				slab_allocations;
+			int64				lock_waits;
+
 			ResizeRequest*		resize_request;
 
 			ObjectCacheResizeEntry* resize_entry_can_wait;
@@ -107,7 +111,7 @@ public:
 									uint32 flags);
 			void*				ObjectAtIndex(slab* source, int32 index) const;
 
-			bool				Lock()	{ return mutex_lock(&lock) == B_OK; }
+	inline	bool				Lock();
 			void				Unlock()	{ mutex_unlock(&lock); }
 
 			status_t			AllocatePages(void** pages, uint32 flags);
@@ -130,6 +134,23 @@ public:
 };
 
 
+typedef AutoLocker<ObjectCache> ObjectCacheLocker;
+
+
+/*!	Like locking the cache's mutex directly, but keeps track of how often the
+	lock was contended.
+*/
+bool
+ObjectCache::Lock()
+{
+	if (mutex_trylock(&lock) == B_OK)
+		return true;
+
+	atomic_add64(&lock_waits, 1);
+	return mutex_lock(&lock) == B_OK;
+}
+
+
 static inline void*
 link_to_object(object_link* link, size_t objectSize)
 {
@@ -11,6 +11,7 @@
 
 #include <algorithm>
 
+#include <cpu.h>
 #include <interrupts.h>
 #include <slab/Slab.h>
 #include <smp.h>
@@ -42,7 +43,21 @@ public:
 struct depot_cpu_store {
 	DepotMagazine*	loaded;
 	DepotMagazine*	previous;
-};
+
+	// statistics, only written by the CPU owning the store
+	uint64			hits;
+	uint64			exchanges;
+	uint64			misses;
+} CACHE_LINE_ALIGN;
+
+
+static const size_t kMaxMagazineCapacity = 128;
+
+// object_depot_maintenance() parameters, per maintenance interval
+static const uint64 kMinBusyOperations = 1024;
+static const uint64 kMaxDepotAccessPercentage = 5;
+static const uint64 kMaxLockWaits = 16;
+static const uint32 kIdleIntervalsBeforeReap = 10;
 
 
 RANGE_MARKER_FUNCTION_BEGIN(SlabObjectDepot)
@@ -102,13 +117,15 @@ DepotMagazine::ContainsObject(void* object) const
 static DepotMagazine*
 alloc_magazine(object_depot* depot, uint32 flags)
 {
+	// the capacity might be changed by the maintainer at any time
+	size_t capacity = depot->magazine_capacity;
+
 	DepotMagazine* magazine = (DepotMagazine*)slab_internal_alloc(
-		sizeof(DepotMagazine) + depot->magazine_capacity * sizeof(void*),
-		flags);
+		sizeof(DepotMagazine) + capacity * sizeof(void*), flags);
 	if (magazine) {
 		magazine->next = NULL;
 		magazine->current_round = 0;
-		magazine->round_count = depot->magazine_capacity;
+		magazine->round_count = capacity;
 	}
 
 	return magazine;
@@ -131,12 +148,27 @@ empty_magazine(object_depot* depot, DepotMagazine* magazine, uint32 flags)
 }
 
 
+/*!	Acquires the depot's inner lock, and counts how often we had to wait for
+	it.
+*/
+static inline void
+lock_depot(object_depot* depot)
+{
+	if (try_acquire_spinlock(&depot->inner_lock))
+		return;
+
+	acquire_spinlock(&depot->inner_lock);
+	depot->lock_waits++;
+}
+
+
 static bool
 exchange_with_full(object_depot* depot, DepotMagazine*& magazine)
 {
 	ASSERT(magazine->IsEmpty());
 
-	SpinLocker _(depot->inner_lock);
+	lock_depot(depot);
+	SpinLocker _(depot->inner_lock, true);
 
 	if (depot->full == NULL)
 		return false;
@@ -156,7 +188,8 @@ exchange_with_empty(object_depot* depot, DepotMagazine*& magazine,
 {
 	ASSERT(magazine == NULL || magazine->IsFull());
 
-	SpinLocker _(depot->inner_lock);
+	lock_depot(depot);
+	SpinLocker _(depot->inner_lock, true);
 
 	if (depot->empty == NULL)
 		return false;
@@ -180,13 +213,60 @@ exchange_with_empty(object_depot* depot, DepotMagazine*& magazine,
 static void
 push_empty_magazine(object_depot* depot, DepotMagazine* magazine)
 {
-	SpinLocker _(depot->inner_lock);
+	lock_depot(depot);
+	SpinLocker _(depot->inner_lock, true);
 
 	_push(depot->empty, magazine);
 	depot->empty_count++;
 }
 
 
+/*!	Frees the empty magazines of the depot that no longer have the current
+	magazine capacity.
+	\return \c true, if there were any.
+*/
+static bool
+free_stale_magazines(object_depot* depot, uint32 flags)
+{
+	ReadLocker readLocker(depot->outer_lock);
+	InterruptsSpinLocker locker(depot->inner_lock);
+
+	DepotMagazine* magazines = depot->empty;
+	depot->empty = NULL;
+	depot->empty_count = 0;
+
+	locker.Unlock();
+
+	DepotMagazine* staleMagazines = NULL;
+	DepotMagazine* currentMagazines = NULL;
+	while (magazines != NULL) {
+		DepotMagazine* magazine = _pop(magazines);
+		if (magazine->round_count != depot->magazine_capacity)
+			_push(staleMagazines, magazine);
+		else
+			_push(currentMagazines, magazine);
+	}
+
+	locker.Lock();
+
+	while (currentMagazines != NULL) {
+		_push(depot->empty, _pop(currentMagazines));
+		depot->empty_count++;
+	}
+
+	locker.Unlock();
+	readLocker.Unlock();
+
+	if (staleMagazines == NULL)
+		return false;
+
+	while (staleMagazines != NULL)
+		free_magazine(_pop(staleMagazines), flags);
+
+	return true;
+}
+
+
 static inline depot_cpu_store*
 object_depot_cpu(object_depot* depot)
 {
@@ -207,6 +287,15 @@ object_depot_init(object_depot* depot, size_t capacity, size_t maxCount,
 	depot->full_count = depot->empty_count = 0;
 	depot->max_count = maxCount;
 	depot->magazine_capacity = capacity;
+	depot->min_magazine_capacity = capacity;
+
+	depot->lock_waits = 0;
+	depot->last_operations = 0;
+	depot->last_depot_accesses = 0;
+	depot->last_lock_waits = 0;
+	depot->idle_intervals = 0;
+	depot->resize_count = 0;
+	depot->stale_magazines = false;
 
 	rw_lock_init(&depot->outer_lock, "object depot");
 	B_INITIALIZE_SPINLOCK(&depot->inner_lock);
@@ -222,6 +311,9 @@ object_depot_init(object_depot* depot, size_t capacity, size_t maxCount,
 	for (int i = 0; i < cpuCount; i++) {
 		depot->stores[i].loaded = NULL;
 		depot->stores[i].previous = NULL;
+		depot->stores[i].hits = 0;
+		depot->stores[i].exchanges = 0;
+		depot->stores[i].misses = 0;
 	}
 
 	depot->cookie = cookie;
@@ -257,20 +349,31 @@ object_depot_obtain(object_depot* depot)
 	// if it's not empty, or from the previous magazine if it's full
 	// and finally from the Slab if the magazine depot has no full magazines.
 
-	if (store->loaded == NULL)
+	if (store->loaded == NULL) {
+		store->misses++;
 		return NULL;
+	}
 
 	while (true) {
-		if (!store->loaded->IsEmpty())
+		if (!store->loaded->IsEmpty()) {
+			store->hits++;
 			return store->loaded->Pop();
+		}
 
-		if (store->previous
-			&& (store->previous->IsFull()
-				|| exchange_with_full(depot, store->previous))) {
-			std::swap(store->previous, store->loaded);
-		} else
-			return NULL;
+		if (store->previous == NULL)
+			break;
+
+		if (!store->previous->IsFull()) {
+			if (!exchange_with_full(depot, store->previous))
+				break;
+			store->exchanges++;
+		}
+
+		std::swap(store->previous, store->loaded);
 	}
+
+	store->misses++;
+	return NULL;
 }
 
 
@@ -288,12 +391,19 @@ object_depot_store(object_depot* depot, void* object, uint32 flags)
 	// we return the object directly to the slab.
 
 	while (true) {
-		if (store->loaded != NULL && store->loaded->Push(object))
+		if (store->loaded != NULL && store->loaded->Push(object)) {
+			store->hits++;
 			return;
+		}
+
+		if (store->previous != NULL && store->previous->IsEmpty()) {
+			std::swap(store->loaded, store->previous);
+			continue;
+		}
 
 		DepotMagazine* freeMagazine = NULL;
-		if ((store->previous != NULL && store->previous->IsEmpty())
-			|| exchange_with_empty(depot, store->previous, freeMagazine)) {
+		if (exchange_with_empty(depot, store->previous, freeMagazine)) {
+			store->exchanges++;
 			std::swap(store->loaded, store->previous);
 
 			if (freeMagazine != NULL) {
@@ -316,6 +426,9 @@ object_depot_store(object_depot* depot, void* object, uint32 flags)
 			DepotMagazine* magazine = alloc_magazine(depot, flags);
 			if (magazine == NULL) {
 				depot->return_object(depot, depot->cookie, object, flags);
+
+				InterruptsLocker _;
+				object_depot_cpu(depot)->misses++;
 				return;
 			}
 
@@ -376,6 +489,98 @@ object_depot_make_empty(object_depot* depot, uint32 flags)
 }
 
 
+/*!	Adapts the magazine capacity of the depot to how it has been used since
+	the last call; it is called periodically by the object cache maintainer.
+
+	As in Bonwick's later work, busy depots get larger magazines, if their
+	CPUs have to go to the depot lists or the slabs too often, or if there is
+	contention on the depot lock. Depots that are hardly used shrink back to
+	their initial magazine capacity, and are emptied completely when they have
+	been idle for a while, so that they don't hold on to memory they don't
+	need.
+*/
+void
+object_depot_maintenance(object_depot* depot, uint32 flags)
+{
+	object_depot_stats stats;
+	object_depot_get_stats(depot, &stats);
+
+	uint64 operations = stats.hits + stats.misses;
+	uint64 depotAccesses = stats.exchanges + stats.misses;
+
+	uint64 intervalOperations = operations - depot->last_operations;
+	uint64 intervalAccesses = depotAccesses - depot->last_depot_accesses;
+	uint64 intervalLockWaits = stats.lock_waits - depot->last_lock_waits;
+
+	depot->last_operations = operations;
+	depot->last_depot_accesses = depotAccesses;
+	depot->last_lock_waits = stats.lock_waits;
+
+	if (intervalOperations == 0) {
+		if (++depot->idle_intervals == kIdleIntervalsBeforeReap) {
+			object_depot_make_empty(depot, flags);
+
+			if (depot->magazine_capacity != depot->min_magazine_capacity) {
+				depot->magazine_capacity = depot->min_magazine_capacity;
+				depot->resize_count++;
+			}
+			// object_depot_make_empty() already got rid of all magazines
+			depot->stale_magazines = false;
+		}
+		return;
+	}
+
+	depot->idle_intervals = 0;
+
+	size_t capacity = depot->magazine_capacity;
+	size_t maxCapacity = std::max(kMaxMagazineCapacity,
+		depot->min_magazine_capacity);
+
+	if (intervalOperations >= kMinBusyOperations) {
+		if (intervalAccesses * 100
+				> intervalOperations * kMaxDepotAccessPercentage
+			|| intervalLockWaits > kMaxLockWaits) {
+			capacity = std::min(capacity * 2, maxCapacity);
+		}
+	} else
+		capacity = std::max(capacity / 2, depot->min_magazine_capacity);
+
+	if (capacity != depot->magazine_capacity) {
+		depot->magazine_capacity = capacity;
+		depot->resize_count++;
+		depot->stale_magazines = true;
+	}
+
+	// Magazines with the old capacity remain in use until they end up empty
+	// in the depot. Once a pass finds none of them anymore, we stop looking;
+	// stragglers still work, they just keep their old capacity.
+	if (depot->stale_magazines && depot->empty_count > 0)
+		depot->stale_magazines = free_stale_magazines(depot, flags);
+}
+
+
+void
+object_depot_get_stats(object_depot* depot, object_depot_stats* stats)
+{
+	stats->hits = 0;
+	stats->exchanges = 0;
+	stats->misses = 0;
+
+	int cpuCount = smp_get_num_cpus();
+	for (int i = 0; i < cpuCount; i++) {
+		stats->hits += depot->stores[i].hits;
+		stats->exchanges += depot->stores[i].exchanges;
+		stats->misses += depot->stores[i].misses;
+	}
+
+	stats->lock_waits = depot->lock_waits;
+	stats->magazine_capacity = depot->magazine_capacity;
+	stats->full_magazines = depot->full_count;
+	stats->empty_magazines = depot->empty_count;
+	stats->resize_count = depot->resize_count;
+}
+
+
 #if PARANOID_KERNEL_FREE
 
 bool
@@ -419,14 +624,20 @@ dump_object_depot(object_depot* depot)
 	kprintf("  full:     %p, count %lu\n", depot->full, depot->full_count);
 	kprintf("  empty:    %p, count %lu\n", depot->empty, depot->empty_count);
 	kprintf("  max full: %lu\n", depot->max_count);
-	kprintf("  capacity: %lu\n", depot->magazine_capacity);
+	kprintf("  capacity: %lu (initial %lu, %" B_PRIu32 " resizes)\n",
+		depot->magazine_capacity, depot->min_magazine_capacity,
+		depot->resize_count);
+	kprintf("  lock waits: %" B_PRIu64 "\n", depot->lock_waits);
 	kprintf("  stores:\n");
 
 	int cpuCount = smp_get_num_cpus();
 
 	for (int i = 0; i < cpuCount; i++) {
-		kprintf("  [%d] loaded:   %p\n", i, depot->stores[i].loaded);
-		kprintf("      previous: %p\n", depot->stores[i].previous);
+		depot_cpu_store& store = depot->stores[i];
+		kprintf("  [%d] loaded:   %p\n", i, store.loaded);
+		kprintf("      previous: %p\n", store.previous);
+		kprintf("      hits %" B_PRIu64 ", exchanges %" B_PRIu64 ", misses %"
+			B_PRIu64 "\n", store.hits, store.exchanges, store.misses);
 	}
 }
 
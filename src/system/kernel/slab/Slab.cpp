@@ -52,6 +52,8 @@ static mutex sMaintenanceLock
 static MaintenanceQueue sMaintenanceQueue;
 static ConditionVariable sMaintenanceCondition;
 
+static const bigtime_t kDepotMaintenanceInterval = 1000000;
+
 
 #if SLAB_ALLOCATION_TRACKING_AVAILABLE
 
@@ -300,6 +302,8 @@ dump_cache_info(int argc, char* argv[])
 	kprintf("usage:             %lu\n", cache->usage);
 	kprintf("maximum:           %lu\n", cache->maximum);
 	kprintf("flags:             0x%" B_PRIx32 "\n", cache->flags);
+	kprintf("slab allocations:  %" B_PRIu64 "\n", cache->slab_allocations);
+	kprintf("lock waits:        %" B_PRId64 "\n", cache->lock_waits);
 	kprintf("cookie:            %p\n", cache->cookie);
 	kprintf("resize entry don't wait: %p\n", cache->resize_entry_dont_wait);
 	kprintf("resize entry can wait:   %p\n", cache->resize_entry_can_wait);
@@ -976,6 +980,7 @@ object_cache_reserve_internal(ObjectCache* cache, size_t objectCount,
 
 		cache->usage += cache->slab_size;
 		cache->total_objects += newSlab->size;
+		cache->slab_allocations++;
 
 		cache->empty.Add(newSlab);
 		cache->empty_count++;
@@ -1083,9 +1088,68 @@ object_cache_low_memory(void* dummy, uint32 resources, int32 level)
 }
 
 
+/*!	Lets the depots of all caches adapt their magazine sizes to how they have
+	been used recently.
+*/
+static void
+object_cache_depot_maintenance()
+{
+	MutexLocker cacheListLocker(sObjectCacheListLock);
+
+	// As in object_cache_low_memory(), the first cache is used as a marker,
+	// and each cache is marked as being in maintenance while we work on it,
+	// so that the list lock doesn't need to be held while depots are
+	// emptied.
+	ObjectCache* firstCache = sObjectCaches.RemoveHead();
+	sObjectCaches.Add(firstCache);
+	cacheListLocker.Unlock();
+
+	ObjectCache* cache;
+	do {
+		cacheListLocker.Lock();
+
+		cache = sObjectCaches.RemoveHead();
+		sObjectCaches.Add(cache);
+
+		if ((cache->flags & CACHE_NO_DEPOT) != 0)
+			continue;
+
+		MutexLocker maintenanceLocker(sMaintenanceLock);
+		if (cache->maintenance_pending || cache->maintenance_in_progress) {
+			// this cache will be maintained next time
+			continue;
+		}
+
+		cache->maintenance_pending = true;
+		cache->maintenance_in_progress = true;
+
+		maintenanceLocker.Unlock();
+		cacheListLocker.Unlock();
+
+		object_depot_maintenance(&cache->depot, 0);
+
+		maintenanceLocker.Lock();
+
+		if (cache->maintenance_delete) {
+			delete_object_cache_internal(cache);
+			continue;
+		}
+
+		cache->maintenance_in_progress = false;
+
+		if (cache->maintenance_resize)
+			sMaintenanceQueue.Add(cache);
+		else
+			cache->maintenance_pending = false;
+	} while (cache != firstCache);
+}
+
+
 static status_t
 object_cache_maintainer(void*)
 {
+	bigtime_t nextDepotMaintenance = system_time() + kDepotMaintenanceInterval;
+
 	while (true) {
 		MutexLocker locker(sMaintenanceLock);
 
@@ -1099,7 +1163,18 @@ object_cache_maintainer(void*)
 				continue;
 			}
 
-			sMaintenanceCondition.Wait(locker.Get());
+			// periodically adjust the object depots
+			if (system_time() >= nextDepotMaintenance) {
+				locker.Unlock();
+				object_cache_depot_maintenance();
+				nextDepotMaintenance = system_time()
+					+ kDepotMaintenanceInterval;
+				locker.Lock();
+				continue;
+			}
+
+			sMaintenanceCondition.Wait(locker.Get(), B_ABSOLUTE_TIMEOUT,
+				nextDepotMaintenance);
 		}
 
 		ObjectCache* cache = sMaintenanceQueue.RemoveHead();
@@ -1248,7 +1323,7 @@ object_cache_alloc(object_cache* cache, uint32 flags)
 		}
 	}
 
-	MutexLocker locker(cache->lock);
+	ObjectCacheLocker locker(cache);
 	slab* source = NULL;
 
 	while (true) {
@@ -1335,7 +1410,7 @@ object_cache_free(object_cache* cache, void* object, uint32 flags)
 		return;
 	}
 
-	MutexLocker _(cache->lock);
+	ObjectCacheLocker _(cache);
 	cache->ReturnObjectToSlab(cache->ObjectSlab(object), object, flags);
 }
 
@@ -1449,6 +1524,69 @@ slab_init_post_thread()
 }
 
 
+// #pragma mark - syscalls
+
+
+status_t
+_user_get_next_object_cache_info(int32* _cookie, object_cache_info* userInfo)
+{
+	int32 cookie;
+	if (_cookie == NULL || userInfo == NULL || !IS_USER_ADDRESS(_cookie)
+		|| !IS_USER_ADDRESS(userInfo)
+		|| user_memcpy(&cookie, _cookie, sizeof(int32)) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+	if (cookie < 0)
+		return B_BAD_VALUE;
+
+	object_cache_info info = {};
+
+	{
+		MutexLocker cacheListLocker(sObjectCacheListLock);
+
+		ObjectCache* cache = sObjectCaches.Head();
+		for (int32 i = 0; cache != NULL && i < cookie; i++)
+			cache = sObjectCaches.GetNext(cache);
+		if (cache == NULL)
+			return B_ENTRY_NOT_FOUND;
+
+		MutexLocker cacheLocker(cache->lock);
+
+		strlcpy(info.name, cache->name, sizeof(info.name));
+		info.object_size = cache->object_size;
+		info.usage = cache->usage;
+		info.total_objects = cache->total_objects;
+		info.used_objects = cache->used_count;
+		info.slab_allocations = cache->slab_allocations;
+		info.lock_waits = cache->lock_waits;
+
+		cacheLocker.Unlock();
+
+		if ((cache->flags & CACHE_NO_DEPOT) == 0) {
+			object_depot_stats stats;
+			object_depot_get_stats(&cache->depot, &stats);
+
+			info.magazine_capacity = stats.magazine_capacity;
+			info.full_magazines = stats.full_magazines;
+			info.depot_hits = stats.hits;
+			info.depot_exchanges = stats.exchanges;
+			info.depot_misses = stats.misses;
+			info.depot_lock_waits = stats.lock_waits;
+			info.depot_resizes = stats.resize_count;
+		}
+	}
+
+	cookie++;
+
+	if (user_memcpy(userInfo, &info, sizeof(object_cache_info)) != B_OK
+		|| user_memcpy(_cookie, &cookie, sizeof(int32)) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return B_OK;
+}
+
+
 RANGE_MARKER_FUNCTION_END(Slab)
 
 
@@ -26,6 +26,7 @@
 #include <event_queue.h>
 #include <frame_buffer_console.h>
 #include <fs/fd.h>
+#include <fs/io_ring.h>
 #include <fs/node_monitor.h>
 #include <generic_syscall.h>
 #include <interrupts.h>
@@ -18,6 +18,7 @@
 
 #include "VMAnonymousCache.h"
 
+#include <algorithm>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdlib.h>
@@ -57,6 +58,7 @@
 #include <vm/vm_priv.h>
 #include <vm/VMAddressSpace.h>
 
+#include "compressed_swap.h"
 #include "IORequest.h"
 
 
@@ -149,6 +151,8 @@ static rw_lock sSwapHashLock;
 
 static SwapFileList sSwapFileList;
 static mutex sSwapFileListLock;
+static mutex sDemotionLock = MUTEX_INITIALIZER("swap demotion");
+static uint8 sDemotionBuffer[B_PAGE_SIZE];
 static swap_file* sSwapFileAlloc = NULL; // allocate from here
 static uint32 sSwapFileCount = 0;
 
@@ -329,17 +333,79 @@ find_swap_file(swap_addr_t slotIndex)
 }
 
 
+static void
+swap_slot_dealloc_locked(swap_addr_t slotIndex, uint32 count)
+{
+	swap_file* swapFile = find_swap_file(slotIndex);
+	slotIndex -= swapFile->first_slot;
+	radix_bitmap_dealloc(swapFile->bmp, slotIndex, count);
+}
+
+
 static void
 swap_slot_dealloc(swap_addr_t slotIndex, uint32 count)
 {
 	if (slotIndex == SWAP_SLOT_NONE)
 		return;
 
-	mutex_lock(&sSwapFileListLock);
-	swap_file* swapFile = find_swap_file(slotIndex);
-	slotIndex -= swapFile->first_slot;
-	radix_bitmap_dealloc(swapFile->bmp, slotIndex, count);
-	mutex_unlock(&sSwapFileListLock);
+	if (!compressed_swap_enabled()) {
+		mutex_lock(&sSwapFileListLock);
+		swap_slot_dealloc_locked(slotIndex, count);
+		mutex_unlock(&sSwapFileListLock);
+		return;
+	}
+
+	// Drop the slots from the compressed store. Slots that are currently
+	// being demoted must not be reused yet; they are freed by
+	// swap_demote_compressed_pages() when it's done.
+	MutexLocker locker(sSwapFileListLock);
+	for (uint32 i = 0; i < count; i++) {
+		if (!compressed_swap_free(slotIndex + i))
+			swap_slot_dealloc_locked(slotIndex + i, 1);
+	}
+}
+
+
+/*!	Writes the least recently used pages of the compressed store back to
+	their swap slots until there is room for another page in the store again.
+*/
+static void
+swap_demote_compressed_pages(uint32 flags)
+{
+	MutexLocker locker(sDemotionLock);
+
+	while (compressed_swap_needs_demotion()) {
+		swap_addr_t slotIndex;
+		if (compressed_swap_begin_demotion(slotIndex, sDemotionBuffer) != B_OK)
+			break;
+
+		mutex_lock(&sSwapFileListLock);
+		swap_file* swapFile = find_swap_file(slotIndex);
+		mutex_unlock(&sSwapFileListLock);
+
+		off_t pos = (off_t)(slotIndex - swapFile->first_slot) * B_PAGE_SIZE;
+
+		generic_io_vec vec;
+		vec.base = (generic_addr_t)(addr_t)sDemotionBuffer;
+		vec.length = B_PAGE_SIZE;
+		generic_size_t length = B_PAGE_SIZE;
+
+		status_t status = vfs_write_pages(swapFile->vnode, swapFile->cookie,
+			pos, &vec, 1, flags & B_VIP_IO_REQUEST, &length);
+		bool written = status == B_OK && length == B_PAGE_SIZE;
+
+		if (compressed_swap_end_demotion(slotIndex, written)) {
+			// the slot has been freed while we were writing it
+			MutexLocker _(sSwapFileListLock);
+			swap_slot_dealloc_locked(slotIndex, 1);
+		}
+
+		if (!written) {
+			dprintf("swap_demote_compressed_pages(): writing slot %" B_PRIu32
+				" failed: %s\n", slotIndex, strerror(status));
+			break;
+		}
+	}
 }
 
 
@@ -781,10 +847,22 @@ VMAnonymousCache::Read(off_t offset, const generic_io_vec* vecs, size_t count,
 
 	for (uint32 i = 0, j = 0; i < count; i = j) {
 		swap_addr_t startSlotIndex = _SwapBlockGetAddress(pageIndex + i);
+
+		// pages in the compressed store don't need to be read from disk
+		status_t status = compressed_swap_load(startSlotIndex, vecs + i, flags);
+		if (status == B_OK) {
+			j = i + 1;
+			continue;
+		}
+		if (status != B_ENTRY_NOT_FOUND)
+			return status;
+
 		for (j = i + 1; j < count; j++) {
 			swap_addr_t slotIndex = _SwapBlockGetAddress(pageIndex + j);
-			if (slotIndex != startSlotIndex + j - i)
+			if (slotIndex != startSlotIndex + j - i
+				|| compressed_swap_has_page(slotIndex)) {
 				break;
+			}
 		}
 
 		T(ReadPage(this, pageIndex, startSlotIndex));
@@ -795,7 +873,7 @@ VMAnonymousCache::Read(off_t offset, const generic_io_vec* vecs, size_t count,
 		off_t pos = (off_t)(startSlotIndex - swapFile->first_slot)
 			* B_PAGE_SIZE;
 
-		status_t status = vfs_read_pages(swapFile->vnode, swapFile->cookie, pos,
+		status = vfs_read_pages(swapFile->vnode, swapFile->cookie, pos,
 			vecs + i, j - i, flags, _numBytes);
 		if (status != B_OK)
 			return status;
@@ -842,6 +920,10 @@ VMAnonymousCache::Write(off_t offset, const generic_io_vec* vecs, size_t count,
 		generic_addr_t vectorBase = vecs[i].base;
 		generic_size_t vectorLength = vecs[i].length;
 		page_num_t n = pageCount;
+		if (compressed_swap_enabled()) {
+			// pages are stored in the compressed store one by one
+			n = 1;
+		}
 
 		for (page_num_t j = 0; j < pageCount; j += n) {
 			swap_addr_t slotIndex;
@@ -864,8 +946,16 @@ VMAnonymousCache::Write(off_t offset, const generic_io_vec* vecs, size_t count,
 			vector->base = vectorBase;
 			vector->length = length;
 
-			status_t status = vfs_write_pages(swapFile->vnode, swapFile->cookie,
-				pos, vector, 1, flags, &length);
+			status_t status = B_ERROR;
+			if (compressed_swap_enabled()) {
+				swap_demote_compressed_pages(flags);
+				status = compressed_swap_store(slotIndex, vector,
+					std::min(length, vectorLength), flags);
+			}
+			if (status != B_OK) {
+				status = vfs_write_pages(swapFile->vnode, swapFile->cookie,
+					pos, vector, 1, flags, &length);
+			}
 			if (status != B_OK) {
 				locker.Lock();
 				fAllocatedSwapSize -= (off_t)pagesLeft * B_PAGE_SIZE;
@@ -942,6 +1032,15 @@ VMAnonymousCache::WriteAsync(off_t offset, const generic_io_vec* vecs,
 
 	T(WritePage(this, pageIndex, slotIndex));
 
+	// try to keep the page in the compressed store first
+	if (compressed_swap_enabled()) {
+		swap_demote_compressed_pages(flags);
+		if (compressed_swap_store(slotIndex, vecs, numBytes, flags) == B_OK) {
+			callback->IOFinished(B_OK, false, numBytes);
+			return B_OK;
+		}
+	}
+
 	// write the page asynchrounously
 	swap_file* swapFile = find_swap_file(slotIndex);
 	off_t pos = (off_t)(slotIndex - swapFile->first_slot) * B_PAGE_SIZE;
@@ -1601,6 +1700,7 @@ swap_init_post_modules()
 	bool swapEnabled = true;
 	bool swapAutomatic = true;
 	off_t swapSize = 0;
+	off_t compressedSize = -1;
 
 	dev_t swapDeviceID = -1;
 	VolumeInfo selectedVolume = {};
@@ -1613,6 +1713,10 @@ swap_init_post_modules()
 
 		// TODO: Some kind of BFS uuid would be great here :)
 		const char* enabled = get_driver_parameter(settings, "vm", NULL, NULL);
+		const char* compressed = get_driver_parameter(settings,
+			"compressed_swap_size", NULL, NULL);
+		if (compressed != NULL)
+			compressedSize = atoll(compressed);
 
 		if (enabled != NULL) {
 			swapEnabled = get_driver_boolean_parameter(settings, "vm",
@@ -1765,6 +1869,20 @@ swap_init_post_modules()
 	if (error != B_OK) {
 		dprintf("%s: Failed to add swap file %s: %s\n", __func__, swapPath,
 			strerror(error));
+		return;
+	}
+
+	// By default, up to an eighth of the memory may be used to keep swapped
+	// out pages compressed in memory.
+	off_t memorySize = (off_t)vm_page_num_pages() * B_PAGE_SIZE;
+	if (compressedSize < 0)
+		compressedSize = memorySize / 8;
+	compressedSize = std::min(compressedSize, memorySize / 2);
+
+	error = compressed_swap_init(compressedSize);
+	if (error != B_OK) {
+		dprintf("%s: Failed to initialize the compressed swap store: %s\n",
+			__func__, strerror(error));
 	}
 }
 
@@ -1836,3 +1954,18 @@ swap_get_info(system_info* info)
 #endif
 }
 
+
+status_t
+_user_get_compressed_swap_info(compressed_swap_info* userInfo)
+{
+	if (userInfo == NULL || !IS_USER_ADDRESS(userInfo))
+		return B_BAD_ADDRESS;
+
+	compressed_swap_info info = {};
+#if ENABLE_SWAP_SUPPORT
+	compressed_swap_get_info(&info);
+#endif
+
+	return user_memcpy(userInfo, &info, sizeof(compressed_swap_info));
+}
+
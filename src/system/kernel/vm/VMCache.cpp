@@ -1127,6 +1127,19 @@ VMCache::_FreePageRange(VMCachePagesTree::Iterator it,
 		// remove the page and put it into the free queue
 		DEBUG_PAGE_ACCESS_START(page);
 		vm_remove_all_page_mappings(page);
+
+		if (page->io_wired_count > 0) {
+			// The page is still used for I/O, and must neither be freed nor
+			// reused before that is done. Just remove it from the cache;
+			// cache_unwire_pages() frees it once it is no longer wired.
+			vm_page_set_state(page, PAGE_STATE_WIRED);
+			RemovePage(page);
+			DEBUG_PAGE_ACCESS_END(page);
+			if (freedPages != NULL)
+				(*freedPages)++;
+			continue;
+		}
+
 		ASSERT(page->WiredCount() == 0);
 			// TODO: Find a real solution! If the page is wired
 			// temporarily (e.g. by lock_memory()), we actually must not
@@ -19,7 +19,8 @@
 
 VMTranslationMap::VMTranslationMap()
 	:
-	fMapCount(0)
+	fMapCount(0),
+	fLargePageCount(0)
 {
 	recursive_lock_init(&fLock, "translation map");
 }
@@ -39,6 +40,52 @@ VMTranslationMap::DebugMarkRangePresent(addr_t start, addr_t end,
 }
 
 
+/*!	Returns the size of the large pages the map supports, or 0, if it doesn't
+	support large pages at all.
+*/
+size_t
+VMTranslationMap::LargePageSize() const
+{
+	return 0;
+}
+
+
+/*!	Replaces the page mappings of all large page sized and aligned chunks in
+	the given range by large page mappings, where possible. That is, if all
+	pages of the chunk are mapped, with the same attributes, and are
+	physically contiguous and suitably aligned.
+	The caller must make sure the mappings don't change while the range is
+	promoted, i.e. the pages need to be wired.
+	\return The number of large pages that were created.
+*/
+int32
+VMTranslationMap::PromoteLargePages(addr_t start, addr_t end)
+{
+	return 0;
+}
+
+
+/*!	Splits all large page mappings intersecting with the given range into
+	regular page mappings again.
+	Implementations that support large pages do this on their own when parts
+	of a large page are unmapped, or get different attributes.
+*/
+void
+VMTranslationMap::DemoteLargePages(addr_t start, addr_t end)
+{
+}
+
+
+/*!	Returns the number of large page mappings intersecting with the given
+	range.
+*/
+int32
+VMTranslationMap::CountLargePages(addr_t start, addr_t end)
+{
+	return 0;
+}
+
+
 /*!	Unmaps a range of pages of an area.
 
 	The default implementation just iterates over all virtual pages of the
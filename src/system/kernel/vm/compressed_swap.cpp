@@ -0,0 +1,516 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	An in-memory store for compressed swap pages.
+
+	It sits in front of the swap files: a page that is swapped out gets a swap
+	slot as usual, but as long as the store has room for it, it is only
+	compressed and kept in memory. When the store is full, its least recently
+	used pages are written back ("demoted") to their slots in the swap file.
+	Swapping in a page that is still in the store is then merely a matter of
+	decompressing it.
+
+	Since every page in the store owns a slot in a swap file, the store does
+	not change the amount of available swap space, and it can always demote
+	its pages.
+*/
+
+
+#include "compressed_swap.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include <KernelExport.h>
+
+#include <condition_variable.h>
+#include <heap.h>
+#include <lock.h>
+#include <util/AutoLock.h>
+#include <util/DoublyLinkedList.h>
+#include <util/OpenHashTable.h>
+#include <vm/vm.h>
+
+#include "IORequest.h"
+
+
+#if ENABLE_SWAP_SUPPORT
+
+
+//#define TRACE_COMPRESSED_SWAP
+#ifdef TRACE_COMPRESSED_SWAP
+#	define TRACE(x...) dprintf("compressed swap: " x)
+#else
+#	define TRACE(x...) do { } while (false)
+#endif
+
+
+// Pages that don't compress to at most this size go to the swap file
+// directly.
+static const size_t kMaxCompressedSize = B_PAGE_SIZE * 3 / 4;
+
+static const int kCompressionLevel = 1;
+static const int kWindowBits = -12;
+	// raw deflate streams with a 4 KB window
+static const int kMemoryLevel = 8;
+
+
+struct compressed_page {
+	compressed_page*		hash_link;
+	DoublyLinkedListLink<compressed_page> lru_link;
+	swap_addr_t				slot;
+	uint32					length;		// uncompressed size
+	uint32					size;		// compressed size
+	bool					demoting;
+	bool					freed;
+	uint8					data[0];
+
+	size_t AllocationSize() const
+	{
+		return sizeof(compressed_page) + size;
+	}
+};
+
+
+struct CompressedPageHashDefinition {
+	typedef swap_addr_t KeyType;
+	typedef compressed_page ValueType;
+
+	size_t HashKey(swap_addr_t key) const
+	{
+		return key;
+	}
+
+	size_t Hash(const compressed_page* value) const
+	{
+		return value->slot;
+	}
+
+	bool Compare(swap_addr_t key, const compressed_page* value) const
+	{
+		return value->slot == key;
+	}
+
+	compressed_page*& GetLink(compressed_page* value) const
+	{
+		return value->hash_link;
+	}
+};
+
+
+typedef BOpenHashTable<CompressedPageHashDefinition, false>
+	CompressedPageTable;
+typedef DoublyLinkedList<compressed_page,
+	DoublyLinkedListMemberGetLink<compressed_page, &compressed_page::lru_link> >
+		CompressedPageList;
+
+
+// protected by sLock
+static mutex sLock = MUTEX_INITIALIZER("compressed swap");
+static CompressedPageTable sPageTable;
+static CompressedPageList sLRUList;
+	// the least recently used pages come first
+static ConditionVariable sDemotionCondition;
+static z_stream sInflateStream;
+
+static size_t sMaxSize = 0;
+static size_t sUsedSize = 0;
+static uint64 sStoredPages = 0;
+static uint64 sStores = 0;
+static uint64 sRejected = 0;
+static uint64 sHits = 0;
+static uint64 sMisses = 0;
+static uint64 sDemotions = 0;
+
+// protected by sCompressorLock
+static mutex sCompressorLock = MUTEX_INITIALIZER("compressed swap compressor");
+static z_stream sDeflateStream;
+static uint8* sPageBuffer;
+static uint8* sCompressedBuffer;
+
+
+static int
+dump_compressed_swap(int argc, char** argv)
+{
+	kprintf("size:          %" B_PRIuSIZE " KB / %" B_PRIuSIZE " KB\n",
+		sUsedSize / 1024, sMaxSize / 1024);
+	kprintf("stored pages:  %" B_PRIu64 "\n", sStoredPages);
+	if (sUsedSize > 0) {
+		kprintf("ratio:         %" B_PRIu64 "%%\n",
+			sStoredPages * B_PAGE_SIZE * 100 / sUsedSize);
+	}
+	kprintf("stores:        %" B_PRIu64 " (%" B_PRIu64 " rejected)\n",
+		sStores, sRejected);
+	kprintf("hits:          %" B_PRIu64 "\n", sHits);
+	kprintf("misses:        %" B_PRIu64 "\n", sMisses);
+	kprintf("demotions:     %" B_PRIu64 "\n", sDemotions);
+	kprintf("LRU list:      %p (head)\n", sLRUList.Head());
+
+	return 0;
+}
+
+
+/*!	Removes \a page from the store, and frees it.
+	The store lock must be held, and the page must not be demoted currently.
+*/
+static void
+remove_page(compressed_page* page)
+{
+	ASSERT(!page->demoting);
+
+	sPageTable.RemoveUnchecked(page);
+	sLRUList.Remove(page);
+	sUsedSize -= page->AllocationSize();
+	sStoredPages--;
+
+	free_etc(page, HEAP_DONT_WAIT_FOR_MEMORY | HEAP_DONT_LOCK_KERNEL_SPACE);
+}
+
+
+/*!	Decompresses \a page into \a buffer, which must be B_PAGE_SIZE large.
+	The store lock must be held.
+*/
+static status_t
+decompress_page(compressed_page* page, uint8* buffer)
+{
+	inflateReset(&sInflateStream);
+	sInflateStream.next_in = page->data;
+	sInflateStream.avail_in = page->size;
+	sInflateStream.next_out = buffer;
+	sInflateStream.avail_out = B_PAGE_SIZE;
+
+	int result = inflate(&sInflateStream, Z_FINISH);
+	if (result != Z_STREAM_END
+		|| B_PAGE_SIZE - sInflateStream.avail_out != page->length) {
+		dprintf("compressed swap: decompressing slot %" B_PRIu32 " failed: "
+			"%d\n", page->slot, result);
+		return B_IO_ERROR;
+	}
+
+	if (page->length < B_PAGE_SIZE)
+		memset(buffer + page->length, 0, B_PAGE_SIZE - page->length);
+
+	return B_OK;
+}
+
+
+/*!	Returns the page of the store for \a slotIndex, after waiting for its
+	demotion to be finished, if necessary.
+	The store lock must be held.
+*/
+static compressed_page*
+lookup_page_not_demoting(swap_addr_t slotIndex)
+{
+	while (true) {
+		compressed_page* page = sPageTable.Lookup(slotIndex);
+		if (page == NULL || !page->demoting)
+			return page;
+
+		sDemotionCondition.Wait(&sLock);
+	}
+}
+
+
+// #pragma mark -
+
+
+status_t
+compressed_swap_init(size_t maxSize)
+{
+	maxSize = ROUNDDOWN(maxSize, B_PAGE_SIZE);
+	if (maxSize == 0)
+		return B_OK;
+
+	sPageBuffer = (uint8*)malloc(B_PAGE_SIZE);
+	sCompressedBuffer = (uint8*)malloc(kMaxCompressedSize);
+	if (sPageBuffer == NULL || sCompressedBuffer == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = sPageTable.Init(maxSize / B_PAGE_SIZE);
+	if (status != B_OK)
+		return status;
+
+	memset(&sDeflateStream, 0, sizeof(z_stream));
+	memset(&sInflateStream, 0, sizeof(z_stream));
+	if (deflateInit2(&sDeflateStream, kCompressionLevel, Z_DEFLATED,
+			kWindowBits, kMemoryLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+		return B_NO_MEMORY;
+	}
+	if (inflateInit2(&sInflateStream, kWindowBits) != Z_OK) {
+		deflateEnd(&sDeflateStream);
+		return B_NO_MEMORY;
+	}
+
+	sDemotionCondition.Init(&sLRUList, "compressed swap demotion");
+	sMaxSize = maxSize;
+
+	add_debugger_command_etc("compressed_swap", &dump_compressed_swap,
+		"Print infos about the compressed swap store",
+		"\n"
+		"Print infos about the compressed swap store.\n", 0);
+
+	dprintf("compressed swap: using up to %" B_PRIuSIZE " MB of memory\n",
+		maxSize / (1024 * 1024));
+	return B_OK;
+}
+
+
+bool
+compressed_swap_enabled()
+{
+	return sMaxSize != 0;
+}
+
+
+/*!	Compresses the page at \a vec and stores it for the swap slot
+	\a slotIndex, replacing the previous contents of the slot, if any.
+	If that is not possible (the page doesn't compress well, or there is no
+	room left), the previous contents are dropped nevertheless, and an error
+	is returned. The caller then has to write the page to the swap file.
+*/
+status_t
+compressed_swap_store(swap_addr_t slotIndex, const generic_io_vec* vec,
+	generic_size_t length, uint32 flags)
+{
+	if (sMaxSize == 0)
+		return B_NOT_SUPPORTED;
+
+	length = std::min(length, (generic_size_t)B_PAGE_SIZE);
+
+	MutexLocker compressorLocker(sCompressorLock);
+
+	status_t status = B_OK;
+	if ((flags & B_PHYSICAL_IO_REQUEST) != 0) {
+		status = vm_memcpy_from_physical(sPageBuffer, vec->base, length,
+			false);
+	} else
+		memcpy(sPageBuffer, (void*)(addr_t)vec->base, length);
+
+	compressed_page* page = NULL;
+	if (status == B_OK) {
+		deflateReset(&sDeflateStream);
+		sDeflateStream.next_in = sPageBuffer;
+		sDeflateStream.avail_in = length;
+		sDeflateStream.next_out = sCompressedBuffer;
+		sDeflateStream.avail_out = kMaxCompressedSize;
+
+		if (deflate(&sDeflateStream, Z_FINISH) == Z_STREAM_END) {
+			size_t size = kMaxCompressedSize - sDeflateStream.avail_out;
+			uint32 allocationFlags = HEAP_DONT_WAIT_FOR_MEMORY
+				| HEAP_DONT_LOCK_KERNEL_SPACE;
+			if ((flags & B_VIP_IO_REQUEST) != 0)
+				allocationFlags |= HEAP_PRIORITY_VIP;
+
+			page = (compressed_page*)malloc_etc(
+				sizeof(compressed_page) + size, allocationFlags);
+			if (page != NULL) {
+				page->slot = slotIndex;
+				page->length = length;
+				page->size = size;
+				page->demoting = false;
+				page->freed = false;
+				memcpy(page->data, sCompressedBuffer, size);
+			}
+		}
+	}
+
+	compressorLocker.Unlock();
+
+	MutexLocker locker(sLock);
+
+	compressed_page* previous = lookup_page_not_demoting(slotIndex);
+	if (previous != NULL)
+		remove_page(previous);
+
+	if (page == NULL || sUsedSize + page->AllocationSize() > sMaxSize) {
+		sRejected++;
+		locker.Unlock();
+
+		free_etc(page, HEAP_DONT_WAIT_FOR_MEMORY | HEAP_DONT_LOCK_KERNEL_SPACE);
+		return status != B_OK ? status : B_NO_MEMORY;
+	}
+
+	sPageTable.InsertUnchecked(page);
+	sLRUList.Add(page);
+	sUsedSize += page->AllocationSize();
+	sStoredPages++;
+	sStores++;
+
+	TRACE("stored slot %" B_PRIu32 ": %" B_PRIu32 " -> %" B_PRIu32 " bytes\n",
+		slotIndex, page->length, page->size);
+	return B_OK;
+}
+
+
+/*!	Copies the contents of swap slot \a slotIndex to \a vec, if the store
+	has them. Returns \c B_ENTRY_NOT_FOUND otherwise.
+*/
+status_t
+compressed_swap_load(swap_addr_t slotIndex, const generic_io_vec* vec,
+	uint32 flags)
+{
+	if (sMaxSize == 0)
+		return B_ENTRY_NOT_FOUND;
+
+	MutexLocker locker(sLock);
+
+	compressed_page* page = sPageTable.Lookup(slotIndex);
+	if (page == NULL) {
+		sMisses++;
+		return B_ENTRY_NOT_FOUND;
+	}
+
+	// a static buffer is fine, since we only decompress with sLock held
+	static uint8 buffer[B_PAGE_SIZE];
+	status_t status = decompress_page(page, buffer);
+	if (status != B_OK)
+		return status;
+
+	size_t length = std::min(vec->length, (generic_size_t)B_PAGE_SIZE);
+	if ((flags & B_PHYSICAL_IO_REQUEST) != 0)
+		status = vm_memcpy_to_physical(vec->base, buffer, length, false);
+	else
+		memcpy((void*)(addr_t)vec->base, buffer, length);
+
+	if (status != B_OK)
+		return status;
+
+	if (!page->demoting) {
+		sLRUList.Remove(page);
+		sLRUList.Add(page);
+	}
+	sHits++;
+
+	return B_OK;
+}
+
+
+bool
+compressed_swap_has_page(swap_addr_t slotIndex)
+{
+	if (sMaxSize == 0)
+		return false;
+
+	MutexLocker locker(sLock);
+	return sPageTable.Lookup(slotIndex) != NULL;
+}
+
+
+/*!	Drops the contents of swap slot \a slotIndex from the store.
+	Returns \c true, if the page is being demoted right now: the slot must not
+	be reused before that is done, and compressed_swap_end_demotion() will
+	tell the demoting thread to free it.
+*/
+bool
+compressed_swap_free(swap_addr_t slotIndex)
+{
+	if (sMaxSize == 0)
+		return false;
+
+	MutexLocker locker(sLock);
+
+	compressed_page* page = sPageTable.Lookup(slotIndex);
+	if (page == NULL)
+		return false;
+
+	if (page->demoting) {
+		page->freed = true;
+		return true;
+	}
+
+	remove_page(page);
+	return false;
+}
+
+
+/*!	Returns whether the store might not have room for another page. */
+bool
+compressed_swap_needs_demotion()
+{
+	return sMaxSize != 0
+		&& sUsedSize + sizeof(compressed_page) + kMaxCompressedSize > sMaxSize;
+}
+
+
+/*!	Chooses the least recently used page of the store to be written back to
+	the swap file, and decompresses it into \a buffer (B_PAGE_SIZE large).
+	The page stays in the store until compressed_swap_end_demotion() is
+	called.
+*/
+status_t
+compressed_swap_begin_demotion(swap_addr_t& _slotIndex, void* buffer)
+{
+	MutexLocker locker(sLock);
+
+	compressed_page* page = sLRUList.Head();
+	if (page == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	status_t status = decompress_page(page, (uint8*)buffer);
+	if (status != B_OK)
+		return status;
+
+	sLRUList.Remove(page);
+	page->demoting = true;
+
+	_slotIndex = page->slot;
+	return B_OK;
+}
+
+
+/*!	Finishes the demotion of the page for \a slotIndex. If it has been
+	\a written to the swap file successfully, it is removed from the store.
+	Returns \c true, if the slot has been freed in the meantime, and the
+	caller has to actually free it now.
+*/
+bool
+compressed_swap_end_demotion(swap_addr_t slotIndex, bool written)
+{
+	MutexLocker locker(sLock);
+
+	compressed_page* page = sPageTable.Lookup(slotIndex);
+	ASSERT(page != NULL && page->demoting);
+
+	bool freed = page->freed;
+	page->demoting = false;
+
+	if (written || freed) {
+		if (written)
+			sDemotions++;
+
+		sLRUList.Add(page);
+			// remove_page() expects the page in the list
+		remove_page(page);
+	} else {
+		// put it back, we'll try again later
+		sLRUList.Add(page, false);
+	}
+
+	sDemotionCondition.NotifyAll();
+	return freed;
+}
+
+
+void
+compressed_swap_get_info(compressed_swap_info* info)
+{
+	MutexLocker locker(sLock);
+
+	info->max_size = sMaxSize;
+	info->used_size = sUsedSize;
+	info->stored_pages = sStoredPages;
+	info->stores = sStores;
+	info->rejected = sRejected;
+	info->hits = sHits;
+	info->misses = sMisses;
+	info->demotions = sDemotions;
+}
+
+
+#endif	// ENABLE_SWAP_SUPPORT
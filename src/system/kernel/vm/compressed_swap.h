@@ -0,0 +1,39 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_VM_COMPRESSED_SWAP_H
+#define _KERNEL_VM_COMPRESSED_SWAP_H
+
+
+#include "VMAnonymousCache.h"
+
+
+#if ENABLE_SWAP_SUPPORT
+
+struct compressed_swap_info;
+
+
+status_t	compressed_swap_init(size_t maxSize);
+bool		compressed_swap_enabled();
+
+status_t	compressed_swap_store(swap_addr_t slotIndex,
+				const generic_io_vec* vec, generic_size_t length,
+				uint32 flags);
+status_t	compressed_swap_load(swap_addr_t slotIndex,
+				const generic_io_vec* vec, uint32 flags);
+bool		compressed_swap_has_page(swap_addr_t slotIndex);
+bool		compressed_swap_free(swap_addr_t slotIndex);
+
+bool		compressed_swap_needs_demotion();
+status_t	compressed_swap_begin_demotion(swap_addr_t& _slotIndex,
+				void* buffer);
+bool		compressed_swap_end_demotion(swap_addr_t slotIndex,
+				bool written);
+
+void		compressed_swap_get_info(compressed_swap_info* info);
+
+#endif	// ENABLE_SWAP_SUPPORT
+
+
+#endif	// _KERNEL_VM_COMPRESSED_SWAP_H
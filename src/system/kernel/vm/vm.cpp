@@ -691,6 +691,27 @@ map_page(VMArea* area, vm_page* page, addr_t address, uint32 protection,
 }
 
 
+/*!	Replaces the mappings of a wired area by large page mappings, wherever
+	its pages allow for it.
+	The area's cache must be locked.
+*/
+static void
+promote_large_pages(VMArea* area)
+{
+	if (area->wiring != B_FULL_LOCK && area->wiring != B_CONTIGUOUS)
+		return;
+
+	VMTranslationMap* map = area->address_space->TranslationMap();
+	size_t largePageSize = map->LargePageSize();
+	if (largePageSize == 0 || area->Size() < largePageSize)
+		return;
+
+	map->Lock();
+	map->PromoteLargePages(area->Base(), area->Base() + (area->Size() - 1));
+	map->Unlock();
+}
+
+
 /*!	If \a preserveModified is \c true, the caller must hold the lock of the
 	page's cache.
 */
@@ -1588,6 +1609,18 @@ vm_reserve_address_range(team_id team, void** _address, uint32 addressSpec,
 }
 
 
+/*!	Frees page runs that were allocated for large pages, but weren't used. */
+static void
+free_large_page_runs(vm_page** runs, page_num_t count, page_num_t runLength)
+{
+	for (page_num_t i = 0; i < count; i++) {
+		page_num_t pageNumber = runs[i]->physical_page_number;
+		for (page_num_t j = 0; j < runLength; j++)
+			vm_page_free(NULL, vm_lookup_page(pageNumber + j));
+	}
+}
+
+
 area_id
 vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 	uint32 wiring, uint32 protection, uint32 flags, addr_t guardSize,
@@ -1624,6 +1657,14 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 	if (isStack || (protection & B_OVERCOMMITTING_AREA) != 0)
 		canOvercommit = true;
 
+	// Large pages are always wired.
+	if ((protection & B_LARGE_PAGES_AREA) != 0) {
+		if (isStack)
+			return B_BAD_VALUE;
+		if (wiring == B_NO_LOCK || wiring == B_LAZY_LOCK)
+			wiring = B_FULL_LOCK;
+	}
+
 #ifdef DEBUG_KERNEL_STACKS
 	if ((protection & B_KERNEL_STACK_AREA) != 0)
 		isStack = true;
@@ -1711,6 +1752,7 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 	// For full lock or contiguous areas we're also going to map the pages and
 	// thus need to reserve pages for the mapping backend upfront.
 	addr_t reservedMapPages = 0;
+	size_t largePageSize = 0;
 	if (wiring == B_FULL_LOCK || wiring == B_CONTIGUOUS) {
 		AddressSpaceWriteLocker locker;
 		status_t status = locker.SetTo(team);
@@ -1719,6 +1761,39 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 
 		VMTranslationMap* map = locker.AddressSpace()->TranslationMap();
 		reservedMapPages = map->MaxPagesNeededToMap(0, size - 1);
+		largePageSize = map->LargePageSize();
+	}
+
+	// If large pages have been requested, figure out how many of them fit
+	// into the area, and make sure it is aligned accordingly.
+	virtual_address_restrictions largePageVirtualRestrictions;
+	page_num_t largePageCount = 0;
+	if ((protection & B_LARGE_PAGES_AREA) != 0 && wiring == B_FULL_LOCK
+		&& largePageSize != 0 && size >= largePageSize
+		&& (flags & CREATE_AREA_DONT_WAIT) == 0) {
+		switch (virtualAddressRestrictions->address_specification) {
+			case B_EXACT_ADDRESS:
+			{
+				addr_t base = (addr_t)virtualAddressRestrictions->address;
+				addr_t start = ROUNDUP(base, largePageSize);
+				addr_t end = ROUNDDOWN(base + size, largePageSize);
+				if (end > start)
+					largePageCount = (end - start) / largePageSize;
+				break;
+			}
+
+			case B_ANY_KERNEL_BLOCK_ADDRESS:
+				// this one overrides the alignment
+				break;
+
+			default:
+				largePageVirtualRestrictions = *virtualAddressRestrictions;
+				largePageVirtualRestrictions.alignment = std::max(
+					largePageVirtualRestrictions.alignment, largePageSize);
+				virtualAddressRestrictions = &largePageVirtualRestrictions;
+				largePageCount = size / largePageSize;
+				break;
+		}
 	}
 
 	int priority;
@@ -1749,12 +1824,43 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 	VMAddressSpace* addressSpace;
 	status_t status;
 
+	// Allocate the physically contiguous page runs for the large pages
+	// upfront, too. If we can't get them all, we just use regular pages for
+	// the rest of the area.
+	const page_num_t pagesPerLargePage = largePageSize / B_PAGE_SIZE;
+	const uint32 allocationFlags = team == VMAddressSpace::KernelID()
+		? HEAP_DONT_LOCK_KERNEL_SPACE : 0;
+	vm_page** largePages = NULL;
+	page_num_t largePagesAllocated = 0;
+	page_num_t largePagesUsed = 0;
+	if (largePageCount > 0) {
+		largePages = (vm_page**)malloc_etc(largePageCount * sizeof(vm_page*),
+			allocationFlags);
+		if (largePages == NULL)
+			largePageCount = 0;
+
+		physical_address_restrictions largePageRestrictions = {};
+		largePageRestrictions.alignment = largePageSize;
+
+		while (largePagesAllocated < largePageCount) {
+			vm_page* run = vm_page_allocate_page_run(
+				PAGE_STATE_WIRED | pageAllocFlags, pagesPerLargePage,
+				&largePageRestrictions, priority);
+			if (run == NULL)
+				break;
+
+			largePages[largePagesAllocated++] = run;
+		}
+	}
+
 	// For full lock areas reserve the pages before locking the address
 	// space. E.g. block caches can't release their memory while we hold the
 	// address space lock.
 	page_num_t reservedPages = reservedMapPages;
-	if (wiring == B_FULL_LOCK)
-		reservedPages += size / B_PAGE_SIZE;
+	if (wiring == B_FULL_LOCK) {
+		reservedPages += size / B_PAGE_SIZE
+			- largePagesAllocated * pagesPerLargePage;
+	}
 
 	vm_page_reservation reservation;
 	if (reservedPages > 0) {
@@ -1836,6 +1942,30 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 			for (addr_t address = area->Base();
 					address < area->Base() + (area->Size() - 1);
 					address += B_PAGE_SIZE, offset += B_PAGE_SIZE) {
+				if (largePagesUsed < largePagesAllocated
+					&& address % largePageSize == 0
+					&& area->Base() + (area->Size() - 1) - address
+						>= largePageSize - 1) {
+					// use one of the preallocated runs
+					vm_page* page = largePages[largePagesUsed++];
+					for (page_num_t i = 0; i < pagesPerLargePage; i++) {
+						vm_page* runPage = vm_lookup_page(
+							page->physical_page_number + i);
+						cache->InsertPage(runPage, offset);
+						map_page(area, runPage, address, protection,
+							&reservation);
+
+						DEBUG_PAGE_ACCESS_END(runPage);
+
+						address += B_PAGE_SIZE;
+						offset += B_PAGE_SIZE;
+					}
+
+					address -= B_PAGE_SIZE;
+					offset -= B_PAGE_SIZE;
+					continue;
+				}
+
 #ifdef DEBUG_KERNEL_STACKS
 #	ifdef STACK_GROWS_DOWNWARDS
 				if (isStack && address < area->Base()
@@ -1854,6 +1984,8 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 				DEBUG_PAGE_ACCESS_END(page);
 			}
 
+			if (!isStack)
+				promote_large_pages(area);
 			break;
 		}
 
@@ -1931,6 +2063,8 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 			}
 
 			map->Unlock();
+
+			promote_large_pages(area);
 			break;
 		}
 
@@ -1943,6 +2077,11 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 	if (reservedPages > 0)
 		vm_page_unreserve_pages(&reservation);
 
+	// The address might not have allowed for all of the runs to be used.
+	free_large_page_runs(largePages + largePagesUsed,
+		largePagesAllocated - largePagesUsed, pagesPerLargePage);
+	free_etc(largePages, allocationFlags);
+
 	TRACE(("vm_create_anonymous_area: done\n"));
 
 	area->cache_type = CACHE_TYPE_RAM;
@@ -1968,6 +2107,9 @@ err0:
 	if (reservedMemory > 0)
 		vm_unreserve_memory(reservedMemory);
 
+	free_large_page_runs(largePages, largePagesAllocated, pagesPerLargePage);
+	free_etc(largePages, allocationFlags);
+
 	return status;
 }
 
@@ -3120,6 +3262,10 @@ vm_set_area_protection(team_id team, area_id areaID, uint32 newProtection,
 			return B_NOT_ALLOWED;
 		}
 
+		// whether large pages were requested isn't up for change
+		newProtection = (newProtection & ~B_LARGE_PAGES_AREA)
+			| (area->protection & B_LARGE_PAGES_AREA);
+
 		if (area->protection == newProtection)
 			return B_OK;
 
@@ -3237,6 +3383,9 @@ vm_set_area_protection(team_id team, area_id areaID, uint32 newProtection,
 		}
 
 		area->protection = newProtection;
+
+		// Per-page protections might have prevented large pages so far.
+		promote_large_pages(area);
 	}
 
 	return status;
@@ -6661,6 +6810,46 @@ _user_get_memory_properties(team_id teamID, const void* address,
 }
 
 
+status_t
+_user_get_large_page_info(area_id areaID, large_page_info* userInfo)
+{
+	if (userInfo == NULL || !IS_USER_ADDRESS(userInfo))
+		return B_BAD_ADDRESS;
+
+	large_page_info info = {};
+
+	if (areaID < 0) {
+		// system wide
+		info.page_size
+			= VMAddressSpace::Kernel()->TranslationMap()->LargePageSize();
+		info.count = atomic_get(&gMappedLargePagesCount);
+	} else {
+		AddressSpaceReadLocker locker;
+		VMArea* area;
+		status_t status = locker.SetFromArea(areaID, area);
+		if (status != B_OK)
+			return status;
+
+		team_id team = area->address_space->ID();
+		if (geteuid() != 0 && team != team_get_current_team_id()
+			&& team_geteuid(team) != geteuid()) {
+			return B_NOT_ALLOWED;
+		}
+
+		VMTranslationMap* map = area->address_space->TranslationMap();
+		info.page_size = map->LargePageSize();
+		if (info.page_size != 0) {
+			map->Lock();
+			info.count = map->CountLargePages(area->Base(),
+				area->Base() + (area->Size() - 1));
+			map->Unlock();
+		}
+	}
+
+	return user_memcpy(userInfo, &info, sizeof(large_page_info));
+}
+
+
 static status_t
 user_set_memory_swappable(const void* _address, size_t size, bool swappable)
 {
@@ -27,6 +27,7 @@
 #include <heap.h>
 #include <kernel.h>
 #include <low_resource_manager.h>
+#include <smp.h>
 #include <thread.h>
 #include <tracing.h>
 #include <util/AutoLock.h>
@@ -101,11 +102,11 @@ static const int32 kPageUsageAdvance = 3;
 static const int32 kPageUsageDecline = 1;
 
 int32 gMappedPagesCount;
+int32 gMappedLargePagesCount;
 
 static VMPageQueue sPageQueues[PAGE_STATE_FIRST_UNQUEUED];
+	// the free and clear page queues are per memory node, see below
 
-static VMPageQueue& sFreePageQueue = sPageQueues[PAGE_STATE_FREE];
-static VMPageQueue& sClearPageQueue = sPageQueues[PAGE_STATE_CLEAR];
 static VMPageQueue& sModifiedPageQueue = sPageQueues[PAGE_STATE_MODIFIED];
 static VMPageQueue& sInactivePageQueue = sPageQueues[PAGE_STATE_INACTIVE];
 static VMPageQueue& sActivePageQueue = sPageQueues[PAGE_STATE_ACTIVE];
@@ -123,6 +124,28 @@ static int32 sUnreservedFreePages;
 static int32 sUnsatisfiedPageReservations;
 static int32 sModifiedTemporaryPages;
 
+// Physical memory is divided into memory (NUMA) nodes, if the boot loader
+// passed on the topology. Every node has its own free and clear page queue.
+// Pages are allocated from the node of the allocating CPU first, and only
+// then from the other nodes, in the order of their distance. Without topology
+// information there is a single node containing all pages.
+struct memory_node {
+	VMPageQueue	free_queue;
+	VMPageQueue	clear_queue;
+	page_num_t	page_count;
+	uint8		distance[MAX_MEMORY_NODES];
+	uint8		fallback_order[MAX_MEMORY_NODES];
+		// all nodes, sorted by their distance to this one
+
+	// statistics
+	int64		local_allocations;
+	int64		remote_allocations;
+};
+
+static memory_node sMemoryNodes[MAX_MEMORY_NODES];
+static uint32 sMemoryNodeCount = 1;
+static uint8 sCPUMemoryNode[SMP_MAX_CPUS];
+
 static ConditionVariable sFreePageCondition;
 static mutex sPageDeficitLock = MUTEX_INITIALIZER("page deficit");
 
@@ -133,6 +156,59 @@ static mutex sPageDeficitLock = MUTEX_INITIALIZER("page deficit");
 static rw_lock sFreePageQueuesLock
 	= RW_LOCK_INITIALIZER("free/clear page queues");
 
+// Per-CPU caches of free and clear pages. They allow vm_page_allocate_page()
+// and free_page() to bypass the free/clear page queues (and the lock above) in
+// the common case. Pages in a per-CPU cache keep their free/clear state and
+// are still accounted for in sUnreservedFreePages, they are just not in any
+// queue. Pages are moved between the caches and the queues in batches, which
+// always happens with sFreePageQueuesLock read-locked. Whoever write-locks the
+// lock in order to examine all free pages has to call
+// disable_page_cpu_caches() first. A CPU's cache only ever contains pages of
+// the CPU's own memory node.
+static const uint32 kPageCPUCacheSize = 64;
+static const uint32 kPageCPUCacheBatchSize = 16;
+
+struct page_cpu_cache {
+	spinlock	lock;
+	uint32		free_count;
+	uint32		clear_count;
+	vm_page*	free_pages[kPageCPUCacheSize];
+	vm_page*	clear_pages[kPageCPUCacheSize];
+
+	// statistics
+	uint64		allocation_hits;
+	uint64		allocation_misses;
+	uint64		refills;
+	uint64		free_hits;
+	uint64		free_overflows;
+} CACHE_LINE_ALIGN;
+
+static page_cpu_cache* sPageCPUCaches;
+static int32 sPageCPUCachesDisabled;
+static int32 sPageCPUCacheFlushes;
+
+
+static inline VMPageQueue&
+free_page_queue(uint32 node, bool clear)
+{
+	return clear
+		? sMemoryNodes[node].clear_queue : sMemoryNodes[node].free_queue;
+}
+
+
+/*!	Returns the number of pages in the free (or clear) queues of all memory
+	nodes.
+*/
+static page_num_t
+free_page_queues_count(bool clear)
+{
+	page_num_t count = 0;
+	for (uint32 i = 0; i < sMemoryNodeCount; i++)
+		count += free_page_queue(i, clear).Count();
+
+	return count;
+}
+
 #ifdef TRACK_PAGE_USAGE_STATS
 static page_num_t sPageUsageArrays[512];
 static page_num_t* sPageUsage = sPageUsageArrays;
@@ -829,8 +905,6 @@ find_page(int argc, char **argv)
 		const char*	name;
 		VMPageQueue*	queue;
 	} pageQueueInfos[] = {
-		{ "free",		&sFreePageQueue },
-		{ "clear",		&sClearPageQueue },
 		{ "modified",	&sModifiedPageQueue },
 		{ "active",		&sActivePageQueue },
 		{ "inactive",	&sInactivePageQueue },
@@ -860,6 +934,41 @@ find_page(int argc, char **argv)
 		}
 	}
 
+	for (uint32 node = 0; node < sMemoryNodeCount; node++) {
+		for (int clear = 0; clear < 2; clear++) {
+			VMPageQueue& queue = free_page_queue(node, clear != 0);
+			VMPageQueue::Iterator it = queue.GetIterator();
+			while (vm_page* p = it.Next()) {
+				if (p == page) {
+					kprintf("found page %p in queue %p (%s, node %" B_PRIu32
+						")\n", page, &queue, clear != 0 ? "clear" : "free",
+						node);
+					return 0;
+				}
+			}
+		}
+	}
+
+	if (sPageCPUCaches != NULL) {
+		for (int32 cpu = 0; cpu < smp_get_num_cpus(); cpu++) {
+			page_cpu_cache& cache = sPageCPUCaches[cpu];
+			for (uint32 i = 0; i < cache.free_count; i++) {
+				if (cache.free_pages[i] == page) {
+					kprintf("found page %p in free cache of CPU %" B_PRId32
+						"\n", page, cpu);
+					return 0;
+				}
+			}
+			for (uint32 i = 0; i < cache.clear_count; i++) {
+				if (cache.clear_pages[i] == page) {
+					kprintf("found page %p in clear cache of CPU %" B_PRId32
+						"\n", page, cpu);
+					return 0;
+				}
+			}
+		}
+	}
+
 	kprintf("page %p isn't in any queue\n", page);
 
 	return 0;
@@ -1060,16 +1169,30 @@ dump_page_queue(int argc, char **argv)
 	struct VMPageQueue *queue;
 
 	if (argc < 2) {
-		kprintf("usage: page_queue <address/name> [list]\n");
+		kprintf("usage: page_queue <address/name> [<node>] [list]\n");
+		return 0;
+	}
+
+	// the free and clear queues exist once per memory node
+	uint32 node = 0;
+	bool list = false;
+	for (int i = 2; i < argc; i++) {
+		if (argv[i][0] >= '0' && argv[i][0] <= '9')
+			node = strtoul(argv[i], NULL, 0);
+		else
+			list = true;
+	}
+	if (node >= sMemoryNodeCount) {
+		kprintf("page_queue: invalid memory node %" B_PRIu32 ".\n", node);
 		return 0;
 	}
 
 	if (strlen(argv[1]) >= 2 && argv[1][0] == '0' && argv[1][1] == 'x')
 		queue = (VMPageQueue*)strtoul(argv[1], NULL, 16);
 	else if (!strcmp(argv[1], "free"))
-		queue = &sFreePageQueue;
+		queue = &sMemoryNodes[node].free_queue;
 	else if (!strcmp(argv[1], "clear"))
-		queue = &sClearPageQueue;
+		queue = &sMemoryNodes[node].clear_queue;
 	else if (!strcmp(argv[1], "modified"))
 		queue = &sModifiedPageQueue;
 	else if (!strcmp(argv[1], "active"))
@@ -1087,7 +1210,7 @@ dump_page_queue(int argc, char **argv)
 		B_PRIuPHYSADDR "\n", queue, queue->Head(), queue->Tail(),
 		queue->Count());
 
-	if (argc == 3) {
+	if (list) {
 		struct vm_page *page = queue->Head();
 
 		kprintf("page        cache       type       state  wired  usage\n");
@@ -1186,6 +1309,7 @@ dump_page_stats(int argc, char **argv)
 	kprintf("unsatisfied page reservations: %" B_PRId32 "\n",
 		sUnsatisfiedPageReservations);
 	kprintf("mapped pages: %" B_PRId32 "\n", gMappedPagesCount);
+	kprintf("mapped large pages: %" B_PRId32 "\n", gMappedLargePagesCount);
 	kprintf("longest free pages run: %" B_PRIuPHYSADDR " pages (at %"
 		B_PRIuPHYSADDR ")\n", longestFreeRun.Length(),
 		sPages[longestFreeRun.start].physical_page_number);
@@ -1202,10 +1326,18 @@ dump_page_stats(int argc, char **argv)
 			waiter->requested, waiter->reserved, waiter->dontTouch);
 	}
 
-	kprintf("\nfree queue: %p, count = %" B_PRIuPHYSADDR "\n", &sFreePageQueue,
-		sFreePageQueue.Count());
-	kprintf("clear queue: %p, count = %" B_PRIuPHYSADDR "\n", &sClearPageQueue,
-		sClearPageQueue.Count());
+	kprintf("\n");
+	for (uint32 i = 0; i < sMemoryNodeCount; i++) {
+		memory_node& node = sMemoryNodes[i];
+		if (sMemoryNodeCount > 1)
+			kprintf("node %" B_PRIu32 " ", i);
+		kprintf("free queue: %p, count = %" B_PRIuPHYSADDR "\n",
+			&node.free_queue, node.free_queue.Count());
+		if (sMemoryNodeCount > 1)
+			kprintf("node %" B_PRIu32 " ", i);
+		kprintf("clear queue: %p, count = %" B_PRIuPHYSADDR "\n",
+			&node.clear_queue, node.clear_queue.Count());
+	}
 	kprintf("modified queue: %p, count = %" B_PRIuPHYSADDR " (%" B_PRId32
 		" temporary, %" B_PRIuPHYSADDR " swappable, " "inactive: %"
 		B_PRIuPHYSADDR ")\n", &sModifiedPageQueue, sModifiedPageQueue.Count(),
@@ -1216,6 +1348,102 @@ dump_page_stats(int argc, char **argv)
 		&sInactivePageQueue, sInactivePageQueue.Count());
 	kprintf("cached queue: %p, count = %" B_PRIuPHYSADDR "\n",
 		&sCachedPageQueue, sCachedPageQueue.Count());
+
+	if (sPageCPUCaches != NULL) {
+		uint32 cachedFree = 0;
+		uint32 cachedClear = 0;
+		for (int32 cpu = 0; cpu < smp_get_num_cpus(); cpu++) {
+			cachedFree += sPageCPUCaches[cpu].free_count;
+			cachedClear += sPageCPUCaches[cpu].clear_count;
+		}
+		kprintf("per-CPU caches: free = %" B_PRIu32 ", clear = %" B_PRIu32
+			"\n", cachedFree, cachedClear);
+	}
+	return 0;
+}
+
+
+static int
+dump_page_cpu_caches(int argc, char** argv)
+{
+	if (argc > 2 || (argc == 2 && strcmp(argv[1], "-r") != 0)) {
+		print_debugger_command_usage(argv[0]);
+		return 0;
+	}
+
+	if (sPageCPUCaches == NULL) {
+		kprintf("per-CPU page caches are not initialized\n");
+		return 0;
+	}
+
+	kprintf("cpu  free  clear  alloc hits  alloc misses     refills"
+		"   free hits  overflows\n");
+
+	uint64 totalHits = 0;
+	uint64 totalMisses = 0;
+	uint64 totalFreeHits = 0;
+	uint64 totalOverflows = 0;
+	for (int32 cpu = 0; cpu < smp_get_num_cpus(); cpu++) {
+		page_cpu_cache& cache = sPageCPUCaches[cpu];
+		kprintf("%3" B_PRId32 " %5" B_PRIu32 " %6" B_PRIu32 " %11" B_PRIu64
+			" %13" B_PRIu64 " %11" B_PRIu64 " %11" B_PRIu64 " %10" B_PRIu64
+			"\n", cpu, cache.free_count, cache.clear_count,
+			cache.allocation_hits, cache.allocation_misses, cache.refills,
+			cache.free_hits, cache.free_overflows);
+
+		totalHits += cache.allocation_hits;
+		totalMisses += cache.allocation_misses;
+		totalFreeHits += cache.free_hits;
+		totalOverflows += cache.free_overflows;
+
+		if (argc == 2) {
+			cache.allocation_hits = 0;
+			cache.allocation_misses = 0;
+			cache.refills = 0;
+			cache.free_hits = 0;
+			cache.free_overflows = 0;
+		}
+	}
+
+	uint64 allocations = totalHits + totalMisses;
+	uint64 frees = totalFreeHits + totalOverflows;
+	kprintf("\nallocations: %" B_PRIu64 ", served by per-CPU caches: %"
+		B_PRIu64 "%%\n", allocations,
+		allocations != 0 ? totalHits * 100 / allocations : 0);
+	kprintf("frees: %" B_PRIu64 ", served by per-CPU caches: %" B_PRIu64
+		"%%\n", frees, frees != 0 ? totalFreeHits * 100 / frees : 0);
+	kprintf("cache flushes: %" B_PRId32 ", disabled: %" B_PRId32 "\n",
+		sPageCPUCacheFlushes, sPageCPUCachesDisabled);
+
+	if (argc == 2)
+		sPageCPUCacheFlushes = 0;
+
+	return 0;
+}
+
+
+static int
+dump_memory_nodes(int argc, char** argv)
+{
+	kprintf("node       pages        free       clear  local allocs  "
+		"remote allocs  distances\n");
+
+	for (uint32 i = 0; i < sMemoryNodeCount; i++) {
+		memory_node& node = sMemoryNodes[i];
+		kprintf("%4" B_PRIu32 " %11" B_PRIuPHYSADDR " %11" B_PRIuPHYSADDR
+			" %11" B_PRIuPHYSADDR " %13" B_PRId64 " %14" B_PRId64 " ", i,
+			node.page_count, node.free_queue.Count(), node.clear_queue.Count(),
+			node.local_allocations, node.remote_allocations);
+		for (uint32 j = 0; j < sMemoryNodeCount; j++)
+			kprintf(" %3u", node.distance[j]);
+		kprintf("\n");
+	}
+
+	kprintf("\ncpu -> node:");
+	for (int32 cpu = 0; cpu < smp_get_num_cpus(); cpu++)
+		kprintf(" %" B_PRId32 ":%u", cpu, sCPUMemoryNode[cpu]);
+	kprintf("\n");
+
 	return 0;
 }
 
@@ -1551,6 +1779,285 @@ unreserve_pages(uint32 count)
 }
 
 
+/*!	Prepends the given pages to \a queue.
+	The caller must hold sFreePageQueuesLock.
+*/
+static void
+return_pages_to_queue(vm_page** pages, uint32 count, VMPageQueue& queue)
+{
+	if (count == 0)
+		return;
+
+	InterruptsSpinLocker locker(queue.GetLock());
+	for (uint32 i = 0; i < count; i++)
+		queue.Prepend(pages[i]);
+}
+
+
+/*!	Moves the pages of all per-CPU caches back to the free/clear page queues
+	and keeps the caches from being used until enable_page_cpu_caches() is
+	called. Afterwards all free and clear pages are in the page queues, and
+	they stay there even when sFreePageQueuesLock is unlocked temporarily.
+	The caller must have write-locked sFreePageQueuesLock.
+*/
+static void
+disable_page_cpu_caches()
+{
+	ASSERT_WRITE_LOCKED_RW_LOCK(&sFreePageQueuesLock);
+
+	atomic_add(&sPageCPUCachesDisabled, 1);
+
+	if (sPageCPUCaches == NULL)
+		return;
+
+	bool freedPages = false;
+	int32 cpuCount = smp_get_num_cpus();
+	for (int32 cpu = 0; cpu < cpuCount; cpu++) {
+		page_cpu_cache& cache = sPageCPUCaches[cpu];
+		InterruptsSpinLocker locker(cache.lock);
+
+		freedPages |= cache.free_count != 0;
+		return_pages_to_queue(cache.free_pages, cache.free_count,
+			free_page_queue(sCPUMemoryNode[cpu], false));
+		return_pages_to_queue(cache.clear_pages, cache.clear_count,
+			free_page_queue(sCPUMemoryNode[cpu], true));
+		cache.free_count = 0;
+		cache.clear_count = 0;
+	}
+
+	if (freedPages)
+		sFreePageCondition.NotifyAll();
+}
+
+
+/*!	Reverts a disable_page_cpu_caches() call. The caller doesn't need to hold
+	sFreePageQueuesLock anymore.
+*/
+static void
+enable_page_cpu_caches()
+{
+	atomic_add(&sPageCPUCachesDisabled, -1);
+}
+
+
+/*!	Tries to take a page from the current CPU's cache. Pages from the clear
+	cache are preferred, if \c VM_PAGE_ALLOC_CLEAR is specified in \a flags,
+	pages from the free cache otherwise.
+	The page's state is set to the one encoded in \a flags while the cache is
+	still locked, so that nobody examining the free pages under the write
+	locked sFreePageQueuesLock can mistake it for a free one.
+	\param _oldPageState Set to the state the page had in the cache.
+	\return The page or \c NULL, if the cache is empty.
+*/
+static vm_page*
+allocate_page_from_cpu_cache(uint32 flags, int& _oldPageState)
+{
+	if (sPageCPUCaches == NULL)
+		return NULL;
+
+	InterruptsLocker interruptsLocker;
+	page_cpu_cache& cache = sPageCPUCaches[smp_get_current_cpu()];
+	SpinLocker locker(cache.lock);
+
+	vm_page* page = NULL;
+	if ((flags & VM_PAGE_ALLOC_CLEAR) != 0) {
+		if (cache.clear_count > 0)
+			page = cache.clear_pages[--cache.clear_count];
+		else if (cache.free_count > 0)
+			page = cache.free_pages[--cache.free_count];
+	} else {
+		if (cache.free_count > 0)
+			page = cache.free_pages[--cache.free_count];
+		else if (cache.clear_count > 0)
+			page = cache.clear_pages[--cache.clear_count];
+	}
+
+	if (page == NULL) {
+		cache.allocation_misses++;
+		return NULL;
+	}
+
+	cache.allocation_hits++;
+
+	// the caches only ever hold pages of the CPU's own node
+	atomic_add64(&sMemoryNodes[page->memory_node].local_allocations, 1);
+
+	_oldPageState = page->State();
+	page->SetState(flags & VM_PAGE_ALLOC_STATE);
+
+	return page;
+}
+
+
+/*!	Removes up to \c kPageCPUCacheBatchSize pages from the free or clear
+	queue of memory node \a node, stores all but the first one in the current
+	CPU's cache, if the CPU belongs to that node, and returns the first one.
+	The caller must have read-locked sFreePageQueuesLock.
+	\return A page from the queue, or \c NULL, if the queue is empty.
+*/
+static vm_page*
+refill_page_cpu_cache(uint32 node, bool clear)
+{
+	VMPageQueue& queue = free_page_queue(node, clear);
+	vm_page* pages[kPageCPUCacheBatchSize];
+	uint32 count = 0;
+
+	InterruptsSpinLocker queueLocker(queue.GetLock());
+	while (count < kPageCPUCacheBatchSize) {
+		vm_page* page = queue.RemoveHead();
+		if (page == NULL)
+			break;
+		pages[count++] = page;
+	}
+	queueLocker.Unlock();
+
+	if (count == 0)
+		return NULL;
+
+	InterruptsLocker interruptsLocker;
+	const int32 cpu = smp_get_current_cpu();
+	page_cpu_cache& cache = sPageCPUCaches[cpu];
+	SpinLocker locker(cache.lock);
+
+	vm_page** cachedPages = clear ? cache.clear_pages : cache.free_pages;
+	uint32& cachedCount = clear ? cache.clear_count : cache.free_count;
+
+	uint32 index = 1;
+	if (atomic_get(&sPageCPUCachesDisabled) == 0
+		&& sCPUMemoryNode[cpu] == node) {
+		while (index < count && cachedCount < kPageCPUCacheSize)
+			cachedPages[cachedCount++] = pages[index++];
+	}
+
+	cache.refills++;
+	locker.Unlock();
+
+	// whatever did not fit goes back to the queue
+	return_pages_to_queue(pages + index, count - index, queue);
+
+	return pages[0];
+}
+
+
+/*!	Puts a page that is being freed into the current CPU's cache. If the cache
+	is full, a batch of its oldest pages is returned to the free page queue
+	together with \a page.
+	\return \c true, if the page has been taken care of, \c false, if the
+		per-CPU caches are not available and the caller has to put the page
+		into the free page queue itself.
+*/
+static bool
+free_page_to_cpu_cache(vm_page* page, bool clear)
+{
+	if (sPageCPUCaches == NULL)
+		return false;
+
+	const uint8 pageState = clear ? PAGE_STATE_CLEAR : PAGE_STATE_FREE;
+
+	{
+		InterruptsLocker interruptsLocker;
+		const int32 cpu = smp_get_current_cpu();
+		page_cpu_cache& cache = sPageCPUCaches[cpu];
+		SpinLocker locker(cache.lock);
+
+		// pages of remote nodes go back to their node's queues directly
+		if (atomic_get(&sPageCPUCachesDisabled) != 0
+			|| sCPUMemoryNode[cpu] != page->memory_node) {
+			return false;
+		}
+
+		vm_page** cachedPages = clear ? cache.clear_pages : cache.free_pages;
+		uint32& cachedCount = clear ? cache.clear_count : cache.free_count;
+		if (cachedCount < kPageCPUCacheSize) {
+			page->SetState(pageState);
+			cachedPages[cachedCount++] = page;
+			cache.free_hits++;
+			return true;
+		}
+	}
+
+	// The cache is full. Move a batch of pages to the queue. Holding the read
+	// lock guarantees that nobody is looking for free pages while the batch
+	// is neither in the cache nor in the queue.
+	ReadLocker queuesLocker(sFreePageQueuesLock);
+
+	vm_page* pages[kPageCPUCacheBatchSize + 1];
+	uint32 count = 0;
+
+	InterruptsLocker interruptsLocker;
+	const int32 cpu = smp_get_current_cpu();
+	const uint32 node = sCPUMemoryNode[cpu];
+	page_cpu_cache& cache = sPageCPUCaches[cpu];
+	SpinLocker locker(cache.lock);
+
+	vm_page** cachedPages = clear ? cache.clear_pages : cache.free_pages;
+	uint32& cachedCount = clear ? cache.clear_count : cache.free_count;
+
+	if (cachedCount >= kPageCPUCacheBatchSize) {
+		// the oldest pages are at the bottom of the stack
+		memcpy(pages, cachedPages, sizeof(vm_page*) * kPageCPUCacheBatchSize);
+		memmove(cachedPages, cachedPages + kPageCPUCacheBatchSize,
+			sizeof(vm_page*) * (cachedCount - kPageCPUCacheBatchSize));
+		cachedCount -= kPageCPUCacheBatchSize;
+		count = kPageCPUCacheBatchSize;
+	}
+
+	// We might have been moved to a CPU of another node in the meantime, in
+	// which case the page goes to its own node's queue.
+	const bool remotePage = page->memory_node != node;
+
+	// The caches might also have been disabled and flushed while we did not
+	// hold the lock; the page must not go into the cache anymore then.
+	const bool cacheDisabled = atomic_get(&sPageCPUCachesDisabled) != 0;
+
+	page->SetState(pageState);
+	if (!remotePage) {
+		if (!cacheDisabled && cachedCount < kPageCPUCacheSize)
+			cachedPages[cachedCount++] = page;
+		else
+			pages[count++] = page;
+	}
+
+	cache.free_overflows++;
+	locker.Unlock();
+
+	return_pages_to_queue(pages, count, free_page_queue(node, clear));
+	if (remotePage) {
+		return_pages_to_queue(&page, 1,
+			free_page_queue(page->memory_node, clear));
+		count++;
+	}
+
+	interruptsLocker.Unlock();
+	queuesLocker.Unlock();
+
+	if (!clear && count > 0)
+		sFreePageCondition.NotifyAll();
+
+	return true;
+}
+
+
+/*!	Returns the number of pages currently held by the per-CPU caches.
+	The value is only a snapshot and may be off by the time it is returned.
+*/
+static page_num_t
+page_cpu_cache_page_count()
+{
+	if (sPageCPUCaches == NULL)
+		return 0;
+
+	page_num_t count = 0;
+	int32 cpuCount = smp_get_num_cpus();
+	for (int32 cpu = 0; cpu < cpuCount; cpu++) {
+		count += sPageCPUCaches[cpu].free_count
+			+ sPageCPUCaches[cpu].clear_count;
+	}
+
+	return count;
+}
+
+
 static void
 free_page(vm_page* page, bool clear)
 {
@@ -1601,16 +2108,19 @@ free_page(vm_page* page, bool clear)
 	page->allocation_tracking_info.Clear();
 #endif
 
-	ReadLocker locker(sFreePageQueuesLock);
-
 	DEBUG_PAGE_ACCESS_END(page);
 
+	if (free_page_to_cpu_cache(page, clear))
+		return;
+
+	ReadLocker locker(sFreePageQueuesLock);
+
 	if (clear) {
 		page->SetState(PAGE_STATE_CLEAR);
-		sClearPageQueue.PrependUnlocked(page);
+		free_page_queue(page->memory_node, true).PrependUnlocked(page);
 	} else {
 		page->SetState(PAGE_STATE_FREE);
-		sFreePageQueue.PrependUnlocked(page);
+		free_page_queue(page->memory_node, false).PrependUnlocked(page);
 		sFreePageCondition.NotifyAll();
 	}
 
@@ -1777,6 +2287,7 @@ mark_page_range_in_use(page_num_t startPage, page_num_t length, bool wired)
 	}
 
 	WriteLocker locker(sFreePageQueuesLock);
+	disable_page_cpu_caches();
 
 	for (page_num_t i = 0; i < length; i++) {
 		vm_page *page = &sPages[startPage + i];
@@ -1790,8 +2301,8 @@ mark_page_range_in_use(page_num_t startPage, page_num_t length, bool wired)
 				ASSERT(gKernelStartup);
 
 				DEBUG_PAGE_ACCESS_START(page);
-				VMPageQueue& queue = page->State() == PAGE_STATE_FREE
-					? sFreePageQueue : sClearPageQueue;
+				VMPageQueue& queue = free_page_queue(page->memory_node,
+					page->State() == PAGE_STATE_CLEAR);
 				queue.Remove(page);
 				page->SetState(wired ? PAGE_STATE_WIRED : PAGE_STATE_UNUSED);
 				page->busy = false;
@@ -1814,6 +2325,8 @@ mark_page_range_in_use(page_num_t startPage, page_num_t length, bool wired)
 		}
 	}
 
+	enable_page_cpu_caches();
+
 	return B_OK;
 }
 
@@ -1831,9 +2344,11 @@ page_scrubber(void *unused)
 
 	TRACE(("page_scrubber starting...\n"));
 
+	uint32 nextNode = 0;
+
 	ConditionVariableEntry entry;
 	for (;;) {
-		while (sFreePageQueue.Count() == 0
+		while (free_page_queues_count(false) == 0
 				|| atomic_get(&sUnreservedFreePages)
 					< (int32)sFreePagesTarget) {
 			sFreePageCondition.Add(&entry);
@@ -1850,13 +2365,25 @@ page_scrubber(void *unused)
 		if (reserved == 0)
 			continue;
 
+		// scrub the memory nodes in turn, so that all of them get clear pages
+		memory_node* node = &sMemoryNodes[nextNode];
+		for (uint32 i = 0; i < sMemoryNodeCount; i++) {
+			memory_node* candidate
+				= &sMemoryNodes[(nextNode + i) % sMemoryNodeCount];
+			if (candidate->free_queue.Count() > 0) {
+				node = candidate;
+				break;
+			}
+		}
+		nextNode = (node - sMemoryNodes + 1) % sMemoryNodeCount;
+
 		// get some pages from the free queue, mostly sorted
 		ReadLocker locker(sFreePageQueuesLock);
 
 		vm_page *page[SCRUB_SIZE];
 		int32 scrubCount = 0;
 		for (int32 i = 0; i < reserved; i++) {
-			page[i] = sFreePageQueue.RemoveHeadUnlocked();
+			page[i] = node->free_queue.RemoveHeadUnlocked();
 			if (page[i] == NULL)
 				break;
 
@@ -1888,7 +2415,7 @@ page_scrubber(void *unused)
 			page[i]->SetState(PAGE_STATE_CLEAR);
 			page[i]->busy = false;
 			DEBUG_PAGE_ACCESS_END(page[i]);
-			sClearPageQueue.PrependUnlocked(page[i]);
+			node->clear_queue.PrependUnlocked(page[i]);
 		}
 
 		locker.Unlock();
@@ -2694,7 +3221,7 @@ free_cached_pages(uint32 pagesToFree, bool dontWait)
 			ReadLocker locker(sFreePageQueuesLock);
 			page->SetState(PAGE_STATE_FREE);
 			DEBUG_PAGE_ACCESS_END(page);
-			sFreePageQueue.PrependUnlocked(page);
+			free_page_queue(page->memory_node, false).PrependUnlocked(page);
 			locker.Unlock();
 
 			TA(StolenPage());
@@ -3357,6 +3884,55 @@ vm_page_schedule_write_page_range(struct VMCache *cache, uint32 firstPage,
 }
 
 
+/*!	Sets up the memory nodes from the NUMA topology the boot loader passed
+	on, or a single node, if there is none.
+*/
+static void
+init_memory_nodes(kernel_args* args)
+{
+	sMemoryNodeCount = 1;
+	if (args->num_memory_nodes > 1
+		&& args->num_memory_nodes <= MAX_MEMORY_NODES) {
+		sMemoryNodeCount = args->num_memory_nodes;
+	}
+
+	for (uint32 i = 0; i < sMemoryNodeCount; i++) {
+		memory_node& node = sMemoryNodes[i];
+		node.free_queue.Init("free pages queue");
+		node.clear_queue.Init("clear pages queue");
+		node.page_count = 0;
+		node.local_allocations = 0;
+		node.remote_allocations = 0;
+
+		for (uint32 j = 0; j < sMemoryNodeCount; j++) {
+			if (sMemoryNodeCount > 1)
+				node.distance[j] = args->memory_node_distance[i][j];
+			else
+				node.distance[j] = 10;
+		}
+
+		// sort the other nodes by their distance, this one comes first
+		for (uint32 j = 0; j < sMemoryNodeCount; j++)
+			node.fallback_order[j] = j;
+		std::swap(node.fallback_order[0], node.fallback_order[i]);
+		for (uint32 j = 2; j < sMemoryNodeCount; j++) {
+			for (uint32 k = j; k > 1 && node.distance[node.fallback_order[k]]
+					< node.distance[node.fallback_order[k - 1]]; k--) {
+				std::swap(node.fallback_order[k], node.fallback_order[k - 1]);
+			}
+		}
+	}
+
+	for (uint32 cpu = 0; cpu < args->num_cpus && cpu < SMP_MAX_CPUS; cpu++) {
+		uint8 node = args->cpu_memory_node[cpu];
+		sCPUMemoryNode[cpu] = node < sMemoryNodeCount ? node : 0;
+	}
+
+	if (sMemoryNodeCount > 1)
+		dprintf("vm_page: %" B_PRIu32 " memory nodes\n", sMemoryNodeCount);
+}
+
+
 void
 vm_page_init_num_pages(kernel_args *args)
 {
@@ -3403,8 +3979,7 @@ vm_page_init(kernel_args *args)
 	sInactivePageQueue.Init("inactive pages queue");
 	sActivePageQueue.Init("active pages queue");
 	sCachedPageQueue.Init("cached pages queue");
-	sFreePageQueue.Init("free pages queue");
-	sClearPageQueue.Init("clear pages queue");
+	init_memory_nodes(args);
 
 	new (&sPageReservationWaiters) PageReservationWaiterList;
 
@@ -3419,13 +3994,34 @@ vm_page_init(kernel_args *args)
 	// initialize the free page table
 	for (uint32 i = 0; i < sNumPages; i++) {
 		sPages[i].Init(sPhysicalPageOffset + i);
-		sFreePageQueue.Append(&sPages[i]);
 
 #if VM_PAGE_ALLOCATION_TRACKING_AVAILABLE
 		sPages[i].allocation_tracking_info.Clear();
 #endif
 	}
 
+	// assign the pages to their memory nodes -- pages not covered by any
+	// range stay in node 0
+	if (sMemoryNodeCount > 1) {
+		for (uint32 i = 0; i < args->num_memory_node_ranges; i++) {
+			page_num_t start = args->memory_node_range[i].start / B_PAGE_SIZE;
+			page_num_t end = start
+				+ args->memory_node_range[i].size / B_PAGE_SIZE;
+			uint8 node = args->memory_node_range_node[i];
+			if (node >= sMemoryNodeCount)
+				continue;
+
+			start = std::max(start, sPhysicalPageOffset) - sPhysicalPageOffset;
+			end = std::min(std::max(end, sPhysicalPageOffset)
+				- sPhysicalPageOffset, sNumPages);
+			for (page_num_t page = start; page < end; page++)
+				sPages[page].memory_node = node;
+		}
+	}
+
+	for (uint32 i = 0; i < sNumPages; i++)
+		free_page_queue(sPages[i].memory_node, false).Append(&sPages[i]);
+
 	sUnreservedFreePages = sNumPages;
 
 	TRACE(("initialized table\n"));
@@ -3452,6 +4048,11 @@ vm_page_init(kernel_args *args)
 	// prevent future allocations from the kernel args ranges
 	args->num_physical_allocated_ranges = 0;
 
+	for (uint32 i = 0; i < sNumPages; i++) {
+		if (sPages[i].State() != PAGE_STATE_UNUSED)
+			sMemoryNodes[sPages[i].memory_node].page_count++;
+	}
+
 	// report initially available memory
 	vm_unreserve_memory(vm_page_num_free_pages() * B_PAGE_SIZE);
 
@@ -3489,6 +4090,19 @@ vm_page_init_post_area(kernel_args *args)
 		PAGE_ALIGN(sNumPages * sizeof(vm_page)), B_ALREADY_WIRED,
 		B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA);
 
+	// create the per-CPU page caches -- without them we just always use the
+	// free/clear page queues
+	int32 cpuCount = smp_get_num_cpus();
+	page_cpu_cache* pageCPUCaches = new(std::nothrow) page_cpu_cache[cpuCount];
+	if (pageCPUCaches != NULL) {
+		memset(pageCPUCaches, 0, sizeof(page_cpu_cache) * cpuCount);
+		for (int32 cpu = 0; cpu < cpuCount; cpu++)
+			B_INITIALIZE_SPINLOCK(&pageCPUCaches[cpu].lock);
+
+		sPageCPUCaches = pageCPUCaches;
+	} else
+		dprintf("vm_page_init_post_area(): failed to create per-CPU caches\n");
+
 	add_debugger_command("list_pages", &dump_page_list,
 		"List physical pages");
 	add_debugger_command("page_stats", &dump_page_stats,
@@ -3506,6 +4120,15 @@ vm_page_init_post_area(kernel_args *args)
 		"search all known address spaces for mappings to that page and print\n"
 		"them.\n", 0);
 	add_debugger_command("page_queue", &dump_page_queue, "Dump page queue");
+	add_debugger_command_etc("page_cpu_caches", &dump_page_cpu_caches,
+		"Dump statistics about the per-CPU page caches",
+		"[ \"-r\" ]\n"
+		"Prints the number of pages in each CPU's free and clear page cache\n"
+		"and how many allocations and frees could be served by the caches\n"
+		"as opposed to the global free/clear page queues.\n"
+		"If \"-r\" is given, the counters are reset afterwards.\n", 0);
+	add_debugger_command("memory_nodes", &dump_memory_nodes,
+		"Dump the memory (NUMA) nodes and their page counts");
 	add_debugger_command("find_page", &find_page,
 		"Find out which queue a page is actually in");
 
@@ -3652,70 +4275,105 @@ vm_page_try_reserve_pages(vm_page_reservation* reservation, uint32 count,
 }
 
 
-vm_page *
-vm_page_allocate_page(vm_page_reservation* reservation, uint32 flags)
+/*!	Allocates a page from the free/clear page queues, refilling the current
+	CPU's page cache on the way, if the per-CPU caches are in use. The queues
+	of the current CPU's memory node are tried first, then those of the other
+	nodes in the order of their distance.
+	The page's state is set to the one encoded in \a flags.
+	\param _oldPageState Set to the state the page had in the queue.
+*/
+static vm_page*
+allocate_page_from_queues(uint32 flags, int& _oldPageState)
 {
-	uint32 pageState = flags & VM_PAGE_ALLOC_STATE;
-	ASSERT(pageState != PAGE_STATE_FREE);
-	ASSERT(pageState != PAGE_STATE_CLEAR);
+	const bool clear = (flags & VM_PAGE_ALLOC_CLEAR) != 0;
+	const memory_node& localNode
+		= sMemoryNodes[sCPUMemoryNode[smp_get_current_cpu()]];
 
-	ASSERT(reservation->count > 0);
-	reservation->count--;
+	ReadLocker locker(sFreePageQueuesLock);
 
-	VMPageQueue* queue;
-	VMPageQueue* otherQueue;
+	vm_page* page = NULL;
+	for (uint32 i = 0; i < sMemoryNodeCount && page == NULL; i++) {
+		uint32 node = localNode.fallback_order[i];
 
-	if ((flags & VM_PAGE_ALLOC_CLEAR) != 0) {
-		queue = &sClearPageQueue;
-		otherQueue = &sFreePageQueue;
-	} else {
-		queue = &sFreePageQueue;
-		otherQueue = &sClearPageQueue;
+		if (sPageCPUCaches != NULL) {
+			page = refill_page_cpu_cache(node, clear);
+			if (page == NULL)
+				page = refill_page_cpu_cache(node, !clear);
+		} else {
+			page = free_page_queue(node, clear).RemoveHeadUnlocked();
+			if (page == NULL) {
+				// if the primary queue was empty, grab the page from the
+				// secondary queue
+				page = free_page_queue(node, !clear).RemoveHeadUnlocked();
+			}
+		}
 	}
 
-	ReadLocker locker(sFreePageQueuesLock);
-
-	vm_page* page = queue->RemoveHeadUnlocked();
 	if (page == NULL) {
-		// if the primary queue was empty, grab the page from the
-		// secondary queue
-		page = otherQueue->RemoveHeadUnlocked();
+		// Unlikely, but possible: the page we have reserved sits in another
+		// CPU's cache, or it has moved between the queues after we checked
+		// the first queue. Grab the write locker, which also flushes the
+		// per-CPU caches, to make sure this doesn't happen again.
+		locker.Unlock();
+		WriteLocker writeLocker(sFreePageQueuesLock);
 
-		if (page == NULL) {
-			// Unlikely, but possible: the page we have reserved has moved
-			// between the queues after we checked the first queue. Grab the
-			// write locker to make sure this doesn't happen again.
-			locker.Unlock();
-			WriteLocker writeLocker(sFreePageQueuesLock);
+		disable_page_cpu_caches();
+		atomic_add(&sPageCPUCacheFlushes, 1);
 
-			page = queue->RemoveHead();
+		for (uint32 i = 0; i < sMemoryNodeCount && page == NULL; i++) {
+			uint32 node = localNode.fallback_order[i];
+			page = free_page_queue(node, clear).RemoveHead();
 			if (page == NULL)
-				otherQueue->RemoveHead();
+				page = free_page_queue(node, !clear).RemoveHead();
+		}
 
-			if (page == NULL) {
-				panic("Had reserved page, but there is none!");
-				return NULL;
-			}
+		enable_page_cpu_caches();
 
-			// downgrade to read lock
-			locker.Lock();
+		if (page == NULL) {
+			panic("Had reserved page, but there is none!");
+			return NULL;
 		}
 	}
 
+	memory_node& node = sMemoryNodes[page->memory_node];
+	if (&node == &localNode)
+		atomic_add64(&node.local_allocations, 1);
+	else
+		atomic_add64(&node.remote_allocations, 1);
+
+	_oldPageState = page->State();
+	page->SetState(flags & VM_PAGE_ALLOC_STATE);
+	return page;
+}
+
+
+vm_page *
+vm_page_allocate_page(vm_page_reservation* reservation, uint32 flags)
+{
+	uint32 pageState = flags & VM_PAGE_ALLOC_STATE;
+	ASSERT(pageState != PAGE_STATE_FREE);
+	ASSERT(pageState != PAGE_STATE_CLEAR);
+
+	ASSERT(reservation->count > 0);
+	reservation->count--;
+
+	int oldPageState;
+	vm_page* page = allocate_page_from_cpu_cache(flags, oldPageState);
+	if (page == NULL)
+		page = allocate_page_from_queues(flags, oldPageState);
+	if (page == NULL)
+		return NULL;
+
 	if (page->CacheRef() != NULL)
 		panic("supposed to be free page %p has cache @! page %p; cache _cache", page, page);
 
 	DEBUG_PAGE_ACCESS_START(page);
 
-	int oldPageState = page->State();
-	page->SetState(pageState);
 	page->busy = (flags & VM_PAGE_ALLOC_BUSY) != 0;
 	page->usage_count = 0;
 	page->accessed = false;
 	page->modified = false;
 
-	locker.Unlock();
-
 	if (pageState < PAGE_STATE_FIRST_UNQUEUED)
 		sPageQueues[pageState].AppendUnlocked(page);
 
@@ -3745,14 +4403,14 @@ allocate_page_run_cleanup(VMPageQueue::PageList& freePages,
 		page->busy = false;
 		page->SetState(PAGE_STATE_FREE);
 		DEBUG_PAGE_ACCESS_END(page);
-		sFreePageQueue.PrependUnlocked(page);
+		free_page_queue(page->memory_node, false).PrependUnlocked(page);
 	}
 
 	while (vm_page* page = clearPages.RemoveTail()) {
 		page->busy = false;
 		page->SetState(PAGE_STATE_CLEAR);
 		DEBUG_PAGE_ACCESS_END(page);
-		sClearPageQueue.PrependUnlocked(page);
+		free_page_queue(page->memory_node, true).PrependUnlocked(page);
 	}
 
 	sFreePageCondition.NotifyAll();
@@ -3801,12 +4459,12 @@ allocate_page_run(page_num_t start, page_num_t length, uint32 flags,
 		switch (page.State()) {
 			case PAGE_STATE_CLEAR:
 				DEBUG_PAGE_ACCESS_START(&page);
-				sClearPageQueue.Remove(&page);
+				free_page_queue(page.memory_node, true).Remove(&page);
 				clearPages.Add(&page);
 				break;
 			case PAGE_STATE_FREE:
 				DEBUG_PAGE_ACCESS_START(&page);
-				sFreePageQueue.Remove(&page);
+				free_page_queue(page.memory_node, false).Remove(&page);
 				freePages.Add(&page);
 				break;
 			case PAGE_STATE_CACHED:
@@ -3984,6 +4642,7 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 	vm_page_reserve_pages(&reservation, length, priority);
 
 	WriteLocker freeClearQueueLocker(sFreePageQueuesLock);
+	disable_page_cpu_caches();
 
 	// First we try to get a run with free pages only. If that fails, we also
 	// consider cached pages. If there are only few free pages and many cached
@@ -4025,6 +4684,7 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 				end, restrictions->alignment, restrictions->boundary);
 
 			freeClearQueueLocker.Unlock();
+			enable_page_cpu_caches();
 			vm_page_unreserve_pages(&reservation);
 			return NULL;
 		}
@@ -4044,6 +4704,7 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 		if (foundRun) {
 			i = allocate_page_run(start, length, flags, freeClearQueueLocker);
 			if (i == length) {
+				enable_page_cpu_caches();
 				reservation.count = 0;
 				return &sPages[start];
 			}
@@ -4228,10 +4889,11 @@ vm_page_get_stats(system_info *info)
 
 	// max_pages is composed of:
 	//	active + inactive + unused + wired + modified + cached + free + clear
+	// (free and clear including the pages in the per-CPU caches)
 	// So taking out the cached (including modified non-temporary), free and
 	// clear ones leaves us with all used pages.
-	uint32 subtractPages = info->cached_pages + sFreePageQueue.Count()
-		+ sClearPageQueue.Count();
+	uint32 subtractPages = info->cached_pages + free_page_queues_count(false)
+		+ free_page_queues_count(true) + page_cpu_cache_page_count();
 	info->used_pages = subtractPages > info->max_pages
 		? 0 : info->max_pages - subtractPages;
 
@@ -4260,4 +4922,72 @@ vm_page_max_address()
 }
 
 
+uint32
+vm_page_memory_node_count(void)
+{
+	return sMemoryNodeCount;
+}
+
+
+/*!	Returns the memory node the given CPU is local to. */
+uint32
+vm_page_cpu_memory_node(int32 cpu)
+{
+	return sCPUMemoryNode[cpu];
+}
+
+
+/*!	Returns the relative distance between the two memory nodes, 10 meaning
+	local access (as in the ACPI SLIT).
+*/
+uint32
+vm_page_memory_node_distance(uint32 from, uint32 to)
+{
+	return sMemoryNodes[from].distance[to];
+}
+
+
+status_t
+_user_get_memory_node_info(uint32 nodeIndex, memory_node_info* userInfo)
+{
+	if (userInfo == NULL || !IS_USER_ADDRESS(userInfo))
+		return B_BAD_ADDRESS;
+	if (nodeIndex >= sMemoryNodeCount)
+		return B_BAD_INDEX;
+
+	memory_node& node = sMemoryNodes[nodeIndex];
+
+	memory_node_info info = {};
+	info.node = nodeIndex;
+	info.node_count = sMemoryNodeCount;
+	info.total_pages = node.page_count;
+	info.free_pages = node.free_queue.Count() + node.clear_queue.Count();
+	info.local_allocations = atomic_get64(&node.local_allocations);
+	info.remote_allocations = atomic_get64(&node.remote_allocations);
+
+	// the per-CPU caches only contain pages of their CPU's node
+	int32 cpuCount = std::min(smp_get_num_cpus(),
+		(int32)B_COUNT_OF(info.cpus) * 64);
+	for (int32 cpu = 0; cpu < cpuCount; cpu++) {
+		if (sCPUMemoryNode[cpu] != nodeIndex)
+			continue;
+
+		info.cpus[cpu / 64] |= 1ULL << (cpu % 64);
+		info.cpu_count++;
+
+		if (sPageCPUCaches != NULL) {
+			info.free_pages += sPageCPUCaches[cpu].free_count
+				+ sPageCPUCaches[cpu].clear_count;
+		}
+	}
+
+	for (uint32 i = 0; i < sMemoryNodeCount && i < B_COUNT_OF(info.distance);
+			i++) {
+		info.distance[i] = node.distance[i];
+	}
+
+	return user_memcpy(userInfo, &info, sizeof(memory_node_info));
+}
+
+
 RANGE_MARKER_FUNCTION_END(vm_page)
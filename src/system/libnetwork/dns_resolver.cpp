@@ -0,0 +1,192 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Asks the DNS resolver server for getaddrinfo() answers, so that all
+	teams share its cache. If the server is not running, the caller resolves
+	the name itself.
+*/
+
+
+#include <netdb.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <AutoDeleter.h>
+#include <AutoDeleterOS.h>
+#include <OS.h>
+
+#include "Definitions.h"
+
+
+/*!	Converts the answer of the server, in which all pointers are offsets
+	into the reply, into a list that freeaddrinfo() can free.
+*/
+static status_t
+unflatten_reply(const char* reply, size_t size, struct addrinfo** _result)
+{
+	struct addrinfo* first = NULL;
+	struct addrinfo** _next = &first;
+
+	size_t offset = 0;
+	while (true) {
+		if (offset + sizeof(addrinfo) > size)
+			break;
+
+		const struct addrinfo* current
+			= reinterpret_cast<const addrinfo*>(reply + offset);
+		size_t addressOffset = (addr_t)current->ai_addr;
+		size_t addressLength = current->ai_addr != NULL
+			? current->ai_addrlen : 0;
+		if (addressOffset + addressLength > size)
+			break;
+
+		// like allocaddrinfo(), the address is part of the allocation
+		struct addrinfo* info = (struct addrinfo*)calloc(1,
+			sizeof(addrinfo) + addressLength);
+		if (info == NULL) {
+			if (first != NULL)
+				freeaddrinfo(first);
+			return B_NO_MEMORY;
+		}
+		*_next = info;
+		_next = &info->ai_next;
+
+		info->ai_flags = current->ai_flags;
+		info->ai_family = current->ai_family;
+		info->ai_socktype = current->ai_socktype;
+		info->ai_protocol = current->ai_protocol;
+		info->ai_addrlen = addressLength;
+		if (current->ai_addr != NULL) {
+			info->ai_addr = (struct sockaddr*)(info + 1);
+			memcpy(info->ai_addr, reply + addressOffset, addressLength);
+		}
+
+		if (current->ai_canonname != NULL) {
+			size_t nameOffset = (addr_t)current->ai_canonname;
+			if (nameOffset >= size
+				|| strnlen(reply + nameOffset, size - nameOffset)
+					== size - nameOffset) {
+				break;
+			}
+
+			info->ai_canonname = strdup(reply + nameOffset);
+			if (info->ai_canonname == NULL) {
+				freeaddrinfo(first);
+				return B_NO_MEMORY;
+			}
+		}
+
+		if (current->ai_next == NULL) {
+			*_result = first;
+			return B_OK;
+		}
+
+		offset = (addr_t)current->ai_next;
+	}
+
+	if (first != NULL)
+		freeaddrinfo(first);
+	return B_BAD_DATA;
+}
+
+
+/*!	Returns \c 0, or an \c EAI_* error, if the server answered, and a
+	negative error code if it couldn't be asked.
+*/
+extern "C" int
+__getaddrinfo_from_server(const char* hostname, const char* servname,
+	const struct addrinfo* hints, struct addrinfo** _result)
+{
+	port_id requestPort = find_port(kPortNameReq);
+	if (requestPort < 0)
+		return requestPort;
+
+	// The request port belongs to the server
+	port_info portInfo;
+	status_t result = get_port_info(requestPort, &portInfo);
+	if (result != B_OK)
+		return result;
+	if (portInfo.team == getpid()) {
+		// we are the server
+		return B_NOT_ALLOWED;
+	}
+
+	uint32 nodeSize = hostname != NULL ? strlen(hostname) + 1 : 1;
+	uint32 serviceSize = servname != NULL ? strlen(servname) + 1 : 1;
+	uint32 size = sizeof(request_header) + nodeSize + serviceSize
+		+ sizeof(*hints);
+	char* buffer = (char*)malloc(size);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter bufferDeleter(buffer);
+
+	size_t offset = sizeof(request_header);
+	strcpy(buffer + offset, hostname != NULL ? hostname : "");
+	offset += nodeSize;
+	strcpy(buffer + offset, servname != NULL ? servname : "");
+	offset += serviceSize;
+
+	if (hints != NULL)
+		memcpy(buffer + offset, hints, sizeof(*hints));
+	else {
+		struct addrinfo* nullHints = (struct addrinfo*)(buffer + offset);
+		memset(nullHints, 0, sizeof(*nullHints));
+		nullHints->ai_family = AF_UNSPEC;
+	}
+
+	// The reply port goes away with the server, so that we won't wait for
+	// an answer forever if it dies
+	PortDeleter replyPort(create_port(1, "dns_resolver reply"));
+	if (!replyPort.IsSet())
+		return replyPort.Get();
+
+	result = set_port_owner(replyPort.Get(), portInfo.team);
+	if (result != B_OK)
+		return result;
+
+	request_header* header = (request_header*)buffer;
+	header->reply_port = replyPort.Get();
+
+	result = write_port(requestPort, MsgGetAddrInfo, buffer, size);
+	if (result != B_OK)
+		return result;
+
+	ssize_t replySize = port_buffer_size(replyPort.Get());
+	if (replySize < 0)
+		return replySize;
+
+	char* reply = (char*)malloc(replySize);
+	if (reply == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter replyDeleter(reply);
+
+	int32 code;
+	replySize = read_port(replyPort.Get(), &code, reply, replySize);
+	if (replySize < 0)
+		return replySize;
+
+	switch (code) {
+		case MsgReply:
+			result = unflatten_reply(reply, replySize, _result);
+			if (result == B_NO_MEMORY)
+				return EAI_MEMORY;
+			return result;
+
+		case MsgError:
+			if (replySize < (ssize_t)sizeof(status_t))
+				return B_BAD_DATA;
+
+			// the server passes on the EAI_* errors of getaddrinfo()
+			result = *(status_t*)reply;
+			if (result == B_NO_MEMORY)
+				return EAI_MEMORY;
+			return result;
+
+		default:
+			return B_BAD_DATA;
+	}
+}
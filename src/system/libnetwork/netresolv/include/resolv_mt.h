@@ -28,6 +28,9 @@ char	precsize_ntoa_retbuf[sizeof "90000000.00"];
 char	loc_ntoa_tmpbuf[sizeof
 "1000 60 60.000 N 1000 60 60.000 W -12345678.00m 90000000.00m 90000000.00m 90000000.00m"];
 char	p_secstodate_output[15];
+#ifdef __HAIKU__
+int	answer_ttl;	/* smallest TTL of the last getaddrinfo() answers */
+#endif
 } mtctxres_t;
 
 /* Thread-specific data (TSD) */
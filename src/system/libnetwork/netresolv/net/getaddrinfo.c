@@ -89,6 +89,7 @@ __RCSID("$NetBSD: getaddrinfo.c,v 1.119.2.1 2020/11/29 11:25:31 martin Exp $");
 #include <FindDirectory.h>
 
 #include <libutil.h>
+#include <resolv_mt.h>
 #include "nsswitch.h"
 #include "servent.h"
 
@@ -447,9 +448,19 @@ str2number(const char *p)
 		return -1;
 }
 
+#ifdef __HAIKU__
+extern int __getaddrinfo_from_server(const char *hostname,
+    const char *servname, const struct addrinfo *hints,
+    struct addrinfo **res);
+
+static int
+getaddrinfo_local(const char *hostname, const char *servname,
+    const struct addrinfo *hints, struct addrinfo **res)
+#else
 int
 getaddrinfo(const char *hostname, const char *servname,
     const struct addrinfo *hints, struct addrinfo **res)
+#endif
 {
 	struct addrinfo sentinel;
 	struct addrinfo *cur;
@@ -710,6 +721,51 @@ getaddrinfo(const char *hostname, const char *servname,
 	return error;
 }
 
+#ifdef __HAIKU__
+/*
+ * Host names are looked up by the DNS resolver server if it is running, so
+ * that all teams share its cache. Numeric hosts are cheaper to handle here.
+ */
+int
+getaddrinfo(const char *hostname, const char *servname,
+    const struct addrinfo *hints, struct addrinfo **res)
+{
+	int error;
+
+	_DIAGASSERT(res != NULL);
+
+	if (hostname != NULL
+	    && (hints == NULL || (hints->ai_flags & AI_NUMERICHOST) == 0)) {
+		error = __getaddrinfo_from_server(hostname, servname, hints, res);
+		if (error >= 0)
+			return error;
+	}
+
+	return getaddrinfo_local(hostname, servname, hints, res);
+}
+
+/*
+ * Like getaddrinfo(), but also returns the smallest time to live of the DNS
+ * records the result is based on, or -1 if it did not come from DNS.
+ * This is a private interface for the DNS resolver server; it always
+ * resolves the name itself.
+ */
+int
+__getaddrinfo_ttl(const char *hostname, const char *servname,
+    const struct addrinfo *hints, struct addrinfo **res, int *ttl)
+{
+	int error;
+
+	_DIAGASSERT(ttl != NULL);
+
+	mtctxres->answer_ttl = -1;
+	error = getaddrinfo_local(hostname, servname, hints, res);
+	*ttl = mtctxres->answer_ttl;
+
+	return error;
+}
+#endif
+
 static int
 reorder(struct addrinfo *sentinel, struct servent_data *svd)
 {
@@ -1742,6 +1798,9 @@ getanswer(res_state res, const querybuf *answer, int anslen, const char *qname,
 	char hostbuf[8*1024];
 	int port, pri, weight;
 	struct srvinfo *srvlist, *srv, *csrv;
+#ifdef __HAIKU__
+	int ttl;
+#endif
 
 	_DIAGASSERT(answer != NULL);
 	_DIAGASSERT(qname != NULL);
@@ -1812,6 +1871,11 @@ getanswer(res_state res, const querybuf *answer, int anslen, const char *qname,
 		type = _getshort(cp);
 		cp += INT16SZ;			/* type */
 		class = _getshort(cp);
+#ifdef __HAIKU__
+		ttl = (int)(_getlong(cp + INT16SZ) & 0x7fffffff);
+		if (mtctxres->answer_ttl < 0 || ttl < mtctxres->answer_ttl)
+			mtctxres->answer_ttl = ttl;
+#endif
 		cp += INT16SZ + INT32SZ;	/* class, TTL */
 		n = _getshort(cp);
 		cp += INT16SZ;			/* len */
@@ -317,6 +317,14 @@ sendmsg(int socket, const struct msghdr *message, int flags)
 }
 
 
+extern "C" ssize_t
+sendfile(int socket, int fd, off_t *_offset, size_t count)
+{
+	RETURN_AND_SET_ERRNO_TEST_CANCEL(
+		_kern_sendfile(socket, fd, _offset, count));
+}
+
+
 extern "C" int
 getsockopt(int socket, int level, int option, void *value, socklen_t *_length)
 {
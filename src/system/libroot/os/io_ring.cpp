@@ -0,0 +1,128 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <io_ring.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <syscalls.h>
+
+
+status_t
+io_ring_init(io_ring* ring, uint32 entries)
+{
+	void* address;
+	int fd = _kern_io_ring_create(entries, O_CLOEXEC, &address);
+	if (fd < 0)
+		return fd;
+
+	ring->fd = fd;
+	ring->header = (io_ring_header*)address;
+	ring->submissions = (io_ring_submission*)((uint8*)address
+		+ ring->header->submission_offset);
+	ring->completions = (io_ring_completion*)((uint8*)address
+		+ ring->header->completion_offset);
+	ring->submission_tail = ring->header->submission_tail;
+	return B_OK;
+}
+
+
+void
+io_ring_destroy(io_ring* ring)
+{
+	// this also deletes the area
+	close(ring->fd);
+	ring->fd = -1;
+}
+
+
+/*!	Returns the next free submission entry, or \c NULL if the submission queue
+	is full. The entry will be passed to the kernel with the next
+	io_ring_submit().
+*/
+io_ring_submission*
+io_ring_get_submission(io_ring* ring)
+{
+	uint32 head = (uint32)atomic_get((int32*)&ring->header->submission_head);
+	if (ring->submission_tail - head >= ring->header->submission_count)
+		return NULL;
+
+	io_ring_submission* submission = &ring->submissions[
+		ring->submission_tail++ & (ring->header->submission_count - 1)];
+	memset(submission, 0, sizeof(io_ring_submission));
+	return submission;
+}
+
+
+/*!	Passes all submissions retrieved since the last call to the kernel, and
+	executes them. Returns the number of submissions processed; if that is
+	less than what was queued, the completion queue is full, and needs to be
+	reaped before the rest can be processed.
+*/
+ssize_t
+io_ring_submit(io_ring* ring)
+{
+	uint32 head = (uint32)atomic_get((int32*)&ring->header->submission_head);
+	uint32 count = ring->submission_tail - head;
+	if (count == 0)
+		return 0;
+
+	atomic_set((int32*)&ring->header->submission_tail,
+		(int32)ring->submission_tail);
+
+	return _kern_io_ring_enter(ring->fd, count, 0);
+}
+
+
+/*!	Returns the oldest completion that hasn't been seen yet, or \c NULL if
+	there is none.
+*/
+io_ring_completion*
+io_ring_peek_completion(io_ring* ring)
+{
+	io_ring_header* header = ring->header;
+	uint32 tail = (uint32)atomic_get((int32*)&header->completion_tail);
+	if (header->completion_head == tail)
+		return NULL;
+
+	return &ring->completions[
+		header->completion_head & (header->completion_count - 1)];
+}
+
+
+void
+io_ring_completion_seen(io_ring* ring)
+{
+	atomic_add((int32*)&ring->header->completion_head, 1);
+}
+
+
+void
+io_ring_prepare_read(io_ring_submission* submission, int fd, void* buffer,
+	size_t length, off_t offset, uint64 userData)
+{
+	submission->opcode = IO_RING_OP_READ;
+	submission->fd = fd;
+	submission->buffer = buffer;
+	submission->length = length;
+	submission->offset = offset;
+	submission->user_data = userData;
+}
+
+
+void
+io_ring_prepare_write(io_ring_submission* submission, int fd,
+	const void* buffer, size_t length, off_t offset, uint64 userData)
+{
+	submission->opcode = IO_RING_OP_WRITE;
+	submission->fd = fd;
+	submission->buffer = (void*)buffer;
+	submission->length = length;
+	submission->offset = offset;
+	submission->user_data = userData;
+}
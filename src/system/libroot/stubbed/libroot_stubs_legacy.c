@@ -1023,6 +1023,7 @@ void _kern_fsync() {}
 void _kern_generic_syscall() {}
 void _kern_get_area_info() {}
 void _kern_get_clock() {}
+void _kern_get_compressed_swap_info() {}
 void _kern_get_cpu() {}
 void _kern_get_cpu_info() {}
 void _kern_get_cpu_topology_info() {}
@@ -1034,12 +1035,15 @@ void _kern_get_disk_system_info() {}
 void _kern_get_extended_team_info() {}
 void _kern_get_file_disk_device_path() {}
 void _kern_get_image_info() {}
+void _kern_get_large_page_info() {}
+void _kern_get_memory_node_info() {}
 void _kern_get_memory_properties() {}
 void _kern_get_next_area_info() {}
 void _kern_get_next_disk_device_id() {}
 void _kern_get_next_disk_system_info() {}
 void _kern_get_next_fd_info() {}
 void _kern_get_next_image_info() {}
+void _kern_get_next_object_cache_info() {}
 void _kern_get_next_port_info() {}
 void _kern_get_next_sem_info() {}
 void _kern_get_next_socket_stat() {}
@@ -1049,6 +1053,7 @@ void _kern_get_port_info() {}
 void _kern_get_port_message_info_etc() {}
 void _kern_get_real_time_clock_is_gmt() {}
 void _kern_get_safemode_option() {}
+void _kern_get_scheduler_cpu_stats() {}
 void _kern_get_scheduler_mode() {}
 void _kern_get_sem_count() {}
 void _kern_get_sem_info() {}
@@ -1072,6 +1077,8 @@ void _kern_image_relocated() {}
 void _kern_initialize_partition() {}
 void _kern_install_default_debugger() {}
 void _kern_install_team_debugger() {}
+void _kern_io_ring_create() {}
+void _kern_io_ring_enter() {}
 void _kern_ioctl() {}
 void _kern_is_computer_on() {}
 void _kern_kernel_debugger() {}
@@ -1154,6 +1161,7 @@ void _kern_select() {}
 void _kern_send() {}
 void _kern_send_data() {}
 void _kern_send_signal() {}
+void _kern_sendfile() {}
 void _kern_sendmsg() {}
 void _kern_sendto() {}
 void _kern_set_area_protection() {}
@@ -1809,6 +1817,14 @@ void insque() {}
 void install_default_debugger() {}
 void install_team_debugger() {}
 void internal_path_for_path__FPcUlPCcT219path_base_directoryT2UlT0Ul() {}
+void io_ring_completion_seen() {}
+void io_ring_destroy() {}
+void io_ring_get_submission() {}
+void io_ring_init() {}
+void io_ring_peek_completion() {}
+void io_ring_prepare_read() {}
+void io_ring_prepare_write() {}
+void io_ring_submit() {}
 void ioctl() {}
 void is_computer_on() {}
 void is_computer_on_fire() {}
@@ -0,0 +1,93 @@
+#!/bin/sh
+#
+# Usage: checkfs_test.sh <bfs_shell>
+#
+# Runs "checkfs -t" on a small BFS image, once with a check bitmap that
+# covers the whole volume, and once with one that only covers two of its
+# eight allocation groups at a time, and compares the results. Then it
+# breaks the block bitmap on disk in two of the groups, and makes sure that
+# both find the same errors, and that a repair fixes them.
+# Note, bfs_shell cannot spawn threads, so it checks the files serially.
+
+if [ $# -ne 1 ] || [ ! -x "$1" ]; then
+	echo "Usage: $0 <bfs_shell>" >&2
+	exit 1
+fi
+
+bfsShell=$1
+testDir=/tmp/checkfs_test
+image=$testDir/image
+rm -rf $testDir
+mkdir -p $testDir/data/dir
+
+fail()
+{
+	echo "FAILED: $*" >&2
+	exit 1
+}
+
+# the results of a checkfs run, without the progress output
+run_checkfs()
+{
+	echo "checkfs $*" | $bfsShell $image 2>&1 \
+		| grep -E "checked|blocks|runs|files|directories|attr|indices|fragments"
+}
+
+# some files of all sizes, a few of them spanning several allocation groups
+for i in $(seq 1 40); do
+	head -c $((i * 7919)) /dev/urandom > $testDir/data/file$i
+done
+for i in $(seq 1 200); do
+	echo $i > $testDir/data/dir/small$i
+done
+for i in 1 2 3; do
+	head -c $((4 * 1024 * 1024 + i * 12345)) /dev/urandom \
+		> $testDir/data/dir/large$i
+done
+
+# 64 MB with 1 KB blocks make 8 allocation groups of 8192 blocks
+dd if=/dev/zero of=$image bs=1M count=0 seek=64 2>/dev/null
+$bfsShell --initialize $image test "block_size 1024" > /dev/null \
+	|| fail "could not initialize the image"
+echo "cp -r :$testDir/data /myfs/data" | $bfsShell $image > /dev/null 2>&1 \
+	|| fail "could not copy the files"
+
+run_checkfs -c -t 4 > $testDir/whole
+run_checkfs -c -t 4 -m 2 > $testDir/windows
+grep -q "^	0 blocks not allocated" $testDir/whole \
+	&& grep -q "^	0 blocks already set" $testDir/whole \
+	&& grep -q "^	0 blocks could be freed" $testDir/whole \
+	|| fail "errors on a new volume: $(cat $testDir/whole)"
+cmp -s $testDir/whole $testDir/windows \
+	|| fail "results differ: $(diff $testDir/whole $testDir/windows)"
+
+# The bitmap blocks follow the super block, one per allocation group. Mark
+# 80 used blocks of the third group as free, and 80 free blocks of the last
+# group as used.
+write_bytes()
+{
+	printf "$2$2$2$2$2$2$2$2$2$2" \
+		| dd of=$image bs=1 seek=$1 conv=notrunc 2>/dev/null
+}
+
+[ "$(od -A n -t x1 -j $((3 * 1024 + 100)) -N 10 $image | tr -d ' ')" \
+	= "ffffffffffffffffffff" ] || fail "unexpected block allocation"
+write_bytes $((3 * 1024 + 100)) '\000'
+write_bytes $((8 * 1024 + 100)) '\377'
+
+run_checkfs -c -t 4 > $testDir/whole-broken
+run_checkfs -c -t 4 -m 2 > $testDir/windows-broken
+grep -q "^	80 blocks not allocated" $testDir/whole-broken \
+	&& grep -q "^	80 blocks could be freed" $testDir/whole-broken \
+	|| fail "errors not found: $(cat $testDir/whole-broken)"
+cmp -s $testDir/whole-broken $testDir/windows-broken \
+	|| fail "results differ: $(diff $testDir/whole-broken \
+		$testDir/windows-broken)"
+
+run_checkfs -t 4 -m 2 > /dev/null
+run_checkfs -c -t 4 > $testDir/repaired
+cmp -s $testDir/whole $testDir/repaired \
+	|| fail "repair did not work: $(diff $testDir/whole $testDir/repaired)"
+
+rm -rf $testDir
+echo "checkfs test passed."
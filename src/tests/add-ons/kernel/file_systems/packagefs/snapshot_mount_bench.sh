@@ -0,0 +1,89 @@
+#!/bin/sh
+#
+# Usage: snapshot_mount_bench.sh [<packages directory> [<mounts>]]
+#
+# Mounts a packagefs with a copy of the given packages directory (default
+# /boot/system/packages) repeatedly, alternating between mounts that ignore
+# the package snapshot and mounts that use it, and prints the average time
+# each of them took. The time is the one the volume logs for adding its
+# packages to the syslog, plus the time the whole mount command took.
+# The packages are hard linked into the copy in /boot/home, so that the
+# snapshot, which keeps track of the packages by their node, can find them
+# again; they have to be on the boot volume.
+
+packagesDir=${1:-/boot/system/packages}
+mounts=${2:-10}
+testDir=/boot/home/snapshot_mount_bench
+mountPoint=$testDir/mount
+syslog=/var/log/syslog
+
+case "$mounts" in
+	""|*[!0-9]*)	mounts=0 ;;
+esac
+if [ ! -d "$packagesDir" ] || [ $mounts -eq 0 ] || [ $# -gt 2 ]; then
+	echo "Usage: $0 [<packages directory> [<mounts>]]" >&2
+	exit 1
+fi
+
+fail()
+{
+	echo "FAILED: $*" >&2
+	unmount "$mountPoint" 2>/dev/null
+	rm -rf "$testDir"
+	exit 1
+}
+
+rm -rf "$testDir"
+mkdir -p "$testDir/packages/administrative" "$mountPoint" \
+	|| fail "could not create $testDir"
+for package in "$packagesDir"/*.hpkg; do
+	ln "$package" "$testDir/packages/" \
+		|| fail "could not link $package"
+done
+
+# Prints the time in microseconds the mount took, and the time the volume
+# needed for adding its packages, as logged by the last mount.
+mount_packagefs()
+{
+	start=$(system_time)
+	mount -t packagefs -p "packages $testDir/packages; type custom; \
+		snapshot $1" "$mountPoint" || fail "could not mount"
+	end=$(system_time)
+	unmount "$mountPoint" || fail "could not unmount"
+
+	added=$(grep "Added [0-9]* packages in" $syslog | tail -n 1 \
+		| sed -e "s/.* packages in \([0-9]*\) us, \([0-9]*\) .*/\1 \2/")
+	echo $((end - start)) $added
+}
+
+# the first mount writes the snapshot
+mount_packagefs true > /dev/null
+[ -f "$testDir/packages/administrative/packagefs-snapshot" ] \
+	|| fail "no snapshot has been written"
+
+withoutTotal=0
+withoutAdded=0
+withTotal=0
+withAdded=0
+for i in $(seq 1 $mounts); do
+	result=$(mount_packagefs false) || exit 1
+	set -- $result
+	withoutTotal=$((withoutTotal + $1))
+	withoutAdded=$((withoutAdded + $2))
+
+	result=$(mount_packagefs true) || exit 1
+	set -- $result
+	withTotal=$((withTotal + $1))
+	withAdded=$((withAdded + $2))
+	[ "$3" -gt 0 ] || fail "the snapshot has not been used"
+done
+
+packageCount=$(ls "$testDir/packages"/*.hpkg | wc -l)
+echo "$packageCount packages, $mounts mounts each, averages in us:"
+printf "%-18s %12s %12s\n" "" "mount" "add packages"
+printf "%-18s %12d %12d\n" "without snapshot" $((withoutTotal / mounts)) \
+	$((withoutAdded / mounts))
+printf "%-18s %12d %12d\n" "with snapshot" $((withTotal / mounts)) \
+	$((withAdded / mounts))
+
+rm -rf "$testDir"
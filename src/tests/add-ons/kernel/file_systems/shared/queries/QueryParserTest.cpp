@@ -23,6 +23,8 @@ public:
 								uint32 flags, port_id port, uint32 token,
 								Query*& _query);
 
+			ssize_t			Explain(char* buffer, size_t bufferSize);
+
 private:
 	struct QueryPolicy;
 	friend struct QueryPolicy;
@@ -114,6 +116,12 @@ struct Query::QueryPolicy {
 		return 0;
 	}
 
+	static status_t IndexEstimatePosition(Index& index, const void* value,
+		size_t size, int32* _position)
+	{
+		return B_NOT_SUPPORTED;
+	}
+
 	static IndexIterator* IndexCreateIterator(Index& index)
 	{
 		return NULL;
@@ -145,6 +153,11 @@ struct Query::QueryPolicy {
 		return B_OK;
 	}
 
+	static ino_t IndexIteratorGetNodeID(IndexIterator* indexIterator)
+	{
+		return -1;
+	}
+
 	static void IndexIteratorSkipDuplicates(IndexIterator* indexIterator)
 	{
 	}
@@ -220,6 +233,13 @@ Query::Query()
 }
 
 
+ssize_t
+Query::Explain(char* buffer, size_t bufferSize)
+{
+	return fImpl->Explain(buffer, bufferSize);
+}
+
+
 status_t
 Query::_Init(const char* queryString, uint32 flags, port_id port, uint32 token)
 {
@@ -232,9 +252,47 @@ Query::_Init(const char* queryString, uint32 flags, port_id port, uint32 token)
 }
 
 
+static bool
+check_plan(const char* queryString, uint32 flags, const char* expectedPlan)
+{
+	Query* query;
+	status_t error = Query::Create(NULL, queryString, flags, 0, 0, query);
+	if (error != B_OK) {
+		fprintf(stderr, "Error creating query \"%s\": %s\n", queryString,
+			strerror(error));
+		return false;
+	}
+
+	char plan[4096];
+	ssize_t length = query->Explain(plan, sizeof(plan));
+	delete query;
+
+	if (length < 0 || strcmp(plan, expectedPlan) != 0) {
+		fprintf(stderr, "Unexpected plan for query \"%s\":\n%s",
+			queryString, length >= 0 ? plan : "");
+		return false;
+	}
+
+	return true;
+}
+
+
 int
 main(int argc, char* argv[])
 {
+	// the test policy does not provide any indices
+	int failed = 0;
+	if (!check_plan("name==\"foo\"", 0,
+			"1. name==\"foo\": no index, skipped\n")) {
+		failed++;
+	}
+	if (!check_plan("(name==\"a\")||(name==\"b\")", B_QUERY_NON_INDEXED,
+			"1. name==\"a\": no index, iterate the \"name\" index\n"
+			"2. name==\"b\": no index, iterate the \"name\" index\n"
+			"\tskip if already found by: name==\"a\"\n")) {
+		failed++;
+	}
+
 	for (int i = 1; i < argc; i++) {
 		Query* query;
 		status_t error = Query::Create(NULL, argv[i], 0, 0, 0, query);
@@ -242,8 +300,13 @@ main(int argc, char* argv[])
 			fprintf(stderr, "Error creating query %d: %s\n", i - 1, strerror(error));
 			continue;
 		}
+
+		char plan[4096];
+		if (query->Explain(plan, sizeof(plan)) >= 0)
+			printf("%s", plan);
+
 		delete query;
 	}
 
-	return 0;
+	return failed == 0 ? 0 : 1;
 }
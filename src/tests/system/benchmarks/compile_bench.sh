@@ -1,4 +1,10 @@
 #!/bin/sh
+#
+# Usage: compile_bench.sh [<scheduler mode> ...]
+#
+# Compiles a small program 100 times, with as many jobs in parallel as there
+# are CPUs. If scheduler modes (low_latency, power_saving, throughput) are
+# given, the benchmark is run in each of them in turn.
 
 testDir=/tmp/compile_bench
 rm -rf $testDir
@@ -17,18 +23,43 @@ main()
 
 EOF
 
-compile_all()
+jobs=$(getconf _NPROCESSORS_ONLN 2>/dev/null)
+if [ -z "$jobs" ] || [ "$jobs" -lt 1 ]; then
+	jobs=1
+fi
+
+compile_some()
 {
-	for f in $(seq 100); do
+	for f in $(seq $1 $jobs 100); do
 		echo -n .
 		g++ -o $f ${f}.cpp
 	done
 }
 
+compile_all()
+{
+	for job in $(seq $jobs); do
+		compile_some $job &
+	done
+	wait
+	echo
+}
+
 for f in $(seq 100); do
 	cp hello_world.cpp ${f}.cpp
 done
 
-time compile_all
+if [ $# -eq 0 ]; then
+	time compile_all
+else
+	previousMode=$(scheduler_mode)
+	for mode in "$@"; do
+		scheduler_mode $mode || break
+		echo "$mode mode, $jobs jobs:"
+		time compile_all
+	done
+	scheduler_mode $previousMode
+fi
 
+cd /
 rm -rf $testDir
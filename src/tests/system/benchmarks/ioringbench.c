@@ -0,0 +1,137 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Compares the cost of issuing small reads one syscall at a time with
+	submitting them in batches through an I/O ring.
+*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#include <io_ring.h>
+
+#define ITERATIONS	200000
+#define READ_SIZE	64
+
+static char sBuffer[IO_RING_MAX_ENTRIES][READ_SIZE];
+
+static void
+usage(void)
+{
+	printf("ioringbench [<file>]\n");
+	exit(1);
+}
+
+static unsigned long
+elapsed_since(struct timeval *before)
+{
+	struct timeval after;
+	gettimeofday(&after, NULL);
+	return 1000000 * (after.tv_sec - before->tv_sec)
+		+ after.tv_usec - before->tv_usec;
+}
+
+static unsigned long
+test_syscalls(int fd)
+{
+	struct timeval before;
+	int i;
+
+	gettimeofday(&before, NULL);
+	for (i = 0; i < ITERATIONS; i++) {
+		if (pread(fd, sBuffer[0], READ_SIZE, 0) < 0) {
+			perror("pread");
+			exit(1);
+		}
+	}
+	return elapsed_since(&before);
+}
+
+static unsigned long
+test_ring(int fd, uint32 batchSize)
+{
+	struct timeval before;
+	io_ring ring;
+	int done = 0;
+	status_t status;
+
+	status = io_ring_init(&ring, batchSize);
+	if (status != B_OK) {
+		fprintf(stderr, "creating ring failed: %s\n", strerror(status));
+		exit(1);
+	}
+
+	gettimeofday(&before, NULL);
+	while (done < ITERATIONS) {
+		io_ring_completion *completion;
+		ssize_t submitted;
+		uint32 i;
+
+		for (i = 0; i < batchSize; i++) {
+			io_ring_submission *submission = io_ring_get_submission(&ring);
+			if (submission == NULL)
+				break;
+			io_ring_prepare_read(submission, fd, sBuffer[i], READ_SIZE, 0, i);
+		}
+
+		submitted = io_ring_submit(&ring);
+		if (submitted < 0) {
+			fprintf(stderr, "submitting failed: %s\n", strerror(submitted));
+			exit(1);
+		}
+
+		while ((completion = io_ring_peek_completion(&ring)) != NULL) {
+			if (completion->result < 0) {
+				fprintf(stderr, "read failed: %s\n",
+					strerror(completion->result));
+				exit(1);
+			}
+			io_ring_completion_seen(&ring);
+			done++;
+		}
+	}
+	io_ring_destroy(&ring);
+
+	return elapsed_since(&before);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *path = "/dev/zero";
+	unsigned long syscall;
+	uint32 batchSize;
+	int fd;
+
+	if (argc > 2)
+		usage();
+	if (argc == 2)
+		path = argv[1];
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		perror(path);
+		return 1;
+	}
+
+	syscall = test_syscalls(fd);
+	printf("pread():           %5ld nanoseconds per read\n",
+		(1000 * syscall) / ITERATIONS);
+
+	for (batchSize = 1; batchSize <= 256; batchSize *= 4) {
+		unsigned long ring = test_ring(fd, batchSize);
+		printf("ring, batch %4" B_PRIu32 ": %5ld nanoseconds per read\n",
+			batchSize, (1000 * ring) / ITERATIONS);
+	}
+
+	close(fd);
+	return 0;
+}
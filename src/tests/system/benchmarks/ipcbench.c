@@ -0,0 +1,298 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Measures the round trip latency, and the bulk throughput of local
+	stream connections: TCP over the loopback interface, and unix domain
+	sockets. Each test runs between two threads of the same team.
+	With "-T" or "-U" only one kind of connection is tested.
+*/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define DEFAULT_MESSAGE_SIZE	1
+#define DEFAULT_ROUND_TRIPS		100000
+#define DEFAULT_WRITE_SIZE		65536
+#define DEFAULT_TOTAL_SIZE		(512LL * 1024 * 1024)
+
+static size_t sMessageSize = DEFAULT_MESSAGE_SIZE;
+static long sRoundTrips = DEFAULT_ROUND_TRIPS;
+static size_t sWriteSize = DEFAULT_WRITE_SIZE;
+static long long sTotal = DEFAULT_TOTAL_SIZE;
+static long long sReceived;
+
+static void
+usage(void)
+{
+	printf("ipcbench [-TU] [-m <message size>] [-n <round trips>]\n"
+		"         [-s <write size>] [-t <total MB>]\n");
+	exit(1);
+}
+
+static unsigned long
+elapsed_since(struct timeval *before)
+{
+	struct timeval after;
+	gettimeofday(&after, NULL);
+	return 1000000 * (after.tv_sec - before->tv_sec)
+		+ after.tv_usec - before->tv_usec;
+}
+
+static int
+read_fully(int fd, char *buffer, size_t size)
+{
+	while (size > 0) {
+		ssize_t bytesRead = read(fd, buffer, size);
+		if (bytesRead <= 0)
+			return -1;
+
+		buffer += bytesRead;
+		size -= bytesRead;
+	}
+
+	return 0;
+}
+
+static int
+write_fully(int fd, const char *buffer, size_t size)
+{
+	while (size > 0) {
+		ssize_t bytesWritten = write(fd, buffer, size);
+		if (bytesWritten <= 0)
+			return -1;
+
+		buffer += bytesWritten;
+		size -= bytesWritten;
+	}
+
+	return 0;
+}
+
+/*!	Creates a connected pair of TCP sockets over the loopback interface. */
+static int
+tcp_pair(int fds[2])
+{
+	struct sockaddr_in address;
+	socklen_t addressLength = sizeof(address);
+	int option = 1;
+	int listenSocket;
+
+	memset(&address, 0, sizeof(address));
+	address.sin_len = sizeof(struct sockaddr_in);
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+	if (listenSocket < 0
+		|| bind(listenSocket, (struct sockaddr *)&address, addressLength) < 0
+		|| getsockname(listenSocket, (struct sockaddr *)&address,
+			&addressLength) < 0
+		|| listen(listenSocket, 1) < 0)
+		return -1;
+
+	fds[0] = socket(AF_INET, SOCK_STREAM, 0);
+	if (fds[0] < 0
+		|| connect(fds[0], (struct sockaddr *)&address, addressLength) < 0)
+		return -1;
+
+	fds[1] = accept(listenSocket, NULL, NULL);
+	close(listenSocket);
+	if (fds[1] < 0)
+		return -1;
+
+	setsockopt(fds[0], IPPROTO_TCP, TCP_NODELAY, &option, sizeof(option));
+	setsockopt(fds[1], IPPROTO_TCP, TCP_NODELAY, &option, sizeof(option));
+	return 0;
+}
+
+static int
+unix_pair(int fds[2])
+{
+	return socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+}
+
+static void *
+echo(void *data)
+{
+	int fd = (int)(long)data;
+	char *buffer = malloc(sMessageSize);
+
+	if (buffer != NULL) {
+		while (read_fully(fd, buffer, sMessageSize) == 0
+			&& write_fully(fd, buffer, sMessageSize) == 0)
+			;
+	}
+
+	free(buffer);
+	return NULL;
+}
+
+static void *
+receiver(void *data)
+{
+	int fd = (int)(long)data;
+	char *buffer = malloc(sWriteSize);
+	ssize_t bytesRead;
+
+	sReceived = 0;
+	if (buffer != NULL) {
+		while ((bytesRead = read(fd, buffer, sWriteSize)) > 0)
+			sReceived += bytesRead;
+	}
+
+	free(buffer);
+	return NULL;
+}
+
+static int
+test_latency(const char *name, int (*createPair)(int fds[2]))
+{
+	struct timeval before;
+	unsigned long elapsed;
+	pthread_t thread;
+	char *buffer;
+	int fds[2];
+	long i;
+
+	if (createPair(fds) < 0) {
+		perror(name);
+		return -1;
+	}
+
+	buffer = malloc(sMessageSize);
+	if (buffer == NULL
+		|| pthread_create(&thread, NULL, &echo, (void *)(long)fds[1]) != 0) {
+		fprintf(stderr, "%s: could not start echo thread\n", name);
+		return -1;
+	}
+	memset(buffer, 0x55, sMessageSize);
+
+	gettimeofday(&before, NULL);
+	for (i = 0; i < sRoundTrips; i++) {
+		if (write_fully(fds[0], buffer, sMessageSize) < 0
+			|| read_fully(fds[0], buffer, sMessageSize) < 0) {
+			perror(name);
+			break;
+		}
+	}
+	elapsed = elapsed_since(&before);
+
+	shutdown(fds[0], SHUT_WR);
+	pthread_join(thread, NULL);
+	close(fds[0]);
+	close(fds[1]);
+	free(buffer);
+
+	if (i == 0)
+		return -1;
+
+	printf("%-6s latency: %ld round trips of %lu bytes in %lu usecs, "
+		"%.2f usecs each\n", name, i, (unsigned long)sMessageSize, elapsed,
+		(double)elapsed / i);
+	return 0;
+}
+
+static int
+test_throughput(const char *name, int (*createPair)(int fds[2]))
+{
+	struct timeval before;
+	unsigned long elapsed;
+	long long sent = 0;
+	pthread_t thread;
+	char *buffer;
+	int fds[2];
+
+	if (createPair(fds) < 0) {
+		perror(name);
+		return -1;
+	}
+
+	buffer = malloc(sWriteSize);
+	if (buffer == NULL
+		|| pthread_create(&thread, NULL, &receiver, (void *)(long)fds[1])
+			!= 0) {
+		fprintf(stderr, "%s: could not start receiver thread\n", name);
+		return -1;
+	}
+	memset(buffer, 0x55, sWriteSize);
+
+	gettimeofday(&before, NULL);
+	while (sent < sTotal) {
+		ssize_t bytesWritten = write(fds[0], buffer, sWriteSize);
+		if (bytesWritten < 0) {
+			perror(name);
+			break;
+		}
+		sent += bytesWritten;
+	}
+	shutdown(fds[0], SHUT_WR);
+	pthread_join(thread, NULL);
+	elapsed = elapsed_since(&before);
+
+	close(fds[0]);
+	close(fds[1]);
+	free(buffer);
+
+	printf("%-6s throughput: %lld bytes in %lu usecs, write size %lu: "
+		"%.1f MB/s\n", name, sReceived, elapsed, (unsigned long)sWriteSize,
+		(double)sReceived / elapsed * 1000000 / (1024 * 1024));
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int testTCP = 1;
+	int testUnix = 1;
+	int status = 0;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "TUm:n:s:t:h")) != -1) {
+		switch (ch) {
+			case 'T':
+				testUnix = 0;
+				break;
+			case 'U':
+				testTCP = 0;
+				break;
+			case 'm':
+				sMessageSize = strtoul(optarg, NULL, 0);
+				break;
+			case 'n':
+				sRoundTrips = strtol(optarg, NULL, 0);
+				break;
+			case 's':
+				sWriteSize = strtoul(optarg, NULL, 0);
+				break;
+			case 't':
+				sTotal = strtoll(optarg, NULL, 0) * 1024 * 1024;
+				break;
+			default:
+				usage();
+		}
+	}
+	if (sMessageSize == 0 || sRoundTrips <= 0 || sWriteSize == 0
+		|| sTotal <= 0 || (!testTCP && !testUnix))
+		usage();
+
+	if (testTCP) {
+		status |= test_latency("tcp", &tcp_pair);
+		status |= test_throughput("tcp", &tcp_pair);
+	}
+	if (testUnix) {
+		status |= test_latency("unix", &unix_pair);
+		status |= test_throughput("unix", &unix_pair);
+	}
+
+	return status != 0 ? 1 : 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include <scheduler.h>
+
+
+static const char* const kModeNames[] = {
+	"low_latency",
+	"power_saving",
+	"throughput",
+};
+static const int kModeCount = sizeof(kModeNames) / sizeof(kModeNames[0]);
+
+
+int
+main(int argc, char** argv)
+{
+	int32 mode = get_scheduler_mode();
+	int i;
+
+	if (argc < 2) {
+		if (mode >= 0 && mode < kModeCount)
+			puts(kModeNames[mode]);
+		else
+			printf("%" B_PRId32 "\n", mode);
+		return 0;
+	}
+
+	for (i = 0; i < kModeCount; i++) {
+		if (strcmp(argv[1], kModeNames[i]) == 0)
+			break;
+	}
+	if (i == kModeCount) {
+		fprintf(stderr, "usage: %s [low_latency|power_saving|throughput]\n",
+			argv[0]);
+		return 1;
+	}
+
+	if (set_scheduler_mode(i) != B_OK) {
+		fprintf(stderr, "%s: could not switch to %s mode\n", argv[0],
+			argv[1]);
+		return 1;
+	}
+
+	return 0;
+}
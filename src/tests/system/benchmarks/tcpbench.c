@@ -0,0 +1,194 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Measures the bulk throughput of a TCP connection over the loopback
+	interface. Running it with a smaller loopback MTU (ie.
+	"ifconfig loop mtu 1500") shows the effect of passing oversized
+	segments through the stack, and merging them on the receiving side.
+	With "-z" the data is sent with MSG_ZEROCOPY, and with "-f <file>" the
+	file is sent with sendfile() instead, both of which avoid copying it.
+*/
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define DEFAULT_WRITE_SIZE	65536
+#define DEFAULT_TOTAL_SIZE	(1024LL * 1024 * 1024)
+
+static int sListenSocket;
+static long long sReceived;
+
+static void
+usage(void)
+{
+	printf("tcpbench [-6z] [-f <file>] [-s <write size>] [-t <total MB>]\n");
+	exit(1);
+}
+
+static unsigned long
+elapsed_since(struct timeval *before)
+{
+	struct timeval after;
+	gettimeofday(&after, NULL);
+	return 1000000 * (after.tv_sec - before->tv_sec)
+		+ after.tv_usec - before->tv_usec;
+}
+
+static void *
+receiver(void *data)
+{
+	char buffer[DEFAULT_WRITE_SIZE];
+	ssize_t bytesRead;
+	int fd;
+
+	fd = accept(sListenSocket, NULL, NULL);
+	if (fd < 0) {
+		perror("accept");
+		exit(1);
+	}
+
+	while ((bytesRead = read(fd, buffer, sizeof(buffer))) > 0)
+		sReceived += bytesRead;
+
+	close(fd);
+	return NULL;
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct sockaddr_storage address;
+	socklen_t addressLength;
+	size_t writeSize = DEFAULT_WRITE_SIZE;
+	long long total = DEFAULT_TOTAL_SIZE;
+	long long sent = 0;
+	int family = AF_INET;
+	int flags = 0;
+	const char *file = NULL;
+	int fileFD = -1;
+	off_t fileSize = 0;
+	struct timeval before;
+	unsigned long elapsed;
+	pthread_t thread;
+	char *buffer;
+	int option = 1;
+	int fd, ch;
+
+	while ((ch = getopt(argc, argv, "6f:s:t:zh")) != -1) {
+		switch (ch) {
+			case '6':
+				family = AF_INET6;
+				break;
+			case 'f':
+				file = optarg;
+				break;
+			case 's':
+				writeSize = strtoul(optarg, NULL, 0);
+				break;
+			case 't':
+				total = strtoll(optarg, NULL, 0) * 1024 * 1024;
+				break;
+			case 'z':
+				flags |= MSG_ZEROCOPY;
+				break;
+			default:
+				usage();
+		}
+	}
+	if (writeSize == 0 || total <= 0)
+		usage();
+
+	if (file != NULL) {
+		fileFD = open(file, O_RDONLY);
+		if (fileFD < 0 || (fileSize = lseek(fileFD, 0, SEEK_END)) <= 0) {
+			fprintf(stderr, "could not open %s\n", file);
+			return 1;
+		}
+	}
+
+	memset(&address, 0, sizeof(address));
+	if (family == AF_INET) {
+		struct sockaddr_in *in = (struct sockaddr_in *)&address;
+		in->sin_len = sizeof(struct sockaddr_in);
+		in->sin_family = AF_INET;
+		in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addressLength = sizeof(struct sockaddr_in);
+	} else {
+		struct sockaddr_in6 *in6 = (struct sockaddr_in6 *)&address;
+		in6->sin6_len = sizeof(struct sockaddr_in6);
+		in6->sin6_family = AF_INET6;
+		in6->sin6_addr = in6addr_loopback;
+		addressLength = sizeof(struct sockaddr_in6);
+	}
+
+	sListenSocket = socket(family, SOCK_STREAM, 0);
+	if (sListenSocket < 0
+		|| bind(sListenSocket, (struct sockaddr *)&address, addressLength) < 0
+		|| getsockname(sListenSocket, (struct sockaddr *)&address,
+			&addressLength) < 0
+		|| listen(sListenSocket, 1) < 0) {
+		perror("listen");
+		return 1;
+	}
+
+	if (pthread_create(&thread, NULL, &receiver, NULL) != 0) {
+		fprintf(stderr, "could not create receiver thread\n");
+		return 1;
+	}
+
+	buffer = malloc(writeSize);
+	if (buffer == NULL) {
+		fprintf(stderr, "no memory\n");
+		return 1;
+	}
+	memset(buffer, 0x55, writeSize);
+
+	fd = socket(family, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr *)&address, addressLength) < 0) {
+		perror("connect");
+		return 1;
+	}
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &option, sizeof(option));
+
+	gettimeofday(&before, NULL);
+	while (sent < total) {
+		ssize_t bytesWritten;
+		if (fileFD >= 0) {
+			off_t offset = sent % fileSize;
+			size_t size = writeSize;
+			if ((off_t)size > fileSize - offset)
+				size = fileSize - offset;
+			bytesWritten = sendfile(fd, fileFD, &offset, size);
+		} else
+			bytesWritten = send(fd, buffer, writeSize, flags);
+		if (bytesWritten < 0) {
+			perror("write");
+			return 1;
+		}
+		sent += bytesWritten;
+	}
+	close(fd);
+	pthread_join(thread, NULL);
+	elapsed = elapsed_since(&before);
+
+	printf("%lld bytes in %lu usecs, write size %lu: %.1f MB/s\n", sReceived,
+		elapsed, (unsigned long)writeSize,
+		(double)sReceived / elapsed * 1000000 / (1024 * 1024));
+
+	free(buffer);
+	if (fileFD >= 0)
+		close(fileFD);
+	close(sListenSocket);
+	return 0;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#define write_pos	block_cache_write_pos
+#define read_pos	block_cache_read_pos
+
+#include "block_cache.cpp"
+
+#undef write_pos
+#undef read_pos
+
+#include <algorithm>
+
+
+static const off_t kBlockCount = 256;
+static const size_t kBlockSize = 2048;
+static const int32 kMaxThreads = 32;
+
+static void* sCache;
+static int32 sIterations = 200000;
+static int32 sStartSignal;
+
+
+ssize_t
+block_cache_write_pos(int fd, off_t offset, const void* buffer, size_t size)
+{
+	return size;
+}
+
+
+ssize_t
+block_cache_read_pos(int fd, off_t offset, void* buffer, size_t size)
+{
+	memset(buffer, offset / kBlockSize, size);
+	return size;
+}
+
+
+static status_t
+reader_thread(void* _seed)
+{
+	uint32 seed = (uint32)(addr_t)_seed;
+
+	while (atomic_get(&sStartSignal) == 0)
+		;
+
+	for (int32 i = 0; i < sIterations; i++) {
+		seed = seed * 1103515245 + 12345;
+		off_t blockNumber = (seed >> 8) % kBlockCount;
+
+		const uint8* block = (const uint8*)block_cache_get(sCache,
+			blockNumber);
+		if (block == NULL || block[0] != (uint8)blockNumber) {
+			fprintf(stderr, "block %" B_PRIdOFF " has wrong contents!\n",
+				blockNumber);
+			exit(1);
+		}
+		block_cache_put(sCache, blockNumber);
+	}
+
+	return B_OK;
+}
+
+
+static void
+run_test(int32 threadCount, bool pinned)
+{
+	thread_id threads[kMaxThreads];
+
+	atomic_set(&sStartSignal, 0);
+
+	for (int32 i = 0; i < threadCount; i++) {
+		threads[i] = spawn_thread(&reader_thread, "block cache reader",
+			B_NORMAL_PRIORITY, (void*)(addr_t)(i + 1));
+		resume_thread(threads[i]);
+	}
+
+	bigtime_t start = system_time();
+	atomic_set(&sStartSignal, 1);
+
+	for (int32 i = 0; i < threadCount; i++) {
+		status_t result;
+		wait_for_thread(threads[i], &result);
+	}
+
+	bigtime_t duration = system_time() - start;
+	int64 operations = (int64)threadCount * sIterations;
+
+	printf("%-9s %3" B_PRId32 " threads: %10" B_PRId64 " get/put pairs in "
+		"%8" B_PRId64 " us, %10" B_PRId64 " per second\n",
+		pinned ? "pinned" : "unpinned", threadCount, operations, duration,
+		operations * 1000000LL / std::max(duration, (bigtime_t)1));
+}
+
+
+/*!	Measures how well concurrent block_cache_get()/block_cache_put() calls on
+	already cached blocks scale with the number of threads.
+	In "pinned" mode, all blocks are additionally referenced by the main
+	thread, like the blocks of a file system's hot metadata usually are, so
+	that the lock-free fast paths can be used. In "unpinned" mode, every
+	get/put pair moves the block in and out of the unused list, which needs
+	the cache's lock.
+*/
+int
+main(int argc, char** argv)
+{
+	int32 maxThreads = 8;
+	if (argc > 1)
+		maxThreads = std::min(std::max(atoi(argv[1]), 1), (int)kMaxThreads);
+	if (argc > 2)
+		sIterations = std::max(atoi(argv[2]), 1);
+
+	block_cache_init();
+
+	sCache = block_cache_create(-1, kBlockCount, kBlockSize, true);
+	if (sCache == NULL) {
+		fprintf(stderr, "Could not create block cache!\n");
+		return 1;
+	}
+
+	// read in all blocks
+	for (off_t i = 0; i < kBlockCount; i++) {
+		if (block_cache_get(sCache, i) == NULL) {
+			fprintf(stderr, "Could not get block %" B_PRIdOFF "!\n", i);
+			return 1;
+		}
+		block_cache_put(sCache, i);
+	}
+
+	for (int32 threads = 1; threads <= maxThreads; threads *= 2)
+		run_test(threads, false);
+
+	for (off_t i = 0; i < kBlockCount; i++)
+		block_cache_get(sCache, i);
+
+	for (int32 threads = 1; threads <= maxThreads; threads *= 2)
+		run_test(threads, true);
+
+	for (off_t i = 0; i < kBlockCount; i++)
+		block_cache_put(sCache, i);
+
+	block_cache_delete(sCache, false);
+	return 0;
+}
@@ -11,6 +11,7 @@
 #include <file_cache.h>
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 
@@ -20,7 +21,8 @@ extern const char *__progname;
 void
 usage()
 {
-	fprintf(stderr, "usage: %s [clear | unset | set <module-name>]\n", __progname);
+	fprintf(stderr, "usage: %s [clear | unset | set <module-name> | stats "
+		"| readahead <max-bytes>]\n", __progname);
 	exit(0);
 }
 
@@ -50,6 +52,25 @@ main(int argc, char **argv)
 		status = _kern_generic_syscall(CACHE_SYSCALLS, CACHE_SET_MODULE, argv[2], strlen(argv[2]));
 		if (status != B_OK)
 			fprintf(stderr, "%s: setting the module failed: %s\n", __progname, strerror(status));
+	} else if (!strcmp(argv[1], "stats")) {
+		file_cache_read_ahead_stats stats;
+		status = _kern_generic_syscall(CACHE_SYSCALLS, CACHE_GET_READ_AHEAD_STATS, &stats, sizeof(stats));
+		if (status != B_OK) {
+			fprintf(stderr, "%s: getting the statistics failed: %s\n", __progname, strerror(status));
+			return 1;
+		}
+
+		printf("read-ahead hits:        %" B_PRIu64 "\n", stats.hits);
+		printf("read-ahead misses:      %" B_PRIu64 "\n", stats.misses);
+		printf("pages read ahead:       %" B_PRIu64 "\n", stats.pages_read_ahead);
+		printf("pages wasted:           %" B_PRIu64 "\n", stats.pages_wasted);
+		printf("maximum window:         %" B_PRIu32 " KB\n", stats.max_window_size / 1024);
+		printf("effective max. window:  %" B_PRIu32 " KB\n", stats.effective_max_window_size / 1024);
+	} else if (!strcmp(argv[1], "readahead") && argc > 2) {
+		uint32 maxSize = strtoul(argv[2], NULL, 0);
+		status = _kern_generic_syscall(CACHE_SYSCALLS, CACHE_SET_READ_AHEAD_MAX, &maxSize, sizeof(maxSize));
+		if (status != B_OK)
+			fprintf(stderr, "%s: setting the read-ahead size failed: %s\n", __progname, strerror(status));
 	} else
 		usage();
 
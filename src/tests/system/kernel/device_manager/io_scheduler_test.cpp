@@ -0,0 +1,256 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Reads random blocks from a raw device with threads of an interactive,
+	a normal, and a background priority, and prints the operations per
+	second and the latencies each of them got. With -w, every thread writes
+	a pattern to its own part of the device first, and verifies what it
+	reads back; this destroys the data on the device.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <Drivers.h>
+#include <OS.h>
+
+
+static const size_t kBlockSize = 4096;
+static const int32 kMaxThreads = 64;
+static const off_t kMaxVerifyBlocks = 2048;
+	// per thread, so that writing the pattern doesn't take forever
+
+
+struct thread_data {
+	int			fd;
+	int32		priority;
+	off_t		start;
+	off_t		blocks;
+	bool		verify;
+	bigtime_t	duration;
+
+	uint64		operations;
+	uint64		errors;
+	bigtime_t	total_latency;
+	bigtime_t	max_latency;
+	thread_id	thread;
+};
+
+
+static const struct {
+	const char*	name;
+	int32		priority;
+} kClasses[] = {
+	{ "interactive", B_DISPLAY_PRIORITY },
+	{ "best effort", B_NORMAL_PRIORITY },
+	{ "background", B_LOW_PRIORITY }
+};
+static const int32 kClassCount = sizeof(kClasses) / sizeof(kClasses[0]);
+
+
+static void
+fill_block(uint8* buffer, off_t offset)
+{
+	uint64* words = (uint64*)buffer;
+	for (size_t i = 0; i < kBlockSize / sizeof(uint64); i++)
+		words[i] = (uint64)offset + i;
+}
+
+
+static status_t
+io_thread(void* _data)
+{
+	thread_data* data = (thread_data*)_data;
+
+	uint8* buffer = (uint8*)malloc(kBlockSize);
+	uint8* expected = (uint8*)malloc(kBlockSize);
+	if (buffer == NULL || expected == NULL) {
+		free(buffer);
+		free(expected);
+		return B_NO_MEMORY;
+	}
+
+	if (data->verify) {
+		for (off_t block = 0; block < data->blocks; block++) {
+			off_t offset = (data->start + block) * kBlockSize;
+			fill_block(buffer, offset);
+			if (pwrite(data->fd, buffer, kBlockSize, offset)
+					!= (ssize_t)kBlockSize) {
+				data->errors++;
+			}
+		}
+	}
+
+	unsigned int seed = find_thread(NULL);
+	bigtime_t until = system_time() + data->duration;
+
+	while (system_time() < until) {
+		off_t offset = (data->start + rand_r(&seed) % data->blocks)
+			* kBlockSize;
+
+		bigtime_t start = system_time();
+		ssize_t bytesRead = pread(data->fd, buffer, kBlockSize, offset);
+		bigtime_t latency = system_time() - start;
+
+		data->operations++;
+		data->total_latency += latency;
+		if (latency > data->max_latency)
+			data->max_latency = latency;
+
+		if (bytesRead != (ssize_t)kBlockSize) {
+			data->errors++;
+			continue;
+		}
+
+		if (data->verify) {
+			fill_block(expected, offset);
+			if (memcmp(buffer, expected, kBlockSize) != 0)
+				data->errors++;
+		}
+	}
+
+	free(buffer);
+	free(expected);
+	return B_OK;
+}
+
+
+static void
+usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [-w] [-t <threads per class>] "
+		"[-s <seconds>] <raw device>\n"
+		"  -w  write a pattern first, and verify the data read; this "
+			"destroys the\n"
+		"      contents of the device\n", program);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 threadsPerClass = 4;
+	int32 seconds = 10;
+	bool verify = false;
+
+	int option;
+	while ((option = getopt(argc, argv, "ws:t:")) != -1) {
+		switch (option) {
+			case 'w':
+				verify = true;
+				break;
+			case 's':
+				seconds = atol(optarg);
+				break;
+			case 't':
+				threadsPerClass = atol(optarg);
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+
+	if (optind + 1 != argc || seconds <= 0 || threadsPerClass <= 0
+		|| threadsPerClass * kClassCount > kMaxThreads) {
+		usage(argv[0]);
+	}
+
+	const char* device = argv[optind];
+	int fd = open(device, verify ? O_RDWR : O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Could not open %s: %s\n", device, strerror(errno));
+		return 1;
+	}
+
+	size_t deviceSize;
+	off_t size;
+	if (ioctl(fd, B_GET_DEVICE_SIZE, &deviceSize, sizeof(deviceSize)) == 0)
+		size = deviceSize;
+	else {
+		device_geometry geometry;
+		if (ioctl(fd, B_GET_GEOMETRY, &geometry, sizeof(geometry)) != 0) {
+			fprintf(stderr, "Could not get the size of %s: %s\n", device,
+				strerror(errno));
+			return 1;
+		}
+		size = (off_t)geometry.bytes_per_sector * geometry.sectors_per_track
+			* geometry.cylinder_count * geometry.head_count;
+	}
+
+	int32 threadCount = threadsPerClass * kClassCount;
+	off_t blocks = size / kBlockSize / threadCount;
+	if (blocks == 0) {
+		fprintf(stderr, "%s is too small.\n", device);
+		return 1;
+	}
+	if (verify && blocks > kMaxVerifyBlocks)
+		blocks = kMaxVerifyBlocks;
+
+	thread_data data[kMaxThreads];
+	memset(data, 0, sizeof(data));
+
+	for (int32 i = 0; i < threadCount; i++) {
+		data[i].fd = fd;
+		data[i].priority = kClasses[i % kClassCount].priority;
+		data[i].start = i * blocks;
+		data[i].blocks = blocks;
+		data[i].verify = verify;
+		data[i].duration = seconds * 1000000LL;
+		data[i].thread = spawn_thread(&io_thread, "io scheduler test",
+			data[i].priority, &data[i]);
+		if (data[i].thread < 0) {
+			fprintf(stderr, "Could not spawn thread: %s\n",
+				strerror(data[i].thread));
+			return 1;
+		}
+	}
+
+	for (int32 i = 0; i < threadCount; i++)
+		resume_thread(data[i].thread);
+
+	for (int32 i = 0; i < threadCount; i++) {
+		status_t returnValue;
+		wait_for_thread(data[i].thread, &returnValue);
+	}
+
+	close(fd);
+
+	printf("%s: %" B_PRId32 " threads, %" B_PRId32 " s\n", device,
+		threadCount, seconds);
+	printf("%-12s %12s %12s %12s %8s\n", "class", "ops/s", "avg (us)",
+		"max (us)", "errors");
+
+	uint64 totalErrors = 0;
+	for (int32 i = 0; i < kClassCount; i++) {
+		uint64 operations = 0;
+		uint64 errors = 0;
+		bigtime_t totalLatency = 0;
+		bigtime_t maxLatency = 0;
+		for (int32 j = i; j < threadCount; j += kClassCount) {
+			operations += data[j].operations;
+			errors += data[j].errors;
+			totalLatency += data[j].total_latency;
+			if (data[j].max_latency > maxLatency)
+				maxLatency = data[j].max_latency;
+		}
+
+		printf("%-12s %12" B_PRIu64 " %12" B_PRId64 " %12" B_PRId64
+			" %8" B_PRIu64 "\n", kClasses[i].name,
+			operations / seconds,
+			operations > 0 ? totalLatency / (bigtime_t)operations : 0,
+			maxLatency, errors);
+		totalErrors += errors;
+	}
+
+	return totalErrors == 0 ? 0 : 1;
+}
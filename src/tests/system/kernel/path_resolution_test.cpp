@@ -4,11 +4,32 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/stat.h>
 
 #include <OS.h>
 
 
+static const int32 kIterations = 10000;
+static const int32 kMaxThreads = 64;
+
+
+struct thread_args {
+	const char*	path;
+	bigtime_t	time;
+};
+
+
+static void
+lstat_loop(const char* path)
+{
+	for (int32 i = 0; i < kIterations; i++) {
+		struct stat st;
+		lstat(path, &st);
+	}
+}
+
+
 static void
 time_lstat(const char* path)
 {
@@ -16,19 +37,62 @@ time_lstat(const char* path)
 	fflush(stdout);
 	bigtime_t startTime = system_time();
 
-	static const int32 iterations = 10000;
-	for (int32 i = 0; i < iterations; i++) {
-		struct stat st;
-		lstat(path, &st);
-	}
+	lstat_loop(path);
 
 	bigtime_t totalTime = system_time() - startTime;
-	printf(" %5.3f us/call\n", (double)totalTime / iterations);
+	printf(" %5.3f us/call\n", (double)totalTime / kIterations);
+}
+
+
+static status_t
+lstat_thread(void* data)
+{
+	thread_args* args = (thread_args*)data;
+
+	bigtime_t startTime = system_time();
+	lstat_loop(args->path);
+	args->time = system_time() - startTime;
+
+	return B_OK;
+}
+
+
+/*!	Resolves \a path from \a threadCount threads at the same time. Since
+	entry cache lookups don't lock, the time per call should not grow much
+	with the number of threads, as long as there are enough CPUs.
+*/
+static void
+time_parallel_lstat(const char* path, int32 threadCount)
+{
+	printf("%-51s %2" B_PRId32 " threads ...", path, threadCount);
+	fflush(stdout);
+
+	thread_id threads[kMaxThreads];
+	thread_args args[kMaxThreads];
+
+	for (int32 i = 0; i < threadCount; i++) {
+		args[i].path = path;
+		threads[i] = spawn_thread(&lstat_thread, "lstat", B_NORMAL_PRIORITY,
+			&args[i]);
+	}
+
+	for (int32 i = 0; i < threadCount; i++)
+		resume_thread(threads[i]);
+
+	bigtime_t totalTime = 0;
+	for (int32 i = 0; i < threadCount; i++) {
+		status_t result;
+		wait_for_thread(threads[i], &result);
+		totalTime += args[i].time;
+	}
+
+	printf(" %5.3f us/call\n",
+		(double)totalTime / (kIterations * threadCount));
 }
 
 
 int
-main()
+main(int argc, char** argv)
 {
 	const char* const paths[] = {
 		"/",
@@ -41,8 +105,33 @@ main()
 		NULL
 	};
 
+	// paths that don't exist, and should be served by missing entries
+	const char* const missingPaths[] = {
+		"/boot/does-not-exist",
+		"/boot/develop/headers/does-not-exist",
+		"/boot/develop/headers/posix/sys/does-not-exist.h",
+		NULL
+	};
+
 	for (int32 i = 0; paths[i] != NULL; i++)
 		time_lstat(paths[i]);
 
+	puts("");
+	for (int32 i = 0; missingPaths[i] != NULL; i++)
+		time_lstat(missingPaths[i]);
+
+	system_info info;
+	get_system_info(&info);
+
+	int32 maxThreads = argc > 1 ? atoi(argv[1]) : info.cpu_count * 2;
+	if (maxThreads > kMaxThreads)
+		maxThreads = kMaxThreads;
+
+	puts("");
+	for (int32 threads = 1; threads <= maxThreads; threads *= 2) {
+		time_parallel_lstat(paths[6], threads);
+		time_parallel_lstat(missingPaths[2], threads);
+	}
+
 	return 0;
 }
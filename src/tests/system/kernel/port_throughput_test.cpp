@@ -0,0 +1,119 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <port.h>
+
+
+static const size_t kMaxMessageSize = 4 * 1024 * 1024;
+static const bigtime_t kTestDuration = 500000;
+
+
+struct test_data {
+	port_id	port;
+	size_t	size;
+	uint8*	buffer;
+};
+
+
+static status_t
+reader_thread(void* _data)
+{
+	test_data* data = (test_data*)_data;
+
+	while (true) {
+		int32 code;
+		ssize_t bytes = read_port(data->port, &code, data->buffer,
+			data->size);
+		if (bytes < 0 || code == 0)
+			break;
+	}
+
+	return B_OK;
+}
+
+
+static void
+run_test(size_t size, bool zeroCopy)
+{
+	test_data data;
+	data.port = create_port(16, "throughput test");
+	data.size = size;
+	data.buffer = (uint8*)malloc(size);
+
+	uint8* buffer = (uint8*)malloc(size);
+	if (data.port < 0 || data.buffer == NULL || buffer == NULL) {
+		fprintf(stderr, "Could not prepare test!\n");
+		exit(1);
+	}
+
+	memset(buffer, 0x42, size);
+	memset(data.buffer, 0, size);
+
+	thread_id reader = spawn_thread(&reader_thread, "port reader",
+		B_NORMAL_PRIORITY, &data);
+	resume_thread(reader);
+
+	uint32 flags = zeroCopy ? B_ZERO_COPY_PORT_MESSAGE : 0;
+	int64 messages = 0;
+	bigtime_t start = system_time();
+	bigtime_t duration;
+
+	do {
+		status_t status = write_port_etc(data.port, 1, buffer, size, flags, 0);
+		if (status != B_OK) {
+			fprintf(stderr, "Writing %zu bytes failed: %s\n", size,
+				strerror(status));
+			exit(1);
+		}
+
+		messages++;
+		duration = system_time() - start;
+	} while (duration < kTestDuration);
+
+	write_port(data.port, 0, NULL, 0);
+
+	status_t result;
+	wait_for_thread(reader, &result);
+
+	duration = system_time() - start;
+
+	if (data.buffer[size - 1] != 0x42) {
+		fprintf(stderr, "Received wrong message contents!\n");
+		exit(1);
+	}
+
+	printf("%8zu bytes %-9s %9" B_PRId64 " msgs/s %9.1f MB/s\n", size,
+		zeroCopy ? "zero-copy" : "copy", messages * 1000000 / duration,
+		1.0 * messages * size / duration);
+
+	delete_port(data.port);
+	free(data.buffer);
+	free(buffer);
+}
+
+
+/*!	Compares the port throughput of regular (copied) messages with the one
+	of messages sent with B_ZERO_COPY_PORT_MESSAGE, for various message sizes.
+	Messages larger than PORT_MAX_MESSAGE_SIZE are only tested in zero-copy
+	mode, as they are not supported otherwise.
+*/
+int
+main(int argc, char** argv)
+{
+	for (size_t size = 1024; size <= kMaxMessageSize; size *= 4) {
+		if (size <= 256 * 1024)
+			run_test(size, false);
+		run_test(size, true);
+	}
+
+	return 0;
+}
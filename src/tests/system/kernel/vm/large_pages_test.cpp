@@ -0,0 +1,113 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <OS.h>
+
+#include <syscalls.h>
+#include <vm_defs.h>
+
+
+static const size_t kAreaSize = 8 * 1024 * 1024;
+
+
+static size_t
+count_large_pages(area_id area)
+{
+	large_page_info info;
+	if (_kern_get_large_page_info(area, &info) != B_OK)
+		return 0;
+
+	return info.count;
+}
+
+
+static bool
+check_contents(const uint8* address, size_t size, const char* test)
+{
+	for (size_t i = 0; i < size; i += B_PAGE_SIZE) {
+		if (address[i] != (uint8)(i / B_PAGE_SIZE)) {
+			fprintf(stderr, "%s: wrong contents at offset %#zx!\n", test, i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*!	Creates an area with B_LARGE_PAGES_AREA, and makes sure that its contents
+	survive partially protecting and cutting it, which requires the large
+	pages to be split up again.
+*/
+int
+main(int argc, char** argv)
+{
+	large_page_info info;
+	if (_kern_get_large_page_info(-1, &info) != B_OK || info.page_size == 0) {
+		printf("large pages are not supported, skipping test.\n");
+		return 0;
+	}
+
+	uint8* address;
+	area_id area = create_area("large pages", (void**)&address, B_ANY_ADDRESS,
+		kAreaSize, B_NO_LOCK, B_READ_AREA | B_WRITE_AREA | B_LARGE_PAGES_AREA);
+	if (area < 0) {
+		fprintf(stderr, "Could not create area: %s\n", strerror(area));
+		return 1;
+	}
+
+	for (size_t i = 0; i < kAreaSize; i += B_PAGE_SIZE)
+		address[i] = (uint8)(i / B_PAGE_SIZE);
+
+	size_t largePages = count_large_pages(area);
+	printf("area uses %zu large pages of %zu bytes\n", largePages,
+		info.page_size);
+	if (largePages > kAreaSize / info.page_size) {
+		fprintf(stderr, "Too many large pages reported!\n");
+		return 1;
+	}
+
+	// protecting a single page must split up its large page
+	if (mprotect(address + B_PAGE_SIZE, B_PAGE_SIZE, PROT_READ) != 0) {
+		fprintf(stderr, "mprotect() failed: %s\n", strerror(errno));
+		return 1;
+	}
+	if (largePages == kAreaSize / info.page_size
+		&& count_large_pages(area) != largePages - 1) {
+		fprintf(stderr, "Large page was not split up!\n");
+		return 1;
+	}
+	if (!check_contents(address, kAreaSize, "mprotect"))
+		return 1;
+
+	// restoring the protection of the whole area may merge it again
+	if (set_area_protection(area, B_READ_AREA | B_WRITE_AREA) != B_OK) {
+		fprintf(stderr, "set_area_protection() failed!\n");
+		return 1;
+	}
+	if (!check_contents(address, kAreaSize, "set_area_protection"))
+		return 1;
+
+	// cut a hole into the area
+	if (munmap(address + info.page_size + B_PAGE_SIZE, B_PAGE_SIZE) != 0) {
+		fprintf(stderr, "munmap() failed: %s\n", strerror(errno));
+		return 1;
+	}
+	if (!check_contents(address, info.page_size + B_PAGE_SIZE, "munmap"))
+		return 1;
+
+	delete_area(area_for(address));
+	delete_area(area_for(address + kAreaSize - B_PAGE_SIZE));
+
+	printf("All tests passed!\n");
+	return 0;
+}
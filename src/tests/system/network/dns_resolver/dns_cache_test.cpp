@@ -0,0 +1,388 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Tests the cache of the DNS resolver server against a stand-in DNS server
+	on the loopback interface, which answers "*.test" names with records of
+	a short time to live, and "missing.test" with NXDOMAIN.
+	Lookups of names starting with "slow" are answered with a delay, so that
+	concurrent requests can be coalesced, or pile up.
+*/
+
+
+#include <arpa/inet.h>
+#include <arpa/nameser.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <resolv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#include "ResolverCache.h"
+
+
+static const int kTimeToLive = 1;
+static const bigtime_t kSlowDelay = 300000;
+static const int32 kConcurrentLookups = 8;
+
+static sockaddr_in sServerAddress;
+static int32 sQueryCount;
+static ResolverCache* sCache;
+static int sFailures;
+
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+				#condition); \
+			sFailures++; \
+		} \
+	} while (false)
+
+
+//	#pragma mark - stand-in DNS server
+
+
+static status_t
+stand_in_server(void* data)
+{
+	int fd = (int)(addr_t)data;
+
+	while (true) {
+		uint8 packet[512];
+		sockaddr_in client;
+		socklen_t clientLength = sizeof(client);
+		ssize_t length = recvfrom(fd, packet, sizeof(packet), 0,
+			(sockaddr*)&client, &clientLength);
+		if (length < NS_HFIXEDSZ)
+			break;
+
+		atomic_add(&sQueryCount, 1);
+
+		char name[NS_MAXDNAME];
+		int nameLength = dn_expand(packet, packet + length,
+			packet + NS_HFIXEDSZ, name, sizeof(name));
+		if (nameLength < 0)
+			continue;
+
+		uint8* end = packet + NS_HFIXEDSZ + nameLength + NS_QFIXEDSZ;
+		if (end > packet + length)
+			continue;
+
+		HEADER* header = (HEADER*)packet;
+		header->qr = 1;
+		header->aa = 1;
+		header->ra = 1;
+		header->ancount = 0;
+		header->nscount = 0;
+		header->arcount = 0;
+
+		uint16 type = ns_get16(packet + NS_HFIXEDSZ + nameLength);
+		if (!strcmp(name, "missing.test"))
+			header->rcode = NXDOMAIN;
+		else if (type == ns_t_a) {
+			if (!strncmp(name, "slow", 4))
+				snooze(kSlowDelay);
+
+			// a pointer to the name in the question
+			ns_put16(0xc000 | NS_HFIXEDSZ, end);
+			ns_put16(ns_t_a, end + 2);
+			ns_put16(ns_c_in, end + 4);
+			ns_put32(kTimeToLive, end + 6);
+			ns_put16(4, end + 10);
+			in_addr_t address = htonl(0x0a000001);
+			memcpy(end + 12, &address, 4);
+			end += 16;
+
+			header->ancount = htons(1);
+		}
+
+		sendto(fd, packet, end - packet, 0, (sockaddr*)&client,
+			clientLength);
+	}
+
+	return B_OK;
+}
+
+
+static status_t
+start_stand_in_server()
+{
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0)
+		return errno;
+
+	memset(&sServerAddress, 0, sizeof(sServerAddress));
+	sServerAddress.sin_len = sizeof(sockaddr_in);
+	sServerAddress.sin_family = AF_INET;
+	sServerAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	socklen_t length = sizeof(sServerAddress);
+	if (bind(fd, (sockaddr*)&sServerAddress, sizeof(sServerAddress)) != 0
+		|| getsockname(fd, (sockaddr*)&sServerAddress, &length) != 0)
+		return errno;
+
+	thread_id thread = spawn_thread(&stand_in_server, "stand-in DNS server",
+		B_NORMAL_PRIORITY, (void*)(addr_t)fd);
+	if (thread < 0)
+		return thread;
+
+	return resume_thread(thread);
+}
+
+
+/*!	Resolves \a node by asking the stand-in server only; this replaces
+	getaddrinfo() in the cache.
+*/
+static int
+stand_in_resolve(const char* node, const char* service,
+	const struct addrinfo* hints, struct addrinfo** _result, int* _ttl)
+{
+	struct __res_state state;
+	memset(&state, 0, sizeof(state));
+	if (res_ninit(&state) != 0)
+		return EAI_FAIL;
+
+	state.nsaddr_list[0] = sServerAddress;
+	state.nscount = 1;
+	state.retry = 1;
+	state.options &= ~(RES_DNSRCH | RES_DEFNAMES);
+
+	uint8 answer[512];
+	int length = res_nquery(&state, node, ns_c_in, ns_t_a, answer,
+		sizeof(answer));
+	res_nclose(&state);
+	if (length < 0)
+		return state.res_h_errno == HOST_NOT_FOUND ? EAI_NONAME : EAI_AGAIN;
+
+	ns_msg message;
+	ns_rr record;
+	if (ns_initparse(answer, length, &message) != 0
+		|| ns_parserr(&message, ns_s_an, 0, &record) != 0
+		|| ns_rr_type(record) != ns_t_a)
+		return EAI_NODATA;
+
+	char address[INET_ADDRSTRLEN];
+	inet_ntop(AF_INET, ns_rr_rdata(record), address, sizeof(address));
+
+	struct addrinfo numericHints = *hints;
+	numericHints.ai_flags |= AI_NUMERICHOST;
+	*_ttl = ns_rr_ttl(record);
+	return getaddrinfo(address, service, &numericHints, _result);
+}
+
+
+//	#pragma mark -
+
+
+/*!	Looks up \a node through the cache, and returns the status of the
+	answer.
+*/
+static status_t
+lookup(const char* node)
+{
+	port_id port = create_port(1, "reply");
+	if (port < 0)
+		return port;
+
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+
+	sCache->GetAddrInfo(node, NULL, &hints, port);
+
+	char buffer[1024];
+	int32 code;
+	ssize_t size = read_port(port, &code, buffer, sizeof(buffer));
+	delete_port(port);
+	if (size < 0)
+		return size;
+
+	if (code == MsgError)
+		return *(status_t*)buffer;
+
+	// the answer must be the address the stand-in server gave out
+	addrinfo* info = (addrinfo*)buffer;
+	sockaddr_in* address = (sockaddr_in*)(buffer + (addr_t)info->ai_addr);
+	if (info->ai_family != AF_INET
+		|| address->sin_addr.s_addr != htonl(0x0a000001))
+		return B_BAD_DATA;
+
+	return B_OK;
+}
+
+
+static status_t
+lookup_thread(void* data)
+{
+	return lookup((const char*)data);
+}
+
+
+static resolver_statistics
+statistics()
+{
+	resolver_statistics statistics;
+	sCache->GetStatistics(statistics);
+	return statistics;
+}
+
+
+static void
+test_positive()
+{
+	int32 queries = sQueryCount;
+	CHECK(lookup("host.test") == B_OK);
+	CHECK(lookup("host.test") == B_OK);
+	CHECK(lookup("HOST.test") == B_OK);
+	CHECK(sQueryCount == queries + 1);
+	CHECK(statistics().hits == 2);
+
+	// the answer expires with its time to live
+	snooze(kTimeToLive * 1000000LL + 200000);
+	CHECK(lookup("host.test") == B_OK);
+	CHECK(sQueryCount == queries + 2);
+}
+
+
+static void
+test_negative()
+{
+	int32 queries = sQueryCount;
+	CHECK(lookup("missing.test") == EAI_NONAME);
+	CHECK(lookup("missing.test") == EAI_NONAME);
+	CHECK(sQueryCount == queries + 1);
+	CHECK(statistics().negative_hits == 1);
+}
+
+
+static void
+test_coalescing()
+{
+	int32 queries = sQueryCount;
+	uint64 coalesced = statistics().coalesced;
+
+	thread_id threads[kConcurrentLookups];
+	for (int32 i = 0; i < kConcurrentLookups; i++) {
+		threads[i] = spawn_thread(&lookup_thread, "lookup", B_NORMAL_PRIORITY,
+			(void*)"slow.test");
+		resume_thread(threads[i]);
+	}
+
+	for (int32 i = 0; i < kConcurrentLookups; i++) {
+		status_t result;
+		wait_for_thread(threads[i], &result);
+		CHECK(result == B_OK);
+	}
+
+	// Depending on timing, some requests may even have been answered from
+	// the cache already; but there must not have been more than one query.
+	CHECK(sQueryCount == queries + 1);
+	CHECK(statistics().coalesced > coalesced);
+	CHECK(statistics().pending == 0);
+}
+
+
+/*!	Looks up more distinct slow names at once than a cache with a single
+	worker may queue; the surplus has to be rejected right away.
+*/
+static void
+test_bounded()
+{
+	static const char* const kNames[] = {
+		"slow1.test", "slow2.test", "slow3.test", "slow4.test", "slow5.test",
+		"slow6.test"
+	};
+	static const int32 kNameCount = sizeof(kNames) / sizeof(kNames[0]);
+
+	ResolverCache cache(&stand_in_resolve, 1, 2);
+	if (cache.Init() != B_OK) {
+		CHECK(!"Init() failed");
+		return;
+	}
+
+	ResolverCache* previousCache = sCache;
+	sCache = &cache;
+
+	thread_id threads[kNameCount];
+	for (int32 i = 0; i < kNameCount; i++) {
+		threads[i] = spawn_thread(&lookup_thread, "lookup", B_NORMAL_PRIORITY,
+			(void*)kNames[i]);
+		resume_thread(threads[i]);
+	}
+
+	int32 answered = 0;
+	int32 rejected = 0;
+	for (int32 i = 0; i < kNameCount; i++) {
+		status_t result;
+		wait_for_thread(threads[i], &result);
+		if (result == B_OK)
+			answered++;
+		else if (result == EAI_AGAIN)
+			rejected++;
+	}
+
+	// One lookup in progress, and two waiting for the worker
+	CHECK(answered >= 3);
+	CHECK(rejected > 0);
+	CHECK(answered + rejected == kNameCount);
+	CHECK(statistics().rejected == (uint64)rejected);
+	CHECK(statistics().pending == 0);
+
+	sCache = previousCache;
+}
+
+
+static void
+test_flush()
+{
+	CHECK(lookup("flushed.test") == B_OK);
+	CHECK(statistics().entries > 0);
+
+	sCache->Flush();
+	CHECK(statistics().entries == 0);
+
+	int32 queries = sQueryCount;
+	CHECK(lookup("flushed.test") == B_OK);
+	CHECK(sQueryCount == queries + 1);
+}
+
+
+int
+main()
+{
+	status_t status = start_stand_in_server();
+	if (status != B_OK) {
+		fprintf(stderr, "Could not start the stand-in DNS server: %s\n",
+			strerror(status));
+		return 1;
+	}
+
+	ResolverCache cache(&stand_in_resolve);
+	if (cache.Init() != B_OK)
+		return 1;
+	sCache = &cache;
+
+	test_positive();
+	test_negative();
+	test_coalescing();
+	test_bounded();
+	test_flush();
+
+	if (sFailures != 0) {
+		printf("%d checks failed.\n", sFailures);
+		return 1;
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
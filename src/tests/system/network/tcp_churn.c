@@ -0,0 +1,211 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Measures how many TCP connections per second can be established and
+	torn down over the loopback interface. A number of client threads
+	connect, and close their connection again as soon as it has been
+	accepted; the same number of threads accept them.
+	With "-r" every accepting thread gets its own listening socket, all of
+	them bound to the same port with SO_REUSEPORT, instead of sharing one.
+*/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define MAX_THREADS			64
+#define DEFAULT_THREADS		4
+#define DEFAULT_DURATION	5
+
+static struct sockaddr_in sAddress;
+static int sListenSockets[MAX_THREADS];
+static volatile int sQuit;
+static long sAccepted[MAX_THREADS];
+static long sFailed[MAX_THREADS];
+
+static void
+usage(void)
+{
+	printf("tcp_churn [-r] [-c <threads>] [-t <seconds>]\n");
+	exit(1);
+}
+
+static int
+create_listen_socket(int reusePort)
+{
+	int option = 1;
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
+	if (reusePort)
+		setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &option, sizeof(option));
+
+	if (bind(fd, (struct sockaddr *)&sAddress, sizeof(sAddress)) < 0
+		|| listen(fd, 128) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static void *
+acceptor(void *data)
+{
+	int index = (int)(long)data;
+
+	while (!sQuit) {
+		int fd = accept(sListenSockets[index], NULL, NULL);
+		if (fd < 0)
+			break;
+
+		close(fd);
+		sAccepted[index]++;
+	}
+
+	return NULL;
+}
+
+static void *
+connector(void *data)
+{
+	int index = (int)(long)data;
+
+	while (!sQuit) {
+		struct linger linger = { 1, 0 };
+		int fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0) {
+			sFailed[index]++;
+			continue;
+		}
+
+		// reset the connection on close, so that we do not run out of ports
+		// because of connections in TIME_WAIT
+		setsockopt(fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+
+		if (connect(fd, (struct sockaddr *)&sAddress, sizeof(sAddress)) < 0)
+			sFailed[index]++;
+
+		close(fd);
+	}
+
+	return NULL;
+}
+
+int
+main(int argc, char *argv[])
+{
+	pthread_t acceptors[MAX_THREADS];
+	pthread_t connectors[MAX_THREADS];
+	socklen_t addressLength = sizeof(sAddress);
+	int threads = DEFAULT_THREADS;
+	int duration = DEFAULT_DURATION;
+	int reusePort = 0;
+	long accepted = 0;
+	long failed = 0;
+	struct timeval before, after;
+	double elapsed;
+	int i, ch;
+
+	while ((ch = getopt(argc, argv, "c:rt:h")) != -1) {
+		switch (ch) {
+			case 'c':
+				threads = atoi(optarg);
+				break;
+			case 'r':
+				reusePort = 1;
+				break;
+			case 't':
+				duration = atoi(optarg);
+				break;
+			default:
+				usage();
+		}
+	}
+	if (threads < 1 || threads > MAX_THREADS || duration < 1)
+		usage();
+
+	memset(&sAddress, 0, sizeof(sAddress));
+	sAddress.sin_len = sizeof(struct sockaddr_in);
+	sAddress.sin_family = AF_INET;
+	sAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	sListenSockets[0] = create_listen_socket(reusePort);
+	if (sListenSockets[0] < 0
+		|| getsockname(sListenSockets[0], (struct sockaddr *)&sAddress,
+			&addressLength) < 0) {
+		perror("listen");
+		return 1;
+	}
+
+	for (i = 1; i < threads; i++) {
+		if (!reusePort) {
+			sListenSockets[i] = sListenSockets[0];
+			continue;
+		}
+
+		sListenSockets[i] = create_listen_socket(reusePort);
+		if (sListenSockets[i] < 0) {
+			perror("listen with SO_REUSEPORT");
+			return 1;
+		}
+	}
+
+	gettimeofday(&before, NULL);
+
+	for (i = 0; i < threads; i++) {
+		if (pthread_create(&acceptors[i], NULL, &acceptor, (void *)(long)i)
+				!= 0
+			|| pthread_create(&connectors[i], NULL, &connector,
+				(void *)(long)i) != 0) {
+			fprintf(stderr, "could not create threads\n");
+			return 1;
+		}
+	}
+
+	sleep(duration);
+	sQuit = 1;
+
+	for (i = 0; i < threads; i++)
+		pthread_join(connectors[i], NULL);
+
+	// wake up the acceptors
+	for (i = 0; i < threads; i++) {
+		if (i == 0 || reusePort)
+			shutdown(sListenSockets[i], SHUT_RDWR);
+	}
+	for (i = 0; i < threads; i++)
+		pthread_join(acceptors[i], NULL);
+
+	gettimeofday(&after, NULL);
+	elapsed = (after.tv_sec - before.tv_sec)
+		+ (after.tv_usec - before.tv_usec) / 1000000.0;
+
+	for (i = 0; i < threads; i++) {
+		accepted += sAccepted[i];
+		failed += sFailed[i];
+		if (i == 0 || reusePort)
+			close(sListenSockets[i]);
+	}
+
+	printf("%d threads%s: %ld connections in %.2f secs, %.0f accepts/s"
+		" (%ld failed)\n", threads, reusePort ? " (SO_REUSEPORT)" : "",
+		accepted, elapsed, accepted / elapsed, failed);
+
+	if (reusePort) {
+		for (i = 0; i < threads; i++)
+			printf("  listener %d: %ld\n", i, sAccepted[i]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "SackScoreboard.h"
+
+#include <stdio.h>
+
+
+SackScoreboard gScoreboard;
+
+
+void
+update(uint32 acknowledge, uint32 left = 0, uint32 right = 0)
+{
+	tcp_sack sack;
+	sack.left_edge = left;
+	sack.right_edge = right;
+	gScoreboard.Update(acknowledge, 10000, &sack, left != right ? 1 : 0);
+}
+
+
+void
+check_hole(uint32 from, uint32 start, uint32 length)
+{
+	tcp_sequence holeStart;
+	uint32 holeLength;
+	bool found = gScoreboard.NextHole(from, holeStart, holeLength);
+	ASSERT(found == (length != 0));
+	if (found)
+		ASSERT(holeStart == start && holeLength == length);
+}
+
+
+int
+main()
+{
+	update(1000, 2000, 3000);
+	update(1000, 4000, 5000);
+	update(1000, 3000, 3500);
+	ASSERT(gScoreboard.SackedBytes() == 2500);
+	ASSERT(gScoreboard.HighestSacked() == 5000);
+
+	check_hole(1000, 1000, 1000);
+	check_hole(2500, 3500, 500);
+	check_hole(5000, 0, 0);
+	ASSERT(gScoreboard.UnsackedBytes(1000, 5000) == 1500);
+
+	// duplicate and out of range SACKs are ignored
+	update(1000, 500, 900);
+	update(1000, 9000, 11000);
+	ASSERT(gScoreboard.SackedBytes() == 2500);
+
+	// filling the hole merges the blocks
+	update(1000, 3500, 4000);
+	ASSERT(gScoreboard.SackedBytes() == 3000);
+	check_hole(2000, 0, 0);
+
+	// everything acknowledged goes away
+	update(2500);
+	ASSERT(gScoreboard.SackedBytes() == 2500);
+	check_hole(2500, 0, 0);
+	update(5000);
+	ASSERT(gScoreboard.IsEmpty());
+
+	gScoreboard.Dump();
+	printf("all tests passed\n");
+	return 0;
+}
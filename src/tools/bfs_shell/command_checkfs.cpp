@@ -17,15 +17,28 @@ namespace FSShell {
 fssh_status_t
 command_checkfs(int argc, const char* const* argv)
 {
-	if (argc == 2 && !strcmp(argv[1], "--help")) {
-		fssh_dprintf("Usage: %s [-c]\n"
-			"  -c  Check only; don't perform any changes\n", argv[0]);
-		return B_OK;
-	}
-
 	bool checkOnly = false;
-	if (argc == 2 && !strcmp(argv[1], "-c"))
-		checkOnly = true;
+	uint32 threads = 0;
+	uint32 bitmapSize = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-c"))
+			checkOnly = true;
+		else if (!strcmp(argv[i], "-t") && i + 1 < argc
+			&& fssh_sscanf(argv[i + 1], "%" B_SCNu32, &threads) == 1)
+			i++;
+		else if (!strcmp(argv[i], "-m") && i + 1 < argc
+			&& fssh_sscanf(argv[i + 1], "%" B_SCNu32, &bitmapSize) == 1)
+			i++;
+		else {
+			fssh_dprintf("Usage: %s [-c] [-t <threads>] [-m <KB>]\n"
+				"  -c  Check only; don't perform any changes\n"
+				"  -t  Check the blocks of files with that many threads\n"
+				"  -m  Use at most that much memory for the block bitmap\n",
+				argv[0]);
+			return strcmp(argv[i], "--help") ? B_BAD_VALUE : B_OK;
+		}
+	}
 
 	int rootDir = _kern_open_dir(-1, "/myfs");
 	if (rootDir < 0)
@@ -35,6 +48,8 @@ command_checkfs(int argc, const char* const* argv)
 	memset(&result, 0, sizeof(result));
 	result.magic = BFS_IOCTL_CHECK_MAGIC;
 	result.flags = 0;
+	result.threads = threads;
+	result.max_bitmap_size = bitmapSize * 1024;
 	if (!checkOnly) {
 		result.flags |= BFS_FIX_BITMAP_ERRORS | BFS_REMOVE_WRONG_TYPES
 			| BFS_REMOVE_INVALID | BFS_FIX_NAME_MISMATCHES | BFS_FIX_BPLUSTREES;
@@ -54,6 +69,20 @@ command_checkfs(int argc, const char* const* argv)
 	// check all files and report errors
 	while (_kern_ioctl(rootDir, BFS_IOCTL_CHECK_NEXT_NODE, &result,
 			sizeof(result)) == B_OK) {
+		if (result.pass == BFS_CHECK_PASS_BITMAP_WINDOW) {
+			// all nodes are visited again for each further window of the
+			// block bitmap, but they have been counted already
+			if (previousPass != result.pass) {
+				fssh_dprintf("Checking further allocation groups...\n");
+				previousPass = result.pass;
+			}
+			if (result.errors) {
+				fssh_dprintf("%s (inode = %" FSSH_B_PRIdINO "), has blocks "
+					"already set\n", result.name, result.inode);
+			}
+			continue;
+		}
+
 		if (++counter % 50 == 0) {
 			fssh_dprintf("%9" FSSH_B_PRIu64 " nodes processed\x1b[1A\n",
 				counter);
@@ -130,6 +159,9 @@ command_checkfs(int argc, const char* const* argv)
 		result.stats.double_indirect_block_runs,
 		result.stats.double_indirect_array_blocks,
 		result.stats.blocks_in_double_indirect * result.stats.block_size);
+	fssh_dprintf("\tfile fragments\t\t\t%" FSSH_B_PRIu64 " (%" FSSH_B_PRIu64
+		" files fragmented)\n", result.stats.file_fragments,
+		result.stats.fragmented_files);
 
 	if (result.status == B_ENTRY_NOT_FOUND)
 		result.status = B_OK;
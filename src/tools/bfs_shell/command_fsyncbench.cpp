@@ -0,0 +1,128 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "fssh_stdio.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+
+
+namespace FSShell {
+
+
+static const uint32 kMaxWriters = 64;
+
+
+struct bench_writer {
+	char	path[64];
+	int		fd;
+};
+
+
+static void
+close_writers(bench_writer* writers, uint32 count)
+{
+	for (uint32 i = 0; i < count; i++) {
+		if (writers[i].fd < 0)
+			continue;
+
+		_kern_close(writers[i].fd);
+		_kern_unlink(-1, writers[i].path);
+	}
+}
+
+
+/*!	Lets several writers append to files of their own, and sync them after
+	every write, so that each fsync() has to commit the journal.
+	bfs_shell cannot spawn threads, so the writers take turns: in each
+	round, all of them write first, and then all of them call fsync(). With
+	group commit, the first fsync() of a round writes the changes of all
+	writers to the log, and the others find theirs on disk already.
+*/
+fssh_status_t
+command_fsyncbench(int argc, const char* const* argv)
+{
+	uint32 writerCount = 4;
+	uint32 count = 1000;
+	uint32 size = 4096;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-w") && i + 1 < argc
+			&& fssh_sscanf(argv[i + 1], "%" B_SCNu32, &writerCount) == 1)
+			i++;
+		else if (!strcmp(argv[i], "-n") && i + 1 < argc
+			&& fssh_sscanf(argv[i + 1], "%" B_SCNu32, &count) == 1)
+			i++;
+		else if (!strcmp(argv[i], "-s") && i + 1 < argc
+			&& fssh_sscanf(argv[i + 1], "%" B_SCNu32, &size) == 1)
+			i++;
+		else {
+			fssh_dprintf("Usage: %s [-w <writers>] [-n <count>] [-s <size>]\n"
+				"  -w  Number of files written in turns (default 4)\n"
+				"  -n  Number of fsyncs per file (default 1000)\n"
+				"  -s  Bytes written before each fsync (default 4096)\n",
+				argv[0]);
+			return strcmp(argv[i], "--help") ? B_BAD_VALUE : B_OK;
+		}
+	}
+
+	if (writerCount == 0 || writerCount > kMaxWriters || count == 0
+		|| size == 0) {
+		fssh_dprintf("Invalid argument\n");
+		return B_BAD_VALUE;
+	}
+
+	uint8* buffer = (uint8*)malloc(size);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+
+	bench_writer writers[kMaxWriters];
+	fssh_status_t status = B_OK;
+
+	for (uint32 i = 0; i < writerCount; i++) {
+		fssh_snprintf(writers[i].path, sizeof(writers[i].path),
+			"/myfs/fsyncbench.%" B_PRIu32, i);
+		writers[i].fd = _kern_open(-1, writers[i].path,
+			FSSH_O_RDWR | FSSH_O_CREAT | FSSH_O_TRUNC, 0644);
+		if (writers[i].fd < 0 && status == B_OK)
+			status = writers[i].fd;
+	}
+
+	fssh_bigtime_t start = fssh_system_time();
+
+	for (uint32 round = 0; round < count && status == B_OK; round++) {
+		for (uint32 i = 0; i < writerCount && status == B_OK; i++) {
+			memset(buffer, i + round, size);
+
+			fssh_ssize_t bytesWritten = _kern_write(writers[i].fd,
+				(fssh_off_t)round * size, buffer, size);
+			if (bytesWritten < 0)
+				status = bytesWritten;
+		}
+
+		for (uint32 i = 0; i < writerCount && status == B_OK; i++)
+			status = _kern_fsync(writers[i].fd);
+	}
+
+	fssh_bigtime_t elapsed = fssh_system_time() - start;
+
+	close_writers(writers, writerCount);
+	free(buffer);
+
+	if (status != B_OK) {
+		fssh_dprintf("Benchmark failed: %s\n", fssh_strerror(status));
+		return status;
+	}
+
+	uint64 total = (uint64)writerCount * count;
+	fssh_dprintf("%" B_PRIu64 " fsyncs of %" B_PRIu32 " bytes from %" B_PRIu32
+		" writers in %" B_PRId64 " usecs: %.1f fsyncs/s\n", total, size,
+		writerCount, elapsed, elapsed > 0 ? total * 1000000.0 / elapsed : 0.0);
+	return B_OK;
+}
+
+
+}	// namespace FSShell